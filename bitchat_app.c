@@ -13,18 +13,69 @@
 #include "ui/chat_view.h"
 #include "ui/nickname_view.h"
 #include "ui/message_input_view.h"
+#include "ui/search_view.h"
+#include "ui/peer_list_view.h"
+#include "ui/diagnostics_view.h"
 #include "ble/bitchat_ble.h"
 #include "protocol/bitchat_protocol.h"
+#include "crypto/noise_protocol.h"
+#include "storage/bitchat_transfer.h"
+#include "storage/bitchat_history.h"
+#include "storage/bitchat_writer.h"
+#include "storage/bitchat_capture.h"
+#include "storage/bitchat_compactor.h"
+#include "storage/bitchat_search.h"
+#include "storage/bitchat_peers.h"
+#include "storage/bitchat_conversations.h"
+#include "utils/bitchat_names.h"
+#include "utils/bitchat_metrics.h"
+#include "utils/bitchat_log.h"
+#include "utils/bitchat_heap.h"
 
 #define TAG "BitChat"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_APP
+// Identity creation runs Ed25519 key expansion and X25519 on this stack
+#define STARTUP_STACK_SIZE 6144
+// Cold start budgets, from entry to the loading screen and to a usable chat
+#define STARTUP_FIRST_FRAME_TARGET_MS 100
+#define STARTUP_USABLE_TARGET_MS 1500
+// Incoming events are drained this often
+#define EVENT_TICK_MS 100
 
 // View IDs
 typedef enum {
     BitchatViewChat,
     BitchatViewNickname,
     BitchatViewMessageInput,
+    BitchatViewSearchInput,
+    BitchatViewSearchResults,
+    BitchatViewPeerList,
+    BitchatViewDiagnostics,
 } BitchatViewId;
 
+// Custom events
+typedef enum {
+    BitchatCustomEventStartupDone,
+} BitchatCustomEvent;
+
+// Startup stages, run in order on the startup thread
+typedef enum {
+    BitchatStartupStageIdentity,
+    BitchatStartupStageCrypto,
+    BitchatStartupStagePeers,
+    BitchatStartupStageHistory,
+    BitchatStartupStageServices,
+    BitchatStartupStageCount,
+} BitchatStartupStage;
+
+static const char* const bitchat_startup_stage_names[BitchatStartupStageCount] = {
+    "identity",
+    "crypto",
+    "peers",
+    "history",
+    "services",
+};
+
 struct BitchatApp {
     Gui* gui;
     NotificationApp* notifications;
@@ -34,21 +85,77 @@ struct BitchatApp {
     ChatView* chat_view;
     NicknameView* nickname_view;
     MessageInputView* message_input_view;
+    MessageInputView* search_input_view;
+    SearchView* search_view;
+    PeerListView* peer_list_view;
+    DiagnosticsView* diagnostics_view;
+    BitchatNames* names; // Sender names interned by the chat and search views
 
     // Backend
     BitchatIdentity* identity;
+    BitchatNoise* noise;
     BitchatBle* ble;
+    BitchatWriter* writer;
+    BitchatCapture* capture; // Raw frames to SD, toggled from diagnostics
+    BitchatTransfer* transfer;
+    BitchatHistory* history;
+    BitchatCompactor* compactor;
+    BitchatSearch* search;
+    BitchatPeers* peers;
+    BitchatConversations* conversations;
     FuriMessageQueue* event_queue;
 
+    // Startup
+    FuriThread* startup_thread;
+    uint32_t start_tick;
+    uint32_t first_frame_ms;
+    uint32_t stage_ms[BitchatStartupStageCount];
+    uint32_t usable_ms;
+
     // State
     bool is_running;
 };
 
 // Forward declarations
 static bool bitchat_app_back_event_callback(void* context);
+static bool bitchat_app_custom_event_callback(void* context, uint32_t event);
 static void bitchat_app_chat_callback(void* context, uint32_t index);
 static void bitchat_app_nickname_callback(void* context, const char* nickname);
 static void bitchat_app_message_callback(void* context, const char* message);
+static void bitchat_app_search_callback(void* context, const char* query);
+static void bitchat_app_peer_list_callback(void* context, const char* peer);
+static void bitchat_app_tick_event_callback(void* context);
+
+/**
+ * Noise resume store: sessions come back from the peer directory
+ */
+static bool bitchat_app_resume_load(
+    void* context,
+    const uint8_t* peer_id,
+    BitchatNoiseResumeState* state) {
+    BitchatApp* app = context;
+    BitchatPeerEntry entry;
+
+    bool found = bitchat_peers_get(app->peers, peer_id, &entry) &&
+                 (entry.flags & BITCHAT_PEER_FLAG_RESUMABLE);
+    if(found) {
+        memcpy(state->remote_static, entry.remote_static, sizeof(state->remote_static));
+        memcpy(state->resume_secret, entry.resume_secret, sizeof(state->resume_secret));
+    }
+    memset(&entry, 0, sizeof(entry));
+    return found;
+}
+
+/**
+ * Noise resume store: every new session key goes to the peer directory
+ */
+static void bitchat_app_resume_save(
+    void* context,
+    const uint8_t* peer_id,
+    const BitchatNoiseResumeState* state) {
+    BitchatApp* app = context;
+    bitchat_peers_record_session(app->peers, peer_id, state->remote_static, state->resume_secret);
+}
 
 /**
  * Back button handler
@@ -70,15 +177,92 @@ static bool bitchat_app_back_event_callback(void* context) {
 }
 
 /**
- * Chat view callback - handles opening message input
+ * Persist a message, index it under its conversation, and show it if that
+ * conversation is on screen
+ * @param sender Author, or the other party for a private message
+ * @param flags BITCHAT_HISTORY_FLAG_*
+ */
+static void bitchat_app_store_message(
+    BitchatApp* app,
+    const char* sender,
+    const char* content,
+    uint8_t flags,
+    uint32_t timestamp) {
+    BitchatHistoryRecord record;
+    if(bitchat_history_append(app->history, sender, content, flags, timestamp, &record.seq)) {
+        // The index only needs the header, as stored
+        record.flags = flags;
+        record.timestamp = timestamp;
+        strncpy(record.sender, sender, sizeof(record.sender) - 1);
+        record.sender[sizeof(record.sender) - 1] = '\0';
+        record.content[0] = '\0';
+        bitchat_conversations_record(app->conversations, &record);
+        chat_view_add_stored_message(app->chat_view, record.seq, sender, content, flags);
+    } else if(!(flags & BITCHAT_HISTORY_FLAG_PRIVATE)) {
+        chat_view_add_message(app->chat_view, sender, content, flags & BITCHAT_HISTORY_FLAG_OWN);
+    }
+}
+
+/**
+ * Rebuild the peer list: conversations first, then peers in range without one
+ */
+static void bitchat_app_update_peer_list(BitchatApp* app) {
+    PeerListEntry entries[PEER_LIST_MAX_ENTRIES];
+    BitchatBlePeer peers[BITCHAT_BLE_MAX_PEERS];
+    bool listed[BITCHAT_BLE_MAX_PEERS] = {false};
+    size_t peer_count = bitchat_ble_get_peers(app->ble, peers, BITCHAT_BLE_MAX_PEERS);
+    size_t count = 0;
+
+    size_t conversation_count = bitchat_conversations_count(app->conversations);
+    for(size_t i = 0; i < conversation_count && count < PEER_LIST_MAX_ENTRIES; i++) {
+        BitchatConversationInfo info;
+        if(!bitchat_conversations_get_info(app->conversations, i, &info)) break;
+
+        PeerListEntry* entry = &entries[count++];
+        strncpy(entry->peer, info.peer, sizeof(entry->peer) - 1);
+        entry->peer[sizeof(entry->peer) - 1] = '\0';
+        entry->unread = info.unread;
+        entry->connected = false;
+        for(size_t j = 0; j < peer_count; j++) {
+            if(info.peer[0] != '\0' && strcmp(peers[j].nickname, info.peer) == 0) {
+                entry->connected = peers[j].connected;
+                listed[j] = true;
+            }
+        }
+    }
+
+    for(size_t j = 0; j < peer_count && count < PEER_LIST_MAX_ENTRIES; j++) {
+        if(listed[j] || peers[j].nickname[0] == '\0') continue;
+        PeerListEntry* entry = &entries[count++];
+        strncpy(entry->peer, peers[j].nickname, sizeof(entry->peer) - 1);
+        entry->peer[sizeof(entry->peer) - 1] = '\0';
+        entry->unread = 0;
+        entry->connected = peers[j].connected;
+    }
+
+    peer_list_view_set_entries(app->peer_list_view, entries, count);
+    chat_view_set_peer_count(app->chat_view, peer_count);
+}
+
+/**
+ * Chat view callback - handles opening message or search input, the peer list or diagnostics
  */
 static void bitchat_app_chat_callback(void* context, uint32_t index) {
-    UNUSED(index);
     BitchatApp* app = context;
 
-    // Open message input
-    message_input_view_reset(app->message_input_view);
-    view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewMessageInput);
+    if(index == ChatViewEventDiagnostics) {
+        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewDiagnostics);
+    } else if(index == ChatViewEventPeers) {
+        bitchat_app_update_peer_list(app);
+        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewPeerList);
+    } else if(index == ChatViewEventSearch) {
+        message_input_view_reset(app->search_input_view);
+        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewSearchInput);
+    } else {
+        // Open message input
+        message_input_view_reset(app->message_input_view);
+        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewMessageInput);
+    }
 }
 
 /**
@@ -87,11 +271,11 @@ static void bitchat_app_chat_callback(void* context, uint32_t index) {
 static void bitchat_app_nickname_callback(void* context, const char* nickname) {
     BitchatApp* app = context;
 
-    FURI_LOG_I(TAG, "Nickname set to: %s", nickname);
+    BITCHAT_LOG_I(TAG, "Nickname set to: %s", nickname);
 
     // Update identity
     bitchat_identity_set_nickname(app->identity, nickname);
-    bitchat_identity_save(app->identity);
+    bitchat_identity_save_async(app->identity, app->writer);
 
     // Update chat view
     chat_view_set_nickname(app->chat_view, nickname);
@@ -119,14 +303,27 @@ static void bitchat_app_nickname_callback(void* context, const char* nickname) {
 static void bitchat_app_message_callback(void* context, const char* message) {
     BitchatApp* app = context;
 
-    FURI_LOG_I(TAG, "Sending message: %s", message);
+    BITCHAT_LOG_I(TAG, "Sending message: %s", message);
 
     // Get nickname
     char nickname[32];
     bitchat_identity_get_nickname(app->identity, nickname, sizeof(nickname));
 
-    // Add to chat view
-    chat_view_add_message(app->chat_view, nickname, message, true);
+    // Persist into the conversation on screen, then add to chat view
+    BitchatConversationInfo info;
+    bitchat_conversations_get_info(
+        app->conversations, bitchat_conversations_get_active(app->conversations), &info);
+    uint32_t timestamp = bitchat_get_timestamp_ms() / 1000;
+    if(info.peer[0] != '\0') {
+        bitchat_app_store_message(
+            app,
+            info.peer,
+            message,
+            BITCHAT_HISTORY_FLAG_OWN | BITCHAT_HISTORY_FLAG_PRIVATE,
+            timestamp);
+    } else {
+        bitchat_app_store_message(app, nickname, message, BITCHAT_HISTORY_FLAG_OWN, timestamp);
+    }
 
     // TODO: Encode and send via BLE
     // For now, just show in UI
@@ -139,44 +336,256 @@ static void bitchat_app_message_callback(void* context, const char* message) {
 }
 
 /**
- * Allocate app
+ * Search input callback
  */
-static BitchatApp* bitchat_app_alloc() {
-    BitchatApp* app = malloc(sizeof(BitchatApp));
-    memset(app, 0, sizeof(BitchatApp));
+static void bitchat_app_search_callback(void* context, const char* query) {
+    BitchatApp* app = context;
 
-    // Initialize GUI
-    app->gui = furi_record_open(RECORD_GUI);
-    app->notifications = furi_record_open(RECORD_NOTIFICATION);
+    search_view_start(app->search_view, query);
+    view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewSearchResults);
+}
 
-    // Create event queue
-    app->event_queue = furi_message_queue_alloc(8, sizeof(BitchatEvent));
+/**
+ * Peer list callback - opens the public room or a private thread
+ */
+static void bitchat_app_peer_list_callback(void* context, const char* peer) {
+    BitchatApp* app = context;
+
+    // Only the thread's newest page is read, by record number
+    size_t index = bitchat_conversations_open(app->conversations, peer);
+    bitchat_conversations_set_active(app->conversations, index);
+    uint32_t seqs[BITCHAT_CONVERSATION_RECENT];
+    size_t count = bitchat_conversations_get_recent(app->conversations, index, seqs);
+    chat_view_set_conversation(app->chat_view, peer, seqs, count);
+
+    view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewChat);
+}
+
+/**
+ * Tick handler - drains incoming messages and peer changes, runs searches and
+ * re-announces us, once started
+ */
+static void bitchat_app_tick_event_callback(void* context) {
+    BitchatApp* app = context;
+    if(app->startup_thread || !app->history) return;
+
+    uint32_t depth = furi_message_queue_get_count(app->event_queue);
+    bitchat_metrics_set(BitchatGaugeEventQueueDepth, depth);
+    bitchat_metrics_set_max(BitchatGaugeEventQueuePeak, depth);
+    bitchat_metrics_sample_heap();
+
+    BitchatEvent event;
+    bool peers_changed = false;
+    while(furi_message_queue_get(app->event_queue, &event, 0) == FuriStatusOk) {
+        switch(event.type) {
+            case BitchatEventTypeMessage:
+                bitchat_app_store_message(
+                    app,
+                    event.data.message.sender,
+                    event.data.message.content,
+                    event.data.message.is_private ? BITCHAT_HISTORY_FLAG_PRIVATE : 0,
+                    event.data.message.timestamp);
+                peers_changed = true;
+                break;
+
+            case BitchatEventTypePeerConnected:
+            case BitchatEventTypePeerDisconnected:
+                peers_changed = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if(peers_changed &&
+       view_dispatcher_get_current_view(app->view_dispatcher) == BitchatViewPeerList) {
+        bitchat_app_update_peer_list(app);
+    }
+
+    // Searches run a segment per tick so the results screen keeps drawing
+    search_view_tick(app->search_view);
+
+    bitchat_ble_tick(app->ble);
+}
+
+static uint32_t bitchat_app_elapsed_ms(uint32_t since) {
+    return (furi_get_tick() - since) * 1000 / furi_kernel_get_tick_frequency();
+}
+
+/**
+ * Record a finished startup stage and show the next one on the loading screen
+ * @return Tick the next stage starts at
+ */
+static uint32_t
+    bitchat_app_startup_stage_done(BitchatApp* app, BitchatStartupStage stage, uint32_t start) {
+    app->stage_ms[stage] = bitchat_app_elapsed_ms(start);
+    BITCHAT_LOG_I(TAG, "Startup %s: %lu ms", bitchat_startup_stage_names[stage], app->stage_ms[stage]);
+
+    if(stage + 1 < BitchatStartupStageCount) {
+        chat_view_set_loading(app->chat_view, bitchat_startup_stage_names[stage + 1]);
+    }
+    return furi_get_tick();
+}
+
+/**
+ * Startup thread: bring up storage, crypto and services behind the loading screen
+ */
+static int32_t bitchat_app_startup_thread(void* context) {
+    BitchatApp* app = context;
+    uint32_t start = furi_get_tick();
+
+    // Start the storage writer before anything that writes through it
+    app->writer = bitchat_writer_alloc();
 
     // Load or create identity
     app->identity = bitchat_identity_load();
     if(!app->identity) {
-        FURI_LOG_I(TAG, "Creating new identity");
+        BITCHAT_LOG_I(TAG, "Creating new identity");
         app->identity = bitchat_identity_create();
-        bitchat_identity_save(app->identity);
+        if(!bitchat_identity_save_async(app->identity, app->writer)) {
+            bitchat_identity_save(app->identity);
+        }
     }
-
-    // Initialize BLE
+    start = bitchat_app_startup_stage_done(app, BitchatStartupStageIdentity, start);
+
+    // Initialize Noise sessions, resuming stored ones
+    app->noise = bitchat_noise_alloc(
+        bitchat_identity_get_peer_id(app->identity),
+        bitchat_identity_get_noise_private_key(app->identity));
+    start = bitchat_app_startup_stage_done(app, BitchatStartupStageCrypto, start);
+
+    // Known peers are looked up on demand, not loaded
+    app->peers = bitchat_peers_alloc(app->writer);
+    bitchat_noise_set_resume_store(
+        app->noise, bitchat_app_resume_load, bitchat_app_resume_save, app);
+    start = bitchat_app_startup_stage_done(app, BitchatStartupStagePeers, start);
+
+    // Open message history, index its newest records by conversation and
+    // page the public room's tail into the chat view
+    app->history = bitchat_history_open(app->writer);
+    app->conversations = bitchat_conversations_alloc();
+    bitchat_conversations_load(app->conversations, app->history);
+    chat_view_set_history(app->chat_view, app->history);
+    start = bitchat_app_startup_stage_done(app, BitchatStartupStageHistory, start);
+
+    // Initialize BLE, bulk transfers and history services
     app->ble = bitchat_ble_alloc(app->event_queue);
+    bitchat_ble_set_peer_directory(app->ble, app->peers);
+    app->capture = bitchat_capture_alloc(app->writer);
+    bitchat_ble_set_capture(app->ble, app->capture);
+    diagnostics_view_set_ble(app->diagnostics_view, app->ble);
+    diagnostics_view_set_capture(app->diagnostics_view, app->capture);
+    app->transfer = bitchat_transfer_alloc(
+        app->ble, app->writer, bitchat_identity_get_peer_id(app->identity));
+    app->compactor = bitchat_compactor_alloc(app->history, app->writer, NULL);
+    app->search = bitchat_search_alloc(app->history);
+    bitchat_app_startup_stage_done(app, BitchatStartupStageServices, start);
+
+    view_dispatcher_send_custom_event(app->view_dispatcher, BitchatCustomEventStartupDone);
+    return 0;
+}
+
+/**
+ * Finish startup on the UI thread once the backend is up
+ */
+static void bitchat_app_startup_finish(BitchatApp* app) {
+    furi_thread_join(app->startup_thread);
+    furi_thread_free(app->startup_thread);
+    app->startup_thread = NULL;
+
+    search_view_set_search(app->search_view, app->search);
+    chat_view_set_loading(app->chat_view, NULL);
+
+    // Check if we need nickname setup
+    char nickname[32];
+    if(!bitchat_identity_get_nickname(app->identity, nickname, sizeof(nickname))) {
+        // First time setup - show nickname view
+        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewNickname);
+    } else {
+        // Start BLE and stay in chat
+        chat_view_set_nickname(app->chat_view, nickname);
+        bitchat_ble_start(app->ble, app->identity);
+        chat_view_set_connected(app->chat_view, bitchat_ble_is_active(app->ble));
+
+        // Add system message
+        chat_view_add_message(app->chat_view, "System", "BitChat started. Looking for peers...", false);
+    }
+
+    app->usable_ms = bitchat_app_elapsed_ms(app->start_tick);
+    if(app->usable_ms > STARTUP_USABLE_TARGET_MS) {
+        BITCHAT_LOG_W(
+            TAG, "Startup: usable after %lu ms (target %d ms)", app->usable_ms, STARTUP_USABLE_TARGET_MS);
+    } else {
+        BITCHAT_LOG_I(TAG, "Startup: usable after %lu ms", app->usable_ms);
+    }
+}
+
+/**
+ * Custom event handler
+ */
+static bool bitchat_app_custom_event_callback(void* context, uint32_t event) {
+    BitchatApp* app = context;
+
+    if(event == BitchatCustomEventStartupDone) {
+        bitchat_app_startup_finish(app);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Allocate app
+ * Only the UI is set up here; the backend comes up on the startup thread
+ * while the chat view shows what is loading.
+ * @param start_tick Tick the app was entered at
+ */
+static BitchatApp* bitchat_app_alloc(uint32_t start_tick) {
+    BitchatApp* app = bitchat_heap_alloc(BitchatHeapTagApp, sizeof(BitchatApp));
+    memset(app, 0, sizeof(BitchatApp));
+    app->start_tick = start_tick;
+
+    // Initialize GUI
+    app->gui = furi_record_open(RECORD_GUI);
+    app->notifications = furi_record_open(RECORD_NOTIFICATION);
+
+    // Create event queue
+    app->event_queue = furi_message_queue_alloc(8, sizeof(BitchatEvent));
 
     // Initialize view dispatcher
     app->view_dispatcher = view_dispatcher_alloc();
     view_dispatcher_attach_to_gui(app->view_dispatcher, app->gui, ViewDispatcherTypeFullscreen);
     view_dispatcher_set_event_callback_context(app->view_dispatcher, app);
-    view_dispatcher_set_custom_event_callback(app->view_dispatcher, bitchat_app_back_event_callback);
+    view_dispatcher_set_custom_event_callback(app->view_dispatcher, bitchat_app_custom_event_callback);
     view_dispatcher_set_navigation_event_callback(app->view_dispatcher, bitchat_app_back_event_callback);
+    view_dispatcher_set_tick_event_callback(
+        app->view_dispatcher, bitchat_app_tick_event_callback, furi_ms_to_ticks(EVENT_TICK_MS));
 
-    // Initialize views
-    app->chat_view = chat_view_alloc();
+    // Chat view first, so the loading screen is up as early as possible
+    app->names = bitchat_names_alloc();
+    app->chat_view = chat_view_alloc(app->names);
     chat_view_set_callback(app->chat_view, bitchat_app_chat_callback, app);
+    chat_view_set_loading(app->chat_view, bitchat_startup_stage_names[0]);
     view_dispatcher_add_view(
         app->view_dispatcher,
         BitchatViewChat,
         chat_view_get_view(app->chat_view));
+    view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewChat);
+
+    app->first_frame_ms = bitchat_app_elapsed_ms(app->start_tick);
+    if(app->first_frame_ms > STARTUP_FIRST_FRAME_TARGET_MS) {
+        BITCHAT_LOG_W(
+            TAG,
+            "Startup: first frame after %lu ms (target %d ms)",
+            app->first_frame_ms,
+            STARTUP_FIRST_FRAME_TARGET_MS);
+    } else {
+        BITCHAT_LOG_I(TAG, "Startup: first frame after %lu ms", app->first_frame_ms);
+    }
+
+    app->startup_thread = furi_thread_alloc_ex(
+        "BitchatStartup", STARTUP_STACK_SIZE, bitchat_app_startup_thread, app);
+    furi_thread_start(app->startup_thread);
 
     app->nickname_view = nickname_view_alloc();
     nickname_view_set_callback(app->nickname_view, bitchat_app_nickname_callback, app);
@@ -192,22 +601,32 @@ static BitchatApp* bitchat_app_alloc() {
         BitchatViewMessageInput,
         message_input_view_get_view(app->message_input_view));
 
-    // Check if we need nickname setup
-    char nickname[32];
-    if(!bitchat_identity_get_nickname(app->identity, nickname, sizeof(nickname))) {
-        // First time setup - show nickname view
-        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewNickname);
-    } else {
-        // Start BLE and go to chat
-        chat_view_set_nickname(app->chat_view, nickname);
-        bitchat_ble_start(app->ble, app->identity);
-        chat_view_set_connected(app->chat_view, bitchat_ble_is_active(app->ble));
+    app->search_input_view = message_input_view_alloc();
+    message_input_view_set_header_text(app->search_input_view, "Search messages:");
+    message_input_view_set_callback(app->search_input_view, bitchat_app_search_callback, app);
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        BitchatViewSearchInput,
+        message_input_view_get_view(app->search_input_view));
 
-        // Add system message
-        chat_view_add_message(app->chat_view, "System", "BitChat started. Looking for peers...", false);
+    app->search_view = search_view_alloc(app->names);
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        BitchatViewSearchResults,
+        search_view_get_view(app->search_view));
 
-        view_dispatcher_switch_to_view(app->view_dispatcher, BitchatViewChat);
-    }
+    app->peer_list_view = peer_list_view_alloc();
+    peer_list_view_set_callback(app->peer_list_view, bitchat_app_peer_list_callback, app);
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        BitchatViewPeerList,
+        peer_list_view_get_view(app->peer_list_view));
+
+    app->diagnostics_view = diagnostics_view_alloc();
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        BitchatViewDiagnostics,
+        diagnostics_view_get_view(app->diagnostics_view));
 
     return app;
 }
@@ -218,11 +637,37 @@ static BitchatApp* bitchat_app_alloc() {
 static void bitchat_app_free(BitchatApp* app) {
     furi_assert(app);
 
+    // Exited while still loading: let the backend finish coming up first
+    if(app->startup_thread) {
+        furi_thread_join(app->startup_thread);
+        furi_thread_free(app->startup_thread);
+    }
+
+    // Stop compaction before anything it uses goes away
+    if(app->compactor) {
+        bitchat_compactor_free(app->compactor);
+    }
+
+    // Abandon bulk transfers
+    if(app->transfer) {
+        bitchat_transfer_free(app->transfer);
+    }
+
     // Stop BLE
     if(app->ble) {
         bitchat_ble_free(app->ble);
     }
 
+    // Stop capturing once no more frames can arrive
+    if(app->capture) {
+        bitchat_capture_free(app->capture);
+    }
+
+    // Free Noise sessions
+    if(app->noise) {
+        bitchat_noise_free(app->noise);
+    }
+
     // Free identity
     if(app->identity) {
         bitchat_identity_free(app->identity);
@@ -232,14 +677,62 @@ static void bitchat_app_free(BitchatApp* app) {
     view_dispatcher_remove_view(app->view_dispatcher, BitchatViewChat);
     view_dispatcher_remove_view(app->view_dispatcher, BitchatViewNickname);
     view_dispatcher_remove_view(app->view_dispatcher, BitchatViewMessageInput);
+    view_dispatcher_remove_view(app->view_dispatcher, BitchatViewSearchInput);
+    view_dispatcher_remove_view(app->view_dispatcher, BitchatViewSearchResults);
+    view_dispatcher_remove_view(app->view_dispatcher, BitchatViewPeerList);
+    view_dispatcher_remove_view(app->view_dispatcher, BitchatViewDiagnostics);
 
     chat_view_free(app->chat_view);
     nickname_view_free(app->nickname_view);
     message_input_view_free(app->message_input_view);
+    message_input_view_free(app->search_input_view);
+    search_view_free(app->search_view);
+    peer_list_view_free(app->peer_list_view);
+    diagnostics_view_free(app->diagnostics_view);
+    bitchat_names_free(app->names);
 
     // Free dispatcher
     view_dispatcher_free(app->view_dispatcher);
 
+    // Close history after the views and search that page from it
+    if(app->search) {
+        bitchat_search_free(app->search);
+    }
+    if(app->conversations) {
+        bitchat_conversations_free(app->conversations);
+    }
+    if(app->history) {
+        bitchat_history_close(app->history);
+    }
+
+    // Peer updates are staged before the writer drains
+    if(app->peers) {
+        bitchat_peers_free(app->peers);
+    }
+
+    // Metrics of the whole run go to the log and, through the writer, to a file
+    BitchatMetricsSnapshot* metrics =
+        bitchat_heap_alloc(BitchatHeapTagApp, sizeof(BitchatMetricsSnapshot));
+    bitchat_metrics_sample_heap();
+    bitchat_metrics_snapshot(metrics);
+    bitchat_metrics_log(metrics);
+    if(app->writer) {
+        bitchat_metrics_save(metrics, app->writer, BITCHAT_METRICS_PATH);
+    }
+    bitchat_heap_free(metrics);
+
+    // So are the last trace events, in binary for tools/bitchat_trace.c;
+    // staging is drained first to make room next to the metrics
+    if(app->writer) {
+        bitchat_writer_flush(app->writer, true);
+        bitchat_trace_save(app->writer, BITCHAT_TRACE_PATH);
+    }
+
+    // Drain staged writes last
+    if(app->writer) {
+        bitchat_writer_free(app->writer);
+    }
+
     // Free event queue
     furi_message_queue_free(app->event_queue);
 
@@ -247,7 +740,10 @@ static void bitchat_app_free(BitchatApp* app) {
     furi_record_close(RECORD_NOTIFICATION);
     furi_record_close(RECORD_GUI);
 
-    free(app);
+    bitchat_heap_free(app);
+
+    // Everything tagged is released by now; whatever remains is a leak
+    bitchat_heap_report();
 }
 
 /**
@@ -255,12 +751,13 @@ static void bitchat_app_free(BitchatApp* app) {
  */
 int32_t bitchat_app(void* p) {
     UNUSED(p);
-    FURI_LOG_I(TAG, "BitChat starting...");
+    uint32_t start_tick = furi_get_tick();
+    BITCHAT_LOG_I(TAG, "BitChat starting...");
 
-    BitchatApp* app = bitchat_app_alloc();
+    BitchatApp* app = bitchat_app_alloc(start_tick);
     view_dispatcher_run(app->view_dispatcher);
     bitchat_app_free(app);
 
-    FURI_LOG_I(TAG, "BitChat stopped");
+    BITCHAT_LOG_I(TAG, "BitChat stopped");
     return 0;
 }
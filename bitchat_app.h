@@ -6,10 +6,12 @@
 #pragma once
 
 #include <furi.h>
+#include "crypto/bitchat_ed25519.h"
 
 typedef struct BitchatApp BitchatApp;
 typedef struct BitchatBle BitchatBle;
 typedef struct BitchatIdentity BitchatIdentity;
+typedef struct BitchatWriter BitchatWriter;
 
 /**
  * Event types for BitChat
@@ -56,8 +58,12 @@ typedef struct {
 BitchatIdentity* bitchat_identity_create(void);
 BitchatIdentity* bitchat_identity_load(void);
 void bitchat_identity_save(BitchatIdentity* identity);
+bool bitchat_identity_save_async(BitchatIdentity* identity, BitchatWriter* writer);
 void bitchat_identity_free(BitchatIdentity* identity);
 bool bitchat_identity_get_nickname(BitchatIdentity* identity, char* nickname, size_t size);
 void bitchat_identity_set_nickname(BitchatIdentity* identity, const char* nickname);
 const uint8_t* bitchat_identity_get_public_key(BitchatIdentity* identity);
+const uint8_t* bitchat_identity_get_noise_private_key(BitchatIdentity* identity);
 const uint8_t* bitchat_identity_get_peer_id(BitchatIdentity* identity);
+const uint8_t* bitchat_identity_get_signing_public_key(BitchatIdentity* identity);
+const BitchatEd25519Key* bitchat_identity_get_signing_key(BitchatIdentity* identity);
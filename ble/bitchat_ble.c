@@ -3,22 +3,66 @@
  */
 
 #include "bitchat_ble.h"
-#include "../protocol/bitchat_protocol.h"
+#include "bitchat_link_context.h"
+#include "../protocol/bitchat_fragment.h"
+#include "../crypto/bitchat_signature.h"
+#include "../storage/bitchat_capture.h"
+#include "../storage/bitchat_peers.h"
+#include "../utils/bitchat_metrics.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
 #include <furi.h>
 #include <furi_hal.h>
 #include <string.h>
 
 #define TAG "BitchatBLE"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_BLE
+// Nickname, both public keys and the wire version TLV
+#define ANNOUNCE_PAYLOAD_SIZE 128
+#define ANNOUNCE_FRAME_SIZE \
+    (BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE + ANNOUNCE_PAYLOAD_SIZE + BITCHAT_SIGNATURE_SIZE)
+
+/**
+ * Per-link wire state, indexed like peers[]
+ */
+typedef struct {
+    uint8_t wire_version; // Version we send on this link
+    uint64_t peer_epoch; // Base for compact timestamps sent to this peer
+    BitchatLinkContext context; // Alias tables for BITCHAT_VERSION_ALIASED
+} BitchatBleLink;
 
 struct BitchatBle {
     FuriMessageQueue* event_queue;
     BitchatBlePeer peers[BITCHAT_BLE_MAX_PEERS];
+    BitchatBleLink links[BITCHAT_BLE_MAX_PEERS];
     size_t peer_count;
     bool is_active;
     FuriMutex* mutex;
 
     // BLE state
     uint8_t local_peer_id[8];
+    uint64_t link_epoch;
+
+    // Our announcement is built from the identity each time it is sent
+    BitchatIdentity* identity;
+    uint32_t announce_tick;
+
+    // Per-link re-encoding of outgoing frames
+    uint8_t tx_buffer[BITCHAT_BLE_MTU];
+
+    // Frames larger than the MTU go out as fragment packets built here
+    uint8_t fragment_buffer[BITCHAT_BLE_MTU];
+    bool fec_enabled;
+    BitchatReassembler* reassembler;
+
+    // Announcements are remembered across restarts here
+    BitchatPeers* directory;
+
+    // Checks signed announcements; only touched from the receive path
+    BitchatSignatureVerifier* verifier;
+
+    // Raw frames in both directions are recorded here while capturing
+    BitchatCapture* capture;
 
     // Stream assembler for fragmented packets
     uint8_t rx_buffer[BITCHAT_BLE_MTU * 2];
@@ -27,26 +71,79 @@ struct BitchatBle {
 
 // BLE event handler removed - will be implemented when BLE API is used
 
+/**
+ * Broadcast our announcement: nickname, keys and the highest wire version
+ * we accept with the link epoch compact timestamps are based on
+ */
+static void ble_announce(BitchatBle* ble) {
+    BitchatIdentity* identity = ble->identity;
+    ble->announce_tick = furi_get_tick();
+
+    BitchatAnnouncement announcement = {0};
+    bitchat_identity_get_nickname(identity, announcement.nickname, sizeof(announcement.nickname));
+    memcpy(
+        announcement.noise_public_key,
+        bitchat_identity_get_public_key(identity),
+        sizeof(announcement.noise_public_key));
+    announcement.has_noise_public_key = true;
+    memcpy(
+        announcement.signing_public_key,
+        bitchat_identity_get_signing_public_key(identity),
+        sizeof(announcement.signing_public_key));
+    announcement.has_signing_public_key = true;
+    announcement.max_version = BITCHAT_MAX_WIRE_VERSION;
+    announcement.link_epoch = ble->link_epoch;
+
+    uint8_t payload[ANNOUNCE_PAYLOAD_SIZE];
+    BitchatPacket packet = {0};
+    packet.version = BITCHAT_VERSION;
+    packet.type = BITCHAT_PACKET_TYPE_ANNOUNCEMENT;
+    packet.ttl = BITCHAT_BLE_ANNOUNCE_TTL;
+    packet.timestamp = bitchat_get_timestamp_ms();
+    packet.payload = payload;
+    packet.payload_length = bitchat_announcement_encode(&announcement, payload, sizeof(payload));
+    memcpy(packet.sender_id, ble->local_peer_id, BITCHAT_SENDER_ID_SIZE);
+
+    // Signed so receivers can tie the announced keys to this peer ID
+    uint8_t frame[ANNOUNCE_FRAME_SIZE];
+    size_t frame_size = 0;
+    if(packet.payload_length > 0 &&
+       bitchat_packet_sign(&packet, bitchat_identity_get_signing_key(identity))) {
+        frame_size = bitchat_packet_encode(&packet, frame, sizeof(frame));
+    }
+    if(frame_size == 0) {
+        BITCHAT_LOG_W(TAG, "Announcement encode failed");
+        bitchat_metrics_add(BitchatCounterEncodeFailed, 1);
+        return;
+    }
+
+    bitchat_ble_broadcast(ble, frame, frame_size);
+}
+
 /**
  * Initialize BLE service
  */
 BitchatBle* bitchat_ble_alloc(FuriMessageQueue* event_queue) {
     furi_assert(event_queue);
 
-    BitchatBle* ble = malloc(sizeof(BitchatBle));
+    BitchatBle* ble = bitchat_heap_alloc(BitchatHeapTagBle, sizeof(BitchatBle));
     memset(ble, 0, sizeof(BitchatBle));
 
     ble->event_queue = event_queue;
     ble->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     ble->is_active = false;
     ble->peer_count = 0;
+    memset(ble->links, 0, sizeof(ble->links));
+    ble->fec_enabled = true;
+    ble->reassembler = bitchat_reassembler_alloc();
+    ble->verifier = bitchat_signature_verifier_alloc();
 
     // Generate random local peer ID
     for(int i = 0; i < 8; i++) {
         ble->local_peer_id[i] = furi_hal_random_get() & 0xFF;
     }
 
-    FURI_LOG_I(TAG, "BLE service initialized");
+    BITCHAT_LOG_I(TAG, "BLE service initialized");
 
     return ble;
 }
@@ -61,10 +158,12 @@ void bitchat_ble_free(BitchatBle* ble) {
         bitchat_ble_stop(ble);
     }
 
+    bitchat_reassembler_free(ble->reassembler);
+    bitchat_signature_verifier_free(ble->verifier);
     furi_mutex_free(ble->mutex);
-    free(ble);
+    bitchat_heap_free(ble);
 
-    FURI_LOG_I(TAG, "BLE service freed");
+    BITCHAT_LOG_I(TAG, "BLE service freed");
 }
 
 /**
@@ -83,6 +182,10 @@ void bitchat_ble_start(BitchatBle* ble, BitchatIdentity* identity) {
 
     // Copy peer ID from identity
     memcpy(ble->local_peer_id, bitchat_identity_get_peer_id(identity), 8);
+    ble->identity = identity;
+
+    // Compact timestamps peers send us are offsets from this
+    ble->link_epoch = bitchat_get_timestamp_ms();
 
     // TODO: Start BLE advertising with BitChat service UUID
     // TODO: Start BLE scanning for other BitChat devices
@@ -92,11 +195,27 @@ void bitchat_ble_start(BitchatBle* ble, BitchatIdentity* identity) {
 
     furi_mutex_release(ble->mutex);
 
-    FURI_LOG_I(TAG, "BLE started, peer_id=%02X%02X%02X%02X%02X%02X%02X%02X",
+    BITCHAT_LOG_I(TAG, "BLE started, peer_id=%02X%02X%02X%02X%02X%02X%02X%02X",
         ble->local_peer_id[0], ble->local_peer_id[1],
         ble->local_peer_id[2], ble->local_peer_id[3],
         ble->local_peer_id[4], ble->local_peer_id[5],
         ble->local_peer_id[6], ble->local_peer_id[7]);
+
+    ble_announce(ble);
+}
+
+/**
+ * Repeat our announcement when it is due
+ */
+void bitchat_ble_tick(BitchatBle* ble) {
+    furi_assert(ble);
+
+    if(!ble->is_active) return;
+    if(furi_get_tick() - ble->announce_tick <
+       furi_ms_to_ticks(BITCHAT_BLE_ANNOUNCE_INTERVAL_MS)) {
+        return;
+    }
+    ble_announce(ble);
 }
 
 /**
@@ -117,10 +236,120 @@ void bitchat_ble_stop(BitchatBle* ble) {
 
     ble->is_active = false;
     ble->peer_count = 0;
+    memset(ble->links, 0, sizeof(ble->links));
 
     furi_mutex_release(ble->mutex);
 
-    FURI_LOG_I(TAG, "BLE stopped");
+    BITCHAT_LOG_I(TAG, "BLE stopped");
+}
+
+/**
+ * Find a peer slot by ID
+ */
+static int ble_find_peer_locked(BitchatBle* ble, const uint8_t* peer_id) {
+    for(size_t i = 0; i < ble->peer_count; i++) {
+        if(memcmp(ble->peers[i].peer_id, peer_id, 8) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Send a v1 frame on one link, re-encoded for the version that link speaks
+ */
+static void ble_send_locked(BitchatBle* ble, size_t index, const uint8_t* data, size_t size) {
+    BitchatBleLink* link = &ble->links[index];
+    bitchat_metrics_count_packet(true, data[1]);
+    ble->peers[index].frames_tx++;
+
+    // Packets that don't fit the compact header go out as v1
+    size_t link_size = 0;
+    if(link->wire_version >= BITCHAT_VERSION_ALIASED) {
+        link_size = bitchat_link_compress(
+            &link->context, data, size, link->peer_epoch, ble->tx_buffer, sizeof(ble->tx_buffer));
+    } else if(link->wire_version >= BITCHAT_VERSION_COMPACT) {
+        link_size = bitchat_packet_compact(
+            data, size, link->peer_epoch, ble->tx_buffer, sizeof(ble->tx_buffer));
+    }
+    if(link_size > 0) {
+        data = ble->tx_buffer;
+        size = link_size;
+    }
+    if(ble->capture) {
+        bitchat_capture_frame(
+            ble->capture,
+            BitchatCaptureDirectionTx,
+            ble->peers[index].peer_id,
+            link->peer_epoch,
+            data,
+            size);
+    }
+
+    // TODO: Write to the peer's BLE characteristic
+    BITCHAT_TRACE(BitchatTraceBleSend, index, size, data[0]);
+}
+
+/**
+ * Send a v1 frame to one peer, or to all peers when index is negative,
+ * splitting it into fragment packets if it exceeds the MTU
+ */
+static bool ble_send_frame_locked(BitchatBle* ble, int index, const uint8_t* data, size_t size) {
+    if(size <= BITCHAT_BLE_MTU) {
+        for(size_t i = 0; i < ble->peer_count; i++) {
+            if(index < 0 || (size_t)index == i) ble_send_locked(ble, i, data, size);
+        }
+        return true;
+    }
+
+    if(size > BITCHAT_FRAGMENT_MAX_FRAME || size < BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE) {
+        BITCHAT_LOG_W(TAG, "Packet too large: %zu bytes", size);
+        bitchat_metrics_add(BitchatCounterSendFailed, 1);
+        return false;
+    }
+
+    // One repair fragment per four data fragments rides out typical burst loss
+    size_t max_fragment = BITCHAT_BLE_MTU - BITCHAT_HEADER_SIZE - BITCHAT_SENDER_ID_SIZE;
+    size_t data_count = (size + max_fragment - BITCHAT_FRAGMENT_HEADER_SIZE - 1) /
+                        (max_fragment - BITCHAT_FRAGMENT_HEADER_SIZE);
+    uint8_t repair_count = ble->fec_enabled ? (data_count + BITCHAT_BLE_FEC_RATIO - 1) /
+                                                  BITCHAT_BLE_FEC_RATIO :
+                                              0;
+
+    BitchatFragmentPlan plan;
+    if(!bitchat_fragment_plan(size, max_fragment, repair_count, data[1], &plan)) {
+        BITCHAT_LOG_W(TAG, "Packet too large: %zu bytes", size);
+        bitchat_metrics_add(BitchatCounterSendFailed, 1);
+        return false;
+    }
+
+    // Fragments keep the original TTL, timestamp and sender so relays treat them alike
+    BitchatPacket packet = {0};
+    packet.version = BITCHAT_VERSION;
+    packet.type = BITCHAT_PACKET_TYPE_FRAGMENT;
+    packet.ttl = data[BITCHAT_PACKET_TTL_OFFSET];
+    memcpy(packet.sender_id, &data[BITCHAT_HEADER_SIZE], BITCHAT_SENDER_ID_SIZE);
+    packet.payload_length = BITCHAT_FRAGMENT_HEADER_SIZE + plan.block_size;
+
+    size_t frame_size =
+        bitchat_packet_encode(&packet, ble->fragment_buffer, sizeof(ble->fragment_buffer));
+    if(frame_size == 0) return false;
+    memcpy(&ble->fragment_buffer[3], &data[3], 8);
+    uint8_t* fragment = &ble->fragment_buffer[frame_size - packet.payload_length];
+
+    size_t count = bitchat_fragment_count(&plan);
+    BITCHAT_TRACE(BitchatTraceBleFragment, size, count - repair_count, repair_count);
+    bitchat_metrics_add(BitchatCounterFragmentsSent, count);
+    for(size_t f = 0; f < count; f++) {
+        bitchat_fragment_encode(&plan, data, f, fragment, packet.payload_length);
+        for(size_t i = 0; i < ble->peer_count; i++) {
+            if(index < 0 || (size_t)index == i) {
+                ble_send_locked(ble, i, ble->fragment_buffer, frame_size);
+            }
+        }
+    }
+
+    return true;
 }
 
 /**
@@ -131,23 +360,19 @@ bool bitchat_ble_broadcast(BitchatBle* ble, const uint8_t* data, size_t size) {
     furi_assert(data);
 
     if(!ble->is_active) {
-        FURI_LOG_W(TAG, "Cannot broadcast: BLE not active");
-        return false;
-    }
-
-    if(size > BITCHAT_BLE_MTU) {
-        FURI_LOG_W(TAG, "Packet too large: %zu bytes", size);
+        BITCHAT_LOG_W(TAG, "Cannot broadcast: BLE not active");
+        bitchat_metrics_add(BitchatCounterSendFailed, 1);
         return false;
     }
 
     furi_mutex_acquire(ble->mutex, FuriWaitForever);
 
-    // TODO: Send to all connected peers via BLE characteristic write
-    FURI_LOG_D(TAG, "Broadcasting %zu bytes to %zu peers", size, ble->peer_count);
+    BITCHAT_TRACE(BitchatTraceBleBroadcast, size, ble->peer_count, 0);
+    bool result = ble_send_frame_locked(ble, -1, data, size);
 
     furi_mutex_release(ble->mutex);
 
-    return true;
+    return result;
 }
 
 /**
@@ -163,32 +388,283 @@ bool bitchat_ble_send_to_peer(
     furi_assert(data);
 
     if(!ble->is_active) {
+        bitchat_metrics_add(BitchatCounterSendFailed, 1);
         return false;
     }
 
     furi_mutex_acquire(ble->mutex, FuriWaitForever);
 
     // Find peer
-    bool found = false;
-    for(size_t i = 0; i < ble->peer_count; i++) {
-        if(memcmp(ble->peers[i].peer_id, peer_id, 8) == 0) {
-            found = true;
-            break;
+    int index = ble_find_peer_locked(ble, peer_id);
+    if(index < 0) {
+        BITCHAT_LOG_W(TAG, "Peer not found");
+        furi_mutex_release(ble->mutex);
+        bitchat_metrics_add(BitchatCounterSendFailed, 1);
+        return false;
+    }
+
+    bool result = ble_send_frame_locked(ble, index, data, size);
+
+    furi_mutex_release(ble->mutex);
+
+    return result;
+}
+
+/**
+ * Enable or disable repair fragments on outgoing fragmented frames
+ */
+void bitchat_ble_set_fec_enabled(BitchatBle* ble, bool enabled) {
+    furi_assert(ble);
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+    ble->fec_enabled = enabled;
+    furi_mutex_release(ble->mutex);
+}
+
+/**
+ * Attach the peer directory
+ */
+void bitchat_ble_set_peer_directory(BitchatBle* ble, BitchatPeers* peers) {
+    furi_assert(ble);
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+    ble->directory = peers;
+    furi_mutex_release(ble->mutex);
+}
+
+/**
+ * Attach a frame capture
+ */
+void bitchat_ble_set_capture(BitchatBle* ble, BitchatCapture* capture) {
+    furi_assert(ble);
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+    ble->capture = capture;
+    furi_mutex_release(ble->mutex);
+}
+
+/**
+ * Get our link epoch
+ */
+uint64_t bitchat_ble_get_link_epoch(BitchatBle* ble) {
+    furi_assert(ble);
+    return ble->link_epoch;
+}
+
+/**
+ * Record a neighbour's announcement and pick the wire version for its link
+ */
+void bitchat_ble_handle_announcement(
+    BitchatBle* ble,
+    const uint8_t* peer_id,
+    const BitchatAnnouncement* announcement) {
+    furi_assert(ble);
+    furi_assert(peer_id);
+    furi_assert(announcement);
+
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+
+    int index = ble_find_peer_locked(ble, peer_id);
+    if(index >= 0) {
+        BitchatBleLink* link = &ble->links[index];
+        uint8_t version = announcement->max_version < BITCHAT_MAX_WIRE_VERSION ?
+                              announcement->max_version :
+                              BITCHAT_MAX_WIRE_VERSION;
+
+        // A new epoch means the peer restarted: its alias tables are gone too
+        if(version != link->wire_version || announcement->link_epoch != link->peer_epoch) {
+            bitchat_link_context_reset(&link->context);
+        }
+
+        // iOS/macOS peers never advertise more than v1 and keep the full header
+        if(version >= BITCHAT_VERSION_COMPACT) {
+            link->wire_version = version;
+            link->peer_epoch = announcement->link_epoch;
+        } else {
+            link->wire_version = BITCHAT_VERSION;
+        }
+        BITCHAT_LOG_D(TAG, "Peer %d speaks v%d", index, link->wire_version);
+
+        BitchatBlePeer* peer = &ble->peers[index];
+        strncpy(peer->nickname, announcement->nickname, sizeof(peer->nickname) - 1);
+        peer->nickname[sizeof(peer->nickname) - 1] = '\0';
+        peer->last_seen = furi_get_tick();
+    }
+    BitchatPeers* directory = ble->directory;
+
+    furi_mutex_release(ble->mutex);
+
+    // May read the card, so not under the link lock
+    if(directory) {
+        bitchat_peers_record_announcement(
+            directory,
+            peer_id,
+            announcement->nickname,
+            announcement->has_noise_public_key ? announcement->noise_public_key : NULL,
+            announcement->has_signing_public_key ? announcement->signing_public_key : NULL,
+            bitchat_get_timestamp_ms() / 1000);
+    }
+}
+
+/**
+ * Route a normalized frame, counting those dropped
+ */
+static BitchatRoute ble_classify(BitchatBle* ble, const uint8_t* frame, size_t size) {
+    BitchatPacketHeader header;
+    if(!bitchat_packet_peek_header(frame, size, &header)) {
+        bitchat_metrics_add(BitchatCounterDecodeFailed, 1);
+        return BitchatRouteDrop;
+    }
+
+    BitchatRoute route = bitchat_packet_classify(&header, ble->local_peer_id);
+    if(route == BitchatRouteDrop) bitchat_metrics_add(BitchatCounterFramesDropped, 1);
+    return route;
+}
+
+/**
+ * Pass an announcement sent by the neighbour itself to
+ * bitchat_ble_handle_announcement(); relayed ones say nothing about this link.
+ * A signed announcement must verify against the signing key it carries.
+ * Unsigned ones (older iOS/macOS peers) are kept, but their signing key is not.
+ */
+static void ble_receive_announcement(
+    BitchatBle* ble,
+    const uint8_t* peer_id,
+    const uint8_t* frame,
+    size_t size) {
+    if(frame[1] != BITCHAT_PACKET_TYPE_ANNOUNCEMENT) return;
+    if(memcmp(&frame[BITCHAT_HEADER_SIZE], peer_id, BITCHAT_SENDER_ID_SIZE) != 0) return;
+
+    BitchatPacket packet;
+    BitchatAnnouncement announcement;
+    if(!bitchat_packet_decode(frame, size, &packet)) {
+        bitchat_metrics_add(BitchatCounterDecodeFailed, 1);
+        return;
+    }
+    bool valid = !packet.is_compressed && packet.payload_length > 0 &&
+                 bitchat_announcement_decode(packet.payload, packet.payload_length, &announcement);
+    if(!valid) {
+        bitchat_metrics_add(BitchatCounterDecodeFailed, 1);
+    } else if(packet.has_signature) {
+        valid = announcement.has_signing_public_key &&
+                bitchat_signature_verify_packet(
+                    ble->verifier, &packet, announcement.signing_public_key);
+        if(!valid) {
+            BITCHAT_LOG_W(TAG, "Dropping announcement with a bad signature");
+            bitchat_metrics_add(BitchatCounterCryptoFailed, 1);
         }
+    } else {
+        announcement.has_signing_public_key = false;
     }
+    bitchat_heap_free(packet.payload);
+
+    if(valid) bitchat_ble_handle_announcement(ble, peer_id, &announcement);
+}
 
-    if(!found) {
-        FURI_LOG_W(TAG, "Peer not found");
+/**
+ * Normalize a received frame to v1
+ */
+size_t bitchat_ble_receive_frame(
+    BitchatBle* ble,
+    const uint8_t* peer_id,
+    const uint8_t* data,
+    size_t size,
+    uint8_t* buffer,
+    size_t buffer_size,
+    BitchatRoute* route) {
+    furi_assert(ble);
+    furi_assert(peer_id);
+    furi_assert(data);
+    furi_assert(buffer);
+
+    if(size == 0) return 0;
+
+    // All versions are always accepted; the first byte tells them apart
+    size_t frame_size = 0;
+    if(data[0] == BITCHAT_VERSION_COMPACT) {
+        frame_size = bitchat_packet_expand(data, size, ble->link_epoch, buffer, buffer_size);
+    } else if(data[0] == BITCHAT_VERSION_ALIASED) {
+        furi_mutex_acquire(ble->mutex, FuriWaitForever);
+        int index = ble_find_peer_locked(ble, peer_id);
+        if(index >= 0) {
+            frame_size = bitchat_link_decompress(
+                &ble->links[index].context, data, size, ble->link_epoch, buffer, buffer_size);
+        }
         furi_mutex_release(ble->mutex);
-        return false;
+    } else if(size <= buffer_size) {
+        memcpy(buffer, data, size);
+        frame_size = size;
+    }
+
+    // Per-link counts for link quality; the raw frame is captured as received
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+    if(ble->capture) {
+        bitchat_capture_frame(
+            ble->capture, BitchatCaptureDirectionRx, peer_id, ble->link_epoch, data, size);
+    }
+    int index = ble_find_peer_locked(ble, peer_id);
+    if(index >= 0) {
+        if(frame_size > 0) {
+            ble->peers[index].frames_rx++;
+        } else {
+            ble->peers[index].rx_errors++;
+        }
+    }
+    furi_mutex_release(ble->mutex);
+
+    if(frame_size == 0) {
+        if(data[0] == BITCHAT_VERSION_COMPACT || data[0] == BITCHAT_VERSION_ALIASED) {
+            bitchat_metrics_add(BitchatCounterLinkDecodeFailed, 1);
+        }
+        return 0;
+    }
+    bitchat_metrics_count_packet(false, buffer[1]);
+
+    // Route from the header alone, so frames we would drop skip reassembly
+    // and never reach the full decoder
+    BitchatRoute frame_route = ble_classify(ble, buffer, frame_size);
+    if(frame_route == BitchatRouteDrop) return 0;
+    if(buffer[1] != BITCHAT_PACKET_TYPE_FRAGMENT) {
+        if(frame_route & BitchatRouteDeliver) {
+            ble_receive_announcement(ble, peer_id, buffer, frame_size);
+        }
+        if(route) *route = frame_route;
+        return frame_size;
     }
 
-    // TODO: Send to specific peer via BLE
-    FURI_LOG_D(TAG, "Sending %zu bytes to peer", size);
+    // Fragments are held until enough have arrived to rebuild the frame
+    size_t offset;
+    size_t length;
+    if(!bitchat_packet_locate_payload(buffer, frame_size, &offset, &length)) {
+        return 0;
+    }
 
+    furi_mutex_acquire(ble->mutex, FuriWaitForever);
+    const uint8_t* frame;
+    size_t rebuilt_size = 0;
+    if(bitchat_reassembler_add(
+           ble->reassembler,
+           &buffer[BITCHAT_HEADER_SIZE],
+           &buffer[offset],
+           length,
+           &frame,
+           &rebuilt_size)) {
+        if(rebuilt_size <= buffer_size) {
+            memcpy(buffer, frame, rebuilt_size);
+            bitchat_metrics_add(BitchatCounterFramesReassembled, 1);
+        } else {
+            BITCHAT_LOG_W(TAG, "No room for reassembled frame: %zu bytes", rebuilt_size);
+            rebuilt_size = 0;
+        }
+    }
     furi_mutex_release(ble->mutex);
 
-    return true;
+    // The rebuilt frame is routed on its own header
+    if(rebuilt_size == 0) return 0;
+    frame_route = ble_classify(ble, buffer, rebuilt_size);
+    if(frame_route == BitchatRouteDrop) return 0;
+    if(frame_route & BitchatRouteDeliver) {
+        ble_receive_announcement(ble, peer_id, buffer, rebuilt_size);
+    }
+    if(route) *route = frame_route;
+    return rebuilt_size;
 }
 
 /**
@@ -8,6 +8,7 @@
 #include <furi.h>
 #include <furi_hal_bt.h>
 #include "../bitchat_app.h"
+#include "../protocol/bitchat_protocol.h"
 
 // BLE Service UUIDs (matching BitChat iOS/macOS)
 // Mainnet UUID: F47B5E2D-4A9E-4C5A-9B3F-8E1D2C3A4B5C
@@ -22,8 +23,15 @@
 
 #define BITCHAT_BLE_MTU 512
 #define BITCHAT_BLE_MAX_PEERS 8
+// Repair fragments added per this many data fragments when FEC is enabled
+#define BITCHAT_BLE_FEC_RATIO 4
+// Our announcement is repeated this often while active
+#define BITCHAT_BLE_ANNOUNCE_INTERVAL_MS 30000
+#define BITCHAT_BLE_ANNOUNCE_TTL 7
 
 typedef struct BitchatBle BitchatBle;
+typedef struct BitchatPeers BitchatPeers;
+typedef struct BitchatCapture BitchatCapture;
 
 /**
  * Peer connection information
@@ -33,6 +41,10 @@ typedef struct {
     char nickname[32];
     bool connected;
     uint32_t last_seen;
+    // Link quality: frames on this link and received frames that did not decode
+    uint32_t frames_rx;
+    uint32_t frames_tx;
+    uint32_t rx_errors;
 } BitchatBlePeer;
 
 /**
@@ -48,12 +60,18 @@ BitchatBle* bitchat_ble_alloc(FuriMessageQueue* event_queue);
 void bitchat_ble_free(BitchatBle* ble);
 
 /**
- * Start BLE advertising and scanning
+ * Start BLE advertising and scanning, and announce ourselves
  * @param ble BLE service instance
- * @param identity Local identity for advertising
+ * @param identity Local identity for advertising; must outlive the service
  */
 void bitchat_ble_start(BitchatBle* ble, BitchatIdentity* identity);
 
+/**
+ * Repeat our announcement once BITCHAT_BLE_ANNOUNCE_INTERVAL_MS has passed
+ * Call periodically; does nothing while stopped.
+ */
+void bitchat_ble_tick(BitchatBle* ble);
+
 /**
  * Stop BLE advertising and scanning
  */
@@ -61,6 +79,7 @@ void bitchat_ble_stop(BitchatBle* ble);
 
 /**
  * Send a packet to all connected peers (broadcast)
+ * Packets larger than BITCHAT_BLE_MTU are sent as fragments
  * @param ble BLE service instance
  * @param data Packet data
  * @param size Packet size
@@ -78,6 +97,73 @@ bool bitchat_ble_broadcast(BitchatBle* ble, const uint8_t* data, size_t size);
  */
 bool bitchat_ble_send_to_peer(BitchatBle* ble, const uint8_t* peer_id, const uint8_t* data, size_t size);
 
+/**
+ * Enable or disable forward error correction for fragmented packets
+ * When enabled, receivers can rebuild a packet despite lost fragments
+ * @param ble BLE service instance
+ * @param enabled Add repair fragments
+ */
+void bitchat_ble_set_fec_enabled(BitchatBle* ble, bool enabled);
+
+/**
+ * Attach the peer directory that announcements are recorded in
+ * @param ble BLE service instance
+ * @param peers Peer directory, or NULL to stop recording
+ */
+void bitchat_ble_set_peer_directory(BitchatBle* ble, BitchatPeers* peers);
+
+/**
+ * Attach a frame capture that every raw frame sent and received is offered to
+ * @param ble BLE service instance
+ * @param capture Frame capture, or NULL to detach
+ */
+void bitchat_ble_set_capture(BitchatBle* ble, BitchatCapture* capture);
+
+/**
+ * Get our link epoch, advertised in announcements (BITCHAT_ANNOUNCE_TLV_WIRE_VERSION)
+ * as the base for compact timestamps peers send us
+ */
+uint64_t bitchat_ble_get_link_epoch(BitchatBle* ble);
+
+/**
+ * Record a neighbour's announcement and pick the wire version for its link.
+ * Only announcements received directly from the neighbour should be passed here.
+ * The nickname and keys are also recorded in the peer directory, if attached.
+ * @param ble BLE service instance
+ * @param peer_id Neighbour peer ID (8 bytes)
+ * @param announcement Decoded announcement
+ */
+void bitchat_ble_handle_announcement(
+    BitchatBle* ble,
+    const uint8_t* peer_id,
+    const BitchatAnnouncement* announcement);
+
+/**
+ * Normalize a received frame to v1, expanding compact and aliased headers
+ * @param ble BLE service instance
+ * @param peer_id Neighbour the frame arrived from (8 bytes)
+ * @param data Received frame
+ * @param size Frame size
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @param route Output route of the returned frame, or NULL
+ * Fragment packets are absorbed; the frame they complete is returned instead,
+ * so buffer should hold up to BITCHAT_FRAGMENT_MAX_FRAME bytes. Frames are
+ * classified from their header first; those routed nowhere are dropped here.
+ * Announcements sent by the neighbour itself are passed to
+ * bitchat_ble_handle_announcement() before being returned.
+ * @return v1 frame size, or 0 on error, when dropped or while a fragmented
+ * frame is incomplete
+ */
+size_t bitchat_ble_receive_frame(
+    BitchatBle* ble,
+    const uint8_t* peer_id,
+    const uint8_t* data,
+    size_t size,
+    uint8_t* buffer,
+    size_t buffer_size,
+    BitchatRoute* route);
+
 /**
  * Get list of connected peers
  * @param ble BLE service instance
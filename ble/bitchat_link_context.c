@@ -0,0 +1,362 @@
+/**
+ * BitChat Link Header Compression Implementation
+ */
+
+#include "bitchat_link_context.h"
+#include "../protocol/bitchat_protocol.h"
+#include "../utils/bitchat_log.h"
+#include <furi.h>
+#include <string.h>
+
+#define TAG "BitchatLink"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_BLE
+
+// Control byte: which fields are present and how each ID is sent
+#define LINK_CTRL_TYPE 0x01
+#define LINK_CTRL_TTL_FLAGS 0x02
+#define LINK_CTRL_SENDER_SHIFT 2
+#define LINK_CTRL_RECIPIENT_SHIFT 4
+#define LINK_CTRL_ID_MASK 0x03
+
+#define LINK_ID_ALIAS 0 // alias (1)
+#define LINK_ID_FULL 1 // full ID (8)
+#define LINK_ID_ASSIGN 2 // alias (1) | full ID (8)
+
+#define LINK_ID_SIZE 8
+#define LINK_MAX_HEADER_SIZE (2 + 2 + 4 + 2 + 3 + 2 * (1 + LINK_ID_SIZE))
+
+/**
+ * CRC-16/CCITT-FALSE over the rebuilt v1 header and IDs
+ * A stale alias slips past it once in 65536 frames rather than once in 256.
+ */
+static uint16_t link_crc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0xFFFF;
+    while(size--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for(int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * Forget all aliases and references
+ */
+void bitchat_link_context_reset(BitchatLinkContext* context) {
+    furi_assert(context);
+    memset(context, 0, sizeof(BitchatLinkContext));
+}
+
+/**
+ * Encode one ID, assigning or refreshing its alias as needed
+ */
+static size_t link_tx_id(BitchatLinkTxContext* tx, const uint8_t* id, uint8_t* out, uint8_t* mode) {
+    int slot = -1;
+    for(int i = 0; i < BITCHAT_LINK_ALIAS_COUNT; i++) {
+        if((tx->valid & (1 << i)) && memcmp(tx->ids[i], id, LINK_ID_SIZE) == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if(slot >= 0) {
+        if(tx->repeats_left[slot] > 0) {
+            tx->repeats_left[slot]--;
+            *mode = LINK_ID_ASSIGN;
+        } else if(++tx->uses[slot] >= BITCHAT_LINK_REFRESH_INTERVAL) {
+            tx->uses[slot] = 0;
+            *mode = LINK_ID_ASSIGN;
+        } else {
+            *mode = LINK_ID_ALIAS;
+        }
+    } else {
+        // New ID: take a free alias or the least recently used one
+        slot = 0;
+        for(int i = 0; i < BITCHAT_LINK_ALIAS_COUNT; i++) {
+            if(!(tx->valid & (1 << i))) {
+                slot = i;
+                break;
+            }
+            if((int32_t)(tx->last_used[i] - tx->last_used[slot]) < 0) {
+                slot = i;
+            }
+        }
+        memcpy(tx->ids[slot], id, LINK_ID_SIZE);
+        tx->valid |= 1 << slot;
+        tx->repeats_left[slot] = BITCHAT_LINK_REPEAT_COUNT - 1;
+        tx->uses[slot] = 0;
+        *mode = LINK_ID_ASSIGN;
+    }
+
+    tx->last_used[slot] = ++tx->clock;
+
+    size_t offset = 0;
+    out[offset++] = slot;
+    if(*mode == LINK_ID_ASSIGN) {
+        memcpy(&out[offset], id, LINK_ID_SIZE);
+        offset += LINK_ID_SIZE;
+    }
+    return offset;
+}
+
+/**
+ * Decide whether an elidable field must be sent
+ */
+static bool link_tx_field(uint8_t* reference, uint8_t* repeats_left, uint8_t value, bool refresh) {
+    if(*reference != value) {
+        *reference = value;
+        *repeats_left = BITCHAT_LINK_REPEAT_COUNT - 1;
+        return true;
+    }
+    if(*repeats_left > 0) {
+        (*repeats_left)--;
+        return true;
+    }
+    return refresh;
+}
+
+/**
+ * Compress a v1 frame for the link
+ */
+size_t bitchat_link_compress(
+    BitchatLinkContext* context,
+    const uint8_t* data,
+    size_t size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(context);
+    furi_assert(data);
+    furi_assert(buffer);
+
+    size_t payload_offset, payload_length;
+    if(!bitchat_packet_locate_payload(data, size, &payload_offset, &payload_length)) return 0;
+
+    uint8_t ttl = data[BITCHAT_PACKET_TTL_OFFSET];
+    uint8_t flags = data[11];
+    if(ttl > BITCHAT_COMPACT_MAX_TTL || flags > 0x0F) return 0;
+
+    uint64_t timestamp = 0;
+    for(int i = 0; i < 8; i++) {
+        timestamp = (timestamp << 8) | data[3 + i];
+    }
+    int64_t delta = (int64_t)(timestamp - epoch);
+    if(delta < INT32_MIN || delta > INT32_MAX) return 0;
+
+    size_t body_size = size - payload_offset;
+    if(buffer_size < LINK_MAX_HEADER_SIZE + body_size) return 0;
+
+    // Nothing can fail from here on, so the context may change
+    BitchatLinkTxContext* tx = &context->tx;
+    bool has_recipient = flags & BITCHAT_FLAG_HAS_RECIPIENT;
+    uint8_t ttl_flags = (ttl << 4) | flags;
+
+    bool refresh = !tx->fields_valid || ++tx->fields_uses >= BITCHAT_LINK_REFRESH_INTERVAL;
+    if(refresh) tx->fields_uses = 0;
+    if(!tx->fields_valid) {
+        // Force both fields out as if they changed
+        tx->type = ~data[1];
+        tx->ttl_flags = ~ttl_flags;
+        tx->fields_valid = true;
+    }
+    bool send_type = link_tx_field(&tx->type, &tx->type_repeats_left, data[1], refresh);
+    bool send_ttl_flags =
+        link_tx_field(&tx->ttl_flags, &tx->ttl_flags_repeats_left, ttl_flags, refresh);
+
+    size_t offset = 0;
+    buffer[offset++] = BITCHAT_VERSION_ALIASED;
+    size_t control_offset = offset++;
+    uint8_t control = 0;
+
+    if(send_type) {
+        control |= LINK_CTRL_TYPE;
+        buffer[offset++] = data[1];
+    }
+    if(send_ttl_flags) {
+        control |= LINK_CTRL_TTL_FLAGS;
+        buffer[offset++] = ttl_flags;
+    }
+
+    uint32_t offset_ms = (uint32_t)(int32_t)delta;
+    buffer[offset++] = (offset_ms >> 24) & 0xFF;
+    buffer[offset++] = (offset_ms >> 16) & 0xFF;
+    buffer[offset++] = (offset_ms >> 8) & 0xFF;
+    buffer[offset++] = offset_ms & 0xFF;
+
+    uint16_t crc = link_crc16(data, payload_offset);
+    buffer[offset++] = crc >> 8;
+    buffer[offset++] = crc & 0xFF;
+
+    size_t length = payload_length;
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        buffer[offset++] = byte | (length ? 0x80 : 0);
+    } while(length);
+
+    uint8_t mode;
+    offset += link_tx_id(tx, &data[BITCHAT_HEADER_SIZE], &buffer[offset], &mode);
+    control |= mode << LINK_CTRL_SENDER_SHIFT;
+
+    if(has_recipient) {
+        offset += link_tx_id(
+            tx, &data[BITCHAT_HEADER_SIZE + LINK_ID_SIZE], &buffer[offset], &mode);
+        control |= mode << LINK_CTRL_RECIPIENT_SHIFT;
+    }
+
+    buffer[control_offset] = control;
+
+    memcpy(&buffer[offset], &data[payload_offset], body_size);
+    return offset + body_size;
+}
+
+/**
+ * Decode one ID; records the alias used so a CRC failure can invalidate it
+ */
+static bool link_rx_id(
+    BitchatLinkRxContext* rx,
+    uint8_t mode,
+    const uint8_t* data,
+    size_t size,
+    size_t* offset,
+    uint8_t* id,
+    uint16_t* used) {
+    if(mode == LINK_ID_FULL) {
+        if(*offset + LINK_ID_SIZE > size) return false;
+        memcpy(id, &data[*offset], LINK_ID_SIZE);
+        *offset += LINK_ID_SIZE;
+        return true;
+    }
+
+    if(*offset + 1 > size) return false;
+    uint8_t alias = data[(*offset)++];
+    if(alias >= BITCHAT_LINK_ALIAS_COUNT) return false;
+
+    if(mode == LINK_ID_ASSIGN) {
+        if(*offset + LINK_ID_SIZE > size) return false;
+        memcpy(rx->ids[alias], &data[*offset], LINK_ID_SIZE);
+        rx->valid |= 1 << alias;
+        *offset += LINK_ID_SIZE;
+    } else if(mode != LINK_ID_ALIAS || !(rx->valid & (1 << alias))) {
+        // Assignment was lost; wait for the sender's repeat or refresh
+        return false;
+    } else {
+        *used |= 1 << alias;
+    }
+
+    memcpy(id, rx->ids[alias], LINK_ID_SIZE);
+    return true;
+}
+
+/**
+ * Rebuild a v1 frame from a compressed one
+ */
+size_t bitchat_link_decompress(
+    BitchatLinkContext* context,
+    const uint8_t* data,
+    size_t size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(context);
+    furi_assert(data);
+    furi_assert(buffer);
+
+    BitchatLinkRxContext* rx = &context->rx;
+    if(size < 2 || data[0] != BITCHAT_VERSION_ALIASED) return 0;
+
+    size_t offset = 1;
+    uint8_t control = data[offset++];
+    bool elided = false;
+
+    if(control & LINK_CTRL_TYPE) {
+        if(offset >= size) return 0;
+        rx->type = data[offset++];
+        rx->type_valid = true;
+    } else if(!rx->type_valid) {
+        return 0;
+    } else {
+        elided = true;
+    }
+
+    if(control & LINK_CTRL_TTL_FLAGS) {
+        if(offset >= size) return 0;
+        rx->ttl_flags = data[offset++];
+        rx->ttl_flags_valid = true;
+    } else if(!rx->ttl_flags_valid) {
+        return 0;
+    } else {
+        elided = true;
+    }
+
+    if(offset + 6 > size) return 0;
+    int32_t delta = (int32_t)(((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) |
+                              ((uint32_t)data[offset + 2] << 8) | data[offset + 3]);
+    offset += 4;
+    uint16_t crc = ((uint16_t)data[offset] << 8) | data[offset + 1];
+    offset += 2;
+
+    uint32_t payload_length = 0;
+    for(int shift = 0;; shift += 7) {
+        if(offset >= size || shift > 14) return 0;
+        uint8_t byte = data[offset++];
+        payload_length |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) break;
+    }
+    if(payload_length > BITCHAT_MAX_PAYLOAD_SIZE) return 0;
+
+    uint8_t flags = rx->ttl_flags & 0x0F;
+    bool has_recipient = flags & BITCHAT_FLAG_HAS_RECIPIENT;
+    size_t ids_size = has_recipient ? 2 * LINK_ID_SIZE : LINK_ID_SIZE;
+    if(buffer_size < BITCHAT_HEADER_SIZE + ids_size) return 0;
+
+    // Rebuild the v1 header
+    uint64_t timestamp = epoch + (int64_t)delta;
+    buffer[0] = BITCHAT_VERSION;
+    buffer[1] = rx->type;
+    buffer[BITCHAT_PACKET_TTL_OFFSET] = rx->ttl_flags >> 4;
+    for(int i = 0; i < 8; i++) {
+        buffer[3 + i] = (timestamp >> ((7 - i) * 8)) & 0xFF;
+    }
+    buffer[11] = flags;
+    buffer[12] = (payload_length >> 8) & 0xFF;
+    buffer[13] = payload_length & 0xFF;
+
+    uint16_t used = 0;
+    uint8_t mode = (control >> LINK_CTRL_SENDER_SHIFT) & LINK_CTRL_ID_MASK;
+    if(!link_rx_id(rx, mode, data, size, &offset, &buffer[BITCHAT_HEADER_SIZE], &used)) {
+        return 0;
+    }
+    if(has_recipient) {
+        mode = (control >> LINK_CTRL_RECIPIENT_SHIFT) & LINK_CTRL_ID_MASK;
+        if(!link_rx_id(
+               rx, mode, data, size, &offset, &buffer[BITCHAT_HEADER_SIZE + LINK_ID_SIZE], &used)) {
+            return 0;
+        }
+    }
+
+    size_t header_size = BITCHAT_HEADER_SIZE + ids_size;
+    if(link_crc16(buffer, header_size) != crc) {
+        // Context damage: drop everything this frame relied on until it is resent
+        BITCHAT_LOG_W(TAG, "Header CRC mismatch, invalidating context");
+        rx->valid &= ~used;
+        if(elided) {
+            if(!(control & LINK_CTRL_TYPE)) rx->type_valid = false;
+            if(!(control & LINK_CTRL_TTL_FLAGS)) rx->ttl_flags_valid = false;
+        }
+        return 0;
+    }
+
+    size_t body_size = size - offset;
+    if(buffer_size < header_size + body_size) return 0;
+    memcpy(&buffer[header_size], &data[offset], body_size);
+
+    size_t located_offset, located_length;
+    if(!bitchat_packet_locate_payload(
+           buffer, header_size + body_size, &located_offset, &located_length)) {
+        return 0;
+    }
+
+    return header_size + body_size;
+}
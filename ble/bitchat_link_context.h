@@ -0,0 +1,101 @@
+/**
+ * BitChat Link Header Compression
+ * Per-neighbour compression context for the aliased (v3) link encoding
+ *
+ * Each direction of a link keeps a small table of peer IDs. The first time
+ * an ID is sent it goes out in full together with a 1-byte alias; later
+ * frames carry only the alias. Type and TTL/flags are elided while they
+ * match the last values sent. No feedback channel is used: assignments
+ * are repeated on the next few frames, refreshed periodically, and every
+ * frame carries a CRC-16 of the rebuilt header. A receiver that misses an
+ * update drops the frame instead of misattributing it, except for about
+ * one such frame in 65536 that passes the check.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_LINK_ALIAS_COUNT 16
+// Frames that repeat a new alias or field value before it is elided
+#define BITCHAT_LINK_REPEAT_COUNT 3
+// Aliases and elided fields are resent in full after this many uses
+#define BITCHAT_LINK_REFRESH_INTERVAL 32
+
+typedef struct {
+    uint8_t ids[BITCHAT_LINK_ALIAS_COUNT][8];
+    uint32_t last_used[BITCHAT_LINK_ALIAS_COUNT];
+    uint8_t repeats_left[BITCHAT_LINK_ALIAS_COUNT];
+    uint8_t uses[BITCHAT_LINK_ALIAS_COUNT];
+    uint16_t valid; // Bit per alias
+    uint32_t clock;
+
+    uint8_t type;
+    uint8_t ttl_flags;
+    uint8_t type_repeats_left;
+    uint8_t ttl_flags_repeats_left;
+    uint8_t fields_uses;
+    bool fields_valid;
+} BitchatLinkTxContext;
+
+typedef struct {
+    uint8_t ids[BITCHAT_LINK_ALIAS_COUNT][8];
+    uint16_t valid;
+
+    uint8_t type;
+    uint8_t ttl_flags;
+    bool type_valid;
+    bool ttl_flags_valid;
+} BitchatLinkRxContext;
+
+/**
+ * Both directions of one link
+ */
+typedef struct {
+    BitchatLinkTxContext tx;
+    BitchatLinkRxContext rx;
+} BitchatLinkContext;
+
+/**
+ * Forget all aliases and references, e.g. when the link (re)connects
+ */
+void bitchat_link_context_reset(BitchatLinkContext* context);
+
+/**
+ * Compress a v1 frame for the link
+ * @param context Link context
+ * @param data Encoded v1 packet
+ * @param size Packet size
+ * @param epoch Receiver's link epoch (ms)
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return Bytes written, or 0 if the frame cannot be compressed
+ *         (the caller then sends it uncompressed; the context is untouched)
+ */
+size_t bitchat_link_compress(
+    BitchatLinkContext* context,
+    const uint8_t* data,
+    size_t size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size);
+
+/**
+ * Rebuild a v1 frame from a compressed one
+ * @param context Link context
+ * @param data Received frame (BITCHAT_VERSION_ALIASED)
+ * @param size Frame size
+ * @param epoch Our link epoch (ms)
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return v1 frame size, or 0 if the frame refers to context we don't have
+ */
+size_t bitchat_link_decompress(
+    BitchatLinkContext* context,
+    const uint8_t* data,
+    size_t size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size);
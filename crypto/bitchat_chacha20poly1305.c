@@ -0,0 +1,356 @@
+/**
+ * BitChat ChaCha20-Poly1305 AEAD Implementation
+ */
+
+#include "bitchat_chacha20poly1305.h"
+#include <string.h>
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define CHACHA_QUARTERROUND(a, b, c, d) \
+    a += b;                             \
+    d = ROTL32(d ^ a, 16);              \
+    c += d;                             \
+    b = ROTL32(b ^ c, 12);              \
+    a += b;                             \
+    d = ROTL32(d ^ a, 8);               \
+    c += d;                             \
+    b = ROTL32(b ^ c, 7);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Cortex-M4 and x86 both allow unaligned word access; memcpy compiles to a single LDR/STR
+static inline uint32_t load32_le(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store32_le(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+#else
+static inline uint32_t load32_le(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+#endif
+
+/**
+ * ChaCha20 input state; word 12 is the block counter
+ */
+typedef struct {
+    uint32_t input[16];
+} ChaCha20;
+
+static void chacha20_init(ChaCha20* st, const uint8_t* key, const uint8_t* nonce, uint32_t counter) {
+    st->input[0] = 0x61707865;
+    st->input[1] = 0x3320646e;
+    st->input[2] = 0x79622d32;
+    st->input[3] = 0x6b206574;
+    for(int i = 0; i < 8; i++) {
+        st->input[4 + i] = load32_le(&key[i * 4]);
+    }
+    st->input[12] = counter;
+    st->input[13] = load32_le(&nonce[0]);
+    st->input[14] = load32_le(&nonce[4]);
+    st->input[15] = load32_le(&nonce[8]);
+}
+
+/**
+ * Produce the next 64-byte keystream block as 16 words
+ */
+static void chacha20_block(ChaCha20* st, uint32_t* x) {
+    memcpy(x, st->input, sizeof(st->input));
+    for(int i = 0; i < 10; i++) {
+        CHACHA_QUARTERROUND(x[0], x[4], x[8], x[12])
+        CHACHA_QUARTERROUND(x[1], x[5], x[9], x[13])
+        CHACHA_QUARTERROUND(x[2], x[6], x[10], x[14])
+        CHACHA_QUARTERROUND(x[3], x[7], x[11], x[15])
+        CHACHA_QUARTERROUND(x[0], x[5], x[10], x[15])
+        CHACHA_QUARTERROUND(x[1], x[6], x[11], x[12])
+        CHACHA_QUARTERROUND(x[2], x[7], x[8], x[13])
+        CHACHA_QUARTERROUND(x[3], x[4], x[9], x[14])
+    }
+    for(int i = 0; i < 16; i++) {
+        x[i] += st->input[i];
+    }
+    st->input[12]++;
+}
+
+/**
+ * XOR data with the keystream a word at a time; in and out may be the same buffer
+ */
+static void chacha20_xor(ChaCha20* st, const uint8_t* in, uint8_t* out, size_t size) {
+    uint32_t x[16];
+
+    while(size >= 64) {
+        chacha20_block(st, x);
+        for(int i = 0; i < 16; i++) {
+            store32_le(&out[i * 4], load32_le(&in[i * 4]) ^ x[i]);
+        }
+        in += 64;
+        out += 64;
+        size -= 64;
+    }
+
+    if(size > 0) {
+        chacha20_block(st, x);
+        size_t i = 0;
+        for(; i + 4 <= size; i += 4) {
+            store32_le(&out[i], load32_le(&in[i]) ^ x[i / 4]);
+        }
+        for(; i < size; i++) {
+            out[i] = in[i] ^ (uint8_t)(x[i / 4] >> ((i % 4) * 8));
+        }
+    }
+
+    memset(x, 0, sizeof(x));
+}
+
+/**
+ * Poly1305 state, 26-bit limbs (32x32->64 multiplies only)
+ */
+typedef struct {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} Poly1305;
+
+static void poly1305_init(Poly1305* st, const uint8_t* key) {
+    st->r[0] = (load32_le(&key[0])) & 0x3ffffff;
+    st->r[1] = (load32_le(&key[3]) >> 2) & 0x3ffff03;
+    st->r[2] = (load32_le(&key[6]) >> 4) & 0x3ffc0ff;
+    st->r[3] = (load32_le(&key[9]) >> 6) & 0x3f03fff;
+    st->r[4] = (load32_le(&key[12]) >> 8) & 0x00fffff;
+
+    memset(st->h, 0, sizeof(st->h));
+
+    for(int i = 0; i < 4; i++) {
+        st->pad[i] = load32_le(&key[16 + i * 4]);
+    }
+}
+
+/**
+ * Absorb one 16-byte block; hibit is 1 << 24 for full blocks, 0 for the padded tail
+ */
+static void poly1305_block(Poly1305* st, const uint8_t* m, uint32_t hibit) {
+    uint32_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2], r3 = st->r[3], r4 = st->r[4];
+    uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    h0 += (load32_le(&m[0])) & 0x3ffffff;
+    h1 += (load32_le(&m[3]) >> 2) & 0x3ffffff;
+    h2 += (load32_le(&m[6]) >> 4) & 0x3ffffff;
+    h3 += (load32_le(&m[9]) >> 6) & 0x3ffffff;
+    h4 += (load32_le(&m[12]) >> 8) | hibit;
+
+    uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 +
+                  (uint64_t)h4 * s1;
+    uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 +
+                  (uint64_t)h4 * s2;
+    uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 +
+                  (uint64_t)h4 * s3;
+    uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 +
+                  (uint64_t)h4 * s4;
+    uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 +
+                  (uint64_t)h4 * r0;
+
+    uint32_t c;
+    c = (uint32_t)(d0 >> 26);
+    h0 = (uint32_t)d0 & 0x3ffffff;
+    d1 += c;
+    c = (uint32_t)(d1 >> 26);
+    h1 = (uint32_t)d1 & 0x3ffffff;
+    d2 += c;
+    c = (uint32_t)(d2 >> 26);
+    h2 = (uint32_t)d2 & 0x3ffffff;
+    d3 += c;
+    c = (uint32_t)(d3 >> 26);
+    h3 = (uint32_t)d3 & 0x3ffffff;
+    d4 += c;
+    c = (uint32_t)(d4 >> 26);
+    h4 = (uint32_t)d4 & 0x3ffffff;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3ffffff;
+    h1 += c;
+
+    st->h[0] = h0;
+    st->h[1] = h1;
+    st->h[2] = h2;
+    st->h[3] = h3;
+    st->h[4] = h4;
+}
+
+/**
+ * Absorb data zero-padded to a multiple of 16 bytes (the RFC 8439 AEAD layout)
+ */
+static void poly1305_update_padded(Poly1305* st, const uint8_t* data, size_t size) {
+    while(size >= 16) {
+        poly1305_block(st, data, 1 << 24);
+        data += 16;
+        size -= 16;
+    }
+    if(size > 0) {
+        uint8_t block[16] = {0};
+        memcpy(block, data, size);
+        poly1305_block(st, block, 1 << 24);
+    }
+}
+
+static void poly1305_finish(Poly1305* st, uint8_t* mac) {
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+    uint32_t c;
+
+    c = h1 >> 26;
+    h1 &= 0x3ffffff;
+    h2 += c;
+    c = h2 >> 26;
+    h2 &= 0x3ffffff;
+    h3 += c;
+    c = h3 >> 26;
+    h3 &= 0x3ffffff;
+    h4 += c;
+    c = h4 >> 26;
+    h4 &= 0x3ffffff;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3ffffff;
+    h1 += c;
+
+    // g = h + 5 - 2^130; use g if it did not underflow
+    uint32_t g0 = h0 + 5;
+    c = g0 >> 26;
+    g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c;
+    c = g1 >> 26;
+    g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c;
+    c = g2 >> 26;
+    g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c;
+    c = g3 >> 26;
+    g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1UL << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    // h mod 2^128, then add the pad
+    uint32_t w0 = h0 | (h1 << 26);
+    uint32_t w1 = (h1 >> 6) | (h2 << 20);
+    uint32_t w2 = (h2 >> 12) | (h3 << 14);
+    uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f;
+    f = (uint64_t)w0 + st->pad[0];
+    store32_le(&mac[0], (uint32_t)f);
+    f = (uint64_t)w1 + st->pad[1] + (f >> 32);
+    store32_le(&mac[4], (uint32_t)f);
+    f = (uint64_t)w2 + st->pad[2] + (f >> 32);
+    store32_le(&mac[8], (uint32_t)f);
+    f = (uint64_t)w3 + st->pad[3] + (f >> 32);
+    store32_le(&mac[12], (uint32_t)f);
+
+    memset(st, 0, sizeof(Poly1305));
+}
+
+/**
+ * Tag over ad || pad || ciphertext || pad || lengths
+ */
+static void chachapoly_tag(
+    const uint8_t* key,
+    const uint8_t* nonce,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* ciphertext,
+    size_t size,
+    uint8_t* tag) {
+    ChaCha20 chacha;
+    uint32_t block[16];
+    uint8_t poly_key[32];
+    uint8_t lengths[16];
+    Poly1305 st;
+
+    // The one-time Poly1305 key is the first half of keystream block 0
+    chacha20_init(&chacha, key, nonce, 0);
+    chacha20_block(&chacha, block);
+    for(int i = 0; i < 8; i++) {
+        store32_le(&poly_key[i * 4], block[i]);
+    }
+    poly1305_init(&st, poly_key);
+
+    poly1305_update_padded(&st, ad, ad_size);
+    poly1305_update_padded(&st, ciphertext, size);
+
+    for(int i = 0; i < 8; i++) {
+        lengths[i] = ((uint64_t)ad_size >> (i * 8)) & 0xFF;
+        lengths[8 + i] = ((uint64_t)size >> (i * 8)) & 0xFF;
+    }
+    poly1305_block(&st, lengths, 1 << 24);
+    poly1305_finish(&st, tag);
+
+    memset(block, 0, sizeof(block));
+    memset(poly_key, 0, sizeof(poly_key));
+    memset(&chacha, 0, sizeof(chacha));
+}
+
+/**
+ * Encrypt and authenticate
+ */
+void bitchat_chachapoly_encrypt(
+    const uint8_t* key,
+    const uint8_t* nonce,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* plaintext,
+    size_t size,
+    uint8_t* ciphertext,
+    uint8_t* tag) {
+    ChaCha20 chacha;
+    chacha20_init(&chacha, key, nonce, 1);
+    chacha20_xor(&chacha, plaintext, ciphertext, size);
+    memset(&chacha, 0, sizeof(chacha));
+
+    chachapoly_tag(key, nonce, ad, ad_size, ciphertext, size, tag);
+}
+
+/**
+ * Check the tag and decrypt
+ */
+bool bitchat_chachapoly_decrypt(
+    const uint8_t* key,
+    const uint8_t* nonce,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* ciphertext,
+    size_t size,
+    const uint8_t* tag,
+    uint8_t* plaintext) {
+    uint8_t expected[BITCHAT_CHACHAPOLY_TAG_SIZE];
+    chachapoly_tag(key, nonce, ad, ad_size, ciphertext, size, expected);
+
+    uint8_t diff = 0;
+    for(int i = 0; i < BITCHAT_CHACHAPOLY_TAG_SIZE; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if(diff != 0) return false;
+
+    if(plaintext) {
+        ChaCha20 chacha;
+        chacha20_init(&chacha, key, nonce, 1);
+        chacha20_xor(&chacha, ciphertext, plaintext, size);
+        memset(&chacha, 0, sizeof(chacha));
+    }
+    return true;
+}
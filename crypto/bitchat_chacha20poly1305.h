@@ -0,0 +1,58 @@
+/**
+ * BitChat ChaCha20-Poly1305 AEAD
+ * RFC 8439 authenticated encryption used by Noise
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_CHACHAPOLY_KEY_SIZE 32
+#define BITCHAT_CHACHAPOLY_NONCE_SIZE 12
+#define BITCHAT_CHACHAPOLY_TAG_SIZE 16
+
+/**
+ * Encrypt and authenticate
+ * @param key 32-byte key
+ * @param nonce 12-byte nonce
+ * @param ad Associated data (may be NULL if ad_size is 0)
+ * @param ad_size Associated data size
+ * @param plaintext Input data
+ * @param size Input size
+ * @param ciphertext Output buffer of the same size (may equal plaintext)
+ * @param tag Output authentication tag (16 bytes)
+ */
+void bitchat_chachapoly_encrypt(
+    const uint8_t* key,
+    const uint8_t* nonce,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* plaintext,
+    size_t size,
+    uint8_t* ciphertext,
+    uint8_t* tag);
+
+/**
+ * Check the tag and decrypt; nothing is written if the tag is wrong
+ * @param key 32-byte key
+ * @param nonce 12-byte nonce
+ * @param ad Associated data (may be NULL if ad_size is 0)
+ * @param ad_size Associated data size
+ * @param ciphertext Input data
+ * @param size Input size
+ * @param tag Authentication tag (16 bytes)
+ * @param plaintext Output buffer of the same size (may equal ciphertext),
+ *                  or NULL to only check the tag
+ * @return true if the tag matched
+ */
+bool bitchat_chachapoly_decrypt(
+    const uint8_t* key,
+    const uint8_t* nonce,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* ciphertext,
+    size_t size,
+    const uint8_t* tag,
+    uint8_t* plaintext);
@@ -0,0 +1,580 @@
+/**
+ * BitChat Ed25519 Signatures Implementation
+ */
+
+#include "bitchat_ed25519.h"
+#include "bitchat_fe25519.h"
+#include "bitchat_sha512.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Point in extended coordinates: x = X/Z, y = Y/Z, x*y = T/Z
+ */
+typedef struct {
+    BitchatFe25519 X;
+    BitchatFe25519 Y;
+    BitchatFe25519 Z;
+    BitchatFe25519 T;
+} GePoint;
+
+/**
+ * Point prepared for repeated addition
+ */
+typedef struct {
+    BitchatFe25519 YplusX;
+    BitchatFe25519 YminusX;
+    BitchatFe25519 Z2;
+    BitchatFe25519 T2d;
+} GeCached;
+
+static const BitchatFe25519 ge_d = {
+    -10913610, 13857413, -15372611, 6949391, 114729,
+    -8787816, -6275908, -3247719, -18696448, -12055116};
+
+static const BitchatFe25519 ge_d2 = {
+    -21827239, -5839606, -30745221, 13898782, 229458,
+    15978800, -12551817, -6495438, 29715968, 9444199};
+
+static const BitchatFe25519 ge_sqrtm1 = {
+    -32595792, -7943725, 9377950, 3500415, 12389472,
+    -272473, -25146209, -2005654, 326686, 11406482};
+
+static const GePoint ge_base = {
+    {-14297830, -7645148, 16144683, -16471763, 27570974,
+     -2696100, -26142465, 8378389, 20764389, 8758491},
+    {-26843541, -6710886, 13421773, -13421773, 26843546,
+     6710886, -13421773, 13421773, -26843546, -6710886},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {28827062, -6116119, -27349572, 244363, 8635006,
+     11264893, 19351346, 13413597, 16611511, -6414980},
+};
+
+// Group order L = 2^252 + 27742317777372353535851937790883648493, little-endian
+static const int64_t sc_order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10};
+
+/* ---- Group operations ---- */
+
+static void ge_identity(GePoint* p) {
+    bitchat_fe25519_0(p->X);
+    bitchat_fe25519_1(p->Y);
+    bitchat_fe25519_1(p->Z);
+    bitchat_fe25519_0(p->T);
+}
+
+static void ge_to_cached(GeCached* c, const GePoint* p) {
+    bitchat_fe25519_add(c->YplusX, p->Y, p->X);
+    bitchat_fe25519_sub(c->YminusX, p->Y, p->X);
+    bitchat_fe25519_add(c->Z2, p->Z, p->Z);
+    bitchat_fe25519_mul(c->T2d, p->T, ge_d2);
+}
+
+/**
+ * r = p + q (complete formula, also valid for doubling)
+ */
+static void ge_add(GePoint* r, const GePoint* p, const GeCached* q) {
+    BitchatFe25519 a, b, c, d, e, f, g, h;
+
+    bitchat_fe25519_sub(a, p->Y, p->X);
+    bitchat_fe25519_mul(a, a, q->YminusX);
+    bitchat_fe25519_add(b, p->Y, p->X);
+    bitchat_fe25519_mul(b, b, q->YplusX);
+    bitchat_fe25519_mul(c, p->T, q->T2d);
+    bitchat_fe25519_mul(d, p->Z, q->Z2);
+
+    bitchat_fe25519_sub(e, b, a);
+    bitchat_fe25519_sub(f, d, c);
+    bitchat_fe25519_add(g, d, c);
+    bitchat_fe25519_add(h, b, a);
+
+    bitchat_fe25519_mul(r->X, e, f);
+    bitchat_fe25519_mul(r->Y, g, h);
+    bitchat_fe25519_mul(r->T, e, h);
+    bitchat_fe25519_mul(r->Z, f, g);
+}
+
+/**
+ * r = 2p
+ */
+static void ge_double(GePoint* r, const GePoint* p) {
+    BitchatFe25519 a, b, c, e, f, g, h;
+
+    bitchat_fe25519_sq(a, p->X);
+    bitchat_fe25519_sq(b, p->Y);
+    bitchat_fe25519_sq(c, p->Z);
+    bitchat_fe25519_add(c, c, c);
+    bitchat_fe25519_add(e, p->X, p->Y);
+    bitchat_fe25519_sq(e, e);
+
+    // a = -1: E = (X+Y)^2 - A - B, G = B - A, F = G - C, H = -(A + B)
+    bitchat_fe25519_add(h, a, b);
+    bitchat_fe25519_sub(e, e, h);
+    bitchat_fe25519_sub(g, b, a);
+    bitchat_fe25519_sub(f, g, c);
+    bitchat_fe25519_neg(h, h);
+    bitchat_fe25519_carry(e);
+    bitchat_fe25519_carry(f);
+
+    bitchat_fe25519_mul(r->X, e, f);
+    bitchat_fe25519_mul(r->Y, g, h);
+    bitchat_fe25519_mul(r->T, e, h);
+    bitchat_fe25519_mul(r->Z, f, g);
+}
+
+static void ge_neg(GePoint* r, const GePoint* p) {
+    bitchat_fe25519_neg(r->X, p->X);
+    bitchat_fe25519_copy(r->Y, p->Y);
+    bitchat_fe25519_copy(r->Z, p->Z);
+    bitchat_fe25519_neg(r->T, p->T);
+}
+
+static void ge_cswap(GePoint* p, GePoint* q, uint32_t b) {
+    bitchat_fe25519_cswap(p->X, q->X, b);
+    bitchat_fe25519_cswap(p->Y, q->Y, b);
+    bitchat_fe25519_cswap(p->Z, q->Z, b);
+    bitchat_fe25519_cswap(p->T, q->T, b);
+}
+
+static bool ge_is_identity(const GePoint* p) {
+    BitchatFe25519 t;
+    bitchat_fe25519_sub(t, p->Y, p->Z);
+    return !bitchat_fe25519_isnonzero(p->X) && !bitchat_fe25519_isnonzero(t);
+}
+
+static void ge_tobytes(uint8_t* s, const GePoint* p) {
+    BitchatFe25519 recip, x, y;
+    bitchat_fe25519_invert(recip, p->Z);
+    bitchat_fe25519_mul(x, p->X, recip);
+    bitchat_fe25519_mul(y, p->Y, recip);
+    bitchat_fe25519_tobytes(s, y);
+    s[31] ^= bitchat_fe25519_isnegative(x) << 7;
+}
+
+/**
+ * Decode a point, rejecting non-canonical y and x = 0 with the sign bit set
+ */
+static bool ge_frombytes(GePoint* p, const uint8_t* s) {
+    BitchatFe25519 u, v, v3, vxx, check;
+    uint8_t canonical[32];
+
+    bitchat_fe25519_frombytes(p->Y, s);
+    bitchat_fe25519_tobytes(canonical, p->Y);
+    canonical[31] |= s[31] & 0x80;
+    if(memcmp(canonical, s, 32) != 0) return false;
+
+    bitchat_fe25519_1(p->Z);
+    bitchat_fe25519_sq(u, p->Y);
+    bitchat_fe25519_mul(v, u, ge_d);
+    bitchat_fe25519_sub(u, u, p->Z); // u = y^2 - 1
+    bitchat_fe25519_add(v, v, p->Z); // v = d*y^2 + 1
+
+    // x = u * v^3 * (u * v^7)^((p - 5) / 8)
+    bitchat_fe25519_sq(v3, v);
+    bitchat_fe25519_mul(v3, v3, v);
+    bitchat_fe25519_sq(p->X, v3);
+    bitchat_fe25519_mul(p->X, p->X, v);
+    bitchat_fe25519_mul(p->X, p->X, u);
+    bitchat_fe25519_pow22523(p->X, p->X);
+    bitchat_fe25519_mul(p->X, p->X, v3);
+    bitchat_fe25519_mul(p->X, p->X, u);
+
+    bitchat_fe25519_sq(vxx, p->X);
+    bitchat_fe25519_mul(vxx, vxx, v);
+    bitchat_fe25519_sub(check, vxx, u);
+    if(bitchat_fe25519_isnonzero(check)) {
+        bitchat_fe25519_add(check, vxx, u);
+        if(bitchat_fe25519_isnonzero(check)) return false;
+        bitchat_fe25519_mul(p->X, p->X, ge_sqrtm1);
+    }
+
+    uint8_t sign = s[31] >> 7;
+    if(!bitchat_fe25519_isnonzero(p->X) && sign) return false;
+    if(bitchat_fe25519_isnegative(p->X) != sign) {
+        bitchat_fe25519_neg(p->X, p->X);
+    }
+
+    bitchat_fe25519_mul(p->T, p->X, p->Y);
+    return true;
+}
+
+/**
+ * r = [scalar]B in constant time (secret scalars only)
+ */
+static void ge_scalarmult_base(GePoint* r, const uint8_t* scalar) {
+    GePoint r1;
+    GeCached cached;
+
+    ge_identity(r);
+    r1 = ge_base;
+
+    // Ladder invariant: r1 = r + B
+    for(int i = 255; i >= 0; i--) {
+        uint32_t bit = (scalar[i >> 3] >> (i & 7)) & 1;
+        ge_cswap(r, &r1, bit);
+        ge_to_cached(&cached, r);
+        ge_add(&r1, &r1, &cached);
+        ge_double(r, r);
+        ge_cswap(r, &r1, bit);
+    }
+}
+
+/**
+ * r = sum(scalars[i] * points[i]) in variable time (public data only).
+ * Straus' method: every term shares the same 256 doublings.
+ */
+static void ge_multiscalarmult_vartime(
+    GePoint* r,
+    const GeCached* points,
+    const uint8_t (*scalars)[32],
+    size_t count) {
+    int top = -1;
+    for(size_t k = 0; k < count; k++) {
+        for(int i = 255; i > top; i--) {
+            if((scalars[k][i >> 3] >> (i & 7)) & 1) {
+                top = i;
+                break;
+            }
+        }
+    }
+
+    ge_identity(r);
+    for(int i = top; i >= 0; i--) {
+        ge_double(r, r);
+        for(size_t k = 0; k < count; k++) {
+            if((scalars[k][i >> 3] >> (i & 7)) & 1) {
+                ge_add(r, r, &points[k]);
+            }
+        }
+    }
+}
+
+/**
+ * [8]p == identity
+ */
+static bool ge_is_small_order_sum(GePoint* p) {
+    ge_double(p, p);
+    ge_double(p, p);
+    ge_double(p, p);
+    return ge_is_identity(p);
+}
+
+/* ---- Scalar arithmetic mod L ---- */
+
+/**
+ * r = x mod L, where x holds 64 signed byte-sized limbs
+ */
+static void sc_mod_order(uint8_t* r, int64_t* x) {
+    int64_t carry;
+    int i, j;
+
+    for(i = 63; i >= 32; i--) {
+        carry = 0;
+        for(j = i - 32; j < i - 12; j++) {
+            x[j] += carry - 16 * x[i] * sc_order[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+
+    carry = 0;
+    for(j = 0; j < 32; j++) {
+        x[j] += carry - (x[31] >> 4) * sc_order[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for(j = 0; j < 32; j++) {
+        x[j] -= carry * sc_order[j];
+    }
+    for(i = 0; i < 32; i++) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = x[i] & 255;
+    }
+}
+
+/**
+ * Reduce a 64-byte hash to a scalar
+ */
+static void sc_reduce(uint8_t* r, const uint8_t* hash) {
+    int64_t x[64];
+    for(int i = 0; i < 64; i++) {
+        x[i] = hash[i];
+    }
+    sc_mod_order(r, x);
+}
+
+/**
+ * r = a * b + c mod L
+ */
+static void sc_muladd(uint8_t* r, const uint8_t* a, const uint8_t* b, const uint8_t* c) {
+    int64_t x[64] = {0};
+    for(int i = 0; i < 32; i++) {
+        x[i] = c[i];
+    }
+    for(int i = 0; i < 32; i++) {
+        for(int j = 0; j < 32; j++) {
+            x[i + j] += (int64_t)a[i] * b[j];
+        }
+    }
+    sc_mod_order(r, x);
+}
+
+/**
+ * s < L (rejects malleable signatures)
+ */
+static bool sc_is_canonical(const uint8_t* s) {
+    for(int i = 31; i >= 0; i--) {
+        if(s[i] < sc_order[i]) return true;
+        if(s[i] > sc_order[i]) return false;
+    }
+    return false;
+}
+
+/**
+ * h = SHA-512(R || A || M) mod L
+ */
+static void ed25519_challenge(
+    uint8_t* h,
+    const uint8_t* r,
+    const uint8_t* public_key,
+    const uint8_t* message,
+    size_t size) {
+    BitchatSha512 sha;
+    uint8_t digest[BITCHAT_SHA512_DIGEST_SIZE];
+
+    bitchat_sha512_init(&sha);
+    bitchat_sha512_update(&sha, r, 32);
+    bitchat_sha512_update(&sha, public_key, BITCHAT_ED25519_PUBLIC_KEY_SIZE);
+    bitchat_sha512_update(&sha, message, size);
+    bitchat_sha512_final(&sha, digest);
+    sc_reduce(h, digest);
+}
+
+/* ---- Public API ---- */
+
+/**
+ * Expand a seed into a signing key
+ */
+void bitchat_ed25519_expand(BitchatEd25519Key* key, const uint8_t* seed) {
+    uint8_t digest[BITCHAT_SHA512_DIGEST_SIZE];
+    GePoint a;
+
+    bitchat_sha512(seed, BITCHAT_ED25519_SEED_SIZE, digest);
+    digest[0] &= 248;
+    digest[31] &= 127;
+    digest[31] |= 64;
+
+    memcpy(key->scalar, digest, 32);
+    memcpy(key->prefix, &digest[32], 32);
+
+    ge_scalarmult_base(&a, key->scalar);
+    ge_tobytes(key->public_key, &a);
+
+    memset(digest, 0, sizeof(digest));
+}
+
+/**
+ * Securely erase an expanded key
+ */
+void bitchat_ed25519_wipe(BitchatEd25519Key* key) {
+    volatile uint8_t* p = (volatile uint8_t*)key;
+    for(size_t i = 0; i < sizeof(BitchatEd25519Key); i++) {
+        p[i] = 0;
+    }
+}
+
+/**
+ * Sign a message
+ */
+void bitchat_ed25519_sign(
+    const BitchatEd25519Key* key,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* signature) {
+    BitchatSha512 sha;
+    uint8_t digest[BITCHAT_SHA512_DIGEST_SIZE];
+    uint8_t nonce[32];
+    uint8_t h[32];
+    GePoint r;
+
+    // r = SHA-512(prefix || M) mod L
+    bitchat_sha512_init(&sha);
+    bitchat_sha512_update(&sha, key->prefix, 32);
+    bitchat_sha512_update(&sha, message, size);
+    bitchat_sha512_final(&sha, digest);
+    sc_reduce(nonce, digest);
+
+    ge_scalarmult_base(&r, nonce);
+    ge_tobytes(signature, &r);
+
+    // S = r + h * a mod L
+    ed25519_challenge(h, signature, key->public_key, message, size);
+    sc_muladd(&signature[32], h, key->scalar, nonce);
+
+    memset(nonce, 0, sizeof(nonce));
+    memset(digest, 0, sizeof(digest));
+}
+
+/**
+ * Verify a signature
+ */
+bool bitchat_ed25519_verify(
+    const uint8_t* public_key,
+    const uint8_t* message,
+    size_t size,
+    const uint8_t* signature) {
+    GePoint a, r, sum;
+    GeCached points[2];
+    GeCached neg_r;
+    uint8_t scalars[2][32];
+
+    if(!sc_is_canonical(&signature[32])) return false;
+    if(!ge_frombytes(&a, public_key)) return false;
+    if(!ge_frombytes(&r, signature)) return false;
+
+    // [S]B + [h](-A) - R must be a small-order point
+    memcpy(scalars[0], &signature[32], 32);
+    ed25519_challenge(scalars[1], signature, public_key, message, size);
+
+    ge_to_cached(&points[0], &ge_base);
+    ge_neg(&a, &a);
+    ge_to_cached(&points[1], &a);
+    ge_multiscalarmult_vartime(&sum, points, (const uint8_t(*)[32])scalars, 2);
+
+    ge_neg(&r, &r);
+    ge_to_cached(&neg_r, &r);
+    ge_add(&sum, &sum, &neg_r);
+
+    return ge_is_small_order_sum(&sum);
+}
+
+/**
+ * Verify several signatures with one multi-scalar multiplication.
+ *
+ * Checks [8]([sum z_i S_i]B - sum [z_i]R_i - sum [z_i h_i]A_i) = 0 with
+ * 128-bit coefficients z_i derived by hashing the whole batch, so a forger
+ * cannot pick signatures whose errors cancel out.
+ */
+size_t bitchat_ed25519_verify_batch(
+    const BitchatEd25519BatchItem* items,
+    size_t count,
+    bool* valid) {
+    if(count == 0) return 0;
+    if(count > BITCHAT_ED25519_BATCH_MAX) count = BITCHAT_ED25519_BATCH_MAX;
+
+    if(count == 1) {
+        valid[0] = bitchat_ed25519_verify(
+            items[0].public_key, items[0].message, items[0].message_size, items[0].signature);
+        return valid[0] ? 1 : 0;
+    }
+
+    // Term 0 is B, then one term per distinct key, then one per R
+    size_t max_terms = 1 + 2 * count;
+    GeCached* points = malloc(max_terms * sizeof(GeCached));
+    uint8_t(*scalars)[32] = malloc(max_terms * 32);
+    uint8_t(*challenges)[32] = malloc(count * 32);
+    size_t key_term[BITCHAT_ED25519_BATCH_MAX];
+
+    bool ok = true;
+    size_t terms = 1;
+    BitchatSha512 sha;
+    uint8_t transcript[BITCHAT_SHA512_DIGEST_SIZE];
+    GePoint p;
+
+    bitchat_sha512_init(&sha);
+    for(size_t i = 0; i < count && ok; i++) {
+        const BitchatEd25519BatchItem* item = &items[i];
+        if(!sc_is_canonical(&item->signature[32])) {
+            ok = false;
+            break;
+        }
+
+        // Reuse the term of an earlier item signed by the same key
+        key_term[i] = 0;
+        for(size_t j = 0; j < i; j++) {
+            if(memcmp(items[j].public_key, item->public_key, BITCHAT_ED25519_PUBLIC_KEY_SIZE) ==
+               0) {
+                key_term[i] = key_term[j];
+                break;
+            }
+        }
+        if(key_term[i] == 0) {
+            if(!ge_frombytes(&p, item->public_key)) {
+                ok = false;
+                break;
+            }
+            ge_neg(&p, &p);
+            ge_to_cached(&points[terms], &p);
+            memset(scalars[terms], 0, 32);
+            key_term[i] = terms++;
+        }
+
+        ed25519_challenge(
+            challenges[i], item->signature, item->public_key, item->message, item->message_size);
+        bitchat_sha512_update(&sha, item->signature, BITCHAT_ED25519_SIGNATURE_SIZE);
+        bitchat_sha512_update(&sha, item->public_key, BITCHAT_ED25519_PUBLIC_KEY_SIZE);
+        bitchat_sha512_update(&sha, challenges[i], 32);
+    }
+    bitchat_sha512_final(&sha, transcript);
+
+    if(ok) {
+        uint8_t b_scalar[32] = {0};
+
+        for(size_t i = 0; i < count && ok; i++) {
+            const BitchatEd25519BatchItem* item = &items[i];
+            uint8_t z[32] = {0};
+            uint8_t seed[BITCHAT_SHA512_DIGEST_SIZE + 1];
+            uint8_t digest[BITCHAT_SHA512_DIGEST_SIZE];
+
+            memcpy(seed, transcript, BITCHAT_SHA512_DIGEST_SIZE);
+            seed[BITCHAT_SHA512_DIGEST_SIZE] = (uint8_t)i;
+            bitchat_sha512(seed, sizeof(seed), digest);
+            memcpy(z, digest, 16);
+
+            if(!ge_frombytes(&p, item->signature)) {
+                ok = false;
+                break;
+            }
+            ge_neg(&p, &p);
+            ge_to_cached(&points[terms], &p);
+            memcpy(scalars[terms], z, 32);
+            terms++;
+
+            // B gets sum z_i S_i, the key term gets sum z_i h_i
+            sc_muladd(b_scalar, z, &item->signature[32], b_scalar);
+            size_t k = key_term[i];
+            sc_muladd(scalars[k], z, challenges[i], scalars[k]);
+        }
+
+        if(ok) {
+            ge_to_cached(&points[0], &ge_base);
+            memcpy(scalars[0], b_scalar, 32);
+
+            ge_multiscalarmult_vartime(&p, points, (const uint8_t(*)[32])scalars, terms);
+            ok = ge_is_small_order_sum(&p);
+        }
+    }
+
+    free(challenges);
+    free(scalars);
+    free(points);
+
+    size_t valid_count = 0;
+    if(ok) {
+        for(size_t i = 0; i < count; i++) {
+            valid[i] = true;
+        }
+        valid_count = count;
+    } else {
+        for(size_t i = 0; i < count; i++) {
+            valid[i] = bitchat_ed25519_verify(
+                items[i].public_key, items[i].message, items[i].message_size, items[i].signature);
+            if(valid[i]) valid_count++;
+        }
+    }
+
+    return valid_count;
+}
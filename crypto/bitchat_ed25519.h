@@ -0,0 +1,88 @@
+/**
+ * BitChat Ed25519 Signatures
+ * RFC 8032 signing with precomputed key expansion and batch verification
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_ED25519_SEED_SIZE 32
+#define BITCHAT_ED25519_PUBLIC_KEY_SIZE 32
+#define BITCHAT_ED25519_SIGNATURE_SIZE 64
+#define BITCHAT_ED25519_BATCH_MAX 8
+
+/**
+ * Expanded signing key.
+ * Derived once from the 32-byte seed so signing skips the seed hash
+ * and the public key derivation on every packet.
+ */
+typedef struct {
+    uint8_t scalar[32]; // Clamped secret scalar a
+    uint8_t prefix[32]; // Nonce prefix (upper half of SHA-512(seed))
+    uint8_t public_key[BITCHAT_ED25519_PUBLIC_KEY_SIZE]; // A = [a]B
+} BitchatEd25519Key;
+
+/**
+ * One signature to check in a batch
+ */
+typedef struct {
+    const uint8_t* public_key;
+    const uint8_t* message;
+    size_t message_size;
+    const uint8_t* signature;
+} BitchatEd25519BatchItem;
+
+/**
+ * Expand a seed into a signing key (hash, clamp and derive the public key)
+ * @param key Output key
+ * @param seed 32-byte secret seed
+ */
+void bitchat_ed25519_expand(BitchatEd25519Key* key, const uint8_t* seed);
+
+/**
+ * Securely erase an expanded key
+ */
+void bitchat_ed25519_wipe(BitchatEd25519Key* key);
+
+/**
+ * Sign a message
+ * @param key Expanded signing key
+ * @param message Message bytes
+ * @param size Message size
+ * @param signature Output buffer (64 bytes)
+ */
+void bitchat_ed25519_sign(
+    const BitchatEd25519Key* key,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* signature);
+
+/**
+ * Verify a signature.
+ * Uses the cofactored equation [8][S]B = [8]R + [8][h]A so that single and
+ * batch verification always agree.
+ * @return true if the signature is valid
+ */
+bool bitchat_ed25519_verify(
+    const uint8_t* public_key,
+    const uint8_t* message,
+    size_t size,
+    const uint8_t* signature);
+
+/**
+ * Verify up to BITCHAT_ED25519_BATCH_MAX signatures at once.
+ * All checks share one multi-scalar multiplication, and items signed by
+ * the same key share its scalar. If the combined check fails, each item
+ * is re-verified on its own to find the bad ones.
+ * @param items Signatures to check
+ * @param count Number of items (at most BITCHAT_ED25519_BATCH_MAX)
+ * @param valid Output array, one result per item
+ * @return Number of valid signatures
+ */
+size_t bitchat_ed25519_verify_batch(
+    const BitchatEd25519BatchItem* items,
+    size_t count,
+    bool* valid);
@@ -0,0 +1,263 @@
+/**
+ * BitChat GF(2^255 - 19) Field Arithmetic Implementation
+ */
+
+#include "bitchat_fe25519.h"
+#include <string.h>
+
+// Limb i holds bits [ceil(25.5 * i), ceil(25.5 * (i + 1))): 26 bits when even, 25 when odd
+#define FE_LIMB_BITS(i) (((i) & 1) ? 25 : 26)
+
+void bitchat_fe25519_0(BitchatFe25519 h) {
+    memset(h, 0, sizeof(BitchatFe25519));
+}
+
+void bitchat_fe25519_1(BitchatFe25519 h) {
+    memset(h, 0, sizeof(BitchatFe25519));
+    h[0] = 1;
+}
+
+void bitchat_fe25519_copy(BitchatFe25519 h, const BitchatFe25519 f) {
+    memmove(h, f, sizeof(BitchatFe25519));
+}
+
+void bitchat_fe25519_add(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g) {
+    for(int i = 0; i < 10; i++) {
+        h[i] = f[i] + g[i];
+    }
+}
+
+void bitchat_fe25519_sub(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g) {
+    for(int i = 0; i < 10; i++) {
+        h[i] = f[i] - g[i];
+    }
+}
+
+void bitchat_fe25519_neg(BitchatFe25519 h, const BitchatFe25519 f) {
+    for(int i = 0; i < 10; i++) {
+        h[i] = -f[i];
+    }
+}
+
+/**
+ * Rounding carry chain over 64-bit accumulators.
+ * Leaves |h[i]| <= 2^25 (2^24 for odd limbs, plus a small excess on limb 1).
+ */
+static void fe_carry_wide(BitchatFe25519 h, int64_t* t) {
+    for(int i = 0; i < 9; i++) {
+        int bits = FE_LIMB_BITS(i);
+        int64_t c = (t[i] + ((int64_t)1 << (bits - 1))) >> bits;
+        t[i + 1] += c;
+        t[i] -= c * ((int64_t)1 << bits);
+    }
+
+    int64_t c = (t[9] + ((int64_t)1 << 24)) >> 25;
+    t[9] -= c * ((int64_t)1 << 25);
+    t[0] += c * 19;
+
+    c = (t[0] + ((int64_t)1 << 25)) >> 26;
+    t[1] += c;
+    t[0] -= c * ((int64_t)1 << 26);
+
+    for(int i = 0; i < 10; i++) {
+        h[i] = (int32_t)t[i];
+    }
+}
+
+void bitchat_fe25519_carry(BitchatFe25519 h) {
+    int64_t t[10];
+    for(int i = 0; i < 10; i++) {
+        t[i] = h[i];
+    }
+    fe_carry_wide(h, t);
+}
+
+void bitchat_fe25519_mul(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g) {
+    int64_t t[10] = {0};
+
+    // Odd x odd limb products land half a bit low and need doubling;
+    // products that wrap past 2^255 fold back in with a factor of 19.
+    for(int i = 0; i < 10; i++) {
+        int32_t fi = f[i];
+        int32_t fi2 = (i & 1) ? 2 * fi : fi;
+        for(int j = 0; j < 10; j++) {
+            int64_t p = (int64_t)((j & 1) ? fi2 : fi) * g[j];
+            if(i + j < 10) {
+                t[i + j] += p;
+            } else {
+                t[i + j - 10] += p * 19;
+            }
+        }
+    }
+
+    fe_carry_wide(h, t);
+}
+
+void bitchat_fe25519_sq(BitchatFe25519 h, const BitchatFe25519 f) {
+    int64_t t[10] = {0};
+
+    // Same as mul, but each cross product is computed once and doubled
+    for(int i = 0; i < 10; i++) {
+        for(int j = i; j < 10; j++) {
+            int64_t p = (int64_t)f[i] * f[j];
+            if((i & 1) && (j & 1)) p *= 2;
+            if(i != j) p *= 2;
+            if(i + j < 10) {
+                t[i + j] += p;
+            } else {
+                t[i + j - 10] += p * 19;
+            }
+        }
+    }
+
+    fe_carry_wide(h, t);
+}
+
+void bitchat_fe25519_mul121666(BitchatFe25519 h, const BitchatFe25519 f) {
+    int64_t t[10];
+    for(int i = 0; i < 10; i++) {
+        t[i] = (int64_t)f[i] * 121666;
+    }
+    fe_carry_wide(h, t);
+}
+
+static void fe_sq_times(BitchatFe25519 h, const BitchatFe25519 f, int n) {
+    bitchat_fe25519_sq(h, f);
+    for(int i = 1; i < n; i++) {
+        bitchat_fe25519_sq(h, h);
+    }
+}
+
+/**
+ * Shared addition chain: out = z^(2^250 - 1), z11 = z^11
+ */
+static void fe_pow250(BitchatFe25519 out, BitchatFe25519 z11, const BitchatFe25519 z) {
+    BitchatFe25519 t0, t1, t2;
+
+    bitchat_fe25519_sq(t0, z); // z^2
+    fe_sq_times(t1, t0, 2); // z^8
+    bitchat_fe25519_mul(t1, t1, z); // z^9
+    bitchat_fe25519_mul(z11, t0, t1); // z^11
+    bitchat_fe25519_sq(t0, z11); // z^22
+    bitchat_fe25519_mul(t0, t0, t1); // z^(2^5 - 1)
+    fe_sq_times(t1, t0, 5);
+    bitchat_fe25519_mul(t0, t1, t0); // z^(2^10 - 1)
+    fe_sq_times(t1, t0, 10);
+    bitchat_fe25519_mul(t1, t1, t0); // z^(2^20 - 1)
+    fe_sq_times(t2, t1, 20);
+    bitchat_fe25519_mul(t1, t2, t1); // z^(2^40 - 1)
+    fe_sq_times(t1, t1, 10);
+    bitchat_fe25519_mul(t0, t1, t0); // z^(2^50 - 1)
+    fe_sq_times(t1, t0, 50);
+    bitchat_fe25519_mul(t1, t1, t0); // z^(2^100 - 1)
+    fe_sq_times(t2, t1, 100);
+    bitchat_fe25519_mul(t1, t2, t1); // z^(2^200 - 1)
+    fe_sq_times(t1, t1, 50);
+    bitchat_fe25519_mul(out, t1, t0); // z^(2^250 - 1)
+}
+
+void bitchat_fe25519_invert(BitchatFe25519 h, const BitchatFe25519 z) {
+    BitchatFe25519 t, z11;
+    fe_pow250(t, z11, z);
+    fe_sq_times(t, t, 5); // z^(2^255 - 32)
+    bitchat_fe25519_mul(h, t, z11); // z^(2^255 - 21) = z^(p - 2)
+}
+
+void bitchat_fe25519_pow22523(BitchatFe25519 h, const BitchatFe25519 z) {
+    BitchatFe25519 t, z11;
+    fe_pow250(t, z11, z);
+    fe_sq_times(t, t, 2); // z^(2^252 - 4)
+    bitchat_fe25519_mul(h, t, z); // z^(2^252 - 3)
+}
+
+void bitchat_fe25519_cswap(BitchatFe25519 f, BitchatFe25519 g, uint32_t b) {
+    int32_t mask = -(int32_t)b;
+    for(int i = 0; i < 10; i++) {
+        int32_t x = (f[i] ^ g[i]) & mask;
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+void bitchat_fe25519_cmov(BitchatFe25519 f, const BitchatFe25519 g, uint32_t b) {
+    int32_t mask = -(int32_t)b;
+    for(int i = 0; i < 10; i++) {
+        f[i] ^= (f[i] ^ g[i]) & mask;
+    }
+}
+
+void bitchat_fe25519_frombytes(BitchatFe25519 h, const uint8_t* s) {
+    int64_t t[10];
+    int shift = 0;
+
+    for(int i = 0; i < 10; i++) {
+        int bits = FE_LIMB_BITS(i);
+        uint64_t v = 0;
+        // Gather the bytes covering this limb
+        int byte = shift / 8;
+        for(int k = 0; k < 5 && byte + k < 32; k++) {
+            v |= (uint64_t)s[byte + k] << (8 * k);
+        }
+        v >>= shift % 8;
+        t[i] = (int64_t)(v & ((1u << bits) - 1));
+        shift += bits;
+    }
+    // shift is now 255, so bit 255 is dropped by the final mask
+
+    fe_carry_wide(h, t);
+}
+
+void bitchat_fe25519_tobytes(uint8_t* s, const BitchatFe25519 h) {
+    int32_t t[10];
+    memcpy(t, h, sizeof(t));
+    bitchat_fe25519_carry(t);
+
+    // q = floor((h + 19) / 2^255), i.e. 1 when h >= p
+    int32_t q = (19 * t[9] + ((int32_t)1 << 24)) >> 25;
+    for(int i = 0; i < 10; i++) {
+        q = (t[i] + q) >> FE_LIMB_BITS(i);
+    }
+
+    // h - q * p = h + 19q - 2^255 q; the 2^255 term falls off the top limb
+    t[0] += 19 * q;
+    for(int i = 0; i < 9; i++) {
+        int bits = FE_LIMB_BITS(i);
+        int32_t c = t[i] >> bits;
+        t[i + 1] += c;
+        t[i] -= c * ((int32_t)1 << bits);
+    }
+    t[9] &= (1 << 25) - 1;
+
+    memset(s, 0, 32);
+    int shift = 0;
+    for(int i = 0; i < 10; i++) {
+        uint32_t v = (uint32_t)t[i];
+        int byte = shift / 8;
+        int bit = shift % 8;
+        for(int k = 0; k < 5 && byte + k < 32; k++) {
+            int offset = 8 * k - bit;
+            if(offset < 0) {
+                s[byte + k] |= (uint8_t)(v << -offset);
+            } else if(offset < 32) {
+                s[byte + k] |= (uint8_t)(v >> offset);
+            }
+        }
+        shift += FE_LIMB_BITS(i);
+    }
+}
+
+bool bitchat_fe25519_isnonzero(const BitchatFe25519 f) {
+    uint8_t s[32];
+    bitchat_fe25519_tobytes(s, f);
+    uint8_t acc = 0;
+    for(int i = 0; i < 32; i++) {
+        acc |= s[i];
+    }
+    return acc != 0;
+}
+
+uint8_t bitchat_fe25519_isnegative(const BitchatFe25519 f) {
+    uint8_t s[32];
+    bitchat_fe25519_tobytes(s, f);
+    return s[0] & 1;
+}
@@ -0,0 +1,69 @@
+/**
+ * BitChat GF(2^255 - 19) Field Arithmetic
+ * Shared by Ed25519 and X25519
+ *
+ * Elements use ten signed 32-bit limbs in radix 2^25.5 so that every
+ * limb product is a single 32x32->64 multiply on Cortex-M4.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t BitchatFe25519[10];
+
+void bitchat_fe25519_0(BitchatFe25519 h);
+void bitchat_fe25519_1(BitchatFe25519 h);
+void bitchat_fe25519_copy(BitchatFe25519 h, const BitchatFe25519 f);
+
+/**
+ * h = f + g and h = f - g, without carrying.
+ * Operands must come from a multiply or carry, or be at most one add deep.
+ */
+void bitchat_fe25519_add(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g);
+void bitchat_fe25519_sub(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g);
+void bitchat_fe25519_neg(BitchatFe25519 h, const BitchatFe25519 f);
+
+/**
+ * Bring limbs back into their nominal range after additions
+ */
+void bitchat_fe25519_carry(BitchatFe25519 h);
+
+void bitchat_fe25519_mul(BitchatFe25519 h, const BitchatFe25519 f, const BitchatFe25519 g);
+void bitchat_fe25519_sq(BitchatFe25519 h, const BitchatFe25519 f);
+
+/**
+ * h = f * 121666, the X25519 ladder constant (A + 2) / 4
+ */
+void bitchat_fe25519_mul121666(BitchatFe25519 h, const BitchatFe25519 f);
+
+void bitchat_fe25519_invert(BitchatFe25519 h, const BitchatFe25519 z);
+
+/**
+ * h = z^((p - 5) / 8), used for square roots during point decoding
+ */
+void bitchat_fe25519_pow22523(BitchatFe25519 h, const BitchatFe25519 z);
+
+/**
+ * Constant-time conditional swap/move when b is 1
+ */
+void bitchat_fe25519_cswap(BitchatFe25519 f, BitchatFe25519 g, uint32_t b);
+void bitchat_fe25519_cmov(BitchatFe25519 f, const BitchatFe25519 g, uint32_t b);
+
+/**
+ * Decode 32 little-endian bytes, ignoring the top bit
+ */
+void bitchat_fe25519_frombytes(BitchatFe25519 h, const uint8_t* s);
+
+/**
+ * Encode the canonical (fully reduced) little-endian form
+ */
+void bitchat_fe25519_tobytes(uint8_t* s, const BitchatFe25519 h);
+
+bool bitchat_fe25519_isnonzero(const BitchatFe25519 f);
+
+/**
+ * Low bit of the canonical encoding (the "sign" of x in Ed25519)
+ */
+uint8_t bitchat_fe25519_isnegative(const BitchatFe25519 f);
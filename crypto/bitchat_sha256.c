@@ -0,0 +1,191 @@
+/**
+ * BitChat SHA-256 Implementation
+ */
+
+#include "bitchat_sha256.h"
+#include <string.h>
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Process one 64-byte block
+ */
+static void sha256_compress(uint32_t* state, const uint8_t* block) {
+    uint32_t w[16];
+    for(int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for(int i = 0; i < 64; i++) {
+        if(i >= 16) {
+            uint32_t w15 = w[(i - 15) & 15];
+            uint32_t w2 = w[(i - 2) & 15];
+            uint32_t s0 = ROTR32(w15, 7) ^ ROTR32(w15, 18) ^ (w15 >> 3);
+            uint32_t s1 = ROTR32(w2, 17) ^ ROTR32(w2, 19) ^ (w2 >> 10);
+            w[i & 15] += s0 + s1 + w[(i - 7) & 15];
+        }
+
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) +
+                      sha256_k[i] + w[i & 15];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+/**
+ * Start a new hash
+ */
+void bitchat_sha256_init(BitchatSha256* ctx) {
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->length = 0;
+    ctx->block_used = 0;
+}
+
+/**
+ * Feed data into the hash
+ */
+void bitchat_sha256_update(BitchatSha256* ctx, const uint8_t* data, size_t size) {
+    if(size == 0) return;
+    ctx->length += size;
+
+    if(ctx->block_used > 0) {
+        size_t take = BITCHAT_SHA256_BLOCK_SIZE - ctx->block_used;
+        if(take > size) take = size;
+        memcpy(&ctx->block[ctx->block_used], data, take);
+        ctx->block_used += take;
+        data += take;
+        size -= take;
+
+        if(ctx->block_used < BITCHAT_SHA256_BLOCK_SIZE) return;
+        sha256_compress(ctx->state, ctx->block);
+        ctx->block_used = 0;
+    }
+
+    while(size >= BITCHAT_SHA256_BLOCK_SIZE) {
+        sha256_compress(ctx->state, data);
+        data += BITCHAT_SHA256_BLOCK_SIZE;
+        size -= BITCHAT_SHA256_BLOCK_SIZE;
+    }
+
+    if(size > 0) {
+        memcpy(ctx->block, data, size);
+        ctx->block_used = size;
+    }
+}
+
+/**
+ * Finish the hash and write the 32-byte digest
+ */
+void bitchat_sha256_final(BitchatSha256* ctx, uint8_t* digest) {
+    uint64_t bit_length = ctx->length * 8;
+
+    ctx->block[ctx->block_used++] = 0x80;
+    if(ctx->block_used > BITCHAT_SHA256_BLOCK_SIZE - 8) {
+        memset(&ctx->block[ctx->block_used], 0, BITCHAT_SHA256_BLOCK_SIZE - ctx->block_used);
+        sha256_compress(ctx->state, ctx->block);
+        ctx->block_used = 0;
+    }
+    memset(&ctx->block[ctx->block_used], 0, BITCHAT_SHA256_BLOCK_SIZE - ctx->block_used);
+
+    for(int i = 0; i < 8; i++) {
+        ctx->block[BITCHAT_SHA256_BLOCK_SIZE - 1 - i] = (bit_length >> (i * 8)) & 0xFF;
+    }
+    sha256_compress(ctx->state, ctx->block);
+
+    for(int i = 0; i < 8; i++) {
+        digest[i * 4] = (ctx->state[i] >> 24) & 0xFF;
+        digest[i * 4 + 1] = (ctx->state[i] >> 16) & 0xFF;
+        digest[i * 4 + 2] = (ctx->state[i] >> 8) & 0xFF;
+        digest[i * 4 + 3] = ctx->state[i] & 0xFF;
+    }
+
+    memset(ctx, 0, sizeof(BitchatSha256));
+}
+
+/**
+ * Hash a single buffer
+ */
+void bitchat_sha256(const uint8_t* data, size_t size, uint8_t* digest) {
+    BitchatSha256 ctx;
+    bitchat_sha256_init(&ctx);
+    bitchat_sha256_update(&ctx, data, size);
+    bitchat_sha256_final(&ctx, digest);
+}
+
+/**
+ * HMAC-SHA256 over data1 || data2
+ */
+void bitchat_hmac_sha256(
+    const uint8_t* key,
+    size_t key_size,
+    const uint8_t* data1,
+    size_t size1,
+    const uint8_t* data2,
+    size_t size2,
+    uint8_t* mac) {
+    uint8_t pad[BITCHAT_SHA256_BLOCK_SIZE];
+    uint8_t inner[BITCHAT_SHA256_DIGEST_SIZE];
+    BitchatSha256 ctx;
+
+    // Keys longer than a block are never used by Noise
+    memset(pad, 0, sizeof(pad));
+    memcpy(pad, key, key_size < sizeof(pad) ? key_size : sizeof(pad));
+
+    for(size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] ^= 0x36;
+    }
+    bitchat_sha256_init(&ctx);
+    bitchat_sha256_update(&ctx, pad, sizeof(pad));
+    if(size1 > 0) bitchat_sha256_update(&ctx, data1, size1);
+    if(size2 > 0) bitchat_sha256_update(&ctx, data2, size2);
+    bitchat_sha256_final(&ctx, inner);
+
+    for(size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] ^= 0x36 ^ 0x5c;
+    }
+    bitchat_sha256_init(&ctx);
+    bitchat_sha256_update(&ctx, pad, sizeof(pad));
+    bitchat_sha256_update(&ctx, inner, sizeof(inner));
+    bitchat_sha256_final(&ctx, mac);
+
+    memset(pad, 0, sizeof(pad));
+    memset(inner, 0, sizeof(inner));
+}
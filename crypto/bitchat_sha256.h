@@ -0,0 +1,61 @@
+/**
+ * BitChat SHA-256 and HMAC-SHA256
+ * Hash function of the Noise_XX_25519_ChaChaPoly_SHA256 suite
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BITCHAT_SHA256_DIGEST_SIZE 32
+#define BITCHAT_SHA256_BLOCK_SIZE 64
+
+/**
+ * SHA-256 hashing context
+ */
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t block[BITCHAT_SHA256_BLOCK_SIZE];
+    size_t block_used;
+} BitchatSha256;
+
+/**
+ * Start a new hash
+ */
+void bitchat_sha256_init(BitchatSha256* ctx);
+
+/**
+ * Feed data into the hash
+ */
+void bitchat_sha256_update(BitchatSha256* ctx, const uint8_t* data, size_t size);
+
+/**
+ * Finish the hash and write the 32-byte digest
+ */
+void bitchat_sha256_final(BitchatSha256* ctx, uint8_t* digest);
+
+/**
+ * Hash a single buffer
+ */
+void bitchat_sha256(const uint8_t* data, size_t size, uint8_t* digest);
+
+/**
+ * HMAC-SHA256 over the concatenation of two buffers (either may be empty)
+ * @param key HMAC key
+ * @param key_size Key size (at most one block)
+ * @param data1 First data buffer
+ * @param size1 First data size
+ * @param data2 Second data buffer
+ * @param size2 Second data size
+ * @param mac Output buffer (32 bytes)
+ */
+void bitchat_hmac_sha256(
+    const uint8_t* key,
+    size_t key_size,
+    const uint8_t* data1,
+    size_t size1,
+    const uint8_t* data2,
+    size_t size2,
+    uint8_t* mac);
@@ -0,0 +1,42 @@
+/**
+ * BitChat SHA-512
+ * Streaming SHA-512 used by Ed25519 and packet digests
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BITCHAT_SHA512_DIGEST_SIZE 64
+#define BITCHAT_SHA512_BLOCK_SIZE 128
+
+/**
+ * SHA-512 hashing context
+ */
+typedef struct {
+    uint64_t state[8];
+    uint64_t length;
+    uint8_t block[BITCHAT_SHA512_BLOCK_SIZE];
+    size_t block_used;
+} BitchatSha512;
+
+/**
+ * Start a new hash
+ */
+void bitchat_sha512_init(BitchatSha512* ctx);
+
+/**
+ * Feed data into the hash
+ */
+void bitchat_sha512_update(BitchatSha512* ctx, const uint8_t* data, size_t size);
+
+/**
+ * Finish the hash and write the 64-byte digest
+ */
+void bitchat_sha512_final(BitchatSha512* ctx, uint8_t* digest);
+
+/**
+ * Hash a single buffer
+ */
+void bitchat_sha512(const uint8_t* data, size_t size, uint8_t* digest);
@@ -0,0 +1,264 @@
+/**
+ * BitChat Packet Signatures Implementation
+ */
+
+#include "bitchat_signature.h"
+#include "bitchat_sha512.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define TAG "BitchatSignature"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_CRYPTO
+
+typedef struct {
+    uint8_t public_key[BITCHAT_ED25519_PUBLIC_KEY_SIZE];
+    uint8_t digest[BITCHAT_SIGNATURE_DIGEST_SIZE];
+    bool valid;
+    bool used;
+} BitchatSignatureCacheEntry;
+
+struct BitchatSignatureVerifier {
+    BitchatSignatureCacheEntry cache[BITCHAT_SIGNATURE_CACHE_SIZE];
+    size_t cache_next;
+    uint32_t cache_hits;
+    uint32_t verifications;
+};
+
+/**
+ * Signed bytes of a packet plus its cache digest
+ */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    uint8_t digest[BITCHAT_SIGNATURE_DIGEST_SIZE];
+} SignedPacketData;
+
+/**
+ * Encode the signed portion of a packet into a fresh buffer
+ */
+static bool signed_data_prepare(SignedPacketData* signed_data, const BitchatPacket* packet) {
+    BitchatPacket unsigned_packet = *packet;
+    unsigned_packet.has_signature = false;
+
+    size_t size = bitchat_packet_get_size(&unsigned_packet);
+    signed_data->data = bitchat_heap_alloc(BitchatHeapTagCrypto, size);
+    signed_data->size = bitchat_packet_encode_for_signing(packet, signed_data->data, size);
+
+    if(signed_data->size == 0) {
+        bitchat_heap_free(signed_data->data);
+        signed_data->data = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Digest over signed bytes and signature: identifies one exact signed packet
+ */
+static void signed_data_digest(SignedPacketData* signed_data, const BitchatPacket* packet) {
+    BitchatSha512 sha;
+    uint8_t digest[BITCHAT_SHA512_DIGEST_SIZE];
+
+    bitchat_sha512_init(&sha);
+    bitchat_sha512_update(&sha, signed_data->data, signed_data->size);
+    bitchat_sha512_update(&sha, packet->signature, BITCHAT_SIGNATURE_SIZE);
+    bitchat_sha512_final(&sha, digest);
+
+    memcpy(signed_data->digest, digest, BITCHAT_SIGNATURE_DIGEST_SIZE);
+}
+
+static BitchatSignatureCacheEntry* cache_lookup(
+    BitchatSignatureVerifier* verifier,
+    const uint8_t* public_key,
+    const uint8_t* digest) {
+    for(size_t i = 0; i < BITCHAT_SIGNATURE_CACHE_SIZE; i++) {
+        BitchatSignatureCacheEntry* entry = &verifier->cache[i];
+        if(entry->used &&
+           memcmp(entry->digest, digest, BITCHAT_SIGNATURE_DIGEST_SIZE) == 0 &&
+           memcmp(entry->public_key, public_key, BITCHAT_ED25519_PUBLIC_KEY_SIZE) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_insert(
+    BitchatSignatureVerifier* verifier,
+    const uint8_t* public_key,
+    const uint8_t* digest,
+    bool valid) {
+    BitchatSignatureCacheEntry* entry = &verifier->cache[verifier->cache_next];
+    verifier->cache_next = (verifier->cache_next + 1) % BITCHAT_SIGNATURE_CACHE_SIZE;
+
+    memcpy(entry->public_key, public_key, BITCHAT_ED25519_PUBLIC_KEY_SIZE);
+    memcpy(entry->digest, digest, BITCHAT_SIGNATURE_DIGEST_SIZE);
+    entry->valid = valid;
+    entry->used = true;
+}
+
+/**
+ * Allocate a verifier
+ */
+BitchatSignatureVerifier* bitchat_signature_verifier_alloc(void) {
+    BitchatSignatureVerifier* verifier =
+        bitchat_heap_alloc(BitchatHeapTagCrypto, sizeof(BitchatSignatureVerifier));
+    memset(verifier, 0, sizeof(BitchatSignatureVerifier));
+    return verifier;
+}
+
+/**
+ * Free a verifier
+ */
+void bitchat_signature_verifier_free(BitchatSignatureVerifier* verifier) {
+    furi_assert(verifier);
+    bitchat_heap_free(verifier);
+}
+
+/**
+ * Sign a packet in place
+ */
+bool bitchat_packet_sign(BitchatPacket* packet, const BitchatEd25519Key* key) {
+    furi_assert(packet);
+    furi_assert(key);
+
+    SignedPacketData signed_data;
+    if(!signed_data_prepare(&signed_data, packet)) {
+        BITCHAT_LOG_E(TAG, "Failed to encode packet for signing");
+        return false;
+    }
+
+    bitchat_ed25519_sign(key, signed_data.data, signed_data.size, packet->signature);
+    packet->has_signature = true;
+
+    bitchat_heap_free(signed_data.data);
+    return true;
+}
+
+/**
+ * Verify a packet signature
+ */
+bool bitchat_signature_verify_packet(
+    BitchatSignatureVerifier* verifier,
+    const BitchatPacket* packet,
+    const uint8_t* public_key) {
+    bool valid = false;
+    bitchat_signature_verify_packets(verifier, &packet, &public_key, 1, &valid);
+    return valid;
+}
+
+/**
+ * Verify a burst of packets
+ */
+size_t bitchat_signature_verify_packets(
+    BitchatSignatureVerifier* verifier,
+    const BitchatPacket* const* packets,
+    const uint8_t* const* public_keys,
+    size_t count,
+    bool* valid) {
+    furi_assert(verifier);
+    furi_assert(packets);
+    furi_assert(public_keys);
+    furi_assert(valid);
+
+    SignedPacketData pending[BITCHAT_ED25519_BATCH_MAX];
+    BitchatEd25519BatchItem items[BITCHAT_ED25519_BATCH_MAX];
+    size_t pending_index[BITCHAT_ED25519_BATCH_MAX];
+    bool pending_valid[BITCHAT_ED25519_BATCH_MAX];
+    size_t alias_index[BITCHAT_ED25519_BATCH_MAX];
+    size_t alias_slot[BITCHAT_ED25519_BATCH_MAX];
+    size_t valid_count = 0;
+    size_t i = 0;
+
+    while(i < count) {
+        size_t pending_count = 0;
+        size_t alias_count = 0;
+
+        // Collect up to one batch worth of packets that miss the cache
+        for(; i < count && pending_count < BITCHAT_ED25519_BATCH_MAX &&
+              alias_count < BITCHAT_ED25519_BATCH_MAX;
+            i++) {
+            const BitchatPacket* packet = packets[i];
+            valid[i] = false;
+
+            if(!packet->has_signature) continue;
+
+            SignedPacketData signed_data;
+            if(!signed_data_prepare(&signed_data, packet)) continue;
+            signed_data_digest(&signed_data, packet);
+
+            BitchatSignatureCacheEntry* entry =
+                cache_lookup(verifier, public_keys[i], signed_data.digest);
+            if(entry) {
+                verifier->cache_hits++;
+                valid[i] = entry->valid;
+                bitchat_heap_free(signed_data.data);
+                continue;
+            }
+
+            // Relayed copies arriving in the same burst share one check
+            size_t slot = 0;
+            for(; slot < pending_count; slot++) {
+                if(memcmp(pending[slot].digest, signed_data.digest, BITCHAT_SIGNATURE_DIGEST_SIZE) ==
+                       0 &&
+                   memcmp(items[slot].public_key, public_keys[i], BITCHAT_ED25519_PUBLIC_KEY_SIZE) ==
+                       0) {
+                    break;
+                }
+            }
+            if(slot < pending_count) {
+                verifier->cache_hits++;
+                alias_index[alias_count] = i;
+                alias_slot[alias_count] = slot;
+                alias_count++;
+                bitchat_heap_free(signed_data.data);
+                continue;
+            }
+
+            pending[pending_count] = signed_data;
+            pending_index[pending_count] = i;
+            items[pending_count].public_key = public_keys[i];
+            items[pending_count].message = pending[pending_count].data;
+            items[pending_count].message_size = pending[pending_count].size;
+            items[pending_count].signature = packet->signature;
+            pending_count++;
+        }
+
+        if(pending_count == 0) continue;
+
+        verifier->verifications += pending_count;
+        bitchat_ed25519_verify_batch(items, pending_count, pending_valid);
+
+        for(size_t k = 0; k < pending_count; k++) {
+            valid[pending_index[k]] = pending_valid[k];
+            cache_insert(verifier, items[k].public_key, pending[k].digest, pending_valid[k]);
+            bitchat_heap_free(pending[k].data);
+        }
+        for(size_t k = 0; k < alias_count; k++) {
+            valid[alias_index[k]] = pending_valid[alias_slot[k]];
+        }
+    }
+
+    for(size_t k = 0; k < count; k++) {
+        if(valid[k]) valid_count++;
+    }
+
+    BITCHAT_LOG_D(TAG, "Verified %zu packets, %zu valid", count, valid_count);
+
+    return valid_count;
+}
+
+/**
+ * Get cache statistics
+ */
+void bitchat_signature_get_stats(
+    BitchatSignatureVerifier* verifier,
+    uint32_t* cache_hits,
+    uint32_t* verifications) {
+    furi_assert(verifier);
+    if(cache_hits) *cache_hits = verifier->cache_hits;
+    if(verifications) *verifications = verifier->verifications;
+}
@@ -0,0 +1,73 @@
+/**
+ * BitChat Packet Signatures
+ * Ed25519 signing of packets and cached/batched verification on receive
+ */
+
+#pragma once
+
+#include "bitchat_ed25519.h"
+#include "../protocol/bitchat_protocol.h"
+
+#define BITCHAT_SIGNATURE_CACHE_SIZE 16
+#define BITCHAT_SIGNATURE_DIGEST_SIZE 16
+
+typedef struct BitchatSignatureVerifier BitchatSignatureVerifier;
+
+/**
+ * Allocate a verifier with an empty verified-sender cache
+ */
+BitchatSignatureVerifier* bitchat_signature_verifier_alloc(void);
+
+/**
+ * Free a verifier
+ */
+void bitchat_signature_verifier_free(BitchatSignatureVerifier* verifier);
+
+/**
+ * Sign a packet in place and set has_signature.
+ * The signature covers the packet encoded with TTL 0 and no signature,
+ * so relays can decrement TTL without invalidating it.
+ * @param packet Packet to sign
+ * @param key Expanded signing key
+ * @return true on success
+ */
+bool bitchat_packet_sign(BitchatPacket* packet, const BitchatEd25519Key* key);
+
+/**
+ * Verify a packet signature.
+ * Relayed copies of an already checked packet are answered from the cache.
+ * @param verifier Verifier instance
+ * @param packet Decoded packet
+ * @param public_key Sender's Ed25519 public key (32 bytes)
+ * @return true if the packet carries a valid signature
+ */
+bool bitchat_signature_verify_packet(
+    BitchatSignatureVerifier* verifier,
+    const BitchatPacket* packet,
+    const uint8_t* public_key);
+
+/**
+ * Verify a burst of packets.
+ * Cache hits and duplicates within the burst are resolved without any curve
+ * work; the rest are checked in batches of BITCHAT_ED25519_BATCH_MAX.
+ * @param verifier Verifier instance
+ * @param packets Decoded packets
+ * @param public_keys Sender public key for each packet
+ * @param count Number of packets
+ * @param valid Output array, one result per packet
+ * @return Number of valid packets
+ */
+size_t bitchat_signature_verify_packets(
+    BitchatSignatureVerifier* verifier,
+    const BitchatPacket* const* packets,
+    const uint8_t* const* public_keys,
+    size_t count,
+    bool* valid);
+
+/**
+ * Get cache statistics
+ */
+void bitchat_signature_get_stats(
+    BitchatSignatureVerifier* verifier,
+    uint32_t* cache_hits,
+    uint32_t* verifications);
@@ -0,0 +1,88 @@
+/**
+ * BitChat X25519 Key Agreement Implementation
+ */
+
+#include "bitchat_x25519.h"
+#include "bitchat_fe25519.h"
+#include <string.h>
+
+static const uint8_t x25519_basepoint[BITCHAT_X25519_KEY_SIZE] = {9};
+
+/**
+ * Montgomery ladder, constant time in the scalar
+ */
+static void x25519_scalarmult(uint8_t* out, const uint8_t* private_key, const uint8_t* point) {
+    uint8_t e[32];
+    BitchatFe25519 x1, x2, z2, x3, z3, a, aa, b, bb, c, d, da, cb, t;
+    uint32_t swap = 0;
+
+    memcpy(e, private_key, 32);
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+
+    bitchat_fe25519_frombytes(x1, point);
+    bitchat_fe25519_1(x2);
+    bitchat_fe25519_0(z2);
+    bitchat_fe25519_copy(x3, x1);
+    bitchat_fe25519_1(z3);
+
+    for(int pos = 254; pos >= 0; pos--) {
+        uint32_t bit = (e[pos >> 3] >> (pos & 7)) & 1;
+        swap ^= bit;
+        bitchat_fe25519_cswap(x2, x3, swap);
+        bitchat_fe25519_cswap(z2, z3, swap);
+        swap = bit;
+
+        bitchat_fe25519_add(a, x2, z2);
+        bitchat_fe25519_sq(aa, a);
+        bitchat_fe25519_sub(b, x2, z2);
+        bitchat_fe25519_sq(bb, b);
+        bitchat_fe25519_sub(t, aa, bb); // E
+        bitchat_fe25519_add(c, x3, z3);
+        bitchat_fe25519_sub(d, x3, z3);
+        bitchat_fe25519_mul(da, d, a);
+        bitchat_fe25519_mul(cb, c, b);
+
+        bitchat_fe25519_add(x3, da, cb);
+        bitchat_fe25519_sq(x3, x3);
+        bitchat_fe25519_sub(z3, da, cb);
+        bitchat_fe25519_sq(z3, z3);
+        bitchat_fe25519_mul(z3, z3, x1);
+
+        bitchat_fe25519_mul(x2, aa, bb);
+        // z2 = E * (BB + 121666 * E), equal to E * (AA + 121665 * E)
+        bitchat_fe25519_mul121666(z2, t);
+        bitchat_fe25519_add(z2, z2, bb);
+        bitchat_fe25519_mul(z2, z2, t);
+    }
+
+    bitchat_fe25519_cswap(x2, x3, swap);
+    bitchat_fe25519_cswap(z2, z3, swap);
+
+    bitchat_fe25519_invert(z2, z2);
+    bitchat_fe25519_mul(x2, x2, z2);
+    bitchat_fe25519_tobytes(out, x2);
+
+    memset(e, 0, sizeof(e));
+}
+
+/**
+ * Derive the public key for a private key
+ */
+void bitchat_x25519_public_key(uint8_t* public_key, const uint8_t* private_key) {
+    x25519_scalarmult(public_key, private_key, x25519_basepoint);
+}
+
+/**
+ * Compute a shared secret
+ */
+bool bitchat_x25519(uint8_t* shared, const uint8_t* private_key, const uint8_t* public_key) {
+    x25519_scalarmult(shared, private_key, public_key);
+
+    uint8_t acc = 0;
+    for(int i = 0; i < BITCHAT_X25519_KEY_SIZE; i++) {
+        acc |= shared[i];
+    }
+    return acc != 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * BitChat X25519 Key Agreement
+ * RFC 7748 Diffie-Hellman over Curve25519
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BITCHAT_X25519_KEY_SIZE 32
+
+/**
+ * Derive the public key for a private key
+ * @param public_key Output (32 bytes)
+ * @param private_key Private scalar (32 bytes, clamped internally)
+ */
+void bitchat_x25519_public_key(uint8_t* public_key, const uint8_t* private_key);
+
+/**
+ * Compute a shared secret
+ * @param shared Output (32 bytes)
+ * @param private_key Our private scalar
+ * @param public_key Their public key
+ * @return false if the result is all zero (low-order public key)
+ */
+bool bitchat_x25519(uint8_t* shared, const uint8_t* private_key, const uint8_t* public_key);
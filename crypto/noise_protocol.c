@@ -0,0 +1,1250 @@
+/**
+ * BitChat Noise Protocol Implementation
+ */
+
+#include "noise_protocol.h"
+#include "bitchat_sha256.h"
+#include "bitchat_x25519.h"
+#include "bitchat_chacha20poly1305.h"
+#include "../protocol/bitchat_protocol.h"
+#include "../utils/bitchat_metrics.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+#include <string.h>
+
+#define TAG "BitchatNoise"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_CRYPTO
+
+#define NOISE_PROTOCOL_NAME "Noise_XX_25519_ChaChaPoly_SHA256"
+#define NOISE_HASH_SIZE BITCHAT_SHA256_DIGEST_SIZE
+#define NOISE_PEER_ID_SIZE 8
+#define NOISE_SESSION_ID_SIZE 8
+#define NOISE_RESUME_NONCE_SIZE 16
+#define NOISE_RESUME_TAG_SIZE 16
+#define NOISE_REPLAY_WINDOW 64
+
+// XX message sizes with empty payloads: e | e, ee, s, es | s, se
+#define NOISE_MSG1_SIZE BITCHAT_X25519_KEY_SIZE
+#define NOISE_MSG2_SIZE (BITCHAT_X25519_KEY_SIZE * 2 + BITCHAT_NOISE_TAG_SIZE * 2)
+#define NOISE_MSG3_SIZE (BITCHAT_X25519_KEY_SIZE + BITCHAT_NOISE_TAG_SIZE * 2)
+
+// Resume messages: kind | session id | nonce | tag
+#define NOISE_RESUME_REQUEST 0x01
+#define NOISE_RESUME_ACCEPT 0x02
+#define NOISE_RESUME_REJECT 0x03
+#define NOISE_RESUME_FULL_SIZE \
+    (1 + NOISE_SESSION_ID_SIZE + NOISE_RESUME_NONCE_SIZE + NOISE_RESUME_TAG_SIZE)
+#define NOISE_RESUME_REJECT_SIZE (1 + NOISE_SESSION_ID_SIZE)
+
+typedef enum {
+    NoiseSessionFree,
+    NoiseSessionHandshake, // XX in progress
+    NoiseSessionResuming, // Resume request sent, waiting for the answer
+    NoiseSessionResumable, // Link down, keys kept for resumption
+    NoiseSessionEstablished,
+} NoiseSessionState;
+
+typedef struct {
+    uint8_t k[BITCHAT_NOISE_KEY_SIZE];
+    uint64_t n;
+    bool has_key;
+} NoiseCipherState;
+
+/**
+ * XX handshake state, only allocated while a handshake runs
+ */
+typedef struct {
+    bool initiator;
+    uint8_t next_message; // 0..2
+    uint32_t started;
+    uint8_t ck[NOISE_HASH_SIZE];
+    uint8_t h[NOISE_HASH_SIZE];
+    NoiseCipherState cipher;
+    uint8_t e_private[BITCHAT_X25519_KEY_SIZE];
+    uint8_t e_public[BITCHAT_X25519_KEY_SIZE];
+    uint8_t re[BITCHAT_X25519_KEY_SIZE];
+    uint8_t rs[BITCHAT_X25519_KEY_SIZE];
+} NoiseHandshake;
+
+typedef struct {
+    NoiseSessionState state;
+    uint8_t peer_id[NOISE_PEER_ID_SIZE];
+    uint32_t last_used;
+    NoiseHandshake* handshake; // Also staged beside kept keys until message 3
+
+    // Transport keys and nonce counters
+    uint8_t send_key[BITCHAT_NOISE_KEY_SIZE];
+    uint8_t recv_key[BITCHAT_NOISE_KEY_SIZE];
+    uint32_t send_nonce;
+    uint32_t recv_highest;
+    uint64_t recv_window;
+    bool recv_any;
+
+    uint8_t remote_static[BITCHAT_X25519_KEY_SIZE];
+    uint8_t resume_secret[NOISE_HASH_SIZE];
+    uint8_t session_id[NOISE_SESSION_ID_SIZE];
+    uint8_t resume_nonce[NOISE_RESUME_NONCE_SIZE];
+} NoiseSession;
+
+struct BitchatNoise {
+    FuriMutex* mutex;
+    uint8_t local_peer_id[NOISE_PEER_ID_SIZE];
+    uint8_t static_private[BITCHAT_X25519_KEY_SIZE];
+    uint8_t static_public[BITCHAT_X25519_KEY_SIZE];
+    NoiseSession sessions[BITCHAT_NOISE_MAX_SESSIONS];
+    BitchatNoiseStats stats;
+
+    // Resumption state kept beyond this engine's lifetime
+    BitchatNoiseResumeLoad resume_load;
+    BitchatNoiseResumeSave resume_save;
+    void* resume_context;
+};
+
+/**
+ * Resumption state waiting to be handed to the resume store, which may
+ * write to the SD card and so is only called with the lock dropped
+ */
+typedef struct {
+    bool pending;
+    BitchatNoiseResumeSave callback;
+    void* context;
+    uint8_t peer_id[NOISE_PEER_ID_SIZE];
+    BitchatNoiseResumeState state;
+} NoiseSave;
+
+static void noise_wipe(void* data, size_t size) {
+    volatile uint8_t* p = data;
+    while(size--) {
+        *p++ = 0;
+    }
+}
+
+/* ---- Symmetric state ---- */
+
+/**
+ * Noise HKDF with two or three outputs
+ */
+static void noise_hkdf(
+    const uint8_t* ck,
+    const uint8_t* ikm,
+    size_t ikm_size,
+    uint8_t* out1,
+    uint8_t* out2,
+    uint8_t* out3) {
+    uint8_t temp[NOISE_HASH_SIZE];
+    uint8_t one = 0x01, two = 0x02, three = 0x03;
+
+    bitchat_hmac_sha256(ck, NOISE_HASH_SIZE, ikm, ikm_size, NULL, 0, temp);
+    bitchat_hmac_sha256(temp, NOISE_HASH_SIZE, &one, 1, NULL, 0, out1);
+    bitchat_hmac_sha256(temp, NOISE_HASH_SIZE, out1, NOISE_HASH_SIZE, &two, 1, out2);
+    if(out3) {
+        bitchat_hmac_sha256(temp, NOISE_HASH_SIZE, out2, NOISE_HASH_SIZE, &three, 1, out3);
+    }
+
+    noise_wipe(temp, sizeof(temp));
+}
+
+static void noise_mix_hash(NoiseHandshake* hs, const uint8_t* data, size_t size) {
+    BitchatSha256 sha;
+    bitchat_sha256_init(&sha);
+    bitchat_sha256_update(&sha, hs->h, NOISE_HASH_SIZE);
+    bitchat_sha256_update(&sha, data, size);
+    bitchat_sha256_final(&sha, hs->h);
+}
+
+static void noise_mix_key(NoiseHandshake* hs, const uint8_t* ikm) {
+    noise_hkdf(hs->ck, ikm, BITCHAT_X25519_KEY_SIZE, hs->ck, hs->cipher.k, NULL);
+    hs->cipher.n = 0;
+    hs->cipher.has_key = true;
+}
+
+/**
+ * ChaChaPoly nonce: 32 zero bits followed by the little-endian counter
+ */
+static void noise_nonce(uint8_t* nonce, uint64_t n) {
+    memset(nonce, 0, BITCHAT_CHACHAPOLY_NONCE_SIZE);
+    for(int i = 0; i < 8; i++) {
+        nonce[4 + i] = (n >> (i * 8)) & 0xFF;
+    }
+}
+
+/**
+ * EncryptAndHash: returns bytes written
+ */
+static size_t noise_encrypt_and_hash(
+    NoiseHandshake* hs,
+    const uint8_t* plaintext,
+    size_t size,
+    uint8_t* out) {
+    size_t written = size;
+
+    if(hs->cipher.has_key) {
+        uint8_t nonce[BITCHAT_CHACHAPOLY_NONCE_SIZE];
+        noise_nonce(nonce, hs->cipher.n++);
+        bitchat_chachapoly_encrypt(
+            hs->cipher.k, nonce, hs->h, NOISE_HASH_SIZE, plaintext, size, out, &out[size]);
+        written += BITCHAT_NOISE_TAG_SIZE;
+    } else if(size > 0) {
+        memmove(out, plaintext, size);
+    }
+
+    noise_mix_hash(hs, out, written);
+    return written;
+}
+
+/**
+ * DecryptAndHash: out may be NULL to authenticate without keeping the plaintext
+ */
+static bool noise_decrypt_and_hash(
+    NoiseHandshake* hs,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out) {
+    uint8_t ad[NOISE_HASH_SIZE];
+    memcpy(ad, hs->h, NOISE_HASH_SIZE);
+    noise_mix_hash(hs, message, size);
+
+    if(!hs->cipher.has_key) {
+        if(out && size > 0) memmove(out, message, size);
+        return true;
+    }
+
+    if(size < BITCHAT_NOISE_TAG_SIZE) return false;
+    size_t plain_size = size - BITCHAT_NOISE_TAG_SIZE;
+
+    uint8_t nonce[BITCHAT_CHACHAPOLY_NONCE_SIZE];
+    noise_nonce(nonce, hs->cipher.n++);
+
+    return bitchat_chachapoly_decrypt(
+        hs->cipher.k, nonce, ad, NOISE_HASH_SIZE, message, plain_size, &message[plain_size], out);
+}
+
+/* ---- Session table ---- */
+
+static void noise_handshake_free(NoiseSession* session) {
+    if(session->handshake) {
+        noise_wipe(session->handshake, sizeof(NoiseHandshake));
+        bitchat_heap_free(session->handshake);
+        session->handshake = NULL;
+    }
+}
+
+static void noise_session_clear(NoiseSession* session) {
+    noise_handshake_free(session);
+    noise_wipe(session, sizeof(NoiseSession));
+}
+
+static NoiseSession* noise_session_find(BitchatNoise* noise, const uint8_t* peer_id) {
+    for(size_t i = 0; i < BITCHAT_NOISE_MAX_SESSIONS; i++) {
+        NoiseSession* session = &noise->sessions[i];
+        if(session->state != NoiseSessionFree &&
+           memcmp(session->peer_id, peer_id, NOISE_PEER_ID_SIZE) == 0) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find the peer's entry, or claim a free one, evicting the least recently used
+ * @param handshake The entry is for a handshake, which an unauthenticated
+ *                  message 1 can start, so it never evicts an established session
+ * @return The entry, or NULL if only established sessions could be evicted
+ */
+static NoiseSession*
+    noise_session_acquire(BitchatNoise* noise, const uint8_t* peer_id, bool handshake) {
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    if(session) return session;
+
+    NoiseSession* victim = NULL;
+    for(size_t i = 0; i < BITCHAT_NOISE_MAX_SESSIONS; i++) {
+        NoiseSession* candidate = &noise->sessions[i];
+        if(candidate->state == NoiseSessionFree) {
+            victim = candidate;
+            break;
+        }
+        if(handshake && candidate->state == NoiseSessionEstablished) continue;
+        if(!victim || (int32_t)(candidate->last_used - victim->last_used) < 0) {
+            victim = candidate;
+        }
+    }
+
+    if(!victim) {
+        BITCHAT_LOG_W(TAG, "No session to evict for a handshake");
+        return NULL;
+    }
+    if(victim->state != NoiseSessionFree) {
+        BITCHAT_LOG_D(TAG, "Evicting least recently used session");
+        noise->stats.evictions++;
+    }
+    noise_session_clear(victim);
+    memcpy(victim->peer_id, peer_id, NOISE_PEER_ID_SIZE);
+    victim->last_used = furi_get_tick();
+    return victim;
+}
+
+static void noise_expire_locked(BitchatNoise* noise) {
+    uint32_t now = furi_get_tick();
+    uint32_t idle_ticks = furi_ms_to_ticks(BITCHAT_NOISE_SESSION_IDLE_MS);
+    uint32_t handshake_ticks = furi_ms_to_ticks(BITCHAT_NOISE_HANDSHAKE_TIMEOUT_MS);
+
+    for(size_t i = 0; i < BITCHAT_NOISE_MAX_SESSIONS; i++) {
+        NoiseSession* session = &noise->sessions[i];
+        if(session->state == NoiseSessionFree) continue;
+
+        uint32_t idle = now - session->last_used;
+        bool pending = session->state == NoiseSessionHandshake ||
+                       session->state == NoiseSessionResuming;
+        if(idle > idle_ticks || (pending && idle > handshake_ticks)) {
+            noise_session_clear(session);
+            noise->stats.expirations++;
+        } else if(
+            session->state != NoiseSessionHandshake && session->handshake &&
+            now - session->handshake->started > handshake_ticks) {
+            // A stalled handshake staged beside kept keys; the keys stay
+            noise_handshake_free(session);
+            noise->stats.expirations++;
+        }
+    }
+}
+
+/**
+ * Derive the resumption session ID from the resumption secret
+ */
+static void noise_session_set_id(NoiseSession* session) {
+    static const uint8_t label[] = "BitchatSessionId";
+    uint8_t mac[NOISE_HASH_SIZE];
+    bitchat_hmac_sha256(
+        session->resume_secret, NOISE_HASH_SIZE, label, sizeof(label) - 1, NULL, 0, mac);
+    memcpy(session->session_id, mac, NOISE_SESSION_ID_SIZE);
+}
+
+/**
+ * Find a peer's session, bringing it back from the resume store on a miss
+ * Entered and left locked, but the lock is dropped around the store lookup,
+ * which may read the SD card; no session pointer survives the call.
+ * @return The session, or NULL if neither the table nor the store has one
+ */
+static NoiseSession* noise_session_find_or_restore(BitchatNoise* noise, const uint8_t* peer_id) {
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    if(session || !noise->resume_load) return session;
+
+    BitchatNoiseResumeLoad load = noise->resume_load;
+    void* context = noise->resume_context;
+    BitchatNoiseResumeState state;
+
+    furi_mutex_release(noise->mutex);
+    bool loaded = load(context, peer_id, &state);
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    // Another caller may have set up a session meanwhile; it wins
+    session = noise_session_find(noise, peer_id);
+    if(!session && loaded) {
+        session = noise_session_acquire(noise, peer_id, false);
+        memcpy(session->remote_static, state.remote_static, BITCHAT_X25519_KEY_SIZE);
+        memcpy(session->resume_secret, state.resume_secret, NOISE_HASH_SIZE);
+        noise_session_set_id(session);
+        session->state = NoiseSessionResumable;
+        BITCHAT_LOG_D(TAG, "Restored stored session");
+    }
+
+    noise_wipe(&state, sizeof(state));
+    return session;
+}
+
+/**
+ * Take an established session's resumption state for the resume store
+ * It is handed over by noise_save_commit() once the lock is dropped.
+ */
+static void noise_save_prepare(BitchatNoise* noise, NoiseSession* session, NoiseSave* save) {
+    if(!noise->resume_save) return;
+
+    save->pending = true;
+    save->callback = noise->resume_save;
+    save->context = noise->resume_context;
+    memcpy(save->peer_id, session->peer_id, NOISE_PEER_ID_SIZE);
+    memcpy(save->state.remote_static, session->remote_static, BITCHAT_X25519_KEY_SIZE);
+    memcpy(save->state.resume_secret, session->resume_secret, NOISE_HASH_SIZE);
+}
+
+/**
+ * Hand prepared resumption state to the resume store; call unlocked
+ */
+static void noise_save_commit(NoiseSave* save) {
+    if(save->pending) {
+        save->callback(save->context, save->peer_id, &save->state);
+    }
+    noise_wipe(save, sizeof(NoiseSave));
+}
+
+/**
+ * Install fresh transport keys and reset nonce counters
+ */
+static void noise_session_establish(NoiseSession* session, const uint8_t* send_key, const uint8_t* recv_key) {
+    memcpy(session->send_key, send_key, BITCHAT_NOISE_KEY_SIZE);
+    memcpy(session->recv_key, recv_key, BITCHAT_NOISE_KEY_SIZE);
+    session->send_nonce = 0;
+    session->recv_highest = 0;
+    session->recv_window = 0;
+    session->recv_any = false;
+    noise_session_set_id(session);
+    session->state = NoiseSessionEstablished;
+}
+
+/* ---- XX handshake ---- */
+
+/**
+ * Start an XX handshake in the session's handshake slot
+ * A session that holds transport keys keeps them, and stays usable, until
+ * the handshake completes and noise_handshake_finish() swaps in new ones.
+ */
+static void noise_handshake_start(NoiseSession* session, bool initiator) {
+    noise_handshake_free(session);
+
+    NoiseHandshake* hs = bitchat_heap_alloc(BitchatHeapTagCrypto, sizeof(NoiseHandshake));
+    memset(hs, 0, sizeof(NoiseHandshake));
+    hs->initiator = initiator;
+
+    // Protocol name is exactly HASHLEN bytes, so h = name; empty prologue
+    memcpy(hs->h, NOISE_PROTOCOL_NAME, NOISE_HASH_SIZE);
+    memcpy(hs->ck, hs->h, NOISE_HASH_SIZE);
+    noise_mix_hash(hs, NULL, 0);
+
+    furi_hal_random_fill_buf(hs->e_private, BITCHAT_X25519_KEY_SIZE);
+    bitchat_x25519_public_key(hs->e_public, hs->e_private);
+    hs->started = furi_get_tick();
+
+    session->handshake = hs;
+    if(session->state == NoiseSessionFree) {
+        session->state = NoiseSessionHandshake;
+    }
+    session->last_used = furi_get_tick();
+}
+
+static bool noise_mix_dh(NoiseHandshake* hs, const uint8_t* private_key, const uint8_t* public_key) {
+    uint8_t shared[BITCHAT_X25519_KEY_SIZE];
+    bool ok = bitchat_x25519(shared, private_key, public_key);
+    noise_mix_key(hs, shared);
+    noise_wipe(shared, sizeof(shared));
+    return ok;
+}
+
+/**
+ * Split into transport keys; initiator sends with the first key
+ */
+static void
+    noise_handshake_finish(BitchatNoise* noise, NoiseSession* session, NoiseSave* save) {
+    NoiseHandshake* hs = session->handshake;
+    uint8_t k1[NOISE_HASH_SIZE], k2[NOISE_HASH_SIZE];
+
+    // A third HKDF output (beyond Noise's Split) seeds resumption
+    noise_hkdf(hs->ck, NULL, 0, k1, k2, session->resume_secret);
+    memcpy(session->remote_static, hs->rs, BITCHAT_X25519_KEY_SIZE);
+
+    if(hs->initiator) {
+        noise_session_establish(session, k1, k2);
+    } else {
+        noise_session_establish(session, k2, k1);
+    }
+
+    noise_wipe(k1, sizeof(k1));
+    noise_wipe(k2, sizeof(k2));
+    noise_handshake_free(session);
+    noise->stats.full_handshakes++;
+    noise_save_prepare(noise, session, save);
+
+    BITCHAT_LOG_I(TAG, "Handshake complete");
+}
+
+/**
+ * -> e
+ */
+static size_t noise_write_message1(NoiseHandshake* hs, uint8_t* out) {
+    memcpy(out, hs->e_public, BITCHAT_X25519_KEY_SIZE);
+    noise_mix_hash(hs, hs->e_public, BITCHAT_X25519_KEY_SIZE);
+    size_t size = BITCHAT_X25519_KEY_SIZE;
+    size += noise_encrypt_and_hash(hs, NULL, 0, &out[size]);
+    hs->next_message = 1;
+    return size;
+}
+
+static bool noise_read_message1(NoiseHandshake* hs, const uint8_t* message, size_t size) {
+    if(size < NOISE_MSG1_SIZE) return false;
+    memcpy(hs->re, message, BITCHAT_X25519_KEY_SIZE);
+    noise_mix_hash(hs, hs->re, BITCHAT_X25519_KEY_SIZE);
+    noise_decrypt_and_hash(hs, &message[NOISE_MSG1_SIZE], size - NOISE_MSG1_SIZE, NULL);
+    hs->next_message = 1;
+    return true;
+}
+
+/**
+ * <- e, ee, s, es
+ */
+static size_t noise_write_message2(BitchatNoise* noise, NoiseHandshake* hs, uint8_t* out) {
+    size_t size = 0;
+    memcpy(out, hs->e_public, BITCHAT_X25519_KEY_SIZE);
+    noise_mix_hash(hs, hs->e_public, BITCHAT_X25519_KEY_SIZE);
+    size += BITCHAT_X25519_KEY_SIZE;
+
+    if(!noise_mix_dh(hs, hs->e_private, hs->re)) return 0;
+    size += noise_encrypt_and_hash(hs, noise->static_public, BITCHAT_X25519_KEY_SIZE, &out[size]);
+    if(!noise_mix_dh(hs, noise->static_private, hs->re)) return 0;
+    size += noise_encrypt_and_hash(hs, NULL, 0, &out[size]);
+
+    hs->next_message = 2;
+    return size;
+}
+
+static bool noise_read_message2(NoiseHandshake* hs, const uint8_t* message, size_t size) {
+    if(size < NOISE_MSG2_SIZE) return false;
+    const uint8_t* p = message;
+
+    memcpy(hs->re, p, BITCHAT_X25519_KEY_SIZE);
+    noise_mix_hash(hs, hs->re, BITCHAT_X25519_KEY_SIZE);
+    p += BITCHAT_X25519_KEY_SIZE;
+
+    if(!noise_mix_dh(hs, hs->e_private, hs->re)) return false;
+    if(!noise_decrypt_and_hash(hs, p, BITCHAT_X25519_KEY_SIZE + BITCHAT_NOISE_TAG_SIZE, hs->rs)) {
+        return false;
+    }
+    p += BITCHAT_X25519_KEY_SIZE + BITCHAT_NOISE_TAG_SIZE;
+
+    if(!noise_mix_dh(hs, hs->e_private, hs->rs)) return false;
+    if(!noise_decrypt_and_hash(hs, p, size - (p - message), NULL)) return false;
+
+    hs->next_message = 2;
+    return true;
+}
+
+/**
+ * -> s, se
+ */
+static size_t noise_write_message3(BitchatNoise* noise, NoiseHandshake* hs, uint8_t* out) {
+    size_t size = noise_encrypt_and_hash(hs, noise->static_public, BITCHAT_X25519_KEY_SIZE, out);
+    if(!noise_mix_dh(hs, noise->static_private, hs->re)) return 0;
+    size += noise_encrypt_and_hash(hs, NULL, 0, &out[size]);
+    return size;
+}
+
+static bool noise_read_message3(NoiseHandshake* hs, const uint8_t* message, size_t size) {
+    if(size < NOISE_MSG3_SIZE) return false;
+    const uint8_t* p = message;
+
+    if(!noise_decrypt_and_hash(hs, p, BITCHAT_X25519_KEY_SIZE + BITCHAT_NOISE_TAG_SIZE, hs->rs)) {
+        return false;
+    }
+    p += BITCHAT_X25519_KEY_SIZE + BITCHAT_NOISE_TAG_SIZE;
+
+    if(!noise_mix_dh(hs, hs->e_private, hs->rs)) return false;
+    return noise_decrypt_and_hash(hs, p, size - (p - message), NULL);
+}
+
+/**
+ * Start a full handshake as initiator and emit message 1
+ */
+static void
+    noise_initiate_locked(NoiseSession* session, uint8_t* out, BitchatNoiseOutput* output) {
+    noise_handshake_start(session, true);
+    output->type = BitchatNoiseOutputHandshake;
+    output->size = noise_write_message1(session->handshake, out);
+}
+
+/* ---- Resumption ---- */
+
+static void noise_resume_tag(
+    const NoiseSession* session,
+    uint8_t kind,
+    const uint8_t* nonce_i,
+    const uint8_t* nonce_r,
+    uint8_t* tag) {
+    uint8_t data[1 + NOISE_SESSION_ID_SIZE + NOISE_RESUME_NONCE_SIZE * 2];
+    size_t size = 0;
+
+    data[size++] = kind;
+    memcpy(&data[size], session->session_id, NOISE_SESSION_ID_SIZE);
+    size += NOISE_SESSION_ID_SIZE;
+    memcpy(&data[size], nonce_i, NOISE_RESUME_NONCE_SIZE);
+    size += NOISE_RESUME_NONCE_SIZE;
+    if(nonce_r) {
+        memcpy(&data[size], nonce_r, NOISE_RESUME_NONCE_SIZE);
+        size += NOISE_RESUME_NONCE_SIZE;
+    }
+
+    uint8_t mac[NOISE_HASH_SIZE];
+    bitchat_hmac_sha256(session->resume_secret, NOISE_HASH_SIZE, data, size, NULL, 0, mac);
+    memcpy(tag, mac, NOISE_RESUME_TAG_SIZE);
+}
+
+static bool noise_resume_tag_matches(const uint8_t* expected, const uint8_t* received) {
+    uint8_t diff = 0;
+    for(size_t i = 0; i < NOISE_RESUME_TAG_SIZE; i++) {
+        diff |= expected[i] ^ received[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * Rekey from the resumption secret and both nonces
+ */
+static void noise_resume_finish(
+    BitchatNoise* noise,
+    NoiseSession* session,
+    bool requester,
+    const uint8_t* nonce_i,
+    const uint8_t* nonce_r,
+    NoiseSave* save) {
+    uint8_t nonces[NOISE_RESUME_NONCE_SIZE * 2];
+    uint8_t k1[NOISE_HASH_SIZE], k2[NOISE_HASH_SIZE], secret[NOISE_HASH_SIZE];
+
+    memcpy(nonces, nonce_i, NOISE_RESUME_NONCE_SIZE);
+    memcpy(&nonces[NOISE_RESUME_NONCE_SIZE], nonce_r, NOISE_RESUME_NONCE_SIZE);
+    noise_hkdf(session->resume_secret, nonces, sizeof(nonces), k1, k2, secret);
+    memcpy(session->resume_secret, secret, NOISE_HASH_SIZE);
+
+    if(requester) {
+        noise_session_establish(session, k1, k2);
+    } else {
+        noise_session_establish(session, k2, k1);
+    }
+    session->last_used = furi_get_tick();
+
+    noise_wipe(k1, sizeof(k1));
+    noise_wipe(k2, sizeof(k2));
+    noise_wipe(secret, sizeof(secret));
+    noise->stats.resumed_sessions++;
+    noise_save_prepare(noise, session, save);
+
+    BITCHAT_LOG_I(TAG, "Session resumed");
+}
+
+static size_t noise_write_resume_request(NoiseSession* session, uint8_t* out) {
+    size_t size = 0;
+    furi_hal_random_fill_buf(session->resume_nonce, NOISE_RESUME_NONCE_SIZE);
+
+    out[size++] = NOISE_RESUME_REQUEST;
+    memcpy(&out[size], session->session_id, NOISE_SESSION_ID_SIZE);
+    size += NOISE_SESSION_ID_SIZE;
+    memcpy(&out[size], session->resume_nonce, NOISE_RESUME_NONCE_SIZE);
+    size += NOISE_RESUME_NONCE_SIZE;
+    noise_resume_tag(session, NOISE_RESUME_REQUEST, session->resume_nonce, NULL, &out[size]);
+    size += NOISE_RESUME_TAG_SIZE;
+
+    session->state = NoiseSessionResuming;
+    session->last_used = furi_get_tick();
+    return size;
+}
+
+static size_t noise_write_resume_reject(const uint8_t* session_id, uint8_t* out) {
+    out[0] = NOISE_RESUME_REJECT;
+    memcpy(&out[1], session_id, NOISE_SESSION_ID_SIZE);
+    return NOISE_RESUME_REJECT_SIZE;
+}
+
+/* ---- Public API ---- */
+
+/**
+ * Allocate the Noise engine
+ */
+BitchatNoise* bitchat_noise_alloc(const uint8_t* local_peer_id, const uint8_t* static_private_key) {
+    furi_assert(local_peer_id);
+    furi_assert(static_private_key);
+
+    BitchatNoise* noise = bitchat_heap_alloc(BitchatHeapTagCrypto, sizeof(BitchatNoise));
+    memset(noise, 0, sizeof(BitchatNoise));
+
+    noise->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    memcpy(noise->local_peer_id, local_peer_id, NOISE_PEER_ID_SIZE);
+    memcpy(noise->static_private, static_private_key, BITCHAT_X25519_KEY_SIZE);
+    bitchat_x25519_public_key(noise->static_public, noise->static_private);
+
+    return noise;
+}
+
+/**
+ * Free the Noise engine
+ */
+void bitchat_noise_free(BitchatNoise* noise) {
+    furi_assert(noise);
+
+    for(size_t i = 0; i < BITCHAT_NOISE_MAX_SESSIONS; i++) {
+        noise_session_clear(&noise->sessions[i]);
+    }
+    furi_mutex_free(noise->mutex);
+    noise_wipe(noise, sizeof(BitchatNoise));
+    bitchat_heap_free(noise);
+}
+
+/**
+ * Attach persistent storage for resumption state
+ */
+void bitchat_noise_set_resume_store(
+    BitchatNoise* noise,
+    BitchatNoiseResumeLoad load,
+    BitchatNoiseResumeSave save,
+    void* context) {
+    furi_assert(noise);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    noise->resume_load = load;
+    noise->resume_save = save;
+    noise->resume_context = context;
+    furi_mutex_release(noise->mutex);
+}
+
+/**
+ * Make sure a session with a peer exists or is being set up
+ */
+bool bitchat_noise_connect(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(out);
+    furi_assert(output);
+
+    output->type = BitchatNoiseOutputNone;
+    output->size = 0;
+    if(out_size < BITCHAT_NOISE_MAX_HANDSHAKE_SIZE) return false;
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    noise_expire_locked(noise);
+
+    NoiseSession* session = noise_session_find_or_restore(noise, peer_id);
+    if(!session) session = noise_session_acquire(noise, peer_id, true);
+    if(!session) {
+        furi_mutex_release(noise->mutex);
+        return false;
+    }
+    switch(session->state) {
+    case NoiseSessionEstablished:
+        if(session->send_nonce < BITCHAT_NOISE_REKEY_NONCE) {
+            session->last_used = furi_get_tick();
+            break;
+        }
+        // Nonces nearly exhausted: rekey through resumption
+        /* fall through */
+    case NoiseSessionResumable:
+        output->type = BitchatNoiseOutputResume;
+        output->size = noise_write_resume_request(session, out);
+        break;
+    case NoiseSessionHandshake:
+    case NoiseSessionResuming:
+        // Already in progress; timeouts are handled by expiry
+        break;
+    case NoiseSessionFree:
+        noise_initiate_locked(session, out, output);
+        break;
+    }
+
+    furi_mutex_release(noise->mutex);
+    return true;
+}
+
+/**
+ * Mark a peer's link as down
+ */
+void bitchat_noise_disconnect(BitchatNoise* noise, const uint8_t* peer_id) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    if(session) {
+        if(session->state == NoiseSessionEstablished || session->state == NoiseSessionResuming) {
+            session->state = NoiseSessionResumable;
+            noise_handshake_free(session);
+        } else if(session->state == NoiseSessionHandshake) {
+            noise_session_clear(session);
+        }
+    }
+
+    furi_mutex_release(noise->mutex);
+}
+
+/**
+ * Process a received handshake message
+ */
+bool bitchat_noise_handle_handshake(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(message);
+    furi_assert(out);
+    furi_assert(output);
+
+    output->type = BitchatNoiseOutputNone;
+    output->size = 0;
+    if(out_size < BITCHAT_NOISE_MAX_HANDSHAKE_SIZE) return false;
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    noise_expire_locked(noise);
+
+    bool ok = false;
+    NoiseSave save = {0};
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    NoiseHandshake* hs = session ? session->handshake : NULL;
+    bool expecting_msg2 = hs && hs->initiator && hs->next_message == 1;
+    bool expecting_msg3 = hs && !hs->initiator && hs->next_message == 2;
+
+    if(size == NOISE_MSG1_SIZE) {
+        if(expecting_msg2 && memcmp(noise->local_peer_id, peer_id, NOISE_PEER_ID_SIZE) < 0) {
+            // Both sides initiated; the lower peer ID stays initiator
+            ok = true;
+        } else {
+            // The peer (re)starts from scratch. Message 1 is unauthenticated,
+            // so kept keys stay in use until message 3 proves it is the peer
+            session = noise_session_acquire(noise, peer_id, true);
+            if(session) {
+                noise_handshake_start(session, false);
+                if(noise_read_message1(session->handshake, message, size)) {
+                    output->size = noise_write_message2(noise, session->handshake, out);
+                }
+            }
+            if(output->size > 0) {
+                output->type = BitchatNoiseOutputHandshake;
+                ok = true;
+            }
+        }
+    } else if(expecting_msg2) {
+        size_t written = 0;
+        if(noise_read_message2(hs, message, size)) {
+            written = noise_write_message3(noise, hs, out);
+        }
+        if(written > 0) {
+            output->type = BitchatNoiseOutputHandshake;
+            output->size = written;
+            noise_handshake_finish(noise, session, &save);
+            ok = true;
+        }
+    } else if(expecting_msg3) {
+        if(noise_read_message3(hs, message, size)) {
+            noise_handshake_finish(noise, session, &save);
+            ok = true;
+        }
+    }
+
+    if(ok) {
+        session->last_used = furi_get_tick();
+    } else {
+        BITCHAT_LOG_W(TAG, "Handshake message rejected");
+        // Only an in-progress handshake is abandoned; stray messages leave keys alone
+        if(session && session->state == NoiseSessionHandshake) {
+            noise_session_clear(session);
+        } else if(session) {
+            noise_handshake_free(session);
+        }
+    }
+
+    furi_mutex_release(noise->mutex);
+    noise_save_commit(&save);
+    return ok;
+}
+
+/**
+ * Process a received resume message
+ */
+bool bitchat_noise_handle_resume(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(message);
+    furi_assert(out);
+    furi_assert(output);
+
+    output->type = BitchatNoiseOutputNone;
+    output->size = 0;
+    if(out_size < BITCHAT_NOISE_MAX_HANDSHAKE_SIZE || size < NOISE_RESUME_REJECT_SIZE) return false;
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    noise_expire_locked(noise);
+
+    bool ok = false;
+    uint8_t kind = message[0];
+    const uint8_t* session_id = &message[1];
+    const uint8_t* nonce = &message[1 + NOISE_SESSION_ID_SIZE];
+    const uint8_t* tag = &message[1 + NOISE_SESSION_ID_SIZE + NOISE_RESUME_NONCE_SIZE];
+    uint8_t expected[NOISE_RESUME_TAG_SIZE];
+    NoiseSave save = {0};
+
+    // Only a request can concern a session we have not loaded yet
+    bool request = kind == NOISE_RESUME_REQUEST && size == NOISE_RESUME_FULL_SIZE;
+    NoiseSession* session = request ? noise_session_find_or_restore(noise, peer_id) :
+                                      noise_session_find(noise, peer_id);
+    bool known = session && session->state != NoiseSessionHandshake &&
+                 memcmp(session->session_id, session_id, NOISE_SESSION_ID_SIZE) == 0;
+
+    if(request) {
+        if(known) noise_resume_tag(session, NOISE_RESUME_REQUEST, nonce, NULL, expected);
+
+        if(known && noise_resume_tag_matches(expected, tag)) {
+            if(session->state == NoiseSessionResuming &&
+               memcmp(noise->local_peer_id, peer_id, NOISE_PEER_ID_SIZE) < 0) {
+                // Both sides asked to resume; the lower peer ID's request wins
+                ok = true;
+            } else {
+                uint8_t nonce_r[NOISE_RESUME_NONCE_SIZE];
+                furi_hal_random_fill_buf(nonce_r, NOISE_RESUME_NONCE_SIZE);
+
+                size_t written = 0;
+                out[written++] = NOISE_RESUME_ACCEPT;
+                memcpy(&out[written], session->session_id, NOISE_SESSION_ID_SIZE);
+                written += NOISE_SESSION_ID_SIZE;
+                memcpy(&out[written], nonce_r, NOISE_RESUME_NONCE_SIZE);
+                written += NOISE_RESUME_NONCE_SIZE;
+                noise_resume_tag(session, NOISE_RESUME_ACCEPT, nonce, nonce_r, &out[written]);
+                written += NOISE_RESUME_TAG_SIZE;
+
+                noise_resume_finish(noise, session, false, nonce, nonce_r, &save);
+                output->type = BitchatNoiseOutputResume;
+                output->size = written;
+                ok = true;
+            }
+        } else {
+            // Unknown or stale session: tell the peer to fall back to XX.
+            // The request is unauthenticated, so our own session is left
+            // alone; only a verified tag may change session state
+            output->type = BitchatNoiseOutputResume;
+            output->size = noise_write_resume_reject(session_id, out);
+            ok = true;
+        }
+    } else if(kind == NOISE_RESUME_ACCEPT && size == NOISE_RESUME_FULL_SIZE) {
+        if(known && session->state == NoiseSessionResuming) {
+            noise_resume_tag(session, NOISE_RESUME_ACCEPT, session->resume_nonce, nonce, expected);
+            if(noise_resume_tag_matches(expected, tag)) {
+                noise_resume_finish(noise, session, true, session->resume_nonce, nonce, &save);
+                ok = true;
+            }
+        }
+    } else if(kind == NOISE_RESUME_REJECT && size == NOISE_RESUME_REJECT_SIZE) {
+        if(known && session->state == NoiseSessionResuming) {
+            BITCHAT_LOG_I(TAG, "Resumption rejected, starting full handshake");
+            noise->stats.resume_rejects++;
+            noise_session_clear(session);
+            session = noise_session_acquire(noise, peer_id, true);
+            noise_initiate_locked(session, out, output);
+            ok = true;
+        }
+    }
+
+    furi_mutex_release(noise->mutex);
+    noise_save_commit(&save);
+    return ok;
+}
+
+/**
+ * Check whether transport messages can be exchanged with a peer
+ */
+bool bitchat_noise_is_established(BitchatNoise* noise, const uint8_t* peer_id) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    bool established = session && session->state == NoiseSessionEstablished;
+    furi_mutex_release(noise->mutex);
+
+    return established;
+}
+
+/**
+ * Get the peer's authenticated static public key
+ */
+bool bitchat_noise_get_remote_static_key(BitchatNoise* noise, const uint8_t* peer_id, uint8_t* key) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(key);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    bool found = session && session->state == NoiseSessionEstablished;
+    if(found) {
+        memcpy(key, session->remote_static, BITCHAT_X25519_KEY_SIZE);
+    }
+    furi_mutex_release(noise->mutex);
+
+    return found;
+}
+
+/* ---- Transport ---- */
+
+/**
+ * Seal in place: region = nonce prefix || plaintext, followed by room for the tag
+ */
+static bool noise_seal_locked(
+    NoiseSession* session,
+    const uint8_t* ad,
+    size_t ad_size,
+    uint8_t* region,
+    size_t plain_size) {
+    if(!session || session->state != NoiseSessionEstablished ||
+       session->send_nonce >= BITCHAT_NOISE_REKEY_NONCE) {
+        return false;
+    }
+
+    uint32_t n = session->send_nonce++;
+    uint8_t nonce[BITCHAT_CHACHAPOLY_NONCE_SIZE];
+    noise_nonce(nonce, n);
+
+    region[0] = (n >> 24) & 0xFF;
+    region[1] = (n >> 16) & 0xFF;
+    region[2] = (n >> 8) & 0xFF;
+    region[3] = n & 0xFF;
+
+    uint8_t* text = &region[BITCHAT_NOISE_NONCE_PREFIX_SIZE];
+    uint32_t start = bitchat_metrics_start();
+    bitchat_chachapoly_encrypt(
+        session->send_key, nonce, ad, ad_size, text, plain_size, text, &text[plain_size]);
+    bitchat_metrics_observe(BitchatHistogramSeal, start);
+
+    session->last_used = furi_get_tick();
+    return true;
+}
+
+/**
+ * Check the replay window, authenticate and decrypt; out may point into region
+ */
+static bool noise_open_locked(
+    BitchatNoise* noise,
+    NoiseSession* session,
+    const uint8_t* ad,
+    size_t ad_size,
+    const uint8_t* region,
+    size_t plain_size,
+    uint8_t* out) {
+    if(!session || session->state != NoiseSessionEstablished) return false;
+
+    uint32_t n = ((uint32_t)region[0] << 24) | ((uint32_t)region[1] << 16) |
+                 ((uint32_t)region[2] << 8) | region[3];
+
+    // Sliding replay window over the last NOISE_REPLAY_WINDOW nonces
+    bool fresh = !session->recv_any || n > session->recv_highest;
+    if(!fresh) {
+        uint32_t age = session->recv_highest - n;
+        fresh = age < NOISE_REPLAY_WINDOW && !(session->recv_window & (1ULL << age));
+    }
+    if(!fresh) {
+        noise->stats.replays_dropped++;
+        bitchat_metrics_add(BitchatCounterCryptoReplays, 1);
+        return false;
+    }
+
+    uint8_t nonce[BITCHAT_CHACHAPOLY_NONCE_SIZE];
+    noise_nonce(nonce, n);
+    const uint8_t* text = &region[BITCHAT_NOISE_NONCE_PREFIX_SIZE];
+
+    uint32_t start = bitchat_metrics_start();
+    bool opened = bitchat_chachapoly_decrypt(
+        session->recv_key, nonce, ad, ad_size, text, plain_size, &text[plain_size], out);
+    bitchat_metrics_observe(BitchatHistogramOpen, start);
+    if(!opened) {
+        bitchat_metrics_add(BitchatCounterCryptoFailed, 1);
+        return false;
+    }
+
+    if(!session->recv_any) {
+        session->recv_highest = n;
+        session->recv_window = 1;
+        session->recv_any = true;
+    } else if(n > session->recv_highest) {
+        uint32_t shift = n - session->recv_highest;
+        session->recv_window = shift < NOISE_REPLAY_WINDOW ? (session->recv_window << shift) | 1 : 1;
+        session->recv_highest = n;
+    } else {
+        session->recv_window |= 1ULL << (session->recv_highest - n);
+    }
+
+    session->last_used = furi_get_tick();
+    return true;
+}
+
+/**
+ * Encrypt a transport message
+ */
+size_t bitchat_noise_encrypt(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* plaintext,
+    size_t size,
+    uint8_t* out,
+    size_t out_size) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(out);
+
+    if(out_size < size + BITCHAT_NOISE_TRANSPORT_OVERHEAD) return 0;
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    size_t written = 0;
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    if(size > 0) {
+        memmove(&out[BITCHAT_NOISE_NONCE_PREFIX_SIZE], plaintext, size);
+    }
+    if(noise_seal_locked(session, NULL, 0, out, size)) {
+        written = size + BITCHAT_NOISE_TRANSPORT_OVERHEAD;
+    }
+
+    furi_mutex_release(noise->mutex);
+    return written;
+}
+
+/**
+ * Decrypt a transport message
+ */
+size_t bitchat_noise_decrypt(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(message);
+    furi_assert(out);
+
+    if(size < BITCHAT_NOISE_TRANSPORT_OVERHEAD) return 0;
+    size_t plain_size = size - BITCHAT_NOISE_TRANSPORT_OVERHEAD;
+    if(out_size < plain_size) return 0;
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    bool ok = noise_open_locked(noise, session, NULL, 0, message, plain_size, out);
+
+    furi_mutex_release(noise->mutex);
+    return ok ? plain_size : 0;
+}
+
+/**
+ * Encrypt the payload of an encoded packet in place
+ */
+bool bitchat_noise_encrypt_frame(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* frame,
+    size_t frame_size) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(frame);
+
+    size_t offset, length;
+    if(!bitchat_packet_locate_payload(frame, frame_size, &offset, &length) ||
+       length < BITCHAT_NOISE_TRANSPORT_OVERHEAD) {
+        return false;
+    }
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    // Header and IDs are authenticated with the TTL zeroed so relays can decrement it
+    uint8_t ttl = frame[BITCHAT_PACKET_TTL_OFFSET];
+    frame[BITCHAT_PACKET_TTL_OFFSET] = 0;
+
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    bool ok = noise_seal_locked(
+        session, frame, offset, &frame[offset], length - BITCHAT_NOISE_TRANSPORT_OVERHEAD);
+
+    frame[BITCHAT_PACKET_TTL_OFFSET] = ttl;
+
+    furi_mutex_release(noise->mutex);
+    return ok;
+}
+
+/**
+ * Decrypt the payload of an encoded packet in place
+ */
+bool bitchat_noise_decrypt_frame(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* frame,
+    size_t frame_size,
+    uint8_t** plaintext,
+    size_t* plaintext_size) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+    furi_assert(frame);
+    furi_assert(plaintext);
+    furi_assert(plaintext_size);
+
+    size_t offset, length;
+    if(!bitchat_packet_locate_payload(frame, frame_size, &offset, &length) ||
+       length < BITCHAT_NOISE_TRANSPORT_OVERHEAD) {
+        return false;
+    }
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+
+    uint8_t ttl = frame[BITCHAT_PACKET_TTL_OFFSET];
+    frame[BITCHAT_PACKET_TTL_OFFSET] = 0;
+
+    size_t plain_size = length - BITCHAT_NOISE_TRANSPORT_OVERHEAD;
+    uint8_t* text = &frame[offset + BITCHAT_NOISE_NONCE_PREFIX_SIZE];
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    bool ok = noise_open_locked(noise, session, frame, offset, &frame[offset], plain_size, text);
+
+    frame[BITCHAT_PACKET_TTL_OFFSET] = ttl;
+
+    furi_mutex_release(noise->mutex);
+
+    if(ok) {
+        *plaintext = text;
+        *plaintext_size = plain_size;
+    }
+    return ok;
+}
+
+/**
+ * Forget a peer's session entirely
+ */
+void bitchat_noise_remove_session(BitchatNoise* noise, const uint8_t* peer_id) {
+    furi_assert(noise);
+    furi_assert(peer_id);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    NoiseSession* session = noise_session_find(noise, peer_id);
+    if(session) {
+        noise_session_clear(session);
+    }
+    furi_mutex_release(noise->mutex);
+}
+
+/**
+ * Drop idle sessions
+ */
+void bitchat_noise_expire_idle(BitchatNoise* noise) {
+    furi_assert(noise);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    noise_expire_locked(noise);
+    furi_mutex_release(noise->mutex);
+}
+
+/**
+ * Get session table statistics
+ */
+void bitchat_noise_get_stats(BitchatNoise* noise, BitchatNoiseStats* stats) {
+    furi_assert(noise);
+    furi_assert(stats);
+
+    furi_mutex_acquire(noise->mutex, FuriWaitForever);
+    *stats = noise->stats;
+    furi_mutex_release(noise->mutex);
+}
@@ -0,0 +1,246 @@
+/**
+ * BitChat Noise Protocol
+ * Noise_XX_25519_ChaChaPoly_SHA256 handshakes with a per-peer session table
+ *
+ * Sessions are kept after a link drops so that a reconnecting peer can
+ * resume with one round trip and no X25519 work (BITCHAT_PACKET_TYPE_NOISE_RESUME)
+ * instead of repeating the 3-message XX handshake. Resumption always rekeys.
+ * With a resume store attached, that state also outlives the engine, so a
+ * peer known from before a restart resumes too.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_NOISE_MAX_SESSIONS 8
+#define BITCHAT_NOISE_SESSION_IDLE_MS (30 * 60 * 1000)
+#define BITCHAT_NOISE_HANDSHAKE_TIMEOUT_MS (15 * 1000)
+#define BITCHAT_NOISE_KEY_SIZE 32
+#define BITCHAT_NOISE_TAG_SIZE 16
+#define BITCHAT_NOISE_NONCE_PREFIX_SIZE 4
+#define BITCHAT_NOISE_TRANSPORT_OVERHEAD (BITCHAT_NOISE_NONCE_PREFIX_SIZE + BITCHAT_NOISE_TAG_SIZE)
+#define BITCHAT_NOISE_MAX_HANDSHAKE_SIZE 96
+// Sessions are rekeyed (via resumption) before the 32-bit nonce wraps
+#define BITCHAT_NOISE_REKEY_NONCE 0xFFFFFF00UL
+
+typedef struct BitchatNoise BitchatNoise;
+
+/**
+ * What the caller must send after a handshake step
+ */
+typedef enum {
+    BitchatNoiseOutputNone, // Nothing to send
+    BitchatNoiseOutputHandshake, // Send as BITCHAT_PACKET_TYPE_NOISE_HANDSHAKE
+    BitchatNoiseOutputResume, // Send as BITCHAT_PACKET_TYPE_NOISE_RESUME
+} BitchatNoiseOutputType;
+
+typedef struct {
+    BitchatNoiseOutputType type;
+    size_t size;
+} BitchatNoiseOutput;
+
+/**
+ * What a session needs to be resumed
+ */
+typedef struct {
+    uint8_t remote_static[BITCHAT_NOISE_KEY_SIZE];
+    uint8_t resume_secret[BITCHAT_NOISE_KEY_SIZE];
+} BitchatNoiseResumeState;
+
+/**
+ * Fetch a stored session for a peer with no session in the table
+ * Called with the engine unlocked, so it may read the SD card; the table
+ * is checked again afterwards.
+ * @return true if state was filled in
+ */
+typedef bool (*BitchatNoiseResumeLoad)(
+    void* context,
+    const uint8_t* peer_id,
+    BitchatNoiseResumeState* state);
+
+/**
+ * Store a session after every handshake or resumption
+ * Called with the engine unlocked, after the call that completed it.
+ */
+typedef void (*BitchatNoiseResumeSave)(
+    void* context,
+    const uint8_t* peer_id,
+    const BitchatNoiseResumeState* state);
+
+/**
+ * Session table statistics
+ */
+typedef struct {
+    uint32_t full_handshakes;
+    uint32_t resumed_sessions;
+    uint32_t resume_rejects;
+    uint32_t evictions;
+    uint32_t expirations;
+    uint32_t replays_dropped;
+} BitchatNoiseStats;
+
+/**
+ * Allocate the Noise engine
+ * @param local_peer_id Our peer ID (8 bytes), used to break simultaneous-open ties
+ * @param static_private_key Our X25519 static private key (32 bytes)
+ * @return Noise engine instance
+ */
+BitchatNoise* bitchat_noise_alloc(const uint8_t* local_peer_id, const uint8_t* static_private_key);
+
+/**
+ * Free the Noise engine, wiping all session keys
+ */
+void bitchat_noise_free(BitchatNoise* noise);
+
+/**
+ * Attach persistent storage for resumption state
+ * @param noise Noise engine instance
+ * @param load Called for peers without a session (optional)
+ * @param save Called when a session is established (optional)
+ * @param context Callback context
+ */
+void bitchat_noise_set_resume_store(
+    BitchatNoise* noise,
+    BitchatNoiseResumeLoad load,
+    BitchatNoiseResumeSave save,
+    void* context);
+
+/**
+ * Make sure a session with a peer exists or is being set up.
+ * Established sessions need nothing; sessions kept from an earlier link
+ * start a resumption; otherwise a full XX handshake is started.
+ * @param noise Noise engine instance
+ * @param peer_id Peer ID (8 bytes)
+ * @param out Output buffer (BITCHAT_NOISE_MAX_HANDSHAKE_SIZE bytes)
+ * @param out_size Size of output buffer
+ * @param output What to send
+ * @return false on error, or if every other session is established
+ */
+bool bitchat_noise_connect(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output);
+
+/**
+ * Mark a peer's link as down; its session is kept for resumption
+ */
+void bitchat_noise_disconnect(BitchatNoise* noise, const uint8_t* peer_id);
+
+/**
+ * Process a received BITCHAT_PACKET_TYPE_NOISE_HANDSHAKE payload.
+ * A new handshake with a peer whose session has keys leaves them in use
+ * until message 3 completes it.
+ * @return false if the message was rejected
+ */
+bool bitchat_noise_handle_handshake(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output);
+
+/**
+ * Process a received BITCHAT_PACKET_TYPE_NOISE_RESUME payload.
+ * A rejected resumption falls back to a full handshake in `output`.
+ * @return false if the message was rejected
+ */
+bool bitchat_noise_handle_resume(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size,
+    BitchatNoiseOutput* output);
+
+/**
+ * Check whether transport messages can be exchanged with a peer
+ */
+bool bitchat_noise_is_established(BitchatNoise* noise, const uint8_t* peer_id);
+
+/**
+ * Get the peer's authenticated static public key
+ * @param key Output (32 bytes)
+ * @return false if no established session exists
+ */
+bool bitchat_noise_get_remote_static_key(BitchatNoise* noise, const uint8_t* peer_id, uint8_t* key);
+
+/**
+ * Encrypt a transport message: nonce (4 bytes) || ciphertext || tag
+ * @return Bytes written (size + BITCHAT_NOISE_TRANSPORT_OVERHEAD), or 0 on error
+ */
+size_t bitchat_noise_encrypt(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* plaintext,
+    size_t size,
+    uint8_t* out,
+    size_t out_size);
+
+/**
+ * Decrypt a transport message, rejecting replayed nonces
+ * @return Plaintext size, or 0 on error
+ */
+size_t bitchat_noise_decrypt(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    const uint8_t* message,
+    size_t size,
+    uint8_t* out,
+    size_t out_size);
+
+/**
+ * Encrypt the payload of an encoded packet in place.
+ * The TX frame is used as-is, with no extra buffers: encode the packet with
+ * payload NULL and payload_length = plaintext size + BITCHAT_NOISE_TRANSPORT_OVERHEAD,
+ * write the plaintext at BITCHAT_NOISE_NONCE_PREFIX_SIZE bytes into the payload,
+ * then call this. Everything before the payload (header with TTL zeroed,
+ * sender and recipient IDs) is authenticated as associated data. Sign the
+ * packet afterwards if it carries a signature.
+ * @param frame Encoded packet
+ * @param frame_size Encoded packet size
+ * @return false if there is no established session or the frame is malformed
+ */
+bool bitchat_noise_encrypt_frame(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* frame,
+    size_t frame_size);
+
+/**
+ * Decrypt the payload of a received packet in place
+ * @param frame Encoded packet, modified in place
+ * @param frame_size Encoded packet size
+ * @param plaintext Set to the plaintext inside frame
+ * @param plaintext_size Set to the plaintext size
+ * @return false if the frame failed authentication or was replayed
+ */
+bool bitchat_noise_decrypt_frame(
+    BitchatNoise* noise,
+    const uint8_t* peer_id,
+    uint8_t* frame,
+    size_t frame_size,
+    uint8_t** plaintext,
+    size_t* plaintext_size);
+
+/**
+ * Forget a peer's session entirely
+ */
+void bitchat_noise_remove_session(BitchatNoise* noise, const uint8_t* peer_id);
+
+/**
+ * Drop sessions idle longer than BITCHAT_NOISE_SESSION_IDLE_MS
+ */
+void bitchat_noise_expire_idle(BitchatNoise* noise);
+
+/**
+ * Get session table statistics
+ */
+void bitchat_noise_get_stats(BitchatNoise* noise, BitchatNoiseStats* stats);
@@ -0,0 +1,498 @@
+/**
+ * BitChat Fragmentation Implementation
+ */
+
+#include "bitchat_fragment.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define TAG "BitchatFragment"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_PROTOCOL
+
+#define FRAGMENT_SLOT_EMPTY 0xFF
+#define FRAGMENT_COMPLETED_HISTORY 4
+
+/**
+ * One frame being reassembled
+ * Slot i holds data block i, or a repair block standing in for it until decode
+ */
+typedef struct {
+    bool active;
+    uint8_t sender_id[8];
+    uint32_t started;
+    BitchatFragmentPlan plan;
+    uint8_t* blocks;
+    uint8_t rows[BITCHAT_FRAGMENT_MAX_DATA];
+    uint64_t seen;
+    uint8_t received;
+} ReassemblyTransfer;
+
+typedef struct {
+    uint8_t sender_id[8];
+    uint32_t transfer_id;
+} CompletedTransfer;
+
+struct BitchatReassembler {
+    ReassemblyTransfer transfers[BITCHAT_FRAGMENT_MAX_TRANSFERS];
+    // Late fragments of finished transfers are ignored rather than restarting them
+    CompletedTransfer completed[FRAGMENT_COMPLETED_HISTORY];
+    size_t completed_next;
+    uint8_t* output;
+};
+
+/* ---- GF(256) arithmetic (polynomial 0x11D) ---- */
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static bool gf_ready = false;
+
+static void gf_init(void) {
+    if(gf_ready) return;
+
+    uint16_t x = 1;
+    for(int i = 0; i < 255; i++) {
+        gf_exp[i] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if(x & 0x100) x ^= 0x11D;
+    }
+    for(int i = 255; i < 512; i++) {
+        gf_exp[i] = gf_exp[i - 255];
+    }
+    gf_ready = true;
+}
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    if(a == 0 || b == 0) return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+/**
+ * Cauchy coefficient of data block i in repair block j: 1 / (x_j + y_i)
+ * with x_j = data_count + j and y_i = i
+ */
+static inline uint8_t fragment_coefficient(uint8_t data_count, uint8_t j, uint8_t i) {
+    return gf_inv((data_count + j) ^ i);
+}
+
+/**
+ * block ^= c * source
+ */
+static void gf_mul_add(uint8_t* block, const uint8_t* source, size_t size, uint8_t c) {
+    if(c == 0) return;
+    uint16_t log_c = gf_log[c];
+    for(size_t i = 0; i < size; i++) {
+        if(source[i]) {
+            block[i] ^= gf_exp[gf_log[source[i]] + log_c];
+        }
+    }
+}
+
+/**
+ * Invert an n x n matrix in place (Gauss-Jordan); Cauchy submatrices always invert
+ */
+static bool gf_invert(uint8_t* m, size_t n) {
+    uint8_t inv[BITCHAT_FRAGMENT_MAX_REPAIR * BITCHAT_FRAGMENT_MAX_REPAIR];
+    memset(inv, 0, n * n);
+    for(size_t i = 0; i < n; i++) {
+        inv[i * n + i] = 1;
+    }
+
+    for(size_t col = 0; col < n; col++) {
+        size_t pivot = col;
+        while(pivot < n && m[pivot * n + col] == 0) {
+            pivot++;
+        }
+        if(pivot == n) return false;
+
+        if(pivot != col) {
+            for(size_t k = 0; k < n; k++) {
+                uint8_t t = m[col * n + k];
+                m[col * n + k] = m[pivot * n + k];
+                m[pivot * n + k] = t;
+                t = inv[col * n + k];
+                inv[col * n + k] = inv[pivot * n + k];
+                inv[pivot * n + k] = t;
+            }
+        }
+
+        uint8_t scale = gf_inv(m[col * n + col]);
+        for(size_t k = 0; k < n; k++) {
+            m[col * n + k] = gf_mul(m[col * n + k], scale);
+            inv[col * n + k] = gf_mul(inv[col * n + k], scale);
+        }
+
+        for(size_t row = 0; row < n; row++) {
+            uint8_t factor = m[row * n + col];
+            if(row == col || factor == 0) continue;
+            for(size_t k = 0; k < n; k++) {
+                m[row * n + k] ^= gf_mul(factor, m[col * n + k]);
+                inv[row * n + k] ^= gf_mul(factor, inv[col * n + k]);
+            }
+        }
+    }
+
+    memcpy(m, inv, n * n);
+    return true;
+}
+
+/* ---- Sender ---- */
+
+/**
+ * Plan the fragmentation of a frame
+ */
+bool bitchat_fragment_plan(
+    size_t size,
+    size_t max_fragment_size,
+    uint8_t repair_count,
+    uint8_t original_type,
+    BitchatFragmentPlan* plan) {
+    furi_assert(plan);
+
+    if(size == 0 || size > 0xFFFF || max_fragment_size <= BITCHAT_FRAGMENT_HEADER_SIZE) {
+        return false;
+    }
+
+    size_t max_block = max_fragment_size - BITCHAT_FRAGMENT_HEADER_SIZE;
+    size_t data_count = (size + max_block - 1) / max_block;
+    if(data_count > BITCHAT_FRAGMENT_MAX_DATA) return false;
+
+    plan->transfer_id = furi_hal_random_get();
+    plan->original_type = original_type;
+    plan->total_size = size;
+    plan->data_count = data_count;
+    plan->repair_count = repair_count < BITCHAT_FRAGMENT_MAX_REPAIR ? repair_count :
+                                                                      BITCHAT_FRAGMENT_MAX_REPAIR;
+    // Spread the frame evenly so the last block carries little padding
+    plan->block_size = (size + data_count - 1) / data_count;
+    return true;
+}
+
+/**
+ * Get the number of fragments a plan produces
+ */
+size_t bitchat_fragment_count(const BitchatFragmentPlan* plan) {
+    furi_assert(plan);
+    return plan->data_count + plan->repair_count;
+}
+
+/**
+ * Copy data block i, zero-padded past the end of the frame
+ */
+static void fragment_data_block(
+    const BitchatFragmentPlan* plan,
+    const uint8_t* frame,
+    uint8_t i,
+    uint8_t* out) {
+    size_t start = (size_t)i * plan->block_size;
+    size_t take = start < plan->total_size ? plan->total_size - start : 0;
+    if(take > plan->block_size) take = plan->block_size;
+    memcpy(out, &frame[start], take);
+    memset(&out[take], 0, plan->block_size - take);
+}
+
+/**
+ * Build one fragment payload
+ */
+size_t bitchat_fragment_encode(
+    const BitchatFragmentPlan* plan,
+    const uint8_t* frame,
+    uint8_t index,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(plan);
+    furi_assert(frame);
+    furi_assert(buffer);
+
+    size_t size = BITCHAT_FRAGMENT_HEADER_SIZE + plan->block_size;
+    if(index >= bitchat_fragment_count(plan) || buffer_size < size) return 0;
+
+    buffer[0] = (plan->transfer_id >> 24) & 0xFF;
+    buffer[1] = (plan->transfer_id >> 16) & 0xFF;
+    buffer[2] = (plan->transfer_id >> 8) & 0xFF;
+    buffer[3] = plan->transfer_id & 0xFF;
+    buffer[4] = index;
+    buffer[5] = plan->data_count;
+    buffer[6] = plan->repair_count;
+    buffer[7] = plan->original_type;
+    buffer[8] = (plan->total_size >> 8) & 0xFF;
+    buffer[9] = plan->total_size & 0xFF;
+
+    uint8_t* block = &buffer[BITCHAT_FRAGMENT_HEADER_SIZE];
+    if(index < plan->data_count) {
+        fragment_data_block(plan, frame, index, block);
+        return size;
+    }
+
+    // Repair block: sum over data blocks, only the last one needs padding
+    gf_init();
+    uint8_t j = index - plan->data_count;
+    memset(block, 0, plan->block_size);
+    for(uint8_t i = 0; i < plan->data_count; i++) {
+        size_t start = (size_t)i * plan->block_size;
+        size_t take = plan->total_size - start;
+        if(take > plan->block_size) take = plan->block_size;
+        gf_mul_add(block, &frame[start], take, fragment_coefficient(plan->data_count, j, i));
+    }
+    return size;
+}
+
+/* ---- Receiver ---- */
+
+/**
+ * Allocate a reassembler
+ */
+BitchatReassembler* bitchat_reassembler_alloc(void) {
+    BitchatReassembler* reassembler =
+        bitchat_heap_alloc(BitchatHeapTagPacket, sizeof(BitchatReassembler));
+    memset(reassembler, 0, sizeof(BitchatReassembler));
+    gf_init();
+    return reassembler;
+}
+
+static void reassembly_clear(ReassemblyTransfer* transfer) {
+    bitchat_heap_free(transfer->blocks);
+    memset(transfer, 0, sizeof(ReassemblyTransfer));
+}
+
+/**
+ * Free a reassembler
+ */
+void bitchat_reassembler_free(BitchatReassembler* reassembler) {
+    furi_assert(reassembler);
+
+    for(size_t i = 0; i < BITCHAT_FRAGMENT_MAX_TRANSFERS; i++) {
+        reassembly_clear(&reassembler->transfers[i]);
+    }
+    bitchat_heap_free(reassembler->output);
+    bitchat_heap_free(reassembler);
+}
+
+/**
+ * Recover missing data blocks from the repair blocks standing in their slots
+ */
+static bool reassembly_decode(ReassemblyTransfer* transfer) {
+    const BitchatFragmentPlan* plan = &transfer->plan;
+    uint8_t missing[BITCHAT_FRAGMENT_MAX_REPAIR];
+    size_t m = 0;
+
+    for(uint8_t i = 0; i < plan->data_count; i++) {
+        if(transfer->rows[i] != i) {
+            if(m == BITCHAT_FRAGMENT_MAX_REPAIR) return false;
+            missing[m++] = i;
+        }
+    }
+    if(m == 0) return true;
+
+    // Remove the known data blocks from each repair block
+    for(size_t a = 0; a < m; a++) {
+        uint8_t* repair = &transfer->blocks[(size_t)missing[a] * plan->block_size];
+        uint8_t j = transfer->rows[missing[a]] - plan->data_count;
+        for(uint8_t i = 0; i < plan->data_count; i++) {
+            if(transfer->rows[i] != i) continue;
+            gf_mul_add(
+                repair,
+                &transfer->blocks[(size_t)i * plan->block_size],
+                plan->block_size,
+                fragment_coefficient(plan->data_count, j, i));
+        }
+    }
+
+    // Solve the m x m Cauchy system one byte column at a time
+    uint8_t matrix[BITCHAT_FRAGMENT_MAX_REPAIR * BITCHAT_FRAGMENT_MAX_REPAIR];
+    for(size_t a = 0; a < m; a++) {
+        uint8_t j = transfer->rows[missing[a]] - plan->data_count;
+        for(size_t b = 0; b < m; b++) {
+            matrix[a * m + b] = fragment_coefficient(plan->data_count, j, missing[b]);
+        }
+    }
+    if(!gf_invert(matrix, m)) return false;
+
+    uint8_t in[BITCHAT_FRAGMENT_MAX_REPAIR];
+    for(size_t k = 0; k < plan->block_size; k++) {
+        for(size_t a = 0; a < m; a++) {
+            in[a] = transfer->blocks[(size_t)missing[a] * plan->block_size + k];
+        }
+        for(size_t b = 0; b < m; b++) {
+            uint8_t value = 0;
+            for(size_t a = 0; a < m; a++) {
+                value ^= gf_mul(matrix[b * m + a], in[a]);
+            }
+            transfer->blocks[(size_t)missing[b] * plan->block_size + k] = value;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Whether two plans describe the same transfer; compared field by field so
+ * struct padding never takes part
+ */
+static bool fragment_plan_equal(const BitchatFragmentPlan* a, const BitchatFragmentPlan* b) {
+    return a->transfer_id == b->transfer_id && a->original_type == b->original_type &&
+           a->total_size == b->total_size && a->data_count == b->data_count &&
+           a->repair_count == b->repair_count && a->block_size == b->block_size;
+}
+
+/**
+ * Find the transfer a fragment belongs to, or start one
+ */
+static ReassemblyTransfer* reassembly_acquire(
+    BitchatReassembler* reassembler,
+    const uint8_t* sender_id,
+    const BitchatFragmentPlan* plan) {
+    uint32_t now = furi_get_tick();
+
+    for(size_t i = 0; i < BITCHAT_FRAGMENT_MAX_TRANSFERS; i++) {
+        ReassemblyTransfer* transfer = &reassembler->transfers[i];
+        if(!transfer->active) continue;
+        if(transfer->plan.transfer_id == plan->transfer_id &&
+           memcmp(transfer->sender_id, sender_id, 8) == 0) {
+            return transfer;
+        }
+        if(now - transfer->started > furi_ms_to_ticks(BITCHAT_FRAGMENT_TIMEOUT_MS)) {
+            reassembly_clear(transfer);
+        }
+    }
+
+    for(size_t i = 0; i < FRAGMENT_COMPLETED_HISTORY; i++) {
+        if(reassembler->completed[i].transfer_id == plan->transfer_id &&
+           memcmp(reassembler->completed[i].sender_id, sender_id, 8) == 0) {
+            return NULL;
+        }
+    }
+
+    // Free slot, else the oldest incomplete transfer
+    ReassemblyTransfer* victim = &reassembler->transfers[0];
+    for(size_t i = 0; i < BITCHAT_FRAGMENT_MAX_TRANSFERS && victim->active; i++) {
+        ReassemblyTransfer* transfer = &reassembler->transfers[i];
+        if(!transfer->active || (int32_t)(transfer->started - victim->started) < 0) {
+            victim = transfer;
+        }
+    }
+
+    if(victim->active) {
+        BITCHAT_LOG_W(TAG, "Dropping oldest incomplete transfer");
+        reassembly_clear(victim);
+    }
+
+    victim->active = true;
+    memcpy(victim->sender_id, sender_id, 8);
+    victim->started = now;
+    victim->plan = *plan;
+    victim->blocks =
+        bitchat_heap_alloc(BitchatHeapTagPacket, (size_t)plan->data_count * plan->block_size);
+    memset(victim->rows, FRAGMENT_SLOT_EMPTY, sizeof(victim->rows));
+    return victim;
+}
+
+/**
+ * Add a received fragment
+ */
+bool bitchat_reassembler_add(
+    BitchatReassembler* reassembler,
+    const uint8_t* sender_id,
+    const uint8_t* fragment,
+    size_t size,
+    const uint8_t** frame,
+    size_t* frame_size) {
+    furi_assert(reassembler);
+    furi_assert(sender_id);
+    furi_assert(fragment);
+    furi_assert(frame);
+    furi_assert(frame_size);
+
+    if(size <= BITCHAT_FRAGMENT_HEADER_SIZE) return false;
+
+    BitchatFragmentPlan plan = {0};
+    plan.transfer_id = ((uint32_t)fragment[0] << 24) | ((uint32_t)fragment[1] << 16) |
+                       ((uint32_t)fragment[2] << 8) | fragment[3];
+    uint8_t index = fragment[4];
+    plan.data_count = fragment[5];
+    plan.repair_count = fragment[6];
+    plan.original_type = fragment[7];
+    plan.total_size = ((uint16_t)fragment[8] << 8) | fragment[9];
+    plan.block_size = size - BITCHAT_FRAGMENT_HEADER_SIZE;
+
+    if(plan.data_count == 0 || plan.data_count > BITCHAT_FRAGMENT_MAX_DATA ||
+       plan.repair_count > BITCHAT_FRAGMENT_MAX_REPAIR ||
+       index >= plan.data_count + plan.repair_count || plan.total_size == 0 ||
+       plan.total_size > BITCHAT_FRAGMENT_MAX_FRAME ||
+       (size_t)plan.data_count * plan.block_size < plan.total_size ||
+       (size_t)(plan.data_count - 1) * plan.block_size >= plan.total_size) {
+        return false;
+    }
+
+    ReassemblyTransfer* transfer = reassembly_acquire(reassembler, sender_id, &plan);
+    if(!transfer) return false;
+
+    if(!fragment_plan_equal(&transfer->plan, &plan)) {
+        BITCHAT_LOG_W(TAG, "Fragment does not match its transfer");
+        return false;
+    }
+    if(transfer->seen & (1ULL << index)) return false;
+    transfer->seen |= 1ULL << index;
+
+    const uint8_t* block = &fragment[BITCHAT_FRAGMENT_HEADER_SIZE];
+    uint8_t slot = FRAGMENT_SLOT_EMPTY;
+    if(index < plan.data_count) {
+        slot = index;
+        if(transfer->rows[slot] != FRAGMENT_SLOT_EMPTY) {
+            // A repair block is standing in here; move it to another missing slot
+            for(uint8_t i = 0; i < plan.data_count; i++) {
+                if(transfer->rows[i] == FRAGMENT_SLOT_EMPTY) {
+                    memcpy(
+                        &transfer->blocks[(size_t)i * plan.block_size],
+                        &transfer->blocks[(size_t)slot * plan.block_size],
+                        plan.block_size);
+                    transfer->rows[i] = transfer->rows[slot];
+                    break;
+                }
+            }
+        }
+    } else {
+        for(uint8_t i = 0; i < plan.data_count; i++) {
+            if(transfer->rows[i] == FRAGMENT_SLOT_EMPTY) {
+                slot = i;
+                break;
+            }
+        }
+        if(slot == FRAGMENT_SLOT_EMPTY) return false;
+    }
+
+    memcpy(&transfer->blocks[(size_t)slot * plan.block_size], block, plan.block_size);
+    transfer->rows[slot] = index;
+    transfer->received++;
+
+    if(transfer->received < plan.data_count) return false;
+
+    bool ok = reassembly_decode(transfer);
+    if(ok) {
+        CompletedTransfer* completed = &reassembler->completed[reassembler->completed_next];
+        memcpy(completed->sender_id, sender_id, 8);
+        completed->transfer_id = plan.transfer_id;
+        reassembler->completed_next = (reassembler->completed_next + 1) % FRAGMENT_COMPLETED_HISTORY;
+
+        // Hand the block buffer over as the output frame
+        bitchat_heap_free(reassembler->output);
+        reassembler->output = transfer->blocks;
+        transfer->blocks = NULL;
+
+        *frame = reassembler->output;
+        *frame_size = plan.total_size;
+    } else {
+        BITCHAT_LOG_E(TAG, "Failed to decode transfer");
+    }
+
+    reassembly_clear(transfer);
+    return ok;
+}
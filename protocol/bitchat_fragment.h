@@ -0,0 +1,105 @@
+/**
+ * BitChat Fragmentation
+ * Splits packets larger than the link MTU into BITCHAT_PACKET_TYPE_FRAGMENT
+ * packets, with optional forward error correction
+ *
+ * The original frame is cut into K equal data blocks. A sender may add
+ * R repair blocks from a systematic Cauchy Reed-Solomon code over GF(256).
+ * A receiver rebuilds the frame from any K of the K + R fragments, so lost
+ * fragments cost no round trip and no retransmission across hops.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// transfer id (4) | index (1) | data count (1) | repair count (1) | type (1) | total size (2)
+#define BITCHAT_FRAGMENT_HEADER_SIZE 10
+#define BITCHAT_FRAGMENT_MAX_DATA 32
+#define BITCHAT_FRAGMENT_MAX_REPAIR 8
+// Largest frame a receiver will reassemble; bounds reassembly RAM
+#define BITCHAT_FRAGMENT_MAX_FRAME 4096
+#define BITCHAT_FRAGMENT_MAX_TRANSFERS 2
+#define BITCHAT_FRAGMENT_TIMEOUT_MS (30 * 1000)
+
+/**
+ * How a frame is split; shared by every fragment of one transfer
+ */
+typedef struct {
+    uint32_t transfer_id;
+    uint8_t original_type;
+    uint16_t total_size;
+    uint8_t data_count;
+    uint8_t repair_count;
+    uint16_t block_size;
+} BitchatFragmentPlan;
+
+typedef struct BitchatReassembler BitchatReassembler;
+
+/**
+ * Plan the fragmentation of a frame
+ * @param size Frame size
+ * @param max_fragment_size Largest fragment payload (header + block)
+ * @param repair_count Repair fragments to add (0 disables FEC)
+ * @param original_type Packet type of the frame, for receivers' bookkeeping
+ * @param plan Output plan
+ * @return false if the frame needs more than BITCHAT_FRAGMENT_MAX_DATA fragments
+ */
+bool bitchat_fragment_plan(
+    size_t size,
+    size_t max_fragment_size,
+    uint8_t repair_count,
+    uint8_t original_type,
+    BitchatFragmentPlan* plan);
+
+/**
+ * Get the number of fragments a plan produces
+ */
+size_t bitchat_fragment_count(const BitchatFragmentPlan* plan);
+
+/**
+ * Build one fragment payload
+ * Data fragments are copies of the frame; repair fragments are computed from it.
+ * @param plan Fragmentation plan
+ * @param frame The whole frame being fragmented
+ * @param index Fragment index, 0 .. bitchat_fragment_count() - 1
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return Bytes written, or 0 on error
+ */
+size_t bitchat_fragment_encode(
+    const BitchatFragmentPlan* plan,
+    const uint8_t* frame,
+    uint8_t index,
+    uint8_t* buffer,
+    size_t buffer_size);
+
+/**
+ * Allocate a reassembler
+ */
+BitchatReassembler* bitchat_reassembler_alloc(void);
+
+/**
+ * Free a reassembler
+ */
+void bitchat_reassembler_free(BitchatReassembler* reassembler);
+
+/**
+ * Add a received fragment
+ * @param reassembler Reassembler instance
+ * @param sender_id Sender of the fragment packet (8 bytes)
+ * @param fragment Fragment payload
+ * @param size Fragment payload size
+ * @param frame Set to the rebuilt frame when complete; valid until the next call
+ * @param frame_size Set to the rebuilt frame size
+ * @return true when this fragment completed a frame
+ */
+bool bitchat_reassembler_add(
+    BitchatReassembler* reassembler,
+    const uint8_t* sender_id,
+    const uint8_t* fragment,
+    size_t size,
+    const uint8_t** frame,
+    size_t* frame_size);
@@ -3,6 +3,9 @@
  */
 
 #include "bitchat_protocol.h"
+#include "../utils/bitchat_metrics.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
 #include <furi.h>
 #include <furi_hal.h>
 #include <furi_hal_random.h>
@@ -11,6 +14,7 @@
 #include <stdlib.h>
 
 #define TAG "BitchatProtocol"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_PROTOCOL
 
 /**
  * Encode a 16-bit value to big-endian
@@ -48,25 +52,49 @@ static uint64_t decode_u64_be(const uint8_t* buf) {
 }
 
 /**
- * Encode a packet to binary format
+ * Encode a 32-bit value to big-endian
  */
-size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_t buffer_size) {
+static void encode_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+/**
+ * Decode a 32-bit value from big-endian
+ */
+static uint32_t decode_u32_be(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/**
+ * Get the encoded size of a packet
+ */
+size_t bitchat_packet_get_size(const BitchatPacket* packet) {
     furi_assert(packet);
-    furi_assert(buffer);
 
+    size_t size = BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE + packet->payload_length;
+    if(packet->has_recipient) size += BITCHAT_RECIPIENT_ID_SIZE;
+    if(packet->has_signature) size += BITCHAT_SIGNATURE_SIZE;
+    return size;
+}
+
+/**
+ * Encode a packet to binary format
+ */
+static size_t packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_t buffer_size) {
     // Calculate required size
-    size_t required_size = BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE + packet->payload_length;
-    if(packet->has_recipient) required_size += BITCHAT_RECIPIENT_ID_SIZE;
-    if(packet->has_signature) required_size += BITCHAT_SIGNATURE_SIZE;
+    size_t required_size = bitchat_packet_get_size(packet);
 
     if(buffer_size < required_size) {
-        FURI_LOG_E(TAG, "Buffer too small: need %zu, have %zu", required_size, buffer_size);
+        BITCHAT_LOG_E(TAG, "Buffer too small: need %zu, have %zu", required_size, buffer_size);
         return 0;
     }
 
     size_t offset = 0;
 
-    // Header (13 bytes)
+    // Header (14 bytes)
     buffer[offset++] = packet->version;
     buffer[offset++] = packet->type;
     buffer[offset++] = packet->ttl;
@@ -96,11 +124,11 @@ size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_
         offset += BITCHAT_RECIPIENT_ID_SIZE;
     }
 
-    // Payload
+    // Payload (reserved but left untouched when there is no payload buffer)
     if(packet->payload && packet->payload_length > 0) {
         memcpy(&buffer[offset], packet->payload, packet->payload_length);
-        offset += packet->payload_length;
     }
+    offset += packet->payload_length;
 
     // Signature (64 bytes, optional)
     if(packet->has_signature) {
@@ -108,22 +136,48 @@ size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_
         offset += BITCHAT_SIGNATURE_SIZE;
     }
 
-    FURI_LOG_D(TAG, "Encoded packet: type=%d, ttl=%d, payload=%d bytes, total=%zu bytes",
-        packet->type, packet->ttl, packet->payload_length, offset);
+    BITCHAT_TRACE(BitchatTracePacketEncoded, packet->type, packet->ttl, offset);
 
     return offset;
 }
 
 /**
- * Decode binary data to a packet
+ * Encode a packet, timed and counted
  */
-bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket* packet) {
-    furi_assert(data);
+size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_t buffer_size) {
+    furi_assert(packet);
+    furi_assert(buffer);
+
+    uint32_t start = bitchat_metrics_start();
+    size_t size = packet_encode(packet, buffer, buffer_size);
+    bitchat_metrics_observe(BitchatHistogramEncode, start);
+    if(size == 0) bitchat_metrics_add(BitchatCounterEncodeFailed, 1);
+    return size;
+}
+
+/**
+ * Encode the bytes covered by a packet signature
+ */
+size_t bitchat_packet_encode_for_signing(
+    const BitchatPacket* packet,
+    uint8_t* buffer,
+    size_t buffer_size) {
     furi_assert(packet);
 
+    BitchatPacket signing_packet = *packet;
+    signing_packet.ttl = 0;
+    signing_packet.has_signature = false;
+
+    return bitchat_packet_encode(&signing_packet, buffer, buffer_size);
+}
+
+/**
+ * Decode binary data to a packet
+ */
+static bool packet_decode(const uint8_t* data, size_t data_size, BitchatPacket* packet) {
     // Minimum size check (header + sender ID)
     if(data_size < BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE) {
-        FURI_LOG_E(TAG, "Packet too small: %zu bytes", data_size);
+        BITCHAT_LOG_E(TAG, "Packet too small: %zu bytes", data_size);
         return false;
     }
 
@@ -132,7 +186,7 @@ bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket*
     // Parse header
     packet->version = data[offset++];
     if(packet->version != BITCHAT_VERSION) {
-        FURI_LOG_E(TAG, "Invalid version: %d", packet->version);
+        BITCHAT_LOG_E(TAG, "Invalid version: %d", packet->version);
         return false;
     }
 
@@ -167,13 +221,13 @@ bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket*
 
     // Payload
     if(offset + packet->payload_length > data_size) {
-        FURI_LOG_E(TAG, "Payload overflow: need %d, have %zu", packet->payload_length, data_size - offset);
+        BITCHAT_LOG_E(TAG, "Payload overflow: need %d, have %zu", packet->payload_length, data_size - offset);
         return false;
     }
 
     // Allocate and copy payload
     if(packet->payload_length > 0) {
-        packet->payload = malloc(packet->payload_length);
+        packet->payload = bitchat_heap_alloc(BitchatHeapTagPacket, packet->payload_length);
         memcpy(packet->payload, &data[offset], packet->payload_length);
         offset += packet->payload_length;
     } else {
@@ -182,17 +236,375 @@ bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket*
 
     // Signature (optional)
     if(packet->has_signature) {
-        if(offset + BITCHAT_SIGNATURE_SIZE > data_size) return false;
+        if(offset + BITCHAT_SIGNATURE_SIZE > data_size) {
+            bitchat_heap_free(packet->payload);
+            packet->payload = NULL;
+            return false;
+        }
         memcpy(packet->signature, &data[offset], BITCHAT_SIGNATURE_SIZE);
         offset += BITCHAT_SIGNATURE_SIZE;
     }
 
-    FURI_LOG_D(TAG, "Decoded packet: type=%d, ttl=%d, payload=%d bytes",
-        packet->type, packet->ttl, packet->payload_length);
+    BITCHAT_TRACE(BitchatTracePacketDecoded, packet->type, packet->ttl, packet->payload_length);
+
+    return true;
+}
+
+/**
+ * Decode a packet, timed and counted
+ */
+bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket* packet) {
+    furi_assert(data);
+    furi_assert(packet);
+
+    uint32_t start = bitchat_metrics_start();
+    bool decoded = packet_decode(data, data_size, packet);
+    bitchat_metrics_observe(BitchatHistogramDecode, start);
+    if(!decoded) bitchat_metrics_add(BitchatCounterDecodeFailed, 1);
+    return decoded;
+}
+
+/**
+ * Locate the payload inside an encoded packet
+ */
+bool bitchat_packet_locate_payload(
+    const uint8_t* data,
+    size_t data_size,
+    size_t* offset,
+    size_t* length) {
+    furi_assert(data);
+    furi_assert(offset);
+    furi_assert(length);
+
+    if(data_size < BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE) return false;
+    if(data[0] != BITCHAT_VERSION) return false;
+
+    uint8_t flags = data[11];
+    size_t payload_offset = BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE;
+    if(flags & BITCHAT_FLAG_HAS_RECIPIENT) payload_offset += BITCHAT_RECIPIENT_ID_SIZE;
+
+    size_t payload_length = decode_u16_be(&data[12]);
+    size_t required = payload_offset + payload_length;
+    if(flags & BITCHAT_FLAG_HAS_SIGNATURE) required += BITCHAT_SIGNATURE_SIZE;
+    if(required > data_size) return false;
+
+    *offset = payload_offset;
+    *length = payload_length;
+    return true;
+}
+
+/**
+ * Routes each packet type may take, before addressing narrows them
+ * Unknown types are dropped. Link-level types (sync, fragments, transfers)
+ * only concern the neighbour that sent them.
+ */
+static const uint8_t packet_type_routes[256] = {
+    [BITCHAT_PACKET_TYPE_PUBLIC_MESSAGE] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_PRIVATE_MESSAGE] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_ANNOUNCEMENT] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_SYNC_REQUEST] = BitchatRouteDeliver,
+    [BITCHAT_PACKET_TYPE_SYNC_RESPONSE] = BitchatRouteDeliver,
+    [BITCHAT_PACKET_TYPE_NOISE_HANDSHAKE] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_DELIVERY_ACK] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_NOISE_RESUME] = BitchatRouteBoth,
+    [BITCHAT_PACKET_TYPE_FRAGMENT] = BitchatRouteDeliver,
+    [BITCHAT_PACKET_TYPE_TRANSFER_DATA] = BitchatRouteDeliver,
+    [BITCHAT_PACKET_TYPE_TRANSFER_ACK] = BitchatRouteDeliver,
+};
+
+/**
+ * Read and validate the fixed prefix of an encoded packet
+ */
+bool bitchat_packet_peek_header(
+    const uint8_t* data,
+    size_t data_size,
+    BitchatPacketHeader* header) {
+    furi_assert(data);
+    furi_assert(header);
+
+    if(data_size < BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE) return false;
+    if(data[0] != BITCHAT_VERSION) return false;
+
+    header->version = data[0];
+    header->type = data[1];
+    header->ttl = data[2];
+    header->timestamp = decode_u64_be(&data[3]);
+    header->flags = data[11];
+    header->payload_length = decode_u16_be(&data[12]);
+    memcpy(header->sender_id, &data[BITCHAT_HEADER_SIZE], BITCHAT_SENDER_ID_SIZE);
+
+    size_t offset = BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE;
+    header->has_recipient = (header->flags & BITCHAT_FLAG_HAS_RECIPIENT) != 0;
+    if(header->has_recipient) {
+        if(offset + BITCHAT_RECIPIENT_ID_SIZE > data_size) return false;
+        memcpy(header->recipient_id, &data[offset], BITCHAT_RECIPIENT_ID_SIZE);
+        offset += BITCHAT_RECIPIENT_ID_SIZE;
+    } else {
+        memset(header->recipient_id, 0xFF, BITCHAT_RECIPIENT_ID_SIZE);
+    }
+
+    offset += header->payload_length;
+    if(header->flags & BITCHAT_FLAG_HAS_SIGNATURE) offset += BITCHAT_SIGNATURE_SIZE;
+    if(offset > data_size) return false;
+
+    header->packet_size = offset;
+    return true;
+}
+
+/**
+ * Route a packet from its header alone
+ */
+BitchatRoute
+    bitchat_packet_classify(const BitchatPacketHeader* header, const uint8_t* local_peer_id) {
+    furi_assert(header);
+    furi_assert(local_peer_id);
+
+    uint8_t route = packet_type_routes[header->type];
+    if(route == BitchatRouteDrop) return BitchatRouteDrop;
+
+    // Our own packets coming back through the mesh
+    if(memcmp(header->sender_id, local_peer_id, BITCHAT_SENDER_ID_SIZE) == 0) {
+        return BitchatRouteDrop;
+    }
+
+    // All 0xFF, as when absent, addresses everyone
+    bool broadcast = true;
+    for(size_t i = 0; i < BITCHAT_RECIPIENT_ID_SIZE; i++) {
+        if(header->recipient_id[i] != 0xFF) {
+            broadcast = false;
+            break;
+        }
+    }
+    if(!broadcast) {
+        if(memcmp(header->recipient_id, local_peer_id, BITCHAT_RECIPIENT_ID_SIZE) == 0) {
+            route &= ~BitchatRouteRelay;
+        } else {
+            route &= ~BitchatRouteDeliver;
+        }
+    }
+
+    if(header->ttl == 0) route &= ~BitchatRouteRelay;
+    return route;
+}
+
+/**
+ * Re-encode a v1 packet with the compact v2 header
+ */
+size_t bitchat_packet_compact(
+    const uint8_t* data,
+    size_t data_size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(data);
+    furi_assert(buffer);
+
+    size_t payload_offset, payload_length;
+    if(!bitchat_packet_locate_payload(data, data_size, &payload_offset, &payload_length)) {
+        return 0;
+    }
+
+    uint8_t ttl = data[BITCHAT_PACKET_TTL_OFFSET];
+    uint8_t flags = data[11];
+    if(ttl > BITCHAT_COMPACT_MAX_TTL || flags > 0x0F) return 0;
+
+    // Timestamps more than ~24 days from the epoch don't fit the signed offset
+    int64_t delta = (int64_t)(decode_u64_be(&data[3]) - epoch);
+    if(delta < INT32_MIN || delta > INT32_MAX) return 0;
+
+    size_t body_size = data_size - BITCHAT_HEADER_SIZE;
+    if(buffer_size < BITCHAT_COMPACT_HEADER_MAX_SIZE + body_size) return 0;
+
+    size_t offset = 0;
+    buffer[offset++] = BITCHAT_VERSION_COMPACT;
+    buffer[offset++] = data[1];
+    buffer[offset++] = (ttl << 4) | flags;
+    encode_u32_be(&buffer[offset], (uint32_t)(int32_t)delta);
+    offset += 4;
+
+    // Payload length as a little-endian base-128 varint
+    do {
+        uint8_t byte = payload_length & 0x7F;
+        payload_length >>= 7;
+        buffer[offset++] = byte | (payload_length ? 0x80 : 0);
+    } while(payload_length);
+
+    memcpy(&buffer[offset], &data[BITCHAT_HEADER_SIZE], body_size);
+    return offset + body_size;
+}
+
+/**
+ * Expand a compact v2 packet back to v1
+ */
+size_t bitchat_packet_expand(
+    const uint8_t* data,
+    size_t data_size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(data);
+    furi_assert(buffer);
+
+    if(data_size < BITCHAT_COMPACT_HEADER_MIN_SIZE || data[0] != BITCHAT_VERSION_COMPACT) {
+        return 0;
+    }
+
+    size_t offset = 7;
+    uint32_t payload_length = 0;
+    for(int shift = 0;; shift += 7) {
+        if(offset >= data_size || shift > 14) return 0;
+        uint8_t byte = data[offset++];
+        payload_length |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) break;
+    }
+    if(payload_length > BITCHAT_MAX_PAYLOAD_SIZE) return 0;
+
+    size_t body_size = data_size - offset;
+    if(buffer_size < BITCHAT_HEADER_SIZE + body_size) return 0;
+
+    int32_t delta = (int32_t)decode_u32_be(&data[3]);
+
+    buffer[0] = BITCHAT_VERSION;
+    buffer[1] = data[1];
+    buffer[BITCHAT_PACKET_TTL_OFFSET] = data[2] >> 4;
+    encode_u64_be(&buffer[3], epoch + (int64_t)delta);
+    buffer[11] = data[2] & 0x0F;
+    encode_u16_be(&buffer[12], payload_length);
+    memcpy(&buffer[BITCHAT_HEADER_SIZE], &data[offset], body_size);
+
+    // Reject bodies too short for the flags and length
+    size_t size = BITCHAT_HEADER_SIZE + body_size;
+    size_t payload_offset, located_length;
+    if(!bitchat_packet_locate_payload(buffer, size, &payload_offset, &located_length)) {
+        return 0;
+    }
+
+    return size;
+}
 
+/**
+ * Append one TLV entry
+ */
+static bool announcement_put_tlv(
+    uint8_t* buffer,
+    size_t buffer_size,
+    size_t* offset,
+    uint8_t tag,
+    const uint8_t* value,
+    size_t size) {
+    if(size > 0xFF || *offset + 2 + size > buffer_size) return false;
+    buffer[(*offset)++] = tag;
+    buffer[(*offset)++] = size;
+    memcpy(&buffer[*offset], value, size);
+    *offset += size;
     return true;
 }
 
+/**
+ * Encode an announcement payload
+ */
+size_t bitchat_announcement_encode(
+    const BitchatAnnouncement* announcement,
+    uint8_t* buffer,
+    size_t buffer_size) {
+    furi_assert(announcement);
+    furi_assert(buffer);
+
+    size_t offset = 0;
+    bool ok = announcement_put_tlv(
+        buffer,
+        buffer_size,
+        &offset,
+        BITCHAT_ANNOUNCE_TLV_NICKNAME,
+        (const uint8_t*)announcement->nickname,
+        strnlen(announcement->nickname, sizeof(announcement->nickname)));
+
+    if(ok && announcement->has_noise_public_key) {
+        ok = announcement_put_tlv(
+            buffer,
+            buffer_size,
+            &offset,
+            BITCHAT_ANNOUNCE_TLV_NOISE_KEY,
+            announcement->noise_public_key,
+            sizeof(announcement->noise_public_key));
+    }
+
+    if(ok && announcement->has_signing_public_key) {
+        ok = announcement_put_tlv(
+            buffer,
+            buffer_size,
+            &offset,
+            BITCHAT_ANNOUNCE_TLV_SIGNING_KEY,
+            announcement->signing_public_key,
+            sizeof(announcement->signing_public_key));
+    }
+
+    if(ok && announcement->max_version > BITCHAT_VERSION) {
+        uint8_t value[9];
+        value[0] = announcement->max_version;
+        encode_u64_be(&value[1], announcement->link_epoch);
+        ok = announcement_put_tlv(
+            buffer, buffer_size, &offset, BITCHAT_ANNOUNCE_TLV_WIRE_VERSION, value, sizeof(value));
+    }
+
+    return ok ? offset : 0;
+}
+
+/**
+ * Decode an announcement payload
+ */
+bool bitchat_announcement_decode(
+    const uint8_t* data,
+    size_t data_size,
+    BitchatAnnouncement* announcement) {
+    furi_assert(data);
+    furi_assert(announcement);
+
+    memset(announcement, 0, sizeof(BitchatAnnouncement));
+    announcement->max_version = BITCHAT_VERSION;
+
+    size_t offset = 0;
+    while(offset + 2 <= data_size) {
+        uint8_t tag = data[offset];
+        uint8_t len = data[offset + 1];
+        const uint8_t* value = &data[offset + 2];
+        offset += 2;
+        if(offset + len > data_size) return false;
+        offset += len;
+
+        switch(tag) {
+        case BITCHAT_ANNOUNCE_TLV_NICKNAME: {
+            size_t copy_len = len < sizeof(announcement->nickname) - 1 ?
+                                  len :
+                                  sizeof(announcement->nickname) - 1;
+            memcpy(announcement->nickname, value, copy_len);
+            announcement->nickname[copy_len] = '\0';
+            break;
+        }
+        case BITCHAT_ANNOUNCE_TLV_NOISE_KEY:
+            if(len != sizeof(announcement->noise_public_key)) return false;
+            memcpy(announcement->noise_public_key, value, len);
+            announcement->has_noise_public_key = true;
+            break;
+        case BITCHAT_ANNOUNCE_TLV_SIGNING_KEY:
+            if(len != sizeof(announcement->signing_public_key)) return false;
+            memcpy(announcement->signing_public_key, value, len);
+            announcement->has_signing_public_key = true;
+            break;
+        case BITCHAT_ANNOUNCE_TLV_WIRE_VERSION:
+            if(len < 9) break;
+            announcement->max_version = value[0];
+            announcement->link_epoch = decode_u64_be(&value[1]);
+            break;
+        default:
+            // Unknown tags are skipped for forward compatibility
+            break;
+        }
+    }
+
+    return offset == data_size && announcement->nickname[0] != '\0';
+}
+
 /**
  * Encode a message to binary payload
  */
@@ -345,7 +757,7 @@ bool bitchat_message_decode(const uint8_t* data, size_t data_size, BitchatMessag
  * Allocate a new packet
  */
 BitchatPacket* bitchat_packet_alloc(void) {
-    BitchatPacket* packet = malloc(sizeof(BitchatPacket));
+    BitchatPacket* packet = bitchat_heap_alloc(BitchatHeapTagPacket, sizeof(BitchatPacket));
     memset(packet, 0, sizeof(BitchatPacket));
     packet->version = BITCHAT_VERSION;
     return packet;
@@ -356,10 +768,8 @@ BitchatPacket* bitchat_packet_alloc(void) {
  */
 void bitchat_packet_free(BitchatPacket* packet) {
     if(packet) {
-        if(packet->payload) {
-            free(packet->payload);
-        }
-        free(packet);
+        bitchat_heap_free(packet->payload);
+        bitchat_heap_free(packet);
     }
 }
 
@@ -367,7 +777,7 @@ void bitchat_packet_free(BitchatPacket* packet) {
  * Allocate a new message
  */
 BitchatMessage* bitchat_message_alloc(void) {
-    BitchatMessage* message = malloc(sizeof(BitchatMessage));
+    BitchatMessage* message = bitchat_heap_alloc(BitchatHeapTagMessage, sizeof(BitchatMessage));
     memset(message, 0, sizeof(BitchatMessage));
     bitchat_generate_message_id(message->id, sizeof(message->id));
     message->timestamp = bitchat_get_timestamp_ms();
@@ -378,9 +788,7 @@ BitchatMessage* bitchat_message_alloc(void) {
  * Free a message
  */
 void bitchat_message_free(BitchatMessage* message) {
-    if(message) {
-        free(message);
-    }
+    bitchat_heap_free(message);
 }
 
 /**
@@ -11,7 +11,7 @@
 
 // Protocol constants
 #define BITCHAT_VERSION 1
-#define BITCHAT_HEADER_SIZE 13
+#define BITCHAT_HEADER_SIZE 14
 #define BITCHAT_SENDER_ID_SIZE 8
 #define BITCHAT_RECIPIENT_ID_SIZE 8
 #define BITCHAT_SIGNATURE_SIZE 64
@@ -20,6 +20,27 @@
                                  BITCHAT_RECIPIENT_ID_SIZE + BITCHAT_MAX_PAYLOAD_SIZE + \
                                  BITCHAT_SIGNATURE_SIZE)
 
+// Offset of the TTL byte in an encoded packet
+#define BITCHAT_PACKET_TTL_OFFSET 2
+
+// Compact (v2) link encoding, only spoken to peers that announce support:
+// version | type | ttl:4 flags:4 | timestamp offset (4 bytes) | varint length
+#define BITCHAT_VERSION_COMPACT 2
+#define BITCHAT_COMPACT_HEADER_MIN_SIZE 8
+#define BITCHAT_COMPACT_HEADER_MAX_SIZE 10
+#define BITCHAT_COMPACT_MAX_TTL 15
+
+// Compact header plus per-link ID aliases and elided fields (ble/bitchat_link_context)
+#define BITCHAT_VERSION_ALIASED 3
+// Highest wire version we advertise in announcements
+#define BITCHAT_MAX_WIRE_VERSION BITCHAT_VERSION_ALIASED
+
+// Announcement payload TLV tags
+#define BITCHAT_ANNOUNCE_TLV_NICKNAME 0x01
+#define BITCHAT_ANNOUNCE_TLV_NOISE_KEY 0x02
+#define BITCHAT_ANNOUNCE_TLV_SIGNING_KEY 0x03
+#define BITCHAT_ANNOUNCE_TLV_WIRE_VERSION 0x04 // max version (1) | link epoch ms (8, BE)
+
 // Packet types
 typedef enum {
     BITCHAT_PACKET_TYPE_PUBLIC_MESSAGE = 0x01,
@@ -29,6 +50,10 @@ typedef enum {
     BITCHAT_PACKET_TYPE_SYNC_RESPONSE = 0x05,
     BITCHAT_PACKET_TYPE_NOISE_HANDSHAKE = 0x06,
     BITCHAT_PACKET_TYPE_DELIVERY_ACK = 0x07,
+    BITCHAT_PACKET_TYPE_NOISE_RESUME = 0x08,
+    BITCHAT_PACKET_TYPE_FRAGMENT = 0x20,
+    BITCHAT_PACKET_TYPE_TRANSFER_DATA = 0x21,
+    BITCHAT_PACKET_TYPE_TRANSFER_ACK = 0x22,
 } BitchatPacketType;
 
 // Flag bits
@@ -70,8 +95,22 @@ typedef struct {
     char sender_peer_id[17];  // 8 bytes hex = 16 chars + null
 } BitchatMessage;
 
+/**
+ * Decoded announcement payload
+ */
+typedef struct {
+    char nickname[32];
+    uint8_t noise_public_key[32];
+    uint8_t signing_public_key[32];
+    bool has_noise_public_key;
+    bool has_signing_public_key;
+    uint8_t max_version; // BITCHAT_VERSION unless the peer advertised more
+    uint64_t link_epoch; // Base for compact timestamps sent to this peer
+} BitchatAnnouncement;
+
 /**
  * Encode a packet to binary format
+ * If payload is NULL, payload_length bytes are reserved and left for the caller to fill
  * @param packet The packet to encode
  * @param buffer Output buffer
  * @param buffer_size Size of output buffer
@@ -79,8 +118,32 @@ typedef struct {
  */
 size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_t buffer_size);
 
+/**
+ * Get the encoded size of a packet
+ * @param packet The packet to measure
+ * @return Number of bytes bitchat_packet_encode() will write
+ */
+size_t bitchat_packet_get_size(const BitchatPacket* packet);
+
+/**
+ * Encode the bytes covered by a packet signature
+ * The packet is encoded with TTL 0 and without the signature field,
+ * so the result does not change as the packet is relayed.
+ * @param packet The packet to encode
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes written, or 0 on error
+ */
+size_t bitchat_packet_encode_for_signing(
+    const BitchatPacket* packet,
+    uint8_t* buffer,
+    size_t buffer_size);
+
 /**
  * Decode binary data to a packet
+ * The payload is allocated under BitchatHeapTagPacket; release it with
+ * bitchat_heap_free(), or with bitchat_packet_free() for an allocated packet.
+ * On failure nothing is left allocated.
  * @param data Input binary data
  * @param data_size Size of input data
  * @param packet Output packet structure
@@ -88,6 +151,126 @@ size_t bitchat_packet_encode(const BitchatPacket* packet, uint8_t* buffer, size_
  */
 bool bitchat_packet_decode(const uint8_t* data, size_t data_size, BitchatPacket* packet);
 
+/**
+ * Locate the payload inside an encoded packet without decoding or copying it
+ * @param data Encoded packet
+ * @param data_size Size of encoded packet
+ * @param offset Output payload offset
+ * @param length Output payload length
+ * @return true if the packet is well formed
+ */
+bool bitchat_packet_locate_payload(
+    const uint8_t* data,
+    size_t data_size,
+    size_t* offset,
+    size_t* length);
+
+/**
+ * Fixed prefix of an encoded packet, read without touching the payload
+ */
+typedef struct {
+    uint8_t version;
+    uint8_t type;
+    uint8_t ttl;
+    uint8_t flags;
+    uint64_t timestamp;
+    uint16_t payload_length;
+    uint8_t sender_id[BITCHAT_SENDER_ID_SIZE];
+    uint8_t recipient_id[BITCHAT_RECIPIENT_ID_SIZE]; // All 0xFF when absent
+    bool has_recipient;
+    size_t packet_size; // Bytes the packet spans, signature included
+} BitchatPacketHeader;
+
+/**
+ * Where a received packet goes; relay and deliver combine
+ */
+typedef enum {
+    BitchatRouteDrop = 0,
+    BitchatRouteRelay = 1 << 0, // Forward to other neighbours
+    BitchatRouteDeliver = 1 << 1, // Hand to the local app
+    BitchatRouteBoth = BitchatRouteRelay | BitchatRouteDeliver,
+} BitchatRoute;
+
+/**
+ * Read and validate the header, sender and recipient of an encoded packet
+ * Checks the same bounds as bitchat_packet_decode() but copies only the
+ * fixed prefix and allocates nothing, so frames can be classified before
+ * the full decoder runs.
+ * @param data Encoded v1 packet
+ * @param data_size Size of encoded packet
+ * @param header Output header
+ * @return true if the packet is well formed
+ */
+bool bitchat_packet_peek_header(
+    const uint8_t* data,
+    size_t data_size,
+    BitchatPacketHeader* header);
+
+/**
+ * Route a packet from its header alone
+ * The packet type picks the routes it may take; addressing then narrows
+ * them: our own packets are dropped, packets for another peer are only
+ * relayed, packets for us are only delivered and TTL 0 is never relayed.
+ * @param header Header from bitchat_packet_peek_header()
+ * @param local_peer_id Our peer ID (8 bytes)
+ * @return Route for the packet
+ */
+BitchatRoute
+    bitchat_packet_classify(const BitchatPacketHeader* header, const uint8_t* local_peer_id);
+
+/**
+ * Re-encode a v1 packet with the compact v2 header
+ * @param data Encoded v1 packet
+ * @param data_size Size of encoded packet
+ * @param epoch Receiver's link epoch (ms)
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes written, or 0 if the packet cannot be compacted
+ *         (TTL or timestamp out of range) and must be sent as v1
+ */
+size_t bitchat_packet_compact(
+    const uint8_t* data,
+    size_t data_size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size);
+
+/**
+ * Expand a compact v2 packet back to v1
+ * @param data Encoded v2 packet
+ * @param data_size Size of encoded packet
+ * @param epoch Our link epoch (ms)
+ * @param buffer Output buffer
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes written, or 0 on error
+ */
+size_t bitchat_packet_expand(
+    const uint8_t* data,
+    size_t data_size,
+    uint64_t epoch,
+    uint8_t* buffer,
+    size_t buffer_size);
+
+/**
+ * Encode an announcement payload (TLV)
+ * The wire version TLV is only written when max_version is above BITCHAT_VERSION,
+ * so announcements stay byte-identical for v1-only peers.
+ * @return Number of bytes written, or 0 on error
+ */
+size_t bitchat_announcement_encode(
+    const BitchatAnnouncement* announcement,
+    uint8_t* buffer,
+    size_t buffer_size);
+
+/**
+ * Decode an announcement payload, skipping unknown TLVs
+ * @return true on success
+ */
+bool bitchat_announcement_decode(
+    const uint8_t* data,
+    size_t data_size,
+    BitchatAnnouncement* announcement);
+
 /**
  * Encode a message to binary payload
  * @param message The message to encode
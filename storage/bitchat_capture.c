@@ -0,0 +1,183 @@
+/**
+ * BitChat Frame Capture Implementation
+ */
+
+#include "bitchat_capture.h"
+#include "bitchat_writer.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <string.h>
+
+#define TAG "BitchatCapture"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+
+struct BitchatCapture {
+    BitchatWriter* writer;
+    FuriMutex* mutex;
+
+    volatile bool running;
+    uint32_t start_tick;
+    BitchatCaptureStats stats;
+
+    // One record is built here and copied into the writer's staging buffer
+    uint8_t record[BITCHAT_CAPTURE_RECORD_HEADER_SIZE + BITCHAT_CAPTURE_MAX_FRAME];
+};
+
+static void capture_write_u16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = value >> 8;
+    buffer[1] = value & 0xFF;
+}
+
+static void capture_write_u32(uint8_t* buffer, uint32_t value) {
+    for(int i = 0; i < 4; i++) {
+        buffer[i] = (value >> (24 - i * 8)) & 0xFF;
+    }
+}
+
+/**
+ * Allocate a capture
+ */
+BitchatCapture* bitchat_capture_alloc(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    BitchatCapture* capture = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatCapture));
+    memset(capture, 0, sizeof(BitchatCapture));
+    capture->writer = writer;
+    capture->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+
+    return capture;
+}
+
+/**
+ * Stop capturing and free the capture
+ */
+void bitchat_capture_free(BitchatCapture* capture) {
+    furi_assert(capture);
+
+    bitchat_capture_stop(capture);
+    furi_mutex_free(capture->mutex);
+    bitchat_heap_free(capture);
+}
+
+/**
+ * Start a new capture file
+ */
+bool bitchat_capture_start(BitchatCapture* capture) {
+    furi_assert(capture);
+
+    uint8_t header[BITCHAT_CAPTURE_FILE_HEADER_SIZE] = {0};
+    memcpy(header, BITCHAT_CAPTURE_MAGIC, 4);
+    capture_write_u16(&header[4], BITCHAT_CAPTURE_VERSION);
+
+    furi_mutex_acquire(capture->mutex, FuriWaitForever);
+
+    bool started = bitchat_writer_replace(
+        capture->writer, BITCHAT_CAPTURE_PATH, header, sizeof(header), NULL, NULL);
+    if(started) {
+        memset(&capture->stats, 0, sizeof(capture->stats));
+        capture->stats.running = true;
+        capture->stats.bytes = sizeof(header);
+        capture->start_tick = furi_get_tick();
+        capture->running = true;
+    }
+
+    furi_mutex_release(capture->mutex);
+
+    if(started) {
+        BITCHAT_LOG_I(TAG, "Capturing to %s", BITCHAT_CAPTURE_PATH);
+    } else {
+        BITCHAT_LOG_W(TAG, "Capture not started: writer full");
+    }
+    return started;
+}
+
+/**
+ * Stop capturing
+ */
+void bitchat_capture_stop(BitchatCapture* capture) {
+    furi_assert(capture);
+
+    furi_mutex_acquire(capture->mutex, FuriWaitForever);
+    bool was_running = capture->running;
+    capture->running = false;
+    capture->stats.running = false;
+    BitchatCaptureStats stats = capture->stats;
+    furi_mutex_release(capture->mutex);
+
+    if(was_running) {
+        BITCHAT_LOG_I(
+            TAG,
+            "Capture stopped: %lu frames, %lu dropped",
+            (unsigned long)stats.frames,
+            (unsigned long)stats.dropped);
+    }
+}
+
+/**
+ * Check whether frames are being recorded
+ */
+bool bitchat_capture_is_running(BitchatCapture* capture) {
+    furi_assert(capture);
+    return capture->running;
+}
+
+/**
+ * Record one raw frame if capturing
+ */
+void bitchat_capture_frame(
+    BitchatCapture* capture,
+    BitchatCaptureDirection direction,
+    const uint8_t* peer_id,
+    uint64_t epoch,
+    const uint8_t* data,
+    size_t size) {
+    furi_assert(capture);
+    furi_assert(peer_id);
+    furi_assert(data);
+
+    // Unlocked check keeps the radio path free of the mutex while stopped
+    if(!capture->running) return;
+
+    size_t captured = size < BITCHAT_CAPTURE_MAX_FRAME ? size : BITCHAT_CAPTURE_MAX_FRAME;
+    size_t original = size < 0xFFFF ? size : 0xFFFF;
+
+    furi_mutex_acquire(capture->mutex, FuriWaitForever);
+
+    if(capture->running) {
+        uint64_t elapsed = furi_get_tick() - capture->start_tick;
+        uint8_t* record = capture->record;
+        capture_write_u32(&record[0], elapsed * 1000 / furi_kernel_get_tick_frequency());
+        record[4] = direction;
+        record[5] = 0;
+        capture_write_u16(&record[6], captured);
+        capture_write_u16(&record[8], original);
+        memcpy(&record[10], peer_id, 8);
+        capture_write_u32(&record[18], epoch >> 32);
+        capture_write_u32(&record[22], epoch & 0xFFFFFFFF);
+        memcpy(&record[BITCHAT_CAPTURE_RECORD_HEADER_SIZE], data, captured);
+
+        size_t record_size = BITCHAT_CAPTURE_RECORD_HEADER_SIZE + captured;
+        if(bitchat_writer_append(
+               capture->writer, BITCHAT_CAPTURE_PATH, record, record_size, NULL, NULL)) {
+            capture->stats.frames++;
+            capture->stats.bytes += record_size;
+        } else {
+            capture->stats.dropped++;
+        }
+    }
+
+    furi_mutex_release(capture->mutex);
+}
+
+/**
+ * Get capture statistics
+ */
+void bitchat_capture_get_stats(BitchatCapture* capture, BitchatCaptureStats* stats) {
+    furi_assert(capture);
+    furi_assert(stats);
+
+    furi_mutex_acquire(capture->mutex, FuriWaitForever);
+    *stats = capture->stats;
+    furi_mutex_release(capture->mutex);
+}
@@ -0,0 +1,101 @@
+/**
+ * BitChat Frame Capture
+ * Records every raw frame sent or received to SD card for offline replay
+ *
+ * The file starts with a short header naming the format. Each frame follows
+ * as one record holding the bytes exactly as they were on the air, before
+ * any expansion or reassembly, with the link epoch its compact timestamps
+ * are relative to: ours for frames received, the peer's for frames sent.
+ * Records are staged in the storage writer, so the radio path never waits
+ * for the SD card; a record that does not fit in the staging buffer is
+ * dropped and counted rather than delaying the frame.
+ * tools/bitchat_replay.c reads the file back on a host.
+ *
+ * All integers are big-endian, as on the wire.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_CAPTURE_PATH APP_DATA_PATH("bitchat") "/capture.bcap"
+#define BITCHAT_CAPTURE_MAGIC "BCAP"
+#define BITCHAT_CAPTURE_VERSION 1
+// Longer frames are cut to this; the record keeps the original length
+#define BITCHAT_CAPTURE_MAX_FRAME 512
+
+// magic (4) | version (2) | reserved (2)
+#define BITCHAT_CAPTURE_FILE_HEADER_SIZE 8
+// ms since start (4) | direction (1) | reserved (1) | captured length (2) |
+// original length (2) | link peer id (8) | link epoch ms (8) | frame
+#define BITCHAT_CAPTURE_RECORD_HEADER_SIZE 26
+
+typedef struct BitchatCapture BitchatCapture;
+typedef struct BitchatWriter BitchatWriter;
+
+typedef enum {
+    BitchatCaptureDirectionRx = 0,
+    BitchatCaptureDirectionTx = 1,
+} BitchatCaptureDirection;
+
+/**
+ * Capture statistics since the last start
+ */
+typedef struct {
+    bool running;
+    uint32_t frames;
+    uint32_t bytes; // File size so far
+    uint32_t dropped; // Staging buffer full
+} BitchatCaptureStats;
+
+/**
+ * Allocate a capture, initially stopped
+ * @param writer Storage writer records are staged in
+ */
+BitchatCapture* bitchat_capture_alloc(BitchatWriter* writer);
+
+/**
+ * Stop capturing and free the capture
+ */
+void bitchat_capture_free(BitchatCapture* capture);
+
+/**
+ * Start a new capture file, replacing any previous one
+ * @return false if the file header could not be staged; capture stays stopped
+ */
+bool bitchat_capture_start(BitchatCapture* capture);
+
+/**
+ * Stop capturing; records already staged are still written
+ */
+void bitchat_capture_stop(BitchatCapture* capture);
+
+/**
+ * Check whether frames are being recorded
+ */
+bool bitchat_capture_is_running(BitchatCapture* capture);
+
+/**
+ * Record one raw frame if capturing
+ * Safe from any thread; returns at once when stopped.
+ * @param capture Capture instance
+ * @param direction Received or sent
+ * @param peer_id 8-byte ID of the link the frame was on
+ * @param epoch Link epoch (ms) compact timestamps in the frame are relative to
+ * @param data Frame as on the air
+ * @param size Frame size
+ */
+void bitchat_capture_frame(
+    BitchatCapture* capture,
+    BitchatCaptureDirection direction,
+    const uint8_t* peer_id,
+    uint64_t epoch,
+    const uint8_t* data,
+    size_t size);
+
+/**
+ * Get capture statistics
+ */
+void bitchat_capture_get_stats(BitchatCapture* capture, BitchatCaptureStats* stats);
@@ -0,0 +1,329 @@
+/**
+ * BitChat History Compactor Implementation
+ */
+
+#include "bitchat_compactor.h"
+#include "bitchat_history.h"
+#include "bitchat_writer.h"
+#include "bitchat_search.h"
+#include "../protocol/bitchat_protocol.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TAG "BitchatCompactor"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+#define COMPACTOR_STACK_SIZE 3072
+#define COMPACTOR_FLAG_RUN (1UL << 0)
+#define COMPACTOR_FLAG_STOP (1UL << 1)
+// Records handled between pauses
+#define COMPACTOR_BATCH_RECORDS 16
+#define COMPACTOR_PAUSE_MS 20
+// Slot that conversations beyond the table share
+#define COMPACTOR_SHARED_CONVERSATION (BITCHAT_COMPACTOR_MAX_CONVERSATIONS - 1)
+
+typedef struct {
+    uint32_t key;
+    uint32_t bytes;
+} CompactorConversation;
+
+struct BitchatCompactor {
+    BitchatHistory* history;
+    BitchatWriter* writer;
+    Storage* storage;
+    FuriMutex* mutex;
+    FuriThread* thread;
+    BitchatCompactorQuota quota;
+    bool running;
+
+    // Cycle state, only touched by the compactor thread
+    uint32_t now;
+    uint32_t batch;
+    CompactorConversation conversations[BITCHAT_COMPACTOR_MAX_CONVERSATIONS];
+    size_t conversation_count;
+    uint32_t recent[BITCHAT_COMPACTOR_DEDUP_WINDOW];
+    size_t recent_count;
+    size_t recent_next;
+
+    BitchatCompactorStats stats;
+};
+
+static uint32_t compactor_hash(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * Identify a message by what every copy of it has in common
+ */
+static uint32_t compactor_message_hash(const BitchatHistoryRecord* record) {
+    uint8_t timestamp[4] = {
+        record->timestamp >> 24, record->timestamp >> 16, record->timestamp >> 8, record->timestamp};
+    uint32_t hash = compactor_hash(2166136261UL, timestamp, sizeof(timestamp));
+    hash = compactor_hash(hash, record->sender, strlen(record->sender) + 1);
+    return compactor_hash(hash, record->content, strlen(record->content));
+}
+
+static size_t compactor_record_size(const BitchatHistoryRecord* record) {
+    return BITCHAT_HISTORY_RECORD_HEADER_SIZE + strlen(record->sender) + strlen(record->content);
+}
+
+/**
+ * Find the quota slot of a record's conversation, adding it if new
+ */
+static CompactorConversation*
+    compactor_conversation(BitchatCompactor* compactor, const BitchatHistoryRecord* record) {
+    // Key 0 is the public channel; private conversations are keyed by sender
+    uint32_t key = 0;
+    if(record->flags & BITCHAT_HISTORY_FLAG_PRIVATE) {
+        key = compactor_hash(2166136261UL, record->sender, strlen(record->sender)) | 1;
+    }
+
+    for(size_t i = 0; i < compactor->conversation_count; i++) {
+        if(compactor->conversations[i].key == key) {
+            return &compactor->conversations[i];
+        }
+    }
+    if(compactor->conversation_count == COMPACTOR_SHARED_CONVERSATION) {
+        return &compactor->conversations[COMPACTOR_SHARED_CONVERSATION];
+    }
+
+    CompactorConversation* conversation =
+        &compactor->conversations[compactor->conversation_count++];
+    conversation->key = key;
+    conversation->bytes = 0;
+    return conversation;
+}
+
+static bool compactor_is_running(BitchatCompactor* compactor) {
+    furi_mutex_acquire(compactor->mutex, FuriWaitForever);
+    bool running = compactor->running;
+    furi_mutex_release(compactor->mutex);
+    return running;
+}
+
+/**
+ * Pause after every batch of records, and for as long as writes are pending
+ */
+static void compactor_pace(BitchatCompactor* compactor) {
+    if(++compactor->batch < COMPACTOR_BATCH_RECORDS) return;
+    compactor->batch = 0;
+
+    do {
+        furi_delay_ms(COMPACTOR_PAUSE_MS);
+    } while(bitchat_writer_is_pending(compactor->writer) && compactor_is_running(compactor));
+}
+
+/**
+ * Survey callback: add a record to its conversation's total
+ */
+static void compactor_survey_callback(void* context, const BitchatHistoryRecord* record) {
+    BitchatCompactor* compactor = context;
+    compactor_conversation(compactor, record)->bytes += compactor_record_size(record);
+}
+
+/**
+ * Compaction filter: drop expired, repeated and over-quota records
+ */
+static bool compactor_filter(void* context, const BitchatHistoryRecord* record) {
+    BitchatCompactor* compactor = context;
+
+    compactor_pace(compactor);
+    if(!compactor_is_running(compactor)) return true;
+
+    CompactorConversation* conversation = compactor_conversation(compactor, record);
+    size_t size = compactor_record_size(record);
+    uint32_t hash = compactor_message_hash(record);
+
+    uint32_t* counter = NULL;
+    if(compactor->quota.max_age && compactor->now > compactor->quota.max_age &&
+       record->timestamp < compactor->now - compactor->quota.max_age) {
+        counter = &compactor->stats.expired;
+    } else {
+        for(size_t i = 0; i < compactor->recent_count; i++) {
+            if(compactor->recent[i] == hash) {
+                counter = &compactor->stats.duplicates;
+                break;
+            }
+        }
+    }
+    if(!counter && compactor->quota.max_bytes && conversation->bytes > compactor->quota.max_bytes) {
+        counter = &compactor->stats.over_quota;
+    }
+
+    if(counter) {
+        // Oldest records go first, so the total falls towards the quota
+        conversation->bytes = conversation->bytes > size ? conversation->bytes - size : 0;
+        furi_mutex_acquire(compactor->mutex, FuriWaitForever);
+        (*counter)++;
+        furi_mutex_release(compactor->mutex);
+        return false;
+    }
+
+    compactor->recent[compactor->recent_next] = hash;
+    compactor->recent_next = (compactor->recent_next + 1) % BITCHAT_COMPACTOR_DEDUP_WINDOW;
+    if(compactor->recent_count < BITCHAT_COMPACTOR_DEDUP_WINDOW) compactor->recent_count++;
+    return true;
+}
+
+/**
+ * Build search postings for a sealed segment that has none yet
+ */
+static void compactor_index_segment(BitchatCompactor* compactor, uint32_t segment) {
+    char path[64];
+    snprintf(path, sizeof(path), BITCHAT_HISTORY_DIR "/%08lx.bix", segment);
+    if(storage_common_stat(compactor->storage, path, NULL) == FSE_OK) return;
+    // Compaction may have just removed the whole segment
+    snprintf(path, sizeof(path), BITCHAT_HISTORY_DIR "/%08lx.sig", segment);
+    if(storage_common_stat(compactor->storage, path, NULL) != FSE_OK) return;
+
+    bitchat_search_index_segment(compactor->storage, segment);
+    compactor->batch = COMPACTOR_BATCH_RECORDS - 1;
+    compactor_pace(compactor);
+}
+
+/**
+ * Survey conversation sizes, then compact and index every sealed segment oldest first
+ */
+static void compactor_cycle(BitchatCompactor* compactor) {
+    uint32_t start = furi_get_tick();
+
+    compactor->now = bitchat_get_timestamp_ms() / 1000;
+    compactor->batch = 0;
+    compactor->conversation_count = 0;
+    memset(
+        &compactor->conversations[COMPACTOR_SHARED_CONVERSATION],
+        0,
+        sizeof(CompactorConversation));
+    compactor->recent_count = 0;
+    compactor->recent_next = 0;
+
+    uint32_t first = bitchat_history_first(compactor->history);
+    uint32_t count = bitchat_history_count(compactor->history);
+
+    for(uint32_t seq = first; seq < count && compactor_is_running(compactor);
+        seq += COMPACTOR_BATCH_RECORDS) {
+        bitchat_history_read(
+            compactor->history, seq, COMPACTOR_BATCH_RECORDS, compactor_survey_callback, compactor);
+        compactor->batch = COMPACTOR_BATCH_RECORDS - 1;
+        compactor_pace(compactor);
+    }
+
+    uint32_t compacted = 0;
+    for(uint32_t segment = first / BITCHAT_HISTORY_SEGMENT_RECORDS;
+        segment < count / BITCHAT_HISTORY_SEGMENT_RECORDS && compactor_is_running(compactor);
+        segment++) {
+        if(bitchat_history_compact_segment(compactor->history, segment, compactor_filter, compactor)) {
+            compacted++;
+        }
+        compactor_index_segment(compactor, segment);
+    }
+
+    uint32_t elapsed = (furi_get_tick() - start) * 1000 / furi_kernel_get_tick_frequency();
+    furi_mutex_acquire(compactor->mutex, FuriWaitForever);
+    compactor->stats.cycles++;
+    compactor->stats.segments_compacted += compacted;
+    compactor->stats.last_cycle_ms = elapsed;
+    furi_mutex_release(compactor->mutex);
+
+    BITCHAT_LOG_I(TAG, "Cycle done: %lu segments in %lu ms", compacted, elapsed);
+}
+
+/**
+ * Compactor thread: run a cycle shortly after start, then on every interval
+ */
+static int32_t compactor_thread(void* context) {
+    BitchatCompactor* compactor = context;
+    uint32_t timeout = furi_ms_to_ticks(BITCHAT_COMPACTOR_START_DELAY_MS);
+
+    while(true) {
+        uint32_t flags = furi_thread_flags_wait(
+            COMPACTOR_FLAG_RUN | COMPACTOR_FLAG_STOP, FuriFlagWaitAny, timeout);
+        if(!(flags & FuriFlagError) && (flags & COMPACTOR_FLAG_STOP)) break;
+
+        compactor_cycle(compactor);
+        if(!compactor_is_running(compactor)) break;
+        timeout = furi_ms_to_ticks(BITCHAT_COMPACTOR_INTERVAL_MS);
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate the compactor and start its thread
+ */
+BitchatCompactor* bitchat_compactor_alloc(
+    BitchatHistory* history,
+    BitchatWriter* writer,
+    const BitchatCompactorQuota* quota) {
+    furi_assert(history);
+    furi_assert(writer);
+
+    BitchatCompactor* compactor =
+        bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatCompactor));
+    memset(compactor, 0, sizeof(BitchatCompactor));
+
+    compactor->history = history;
+    compactor->writer = writer;
+    compactor->storage = furi_record_open(RECORD_STORAGE);
+    compactor->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    compactor->running = true;
+    if(quota) {
+        compactor->quota = *quota;
+    } else {
+        compactor->quota.max_age = BITCHAT_COMPACTOR_MAX_AGE_DEFAULT;
+        compactor->quota.max_bytes = BITCHAT_COMPACTOR_MAX_BYTES_DEFAULT;
+    }
+
+    compactor->thread =
+        furi_thread_alloc_ex("BitchatCompactor", COMPACTOR_STACK_SIZE, compactor_thread, compactor);
+    furi_thread_set_priority(compactor->thread, FuriThreadPriorityLow);
+    furi_thread_start(compactor->thread);
+
+    return compactor;
+}
+
+/**
+ * Stop the thread and free the compactor
+ */
+void bitchat_compactor_free(BitchatCompactor* compactor) {
+    furi_assert(compactor);
+
+    furi_mutex_acquire(compactor->mutex, FuriWaitForever);
+    compactor->running = false;
+    furi_mutex_release(compactor->mutex);
+
+    furi_thread_flags_set(furi_thread_get_id(compactor->thread), COMPACTOR_FLAG_STOP);
+    furi_thread_join(compactor->thread);
+    furi_thread_free(compactor->thread);
+
+    furi_mutex_free(compactor->mutex);
+    furi_record_close(RECORD_STORAGE);
+    bitchat_heap_free(compactor);
+}
+
+/**
+ * Start a cycle now
+ */
+void bitchat_compactor_run(BitchatCompactor* compactor) {
+    furi_assert(compactor);
+    furi_thread_flags_set(furi_thread_get_id(compactor->thread), COMPACTOR_FLAG_RUN);
+}
+
+/**
+ * Get compactor statistics
+ */
+void bitchat_compactor_get_stats(BitchatCompactor* compactor, BitchatCompactorStats* stats) {
+    furi_assert(compactor);
+    furi_assert(stats);
+
+    furi_mutex_acquire(compactor->mutex, FuriWaitForever);
+    *stats = compactor->stats;
+    furi_mutex_release(compactor->mutex);
+}
@@ -0,0 +1,82 @@
+/**
+ * BitChat History Compactor
+ * Background retention and compaction of the message history
+ *
+ * A low-priority thread periodically surveys the history, then compacts
+ * every sealed segment oldest first, dropping records that are older than
+ * the age quota, repeat copies of a message already kept, and the oldest
+ * records of any conversation over its size quota. It pauses while the
+ * storage writer has work pending and between small batches of records,
+ * so live traffic always goes first. Each sealed segment also gets its
+ * search postings built once (see bitchat_search.h).
+ *
+ * Records carry no message ID or peer, so a message is identified by a hash
+ * of its timestamp, sender and text, and a conversation is the public
+ * channel or, for private messages, the sender.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_COMPACTOR_START_DELAY_MS (60 * 1000)
+#define BITCHAT_COMPACTOR_INTERVAL_MS (30 * 60 * 1000)
+#define BITCHAT_COMPACTOR_MAX_AGE_DEFAULT (90UL * 24 * 60 * 60)
+#define BITCHAT_COMPACTOR_MAX_BYTES_DEFAULT (64UL * 1024)
+// Conversations past this many share one quota
+#define BITCHAT_COMPACTOR_MAX_CONVERSATIONS 16
+// Repeats are caught among this many most recently kept messages
+#define BITCHAT_COMPACTOR_DEDUP_WINDOW 256
+
+typedef struct BitchatCompactor BitchatCompactor;
+typedef struct BitchatHistory BitchatHistory;
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * Retention quotas, 0 for no limit
+ */
+typedef struct {
+    uint32_t max_age; // Seconds
+    uint32_t max_bytes; // Stored bytes per conversation
+} BitchatCompactorQuota;
+
+/**
+ * Compactor statistics
+ */
+typedef struct {
+    uint32_t cycles;
+    uint32_t segments_compacted;
+    uint32_t expired;
+    uint32_t duplicates;
+    uint32_t over_quota;
+    uint32_t last_cycle_ms;
+} BitchatCompactorStats;
+
+/**
+ * Allocate the compactor and start its thread
+ * @param history History to compact
+ * @param writer Storage writer whose pending work takes priority
+ * @param quota Retention quotas, NULL for the defaults
+ * @return Compactor instance
+ */
+BitchatCompactor* bitchat_compactor_alloc(
+    BitchatHistory* history,
+    BitchatWriter* writer,
+    const BitchatCompactorQuota* quota);
+
+/**
+ * Stop the thread, finishing the segment in progress, and free the compactor
+ */
+void bitchat_compactor_free(BitchatCompactor* compactor);
+
+/**
+ * Start a cycle now instead of at the next interval
+ */
+void bitchat_compactor_run(BitchatCompactor* compactor);
+
+/**
+ * Get compactor statistics
+ */
+void bitchat_compactor_get_stats(BitchatCompactor* compactor, BitchatCompactorStats* stats);
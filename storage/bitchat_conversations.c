@@ -0,0 +1,251 @@
+/**
+ * BitChat Conversation Index Implementation
+ */
+
+#include "bitchat_conversations.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <string.h>
+
+#define TAG "BitchatConversations"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+
+typedef struct {
+    BitchatConversationInfo info;
+    // Ring of the latest record numbers, oldest at recent_head
+    uint32_t recent[BITCHAT_CONVERSATION_RECENT];
+    size_t recent_head;
+    size_t recent_count;
+    uint32_t touched; // Activity stamp; the lowest is replaced first
+} Conversation;
+
+struct BitchatConversations {
+    FuriMutex* mutex;
+    Conversation conversations[BITCHAT_CONVERSATIONS_MAX];
+    size_t count;
+    size_t active;
+    uint32_t clock; // Source of activity stamps
+};
+
+/**
+ * Find or add a conversation
+ * @param peer Peer nickname, or NULL / empty for the public room
+ */
+static size_t conversations_open_locked(BitchatConversations* conversations, const char* peer) {
+    if(!peer || peer[0] == '\0') return BITCHAT_CONVERSATION_PUBLIC;
+
+    for(size_t i = 1; i < conversations->count; i++) {
+        if(strcmp(conversations->conversations[i].info.peer, peer) == 0) {
+            conversations->conversations[i].touched = ++conversations->clock;
+            return i;
+        }
+    }
+
+    size_t index = conversations->count;
+    if(index < BITCHAT_CONVERSATIONS_MAX) {
+        conversations->count++;
+    } else {
+        // Replace the thread idle longest; the one on screen stays
+        index = 0;
+        for(size_t i = 1; i < conversations->count; i++) {
+            if(i == conversations->active) continue;
+            if(index == 0 ||
+               conversations->conversations[i].touched <
+                   conversations->conversations[index].touched) {
+                index = i;
+            }
+        }
+        BITCHAT_LOG_D(
+            TAG, "Dropping thread %s from the index", conversations->conversations[index].info.peer);
+    }
+
+    Conversation* conversation = &conversations->conversations[index];
+    memset(conversation, 0, sizeof(Conversation));
+    strncpy(conversation->info.peer, peer, sizeof(conversation->info.peer) - 1);
+    conversation->touched = ++conversations->clock;
+    return index;
+}
+
+/**
+ * Add a record to its conversation
+ */
+static size_t conversations_record_locked(
+    BitchatConversations* conversations,
+    const BitchatHistoryRecord* record,
+    bool count_unread) {
+    const char* peer = (record->flags & BITCHAT_HISTORY_FLAG_PRIVATE) ? record->sender : NULL;
+    size_t index = conversations_open_locked(conversations, peer);
+    Conversation* conversation = &conversations->conversations[index];
+
+    if(conversation->recent_count == BITCHAT_CONVERSATION_RECENT) {
+        conversation->recent_head = (conversation->recent_head + 1) % BITCHAT_CONVERSATION_RECENT;
+        conversation->recent_count--;
+    }
+    conversation->recent
+        [(conversation->recent_head + conversation->recent_count++) % BITCHAT_CONVERSATION_RECENT] =
+        record->seq;
+    conversation->info.last_timestamp = record->timestamp;
+    conversation->touched = ++conversations->clock;
+
+    if(count_unread && index != conversations->active &&
+       !(record->flags & BITCHAT_HISTORY_FLAG_OWN)) {
+        conversation->info.unread++;
+    }
+    return index;
+}
+
+/**
+ * History read callback: index one record without counting it unread
+ */
+static void conversations_load_callback(void* context, const BitchatHistoryRecord* record) {
+    conversations_record_locked(context, record, false);
+}
+
+/**
+ * Allocate the index
+ */
+BitchatConversations* bitchat_conversations_alloc(void) {
+    BitchatConversations* conversations =
+        bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatConversations));
+    memset(conversations, 0, sizeof(BitchatConversations));
+    conversations->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    conversations->count = 1;
+    conversations->active = BITCHAT_CONVERSATION_PUBLIC;
+    return conversations;
+}
+
+/**
+ * Free the index
+ */
+void bitchat_conversations_free(BitchatConversations* conversations) {
+    furi_assert(conversations);
+    furi_mutex_free(conversations->mutex);
+    bitchat_heap_free(conversations);
+}
+
+/**
+ * Index the newest records of a history
+ */
+void bitchat_conversations_load(BitchatConversations* conversations, BitchatHistory* history) {
+    furi_assert(conversations);
+    furi_assert(history);
+
+    uint32_t count = bitchat_history_count(history);
+    uint32_t first = bitchat_history_first(history);
+    if(count - first > BITCHAT_CONVERSATIONS_SCAN) first = count - BITCHAT_CONVERSATIONS_SCAN;
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t read = bitchat_history_read(
+        history, first, count - first, conversations_load_callback, conversations);
+    size_t threads = conversations->count;
+    furi_mutex_release(conversations->mutex);
+
+    BITCHAT_LOG_I(TAG, "Indexed %zu records into %zu conversations", read, threads);
+}
+
+/**
+ * Index a record that was just appended
+ */
+size_t bitchat_conversations_record(
+    BitchatConversations* conversations,
+    const BitchatHistoryRecord* record) {
+    furi_assert(conversations);
+    furi_assert(record);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t index = conversations_record_locked(conversations, record, true);
+    furi_mutex_release(conversations->mutex);
+    return index;
+}
+
+/**
+ * Find a conversation, adding it if new
+ */
+size_t bitchat_conversations_open(BitchatConversations* conversations, const char* peer) {
+    furi_assert(conversations);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t index = conversations_open_locked(conversations, peer);
+    furi_mutex_release(conversations->mutex);
+    return index;
+}
+
+/**
+ * Make a conversation the one on screen
+ */
+void bitchat_conversations_set_active(BitchatConversations* conversations, size_t index) {
+    furi_assert(conversations);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    furi_assert(index < conversations->count);
+    conversations->active = index;
+    conversations->conversations[index].info.unread = 0;
+    furi_mutex_release(conversations->mutex);
+}
+
+/**
+ * Get the conversation on screen
+ */
+size_t bitchat_conversations_get_active(BitchatConversations* conversations) {
+    furi_assert(conversations);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t active = conversations->active;
+    furi_mutex_release(conversations->mutex);
+    return active;
+}
+
+/**
+ * Get the number of conversations
+ */
+size_t bitchat_conversations_count(BitchatConversations* conversations) {
+    furi_assert(conversations);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t count = conversations->count;
+    furi_mutex_release(conversations->mutex);
+    return count;
+}
+
+/**
+ * Get a conversation's summary
+ */
+bool bitchat_conversations_get_info(
+    BitchatConversations* conversations,
+    size_t index,
+    BitchatConversationInfo* info) {
+    furi_assert(conversations);
+    furi_assert(info);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    bool found = index < conversations->count;
+    if(found) {
+        *info = conversations->conversations[index].info;
+    }
+    furi_mutex_release(conversations->mutex);
+    return found;
+}
+
+/**
+ * Get the record numbers of a conversation's latest messages
+ */
+size_t bitchat_conversations_get_recent(
+    BitchatConversations* conversations,
+    size_t index,
+    uint32_t* seqs) {
+    furi_assert(conversations);
+    furi_assert(seqs);
+
+    furi_mutex_acquire(conversations->mutex, FuriWaitForever);
+    size_t count = 0;
+    if(index < conversations->count) {
+        Conversation* conversation = &conversations->conversations[index];
+        for(count = 0; count < conversation->recent_count; count++) {
+            seqs[count] = conversation->recent
+                              [(conversation->recent_head + count) % BITCHAT_CONVERSATION_RECENT];
+        }
+    }
+    furi_mutex_release(conversations->mutex);
+    return count;
+}
@@ -0,0 +1,105 @@
+/**
+ * BitChat Conversation Index
+ * Splits the message history into the public room and one thread per
+ * private peer
+ *
+ * A private record's sender names the other party of the thread, whoever
+ * wrote it; BITCHAT_HISTORY_FLAG_OWN tells which side that was. Each thread
+ * keeps the record numbers of its latest messages and an unread counter,
+ * both updated as records are appended, so opening a thread reads just its
+ * newest page and nothing is rescanned to count unread messages.
+ */
+
+#pragma once
+
+#include "bitchat_history.h"
+
+#define BITCHAT_CONVERSATIONS_MAX 9 // The public room and 8 private threads
+#define BITCHAT_CONVERSATION_RECENT 10 // Latest record numbers kept per thread
+// Records indexed when the history is opened
+#define BITCHAT_CONVERSATIONS_SCAN BITCHAT_HISTORY_SEGMENT_RECORDS
+#define BITCHAT_CONVERSATION_PUBLIC 0 // Index of the public room
+
+typedef struct BitchatConversations BitchatConversations;
+
+/**
+ * One conversation's summary
+ */
+typedef struct {
+    char peer[BITCHAT_HISTORY_MAX_SENDER + 1]; // Empty for the public room
+    uint32_t unread;
+    uint32_t last_timestamp;
+} BitchatConversationInfo;
+
+/**
+ * Allocate the index with only the public room, which is active
+ */
+BitchatConversations* bitchat_conversations_alloc(void);
+
+/**
+ * Free the index
+ */
+void bitchat_conversations_free(BitchatConversations* conversations);
+
+/**
+ * Index the newest BITCHAT_CONVERSATIONS_SCAN records of a history
+ * Blocks on SD I/O. What is read is not counted as unread.
+ */
+void bitchat_conversations_load(BitchatConversations* conversations, BitchatHistory* history);
+
+/**
+ * Index a record that was just appended
+ * The thread it belongs to is added if new; its unread count goes up unless
+ * the thread is active or the message is our own.
+ * @param conversations Index instance
+ * @param record Appended record
+ * @return Index of the record's conversation
+ */
+size_t bitchat_conversations_record(
+    BitchatConversations* conversations,
+    const BitchatHistoryRecord* record);
+
+/**
+ * Find a conversation, adding it if new
+ * When the index is full, the private thread idle longest is replaced.
+ * @param conversations Index instance
+ * @param peer Peer nickname, or NULL for the public room
+ * @return Conversation index
+ */
+size_t bitchat_conversations_open(BitchatConversations* conversations, const char* peer);
+
+/**
+ * Make a conversation the one on screen and mark it read
+ */
+void bitchat_conversations_set_active(BitchatConversations* conversations, size_t index);
+
+/**
+ * Get the conversation on screen
+ */
+size_t bitchat_conversations_get_active(BitchatConversations* conversations);
+
+/**
+ * Get the number of conversations
+ */
+size_t bitchat_conversations_count(BitchatConversations* conversations);
+
+/**
+ * Get a conversation's summary
+ * @return false if index is out of range
+ */
+bool bitchat_conversations_get_info(
+    BitchatConversations* conversations,
+    size_t index,
+    BitchatConversationInfo* info);
+
+/**
+ * Get the record numbers of a conversation's latest messages, oldest first
+ * @param conversations Index instance
+ * @param index Conversation index
+ * @param seqs Output, BITCHAT_CONVERSATION_RECENT entries
+ * @return Number of record numbers written
+ */
+size_t bitchat_conversations_get_recent(
+    BitchatConversations* conversations,
+    size_t index,
+    uint32_t* seqs);
@@ -0,0 +1,715 @@
+/**
+ * BitChat Message History Implementation
+ */
+
+#include "bitchat_history.h"
+#include "bitchat_writer.h"
+#include "bitchat_search.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TAG "BitchatHistory"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+#define HISTORY_HEAD_PATH BITCHAT_HISTORY_DIR "/head.bin"
+#define HISTORY_FIRST_PATH BITCHAT_HISTORY_DIR "/first.bin"
+// A segment rewrite is built in these, then committed by writing the marker
+#define HISTORY_COMPACT_LOG_PATH BITCHAT_HISTORY_DIR "/compact.log"
+#define HISTORY_COMPACT_INDEX_PATH BITCHAT_HISTORY_DIR "/compact.idx"
+#define HISTORY_COMPACT_MARKER_PATH BITCHAT_HISTORY_DIR "/compact.ok"
+#define HISTORY_INDEX_ENTRIES (BITCHAT_HISTORY_SEGMENT_RECORDS / BITCHAT_HISTORY_INDEX_INTERVAL)
+#define HISTORY_MAX_RECORD_SIZE \
+    (BITCHAT_HISTORY_RECORD_HEADER_SIZE + BITCHAT_HISTORY_MAX_SENDER + BITCHAT_HISTORY_MAX_CONTENT)
+
+#define HISTORY_NOT_PREPARED UINT32_MAX
+// Appends awaiting the card; when full the newest checkpoint is moved forward
+#define HISTORY_CHECKPOINTS 4
+
+typedef struct {
+    uint32_t count; // Records that are on the card once the mark is written
+    uint32_t mark; // Writer mark taken after staging them
+} HistoryCheckpoint;
+
+struct BitchatHistory {
+    Storage* storage;
+    BitchatWriter* writer;
+    FuriMutex* mutex;
+    uint32_t count;
+    uint32_t first_segment; // Older segments have been compacted away
+    uint32_t tail_size; // Bytes in the newest segment, including staged records
+    uint32_t prepared; // Record whose head/index updates are staged but not the record
+    uint32_t signed_count; // Record whose search signature is staged
+    uint32_t written_count; // Records known to be on the card
+    HistoryCheckpoint checkpoints[HISTORY_CHECKPOINTS]; // Oldest first
+    size_t checkpoint_count;
+    char path[64];
+};
+
+static void encode_u16_be(uint8_t* buf, uint16_t value) {
+    buf[0] = (value >> 8) & 0xFF;
+    buf[1] = value & 0xFF;
+}
+
+static uint16_t decode_u16_be(const uint8_t* buf) {
+    return ((uint16_t)buf[0] << 8) | buf[1];
+}
+
+static void encode_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+static uint32_t decode_u32_be(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) |
+           buf[3];
+}
+
+/**
+ * Build the path of a segment's log or index file
+ */
+static const char* history_path(BitchatHistory* history, uint32_t segment, const char* extension) {
+    snprintf(
+        history->path, sizeof(history->path), BITCHAT_HISTORY_DIR "/%08lx.%s", segment, extension);
+    return history->path;
+}
+
+/**
+ * Read a 4-byte big-endian value file
+ */
+static bool history_read_u32(BitchatHistory* history, const char* path, uint32_t* value) {
+    File* file = storage_file_alloc(history->storage);
+    uint8_t buf[4];
+    bool success = storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING) &&
+                   storage_file_read(file, buf, 4) == 4;
+    storage_file_close(file);
+    storage_file_free(file);
+
+    if(success) *value = decode_u32_be(buf);
+    return success;
+}
+
+/**
+ * Write a 4-byte big-endian value file
+ */
+static bool history_write_u32(BitchatHistory* history, const char* path, uint32_t value) {
+    File* file = storage_file_alloc(history->storage);
+    uint8_t buf[4];
+    encode_u32_be(buf, value);
+    bool success = storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+                   storage_file_write(file, buf, 4) == 4;
+    storage_file_close(file);
+    storage_file_free(file);
+    return success;
+}
+
+/**
+ * Move a compacted file over the segment file it replaces
+ */
+static void history_replace_file(BitchatHistory* history, const char* from, const char* to) {
+    if(storage_file_exists(history->storage, from)) {
+        storage_common_remove(history->storage, to);
+        storage_common_rename(history->storage, from, to);
+    }
+}
+
+/**
+ * Finish a segment rewrite whose marker was written, or discard one that
+ * never got that far. Safe to repeat after a crash at any point.
+ */
+static void history_finish_compaction(BitchatHistory* history) {
+    uint32_t segment;
+    if(history_read_u32(history, HISTORY_COMPACT_MARKER_PATH, &segment)) {
+        history_replace_file(
+            history, HISTORY_COMPACT_LOG_PATH, history_path(history, segment, "log"));
+        history_replace_file(
+            history, HISTORY_COMPACT_INDEX_PATH, history_path(history, segment, "idx"));
+    } else {
+        storage_common_remove(history->storage, HISTORY_COMPACT_LOG_PATH);
+        storage_common_remove(history->storage, HISTORY_COMPACT_INDEX_PATH);
+    }
+    storage_common_remove(history->storage, HISTORY_COMPACT_MARKER_PATH);
+}
+
+/**
+ * Read a record header and check its lengths
+ * @return Total record size, or 0 at the end of the segment or on a torn record
+ */
+static size_t history_read_header(File* file, uint8_t* header) {
+    if(storage_file_read(file, header, BITCHAT_HISTORY_RECORD_HEADER_SIZE) !=
+       BITCHAT_HISTORY_RECORD_HEADER_SIZE) {
+        return 0;
+    }
+    size_t size = decode_u16_be(&header[0]);
+    uint8_t sender_length = header[7];
+    if(size < (size_t)BITCHAT_HISTORY_RECORD_HEADER_SIZE + sender_length ||
+       size > HISTORY_MAX_RECORD_SIZE || sender_length > BITCHAT_HISTORY_MAX_SENDER) {
+        return 0;
+    }
+    // Both lengths can be in range while the content alone overflows its buffer
+    if(size - BITCHAT_HISTORY_RECORD_HEADER_SIZE - sender_length > BITCHAT_HISTORY_MAX_CONTENT) {
+        return 0;
+    }
+    return size;
+}
+
+/**
+ * Make the newest segment's signature file hold exactly one signature per
+ * record: cut off any for records that were lost, and give records whose
+ * signature was lost (or predates signatures) one that matches every query
+ */
+static void history_recover_signatures(BitchatHistory* history, uint32_t segment, uint32_t records) {
+    uint32_t expected = records * BITCHAT_SEARCH_SIGNATURE_SIZE;
+    File* file = storage_file_alloc(history->storage);
+
+    if(storage_file_open(file, history_path(history, segment, "sig"), FSAM_WRITE, FSOM_OPEN_ALWAYS)) {
+        uint64_t size = storage_file_size(file);
+        if(size > expected) {
+            storage_file_seek(file, expected, true);
+            storage_file_truncate(file);
+        } else if(size < expected) {
+            uint8_t signature[BITCHAT_SEARCH_SIGNATURE_SIZE];
+            memset(signature, 0xFF, sizeof(signature));
+            storage_file_seek(file, size - size % BITCHAT_SEARCH_SIGNATURE_SIZE, true);
+            for(uint32_t i = size / BITCHAT_SEARCH_SIGNATURE_SIZE; i < records; i++) {
+                storage_file_write(file, signature, sizeof(signature));
+            }
+        }
+        storage_file_close(file);
+    }
+
+    storage_file_free(file);
+}
+
+/**
+ * Find the record count from the newest segment's index and tail,
+ * cutting off anything a power loss left half written
+ */
+static void history_recover(BitchatHistory* history, uint32_t segment) {
+    uint32_t offsets[HISTORY_INDEX_ENTRIES];
+    size_t entries = 0;
+    uint64_t log_size = 0;
+    File* file = storage_file_alloc(history->storage);
+
+    if(storage_file_open(file, history_path(history, segment, "log"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        log_size = storage_file_size(file);
+        storage_file_close(file);
+    }
+
+    if(storage_file_open(file, history_path(history, segment, "idx"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        uint8_t entry[4];
+        while(entries < HISTORY_INDEX_ENTRIES && storage_file_read(file, entry, 4) == 4) {
+            offsets[entries++] = decode_u32_be(entry);
+        }
+        storage_file_close(file);
+    }
+
+    // Index entries are written before their record: drop ones whose record never landed
+    size_t valid_entries = entries;
+    while(valid_entries > 0 && offsets[valid_entries - 1] >= log_size) {
+        valid_entries--;
+    }
+
+    // Scan from the last indexed record; if that one is torn, from the one before
+    uint32_t scanned = 0;
+    uint64_t end = 0;
+    if(valid_entries > 0 &&
+       storage_file_open(file, history_path(history, segment, "log"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        uint8_t header[BITCHAT_HISTORY_RECORD_HEADER_SIZE];
+        while(valid_entries > 0) {
+            end = offsets[valid_entries - 1];
+            storage_file_seek(file, end, true);
+            while(scanned < BITCHAT_HISTORY_INDEX_INTERVAL) {
+                size_t size = history_read_header(file, header);
+                if(size == 0 || end + size > log_size) break;
+                end += size;
+                scanned++;
+                storage_file_seek(file, end, true);
+            }
+            if(scanned > 0) break;
+            valid_entries--;
+        }
+        storage_file_close(file);
+    }
+    if(valid_entries == 0) end = 0;
+
+    if(end < log_size &&
+       storage_file_open(file, history_path(history, segment, "log"), FSAM_WRITE, FSOM_OPEN_EXISTING)) {
+        BITCHAT_LOG_W(TAG, "Dropping %lu torn bytes", (uint32_t)(log_size - end));
+        storage_file_seek(file, end, true);
+        storage_file_truncate(file);
+        storage_file_close(file);
+    }
+
+    if(valid_entries < entries &&
+       storage_file_open(file, history_path(history, segment, "idx"), FSAM_WRITE, FSOM_OPEN_EXISTING)) {
+        storage_file_seek(file, valid_entries * 4, true);
+        storage_file_truncate(file);
+        storage_file_close(file);
+    }
+
+    storage_file_free(file);
+
+    history->tail_size = end;
+    history->count = segment * BITCHAT_HISTORY_SEGMENT_RECORDS;
+    if(valid_entries > 0) {
+        history->count += (valid_entries - 1) * BITCHAT_HISTORY_INDEX_INTERVAL + scanned;
+    }
+
+    history_recover_signatures(
+        history, segment, history->count - segment * BITCHAT_HISTORY_SEGMENT_RECORDS);
+}
+
+/**
+ * Move the written count past every checkpoint the writer has finished
+ */
+static void history_update_written_locked(BitchatHistory* history) {
+    size_t done = 0;
+    while(done < history->checkpoint_count &&
+          bitchat_writer_is_written(history->writer, history->checkpoints[done].mark)) {
+        history->written_count = history->checkpoints[done].count;
+        done++;
+    }
+    if(done > 0) {
+        history->checkpoint_count -= done;
+        memmove(
+            history->checkpoints,
+            &history->checkpoints[done],
+            history->checkpoint_count * sizeof(HistoryCheckpoint));
+    }
+}
+
+/**
+ * Open the history log
+ */
+BitchatHistory* bitchat_history_open(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    BitchatHistory* history = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatHistory));
+    memset(history, 0, sizeof(BitchatHistory));
+
+    history->writer = writer;
+    history->prepared = HISTORY_NOT_PREPARED;
+    history->signed_count = HISTORY_NOT_PREPARED;
+    history->storage = furi_record_open(RECORD_STORAGE);
+    history->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+
+    storage_common_mkdir(history->storage, APP_DATA_PATH("bitchat"));
+    storage_common_mkdir(history->storage, BITCHAT_HISTORY_DIR);
+
+    history_finish_compaction(history);
+    history_read_u32(history, HISTORY_FIRST_PATH, &history->first_segment);
+
+    // The head file names the newest segment; a crash may leave it one behind
+    uint32_t segment = 0;
+    history_read_u32(history, HISTORY_HEAD_PATH, &segment);
+    while(storage_file_exists(history->storage, history_path(history, segment + 1, "log"))) {
+        segment++;
+    }
+
+    history_recover(history, segment);
+    history->written_count = history->count;
+    BITCHAT_LOG_I(TAG, "History opened: %lu records", history->count);
+
+    return history;
+}
+
+/**
+ * Close the history log
+ */
+void bitchat_history_close(BitchatHistory* history) {
+    furi_assert(history);
+
+    furi_mutex_free(history->mutex);
+    furi_record_close(RECORD_STORAGE);
+    bitchat_heap_free(history);
+}
+
+/**
+ * Get the number of records ever appended
+ */
+uint32_t bitchat_history_count(BitchatHistory* history) {
+    furi_assert(history);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+    uint32_t count = history->count;
+    furi_mutex_release(history->mutex);
+
+    return count;
+}
+
+/**
+ * Get the number of records that can be read back
+ */
+uint32_t bitchat_history_written_count(BitchatHistory* history) {
+    furi_assert(history);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+    history_update_written_locked(history);
+    uint32_t count = history->written_count;
+    furi_mutex_release(history->mutex);
+
+    return count;
+}
+
+/**
+ * Get the oldest record that may still be stored
+ */
+uint32_t bitchat_history_first(BitchatHistory* history) {
+    furi_assert(history);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+    uint32_t first = history->first_segment * BITCHAT_HISTORY_SEGMENT_RECORDS;
+    furi_mutex_release(history->mutex);
+
+    return first;
+}
+
+/**
+ * Append a message
+ */
+bool bitchat_history_append(
+    BitchatHistory* history,
+    const char* sender,
+    const char* content,
+    uint8_t flags,
+    uint32_t timestamp,
+    uint32_t* seq) {
+    furi_assert(history);
+    furi_assert(sender);
+    furi_assert(content);
+
+    size_t sender_length = strnlen(sender, BITCHAT_HISTORY_MAX_SENDER);
+    size_t content_length = strnlen(content, BITCHAT_HISTORY_MAX_CONTENT);
+    size_t size = BITCHAT_HISTORY_RECORD_HEADER_SIZE + sender_length + content_length;
+
+    uint8_t record[HISTORY_MAX_RECORD_SIZE];
+    encode_u16_be(&record[0], size);
+    record[2] = flags;
+    encode_u32_be(&record[3], timestamp);
+    record[7] = sender_length;
+    memcpy(&record[BITCHAT_HISTORY_RECORD_HEADER_SIZE], sender, sender_length);
+    memcpy(&record[BITCHAT_HISTORY_RECORD_HEADER_SIZE + sender_length], content, content_length);
+
+    uint8_t signature[BITCHAT_SEARCH_SIGNATURE_SIZE];
+    bitchat_search_signature(content, content_length, signature);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+
+    uint32_t segment = history->count / BITCHAT_HISTORY_SEGMENT_RECORDS;
+    uint32_t position = history->count % BITCHAT_HISTORY_SEGMENT_RECORDS;
+    bool success = true;
+
+    // Head and index updates go first, and only once even if the record is retried
+    if(history->prepared != history->count) {
+        if(position == 0) {
+            uint8_t head[4];
+            encode_u32_be(head, segment);
+            success = bitchat_writer_replace(history->writer, HISTORY_HEAD_PATH, head, 4, NULL, NULL);
+            history->tail_size = 0;
+        }
+        if(success && position % BITCHAT_HISTORY_INDEX_INTERVAL == 0) {
+            uint8_t entry[4];
+            encode_u32_be(entry, history->tail_size);
+            success = bitchat_writer_append(
+                history->writer, history_path(history, segment, "idx"), entry, 4, NULL, NULL);
+        }
+        if(success) {
+            history->prepared = history->count;
+        }
+    }
+
+    // So is the search signature; a retry may carry another message, so it overwrites
+    if(success && history->signed_count != history->count) {
+        success = bitchat_writer_append(
+            history->writer,
+            history_path(history, segment, "sig"),
+            signature,
+            sizeof(signature),
+            NULL,
+            NULL);
+        if(success) history->signed_count = history->count;
+    } else if(success) {
+        success = bitchat_writer_write_at(
+            history->writer,
+            history_path(history, segment, "sig"),
+            position * BITCHAT_SEARCH_SIGNATURE_SIZE,
+            signature,
+            sizeof(signature),
+            NULL,
+            NULL);
+    }
+
+    if(success) {
+        success = bitchat_writer_append(
+            history->writer, history_path(history, segment, "log"), record, size, NULL, NULL);
+    }
+
+    if(success) {
+        if(seq) *seq = history->count;
+        history->count++;
+        history->tail_size += size;
+
+        history_update_written_locked(history);
+        size_t slot = history->checkpoint_count;
+        if(slot == HISTORY_CHECKPOINTS) {
+            slot--;
+        } else {
+            history->checkpoint_count++;
+        }
+        history->checkpoints[slot].count = history->count;
+        history->checkpoints[slot].mark = bitchat_writer_get_mark(history->writer);
+    } else {
+        BITCHAT_LOG_E(TAG, "Failed to append record %lu", history->count);
+    }
+
+    furi_mutex_release(history->mutex);
+
+    return success;
+}
+
+/**
+ * Read a range of records
+ */
+size_t bitchat_history_read(
+    BitchatHistory* history,
+    uint32_t first_seq,
+    size_t count,
+    BitchatHistoryCallback callback,
+    void* context) {
+    furi_assert(history);
+    furi_assert(callback);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+
+    // Records still staged with the writer are left out rather than waited for
+    history_update_written_locked(history);
+    if(first_seq >= history->written_count) {
+        furi_mutex_release(history->mutex);
+        return 0;
+    }
+    if(count > history->written_count - first_seq) {
+        count = history->written_count - first_seq;
+    }
+
+    BitchatHistoryRecord record;
+    uint8_t header[BITCHAT_HISTORY_RECORD_HEADER_SIZE];
+    File* file = storage_file_alloc(history->storage);
+    uint32_t end_seq = first_seq + count;
+    uint32_t seq = first_seq;
+    uint32_t first = history->first_segment * BITCHAT_HISTORY_SEGMENT_RECORDS;
+    if(seq < first) seq = first;
+    size_t read = 0;
+
+    while(seq < end_seq) {
+        uint32_t segment = seq / BITCHAT_HISTORY_SEGMENT_RECORDS;
+        uint32_t position = seq % BITCHAT_HISTORY_SEGMENT_RECORDS;
+        uint32_t segment_end = (segment + 1) * BITCHAT_HISTORY_SEGMENT_RECORDS;
+
+        // Jump to the nearest indexed record at or before seq
+        uint8_t entry[4];
+        bool found = false;
+        if(storage_file_open(
+               file, history_path(history, segment, "idx"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+            found = storage_file_seek(file, (position / BITCHAT_HISTORY_INDEX_INTERVAL) * 4, true) &&
+                    storage_file_read(file, entry, 4) == 4;
+            storage_file_close(file);
+        }
+        if(!found && segment < history->count / BITCHAT_HISTORY_SEGMENT_RECORDS) {
+            // Compacted away entirely
+            seq = segment_end;
+            continue;
+        }
+        if(!found || !storage_file_open(
+                         file, history_path(history, segment, "log"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+            break;
+        }
+
+        uint32_t offset = decode_u32_be(entry);
+        storage_file_seek(file, offset, true);
+        for(uint32_t skip = position % BITCHAT_HISTORY_INDEX_INTERVAL; skip > 0; skip--) {
+            size_t size = history_read_header(file, header);
+            if(size == 0) break;
+            offset += size;
+            storage_file_seek(file, offset, true);
+        }
+
+        // Then read forward to the end of the range or of the segment
+        bool ok = true;
+        while(seq < end_seq && seq < segment_end) {
+            size_t size = history_read_header(file, header);
+            size_t sender_length = header[7];
+            size_t content_length = size - BITCHAT_HISTORY_RECORD_HEADER_SIZE - sender_length;
+            if(size == 0 || storage_file_read(file, record.sender, sender_length) != sender_length ||
+               storage_file_read(file, record.content, content_length) != content_length) {
+                ok = false;
+                break;
+            }
+            record.seq = seq++;
+            record.flags = header[2];
+            if(record.flags & BITCHAT_HISTORY_FLAG_DELETED) continue;
+            record.timestamp = decode_u32_be(&header[3]);
+            record.sender[sender_length] = '\0';
+            record.content[content_length] = '\0';
+            callback(context, &record);
+            read++;
+        }
+        storage_file_close(file);
+
+        if(!ok) {
+            BITCHAT_LOG_E(TAG, "Corrupt record %lu", seq);
+            break;
+        }
+    }
+
+    storage_file_free(file);
+    furi_mutex_release(history->mutex);
+
+    return read;
+}
+
+/**
+ * Remove a segment with no live records left, moving the first segment past it
+ */
+static void history_remove_segment_locked(BitchatHistory* history, uint32_t segment) {
+    // Readers treat a segment without an index as compacted away, so it goes first
+    storage_common_remove(history->storage, history_path(history, segment, "idx"));
+    storage_common_remove(history->storage, history_path(history, segment, "log"));
+    storage_common_remove(history->storage, history_path(history, segment, "sig"));
+    storage_common_remove(history->storage, history_path(history, segment, "bix"));
+
+    uint32_t newest = history->count / BITCHAT_HISTORY_SEGMENT_RECORDS;
+    uint32_t first = history->first_segment;
+    while(first < newest &&
+          !storage_file_exists(history->storage, history_path(history, first, "idx"))) {
+        first++;
+    }
+    if(first != history->first_segment) {
+        history->first_segment = first;
+        history_write_u32(history, HISTORY_FIRST_PATH, first);
+    }
+}
+
+/**
+ * Rewrite a sealed segment without the records the filter rejects
+ */
+bool bitchat_history_compact_segment(
+    BitchatHistory* history,
+    uint32_t segment,
+    BitchatHistoryFilter filter,
+    void* context) {
+    furi_assert(history);
+    furi_assert(filter);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+    bool sealed = segment >= history->first_segment &&
+                  segment < history->count / BITCHAT_HISTORY_SEGMENT_RECORDS;
+    furi_mutex_release(history->mutex);
+    if(!sealed) return false;
+
+    // The segment's last records may still be staged
+    if(bitchat_writer_is_pending(history->writer)) {
+        bitchat_writer_flush(history->writer, true);
+    }
+
+    // Sealed segments only change here, so they are read without the lock
+    char log_path[64];
+    snprintf(log_path, sizeof(log_path), BITCHAT_HISTORY_DIR "/%08lx.log", segment);
+
+    File* source = storage_file_alloc(history->storage);
+    if(!storage_file_open(source, log_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        // Compacted away already
+        storage_file_free(source);
+        return true;
+    }
+    File* target = storage_file_alloc(history->storage);
+    bool ok =
+        storage_file_open(target, HISTORY_COMPACT_LOG_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+
+    BitchatHistoryRecord record;
+    uint8_t buffer[HISTORY_MAX_RECORD_SIZE];
+    uint8_t index[HISTORY_INDEX_ENTRIES * 4];
+    uint32_t offset = 0;
+    uint32_t live = 0;
+    uint32_t dropped = 0;
+
+    for(uint32_t position = 0; ok && position < BITCHAT_HISTORY_SEGMENT_RECORDS; position++) {
+        if(position % BITCHAT_HISTORY_INDEX_INTERVAL == 0) {
+            encode_u32_be(&index[(position / BITCHAT_HISTORY_INDEX_INTERVAL) * 4], offset);
+        }
+
+        size_t size = history_read_header(source, buffer);
+        if(size == 0 || storage_file_read(
+                            source,
+                            &buffer[BITCHAT_HISTORY_RECORD_HEADER_SIZE],
+                            size - BITCHAT_HISTORY_RECORD_HEADER_SIZE) !=
+                            size - BITCHAT_HISTORY_RECORD_HEADER_SIZE) {
+            ok = false;
+            break;
+        }
+
+        if(!(buffer[2] & BITCHAT_HISTORY_FLAG_DELETED)) {
+            size_t sender_length = buffer[7];
+            size_t content_length = size - BITCHAT_HISTORY_RECORD_HEADER_SIZE - sender_length;
+            record.seq = segment * BITCHAT_HISTORY_SEGMENT_RECORDS + position;
+            record.flags = buffer[2];
+            record.timestamp = decode_u32_be(&buffer[3]);
+            memcpy(record.sender, &buffer[BITCHAT_HISTORY_RECORD_HEADER_SIZE], sender_length);
+            record.sender[sender_length] = '\0';
+            memcpy(
+                record.content,
+                &buffer[BITCHAT_HISTORY_RECORD_HEADER_SIZE + sender_length],
+                content_length);
+            record.content[content_length] = '\0';
+
+            if(filter(context, &record)) {
+                live++;
+            } else {
+                // A bare header keeps record numbers and the index layout in place
+                size = BITCHAT_HISTORY_RECORD_HEADER_SIZE;
+                encode_u16_be(&buffer[0], size);
+                buffer[2] |= BITCHAT_HISTORY_FLAG_DELETED;
+                buffer[7] = 0;
+                dropped++;
+            }
+        }
+
+        ok = storage_file_write(target, buffer, size) == size;
+        offset += size;
+    }
+
+    storage_file_close(source);
+    storage_file_close(target);
+    storage_file_free(source);
+
+    if(ok && live > 0 && dropped > 0) {
+        ok = storage_file_open(
+                 target, HISTORY_COMPACT_INDEX_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+             storage_file_write(target, index, sizeof(index)) == sizeof(index);
+        storage_file_close(target);
+
+        // The marker commits the rewrite; from here a crash rolls it forward
+        ok = ok && history_write_u32(history, HISTORY_COMPACT_MARKER_PATH, segment);
+    }
+    storage_file_free(target);
+
+    furi_mutex_acquire(history->mutex, FuriWaitForever);
+    if(ok && live == 0) {
+        BITCHAT_LOG_I(TAG, "Segment %lu expired", segment);
+        history_remove_segment_locked(history, segment);
+    } else if(ok && dropped > 0) {
+        BITCHAT_LOG_I(TAG, "Segment %lu: dropped %lu records", segment, dropped);
+    }
+    // Swaps the rewrite in, or cleans up after a failed or unneeded one
+    history_finish_compaction(history);
+    furi_mutex_release(history->mutex);
+
+    if(!ok) {
+        BITCHAT_LOG_E(TAG, "Failed to compact segment %lu", segment);
+    }
+    return ok;
+}
@@ -0,0 +1,153 @@
+/**
+ * BitChat Message History
+ * Append-only message log on SD card
+ *
+ * Records are numbered from 0 in arrival order. Record n lives in segment
+ * n / BITCHAT_HISTORY_SEGMENT_RECORDS; each segment has a sparse index
+ * holding the file offset of every BITCHAT_HISTORY_INDEX_INTERVAL-th record,
+ * so any record is found with one index read and a short forward scan.
+ * Opening the log only inspects the tail of the newest segment.
+ *
+ * Sealed segments are compacted in the background: dropped records shrink
+ * to a bare header flagged BITCHAT_HISTORY_FLAG_DELETED, so record numbers
+ * and index layout never change, and a segment with nothing left in it is
+ * removed.
+ *
+ * Each segment also keeps a `.sig` file of per-record search signatures,
+ * written alongside the records (see bitchat_search.h).
+ *
+ * A private record's sender is the other party of the conversation, also
+ * for our own messages (see bitchat_conversations.h).
+ *
+ * Record: length (2) | flags (1) | timestamp (4) | sender length (1) | sender | content
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_HISTORY_DIR APP_DATA_PATH("bitchat") "/history"
+#define BITCHAT_HISTORY_SEGMENT_RECORDS 256
+#define BITCHAT_HISTORY_INDEX_INTERVAL 16
+#define BITCHAT_HISTORY_RECORD_HEADER_SIZE 8
+#define BITCHAT_HISTORY_MAX_SENDER 31
+#define BITCHAT_HISTORY_MAX_CONTENT 255
+
+#define BITCHAT_HISTORY_FLAG_OWN 0x01
+#define BITCHAT_HISTORY_FLAG_PRIVATE 0x02
+#define BITCHAT_HISTORY_FLAG_DELETED 0x80
+
+typedef struct BitchatHistory BitchatHistory;
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * One stored message
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t timestamp;
+    uint8_t flags;
+    char sender[BITCHAT_HISTORY_MAX_SENDER + 1];
+    char content[BITCHAT_HISTORY_MAX_CONTENT + 1];
+} BitchatHistoryRecord;
+
+/**
+ * Called for each record read, in ascending order
+ */
+typedef void (*BitchatHistoryCallback)(void* context, const BitchatHistoryRecord* record);
+
+/**
+ * Decide whether a record survives compaction
+ * Runs on the compacting thread between record reads, so it may pace the rewrite.
+ * @return true to keep the record
+ */
+typedef bool (*BitchatHistoryFilter)(void* context, const BitchatHistoryRecord* record);
+
+/**
+ * Open the history log, creating it if needed
+ * A record torn by power loss at the tail is discarded.
+ * @param writer Storage writer that appends go through
+ * @return History instance
+ */
+BitchatHistory* bitchat_history_open(BitchatWriter* writer);
+
+/**
+ * Close the history log
+ */
+void bitchat_history_close(BitchatHistory* history);
+
+/**
+ * Get the number of records ever appended
+ */
+uint32_t bitchat_history_count(BitchatHistory* history);
+
+/**
+ * Get the number of records that can be read back
+ * Records still staged with the storage writer are counted once it has
+ * written them. Never blocks on SD.
+ */
+uint32_t bitchat_history_written_count(BitchatHistory* history);
+
+/**
+ * Get the oldest record that may still be stored
+ * Everything before it has been compacted away.
+ */
+uint32_t bitchat_history_first(BitchatHistory* history);
+
+/**
+ * Append a message
+ * The record is staged with the storage writer and numbered at once;
+ * it reaches the card shortly after. Sender and content longer than the
+ * record limits are truncated.
+ * @param history History instance
+ * @param sender Sender nickname
+ * @param content Message text
+ * @param flags BITCHAT_HISTORY_FLAG_*
+ * @param timestamp Message timestamp
+ * @param seq Set to the record number (optional)
+ * @return false if the writer's staging buffer is full
+ */
+bool bitchat_history_append(
+    BitchatHistory* history,
+    const char* sender,
+    const char* content,
+    uint8_t flags,
+    uint32_t timestamp,
+    uint32_t* seq);
+
+/**
+ * Read a range of records
+ * Records dropped by compaction are skipped. Reads end at
+ * bitchat_history_written_count(); records not yet written are not waited for.
+ * @param history History instance
+ * @param first_seq First record to read
+ * @param count Number of record numbers to cover
+ * @param callback Called once per stored record
+ * @param context Callback context
+ * @return Number of records read
+ */
+size_t bitchat_history_read(
+    BitchatHistory* history,
+    uint32_t first_seq,
+    size_t count,
+    BitchatHistoryCallback callback,
+    void* context);
+
+/**
+ * Rewrite a sealed segment without the records the filter rejects
+ * The new log and index are built beside the old ones and swapped in
+ * together; a crash part way through is finished or discarded on open.
+ * A segment left with no records is removed. Blocks on SD I/O.
+ * @param history History instance
+ * @param segment Segment number; the newest segment is never compacted
+ * @param filter Called once per stored record
+ * @param context Filter context
+ * @return false if the segment is not sealed or on I/O error
+ */
+bool bitchat_history_compact_segment(
+    BitchatHistory* history,
+    uint32_t segment,
+    BitchatHistoryFilter filter,
+    void* context);
@@ -4,25 +4,39 @@
  */
 
 #include "../bitchat_app.h"
+#include "../crypto/bitchat_x25519.h"
+#include "bitchat_writer.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
 #include <furi.h>
 #include <furi_hal.h>
 #include <storage/storage.h>
+#include <stddef.h>
 #include <string.h>
 
 #define TAG "BitchatIdentity"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
 #define IDENTITY_FILE_PATH APP_DATA_PATH("bitchat") "/identity.bin"
-#define IDENTITY_VERSION 1
+#define IDENTITY_VERSION 3
+#define IDENTITY_VERSION_RANDOM_SIGNING_KEY 1
+#define IDENTITY_VERSION_RANDOM_NOISE_KEY 2
 
 struct BitchatIdentity {
     uint8_t version;
     uint8_t peer_id[8];
     uint8_t noise_private_key[32];
     uint8_t noise_public_key[32];
-    uint8_t signing_private_key[32];
+    uint8_t signing_private_key[32]; // Ed25519 seed
     uint8_t signing_public_key[32];
     char nickname[32];
+
+    // Runtime only, derived from signing_private_key on create/load
+    BitchatEd25519Key signing_key;
 };
 
+// Only the fields before the runtime state are written to storage
+#define IDENTITY_STORED_SIZE offsetof(BitchatIdentity, signing_key)
+
 /**
  * Generate a random peer ID from public key
  */
@@ -35,24 +49,24 @@ static void generate_peer_id(const uint8_t* public_key, uint8_t* peer_id) {
  * Create a new identity
  */
 BitchatIdentity* bitchat_identity_create(void) {
-    BitchatIdentity* identity = malloc(sizeof(BitchatIdentity));
+    BitchatIdentity* identity =
+        bitchat_heap_alloc(BitchatHeapTagIdentity, sizeof(BitchatIdentity));
     memset(identity, 0, sizeof(BitchatIdentity));
 
     identity->version = IDENTITY_VERSION;
 
-    // Generate Noise key pair (simplified - using random for now)
-    // In production, use proper Curve25519 key generation
+    // Generate Noise (X25519) key pair
     for(int i = 0; i < 32; i++) {
         identity->noise_private_key[i] = furi_hal_random_get() & 0xFF;
-        identity->noise_public_key[i] = furi_hal_random_get() & 0xFF;
     }
+    bitchat_x25519_public_key(identity->noise_public_key, identity->noise_private_key);
 
-    // Generate signing key pair (simplified - using random for now)
-    // In production, use proper Ed25519 key generation
+    // Generate Ed25519 signing key pair from a random seed
     for(int i = 0; i < 32; i++) {
         identity->signing_private_key[i] = furi_hal_random_get() & 0xFF;
-        identity->signing_public_key[i] = furi_hal_random_get() & 0xFF;
     }
+    bitchat_ed25519_expand(&identity->signing_key, identity->signing_private_key);
+    memcpy(identity->signing_public_key, identity->signing_key.public_key, 32);
 
     // Generate peer ID from public key
     generate_peer_id(identity->noise_public_key, identity->peer_id);
@@ -63,7 +77,7 @@ BitchatIdentity* bitchat_identity_create(void) {
         identity->peer_id[0], identity->peer_id[1],
         identity->peer_id[2], identity->peer_id[3]);
 
-    FURI_LOG_I(TAG, "Created new identity: %s", identity->nickname);
+    BITCHAT_LOG_I(TAG, "Created new identity: %s", identity->nickname);
 
     return identity;
 }
@@ -76,27 +90,57 @@ BitchatIdentity* bitchat_identity_load(void) {
     File* file = storage_file_alloc(storage);
 
     BitchatIdentity* identity = NULL;
+    bool migrated = false;
 
     if(storage_file_open(file, IDENTITY_FILE_PATH, FSAM_READ, FSOM_OPEN_EXISTING)) {
-        identity = malloc(sizeof(BitchatIdentity));
-
-        uint16_t bytes_read = storage_file_read(file, identity, sizeof(BitchatIdentity));
-        if(bytes_read == sizeof(BitchatIdentity) && identity->version == IDENTITY_VERSION) {
-            FURI_LOG_I(TAG, "Loaded identity: %s", identity->nickname);
+        identity = bitchat_heap_alloc(BitchatHeapTagIdentity, sizeof(BitchatIdentity));
+        memset(identity, 0, sizeof(BitchatIdentity));
+
+        uint16_t bytes_read = storage_file_read(file, identity, IDENTITY_STORED_SIZE);
+        if(bytes_read == IDENTITY_STORED_SIZE &&
+           identity->version >= IDENTITY_VERSION_RANDOM_SIGNING_KEY &&
+           identity->version <= IDENTITY_VERSION) {
+            // Expand the signing key once; every signature reuses it
+            bitchat_ed25519_expand(&identity->signing_key, identity->signing_private_key);
+
+            if(identity->version <= IDENTITY_VERSION_RANDOM_SIGNING_KEY) {
+                // Old identities stored an unrelated random public key:
+                // keep the seed and re-derive the matching public key
+                BITCHAT_LOG_I(TAG, "Migrating identity signing key");
+                memcpy(identity->signing_public_key, identity->signing_key.public_key, 32);
+            }
+
+            if(identity->version <= IDENTITY_VERSION_RANDOM_NOISE_KEY) {
+                // Same for the Noise key; the peer ID follows the new public key
+                BITCHAT_LOG_I(TAG, "Migrating identity Noise key");
+                bitchat_x25519_public_key(identity->noise_public_key, identity->noise_private_key);
+                generate_peer_id(identity->noise_public_key, identity->peer_id);
+            }
+
+            if(identity->version != IDENTITY_VERSION) {
+                identity->version = IDENTITY_VERSION;
+                migrated = true;
+            }
+
+            BITCHAT_LOG_I(TAG, "Loaded identity: %s", identity->nickname);
         } else {
-            FURI_LOG_E(TAG, "Invalid identity file");
-            free(identity);
+            BITCHAT_LOG_E(TAG, "Invalid identity file");
+            bitchat_heap_free(identity);
             identity = NULL;
         }
 
         storage_file_close(file);
     } else {
-        FURI_LOG_I(TAG, "No identity file found");
+        BITCHAT_LOG_I(TAG, "No identity file found");
     }
 
     storage_file_free(file);
     furi_record_close(RECORD_STORAGE);
 
+    if(migrated) {
+        bitchat_identity_save(identity);
+    }
+
     return identity;
 }
 
@@ -112,21 +156,36 @@ void bitchat_identity_save(BitchatIdentity* identity) {
     File* file = storage_file_alloc(storage);
 
     if(storage_file_open(file, IDENTITY_FILE_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
-        uint16_t bytes_written = storage_file_write(file, identity, sizeof(BitchatIdentity));
-        if(bytes_written == sizeof(BitchatIdentity)) {
-            FURI_LOG_I(TAG, "Identity saved");
+        uint16_t bytes_written = storage_file_write(file, identity, IDENTITY_STORED_SIZE);
+        if(bytes_written == IDENTITY_STORED_SIZE) {
+            BITCHAT_LOG_I(TAG, "Identity saved");
         } else {
-            FURI_LOG_E(TAG, "Failed to save identity");
+            BITCHAT_LOG_E(TAG, "Failed to save identity");
         }
         storage_file_close(file);
     } else {
-        FURI_LOG_E(TAG, "Failed to open identity file for writing");
+        BITCHAT_LOG_E(TAG, "Failed to open identity file for writing");
     }
 
     storage_file_free(file);
     furi_record_close(RECORD_STORAGE);
 }
 
+/**
+ * Stage an identity save with the storage writer
+ */
+bool bitchat_identity_save_async(BitchatIdentity* identity, BitchatWriter* writer) {
+    furi_assert(identity);
+    furi_assert(writer);
+
+    if(!bitchat_writer_replace(writer, IDENTITY_FILE_PATH, identity, IDENTITY_STORED_SIZE, NULL, NULL)) {
+        BITCHAT_LOG_E(TAG, "Failed to stage identity save");
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * Free identity
  */
@@ -135,7 +194,8 @@ void bitchat_identity_free(BitchatIdentity* identity) {
         // Securely zero out private keys
         memset(identity->noise_private_key, 0, 32);
         memset(identity->signing_private_key, 0, 32);
-        free(identity);
+        bitchat_ed25519_wipe(&identity->signing_key);
+        bitchat_heap_free(identity);
     }
 }
 
@@ -165,7 +225,7 @@ void bitchat_identity_set_nickname(BitchatIdentity* identity, const char* nickna
     strncpy(identity->nickname, nickname, sizeof(identity->nickname) - 1);
     identity->nickname[sizeof(identity->nickname) - 1] = '\0';
 
-    FURI_LOG_I(TAG, "Nickname changed to: %s", identity->nickname);
+    BITCHAT_LOG_I(TAG, "Nickname changed to: %s", identity->nickname);
 }
 
 /**
@@ -176,6 +236,14 @@ const uint8_t* bitchat_identity_get_public_key(BitchatIdentity* identity) {
     return identity->noise_public_key;
 }
 
+/**
+ * Get Noise private key
+ */
+const uint8_t* bitchat_identity_get_noise_private_key(BitchatIdentity* identity) {
+    furi_assert(identity);
+    return identity->noise_private_key;
+}
+
 /**
  * Get peer ID
  */
@@ -183,3 +251,19 @@ const uint8_t* bitchat_identity_get_peer_id(BitchatIdentity* identity) {
     furi_assert(identity);
     return identity->peer_id;
 }
+
+/**
+ * Get Ed25519 signing public key
+ */
+const uint8_t* bitchat_identity_get_signing_public_key(BitchatIdentity* identity) {
+    furi_assert(identity);
+    return identity->signing_public_key;
+}
+
+/**
+ * Get expanded Ed25519 signing key
+ */
+const BitchatEd25519Key* bitchat_identity_get_signing_key(BitchatIdentity* identity) {
+    furi_assert(identity);
+    return &identity->signing_key;
+}
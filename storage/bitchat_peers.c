@@ -0,0 +1,469 @@
+/**
+ * BitChat Peer Directory Implementation
+ */
+
+#include "bitchat_peers.h"
+#include "bitchat_writer.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+
+#define TAG "BitchatPeers"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+
+// Slot: magic (1) | flags (1) | reserved (2) | peer ID (8) | last seen (4) |
+//       nickname (32) | noise key (32) | signing key (32) | remote static (32) |
+//       resume secret (32) | checksum (4)
+#define PEERS_SLOT_MAGIC 0xB7
+#define PEERS_SLOT_PEER_ID 4
+#define PEERS_SLOT_LAST_SEEN 12
+#define PEERS_SLOT_NICKNAME 16
+#define PEERS_SLOT_NOISE_KEY 48
+#define PEERS_SLOT_SIGNING_KEY 80
+#define PEERS_SLOT_REMOTE_STATIC 112
+#define PEERS_SLOT_RESUME_SECRET 144
+#define PEERS_SLOT_CHECKSUM 176
+#define PEERS_SLOT_SIZE 180
+
+#define PEERS_NO_SLOT UINT16_MAX
+
+typedef struct {
+    BitchatPeerEntry entry;
+    uint16_t slot;
+    uint32_t last_used;
+    uint32_t written_seen; // last_seen of the copy staged last
+    bool valid;
+    bool dirty; // Newer than the staged copy
+} PeersCacheEntry;
+
+struct BitchatPeers {
+    Storage* storage;
+    BitchatWriter* writer;
+    FuriMutex* mutex;
+    PeersCacheEntry cache[BITCHAT_PEERS_CACHE_SIZE];
+    BitchatPeersStats stats;
+};
+
+static void encode_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+static uint32_t decode_u32_be(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) |
+           buf[3];
+}
+
+static uint32_t peers_hash(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261UL;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static void peers_wipe(void* data, size_t size) {
+    volatile uint8_t* p = data;
+    while(size--) {
+        *p++ = 0;
+    }
+}
+
+static void peers_encode_slot(const BitchatPeerEntry* entry, uint8_t* slot) {
+    memset(slot, 0, PEERS_SLOT_SIZE);
+    slot[0] = PEERS_SLOT_MAGIC;
+    slot[1] = entry->flags;
+    memcpy(&slot[PEERS_SLOT_PEER_ID], entry->peer_id, 8);
+    encode_u32_be(&slot[PEERS_SLOT_LAST_SEEN], entry->last_seen);
+    memcpy(&slot[PEERS_SLOT_NICKNAME], entry->nickname, 32);
+    memcpy(&slot[PEERS_SLOT_NOISE_KEY], entry->noise_key, 32);
+    memcpy(&slot[PEERS_SLOT_SIGNING_KEY], entry->signing_key, 32);
+    memcpy(&slot[PEERS_SLOT_REMOTE_STATIC], entry->remote_static, 32);
+    memcpy(&slot[PEERS_SLOT_RESUME_SECRET], entry->resume_secret, 32);
+    encode_u32_be(&slot[PEERS_SLOT_CHECKSUM], peers_hash(slot, PEERS_SLOT_CHECKSUM));
+}
+
+/**
+ * Decode a slot
+ * @return false for an empty slot or one torn by power loss
+ */
+static bool peers_decode_slot(const uint8_t* slot, BitchatPeerEntry* entry) {
+    if(slot[0] != PEERS_SLOT_MAGIC ||
+       decode_u32_be(&slot[PEERS_SLOT_CHECKSUM]) != peers_hash(slot, PEERS_SLOT_CHECKSUM)) {
+        return false;
+    }
+
+    entry->flags = slot[1];
+    memcpy(entry->peer_id, &slot[PEERS_SLOT_PEER_ID], 8);
+    entry->last_seen = decode_u32_be(&slot[PEERS_SLOT_LAST_SEEN]);
+    memcpy(entry->nickname, &slot[PEERS_SLOT_NICKNAME], 32);
+    entry->nickname[31] = '\0';
+    memcpy(entry->noise_key, &slot[PEERS_SLOT_NOISE_KEY], 32);
+    memcpy(entry->signing_key, &slot[PEERS_SLOT_SIGNING_KEY], 32);
+    memcpy(entry->remote_static, &slot[PEERS_SLOT_REMOTE_STATIC], 32);
+    memcpy(entry->resume_secret, &slot[PEERS_SLOT_RESUME_SECRET], 32);
+    return true;
+}
+
+static PeersCacheEntry* peers_cache_find(BitchatPeers* peers, const uint8_t* peer_id) {
+    for(size_t i = 0; i < BITCHAT_PEERS_CACHE_SIZE; i++) {
+        PeersCacheEntry* cached = &peers->cache[i];
+        if(cached->valid && memcmp(cached->entry.peer_id, peer_id, 8) == 0) {
+            return cached;
+        }
+    }
+    return NULL;
+}
+
+static bool peers_slot_cached(BitchatPeers* peers, uint16_t slot) {
+    for(size_t i = 0; i < BITCHAT_PEERS_CACHE_SIZE; i++) {
+        if(peers->cache[i].valid && peers->cache[i].slot == slot) return true;
+    }
+    return false;
+}
+
+/**
+ * Stage a cached entry's slot with the writer
+ */
+static void peers_stage_locked(BitchatPeers* peers, PeersCacheEntry* cached) {
+    uint8_t slot[PEERS_SLOT_SIZE];
+    peers_encode_slot(&cached->entry, slot);
+
+    if(bitchat_writer_write_at(
+           peers->writer,
+           BITCHAT_PEERS_PATH,
+           (uint32_t)cached->slot * PEERS_SLOT_SIZE,
+           slot,
+           PEERS_SLOT_SIZE,
+           NULL,
+           NULL)) {
+        cached->dirty = false;
+        cached->written_seen = cached->entry.last_seen;
+        peers->stats.writes++;
+    } else {
+        // Kept dirty and staged again with the next change or on eviction
+        BITCHAT_LOG_W(TAG, "Staging buffer full, peer update deferred");
+    }
+
+    peers_wipe(slot, sizeof(slot));
+}
+
+/**
+ * Find a peer's slot on the card
+ * @param entry Set to the stored entry if found
+ * @param slot Set to the peer's slot, or to the slot a new entry should take
+ * @param reused Set if that slot holds another peer, seen longest ago
+ * @return true if the peer is stored
+ */
+static bool peers_probe_locked(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    BitchatPeerEntry* entry,
+    uint16_t* slot,
+    bool* reused) {
+    uint16_t home = peers_hash(peer_id, 8) % BITCHAT_PEERS_CAPACITY;
+    uint16_t free_slot = PEERS_NO_SLOT;
+    uint16_t oldest_slot = PEERS_NO_SLOT;
+    uint32_t oldest_seen = UINT32_MAX;
+    bool found = false;
+
+    File* file = storage_file_alloc(peers->storage);
+    bool opened = storage_file_open(file, BITCHAT_PEERS_PATH, FSAM_READ, FSOM_OPEN_EXISTING);
+    uint8_t buffer[PEERS_SLOT_SIZE];
+
+    for(size_t i = 0; i < BITCHAT_PEERS_PROBE_LIMIT; i++) {
+        uint16_t probe = (home + i) % BITCHAT_PEERS_CAPACITY;
+        // Claimed by a cached entry whose first write is still deferred
+        if(peers_slot_cached(peers, probe)) continue;
+
+        // A slot still staged with the writer is newer than the card's copy
+        uint32_t offset = (uint32_t)probe * PEERS_SLOT_SIZE;
+        bool used = false;
+        bool staged = bitchat_writer_read_staged(
+            peers->writer, BITCHAT_PEERS_PATH, offset, buffer, PEERS_SLOT_SIZE);
+        if(staged || (opened && storage_file_seek(file, offset, true) &&
+                      storage_file_read(file, buffer, PEERS_SLOT_SIZE) == PEERS_SLOT_SIZE)) {
+            if(!staged) peers->stats.slot_reads++;
+            if(peers_decode_slot(buffer, entry)) {
+                used = true;
+            } else if(buffer[0] == PEERS_SLOT_MAGIC) {
+                // Torn slot: reusable, but an entry may have probed past it
+                if(free_slot == PEERS_NO_SLOT) free_slot = probe;
+                continue;
+            }
+        }
+
+        if(!used) {
+            if(free_slot == PEERS_NO_SLOT) free_slot = probe;
+            break;
+        }
+        if(memcmp(entry->peer_id, peer_id, 8) == 0) {
+            *slot = probe;
+            found = true;
+            break;
+        }
+        if(entry->last_seen < oldest_seen) {
+            oldest_seen = entry->last_seen;
+            oldest_slot = probe;
+        }
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    peers_wipe(buffer, sizeof(buffer));
+
+    if(!found) {
+        *slot = free_slot != PEERS_NO_SLOT ? free_slot : oldest_slot;
+        *reused = free_slot == PEERS_NO_SLOT;
+    }
+    return found;
+}
+
+/**
+ * Get a peer's cache entry, reading it in (or starting a new one) on a miss
+ * @param create Start an entry for an unknown peer
+ * @return Cache entry, or NULL if unknown and not created, or no slot is free
+ */
+static PeersCacheEntry*
+    peers_load_locked(BitchatPeers* peers, const uint8_t* peer_id, bool create) {
+    PeersCacheEntry* cached = peers_cache_find(peers, peer_id);
+    if(cached) {
+        peers->stats.cache_hits++;
+        cached->last_used = furi_get_tick();
+        return cached;
+    }
+    peers->stats.cache_misses++;
+
+    BitchatPeerEntry entry;
+    uint16_t slot;
+    bool reused = false;
+    bool found = peers_probe_locked(peers, peer_id, &entry, &slot, &reused);
+    if((!found && !create) || slot == PEERS_NO_SLOT) {
+        peers_wipe(&entry, sizeof(entry));
+        return NULL;
+    }
+
+    // Reuse an empty cache entry, else the least recently used one
+    for(size_t i = 0; i < BITCHAT_PEERS_CACHE_SIZE; i++) {
+        PeersCacheEntry* candidate = &peers->cache[i];
+        if(!candidate->valid) {
+            cached = candidate;
+            break;
+        }
+        if(!cached || (int32_t)(candidate->last_used - cached->last_used) < 0) {
+            cached = candidate;
+        }
+    }
+    if(cached->valid && cached->dirty) {
+        peers_stage_locked(peers, cached);
+    }
+
+    memset(cached, 0, sizeof(PeersCacheEntry));
+    if(found) {
+        cached->entry = entry;
+        cached->written_seen = entry.last_seen;
+    } else {
+        memcpy(cached->entry.peer_id, peer_id, 8);
+        cached->dirty = true;
+        if(reused) peers->stats.evictions++;
+    }
+    cached->slot = slot;
+    cached->last_used = furi_get_tick();
+    cached->valid = true;
+
+    peers_wipe(&entry, sizeof(entry));
+    return cached;
+}
+
+/**
+ * Open the peer directory
+ */
+BitchatPeers* bitchat_peers_alloc(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    BitchatPeers* peers = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatPeers));
+    memset(peers, 0, sizeof(BitchatPeers));
+
+    peers->storage = furi_record_open(RECORD_STORAGE);
+    peers->writer = writer;
+    peers->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+
+    storage_common_mkdir(peers->storage, APP_DATA_PATH("bitchat"));
+
+    return peers;
+}
+
+/**
+ * Stage pending updates and free the directory
+ */
+void bitchat_peers_free(BitchatPeers* peers) {
+    furi_assert(peers);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+    for(size_t i = 0; i < BITCHAT_PEERS_CACHE_SIZE; i++) {
+        if(peers->cache[i].valid && peers->cache[i].dirty) {
+            peers_stage_locked(peers, &peers->cache[i]);
+        }
+    }
+    furi_mutex_release(peers->mutex);
+
+    furi_mutex_free(peers->mutex);
+    furi_record_close(RECORD_STORAGE);
+    peers_wipe(peers, sizeof(BitchatPeers));
+    bitchat_heap_free(peers);
+}
+
+/**
+ * Look up a peer
+ */
+bool bitchat_peers_get(BitchatPeers* peers, const uint8_t* peer_id, BitchatPeerEntry* entry) {
+    furi_assert(peers);
+    furi_assert(peer_id);
+    furi_assert(entry);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+    PeersCacheEntry* cached = peers_load_locked(peers, peer_id, false);
+    if(cached) *entry = cached->entry;
+    furi_mutex_release(peers->mutex);
+
+    return cached != NULL;
+}
+
+/**
+ * Store a peer
+ */
+void bitchat_peers_put(BitchatPeers* peers, const BitchatPeerEntry* entry) {
+    furi_assert(peers);
+    furi_assert(entry);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+    PeersCacheEntry* cached = peers_load_locked(peers, entry->peer_id, true);
+    if(cached) {
+        cached->entry = *entry;
+        peers_stage_locked(peers, cached);
+    }
+    furi_mutex_release(peers->mutex);
+}
+
+/**
+ * Record a peer's announcement
+ */
+void bitchat_peers_record_announcement(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    const char* nickname,
+    const uint8_t* noise_key,
+    const uint8_t* signing_key,
+    uint32_t timestamp) {
+    furi_assert(peers);
+    furi_assert(peer_id);
+    furi_assert(nickname);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+
+    PeersCacheEntry* cached = peers_load_locked(peers, peer_id, true);
+    if(cached) {
+        BitchatPeerEntry* entry = &cached->entry;
+        bool changed = false;
+
+        if(strncmp(entry->nickname, nickname, sizeof(entry->nickname) - 1) != 0) {
+            strncpy(entry->nickname, nickname, sizeof(entry->nickname) - 1);
+            entry->nickname[sizeof(entry->nickname) - 1] = '\0';
+            changed = true;
+        }
+        if(noise_key && (!(entry->flags & BITCHAT_PEER_FLAG_NOISE_KEY) ||
+                         memcmp(entry->noise_key, noise_key, 32) != 0)) {
+            // A new key voids whatever was proven or resumable with the old one
+            memcpy(entry->noise_key, noise_key, 32);
+            entry->flags |= BITCHAT_PEER_FLAG_NOISE_KEY;
+            entry->flags &= ~(BITCHAT_PEER_FLAG_VERIFIED | BITCHAT_PEER_FLAG_RESUMABLE);
+            changed = true;
+        }
+        if(signing_key && (!(entry->flags & BITCHAT_PEER_FLAG_SIGNING_KEY) ||
+                           memcmp(entry->signing_key, signing_key, 32) != 0)) {
+            memcpy(entry->signing_key, signing_key, 32);
+            entry->flags |= BITCHAT_PEER_FLAG_SIGNING_KEY;
+            changed = true;
+        }
+
+        entry->last_seen = timestamp;
+        cached->dirty = true;
+        if(changed || timestamp - cached->written_seen >= BITCHAT_PEERS_TOUCH_INTERVAL) {
+            peers_stage_locked(peers, cached);
+        }
+    }
+
+    furi_mutex_release(peers->mutex);
+}
+
+/**
+ * Record an established Noise session's resumption state
+ */
+void bitchat_peers_record_session(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    const uint8_t* remote_static,
+    const uint8_t* resume_secret) {
+    furi_assert(peers);
+    furi_assert(peer_id);
+    furi_assert(remote_static);
+    furi_assert(resume_secret);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+
+    PeersCacheEntry* cached = peers_load_locked(peers, peer_id, true);
+    if(cached) {
+        BitchatPeerEntry* entry = &cached->entry;
+        memcpy(entry->remote_static, remote_static, 32);
+        memcpy(entry->resume_secret, resume_secret, 32);
+        entry->flags |= BITCHAT_PEER_FLAG_RESUMABLE;
+        if((entry->flags & BITCHAT_PEER_FLAG_NOISE_KEY) &&
+           memcmp(entry->noise_key, remote_static, 32) == 0) {
+            entry->flags |= BITCHAT_PEER_FLAG_VERIFIED;
+        }
+        // Every resumption rotates the secret, so it is always written
+        peers_stage_locked(peers, cached);
+    }
+
+    furi_mutex_release(peers->mutex);
+}
+
+/**
+ * Resolve a peer ID to its nickname
+ */
+bool bitchat_peers_get_nickname(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    char* nickname,
+    size_t size) {
+    furi_assert(peers);
+    furi_assert(peer_id);
+    furi_assert(nickname);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+    PeersCacheEntry* cached = peers_load_locked(peers, peer_id, false);
+    bool found = cached && cached->entry.nickname[0] != '\0';
+    if(found) {
+        strncpy(nickname, cached->entry.nickname, size - 1);
+        nickname[size - 1] = '\0';
+    }
+    furi_mutex_release(peers->mutex);
+
+    return found;
+}
+
+/**
+ * Get directory statistics
+ */
+void bitchat_peers_get_stats(BitchatPeers* peers, BitchatPeersStats* stats) {
+    furi_assert(peers);
+    furi_assert(stats);
+
+    furi_mutex_acquire(peers->mutex, FuriWaitForever);
+    *stats = peers->stats;
+    furi_mutex_release(peers->mutex);
+}
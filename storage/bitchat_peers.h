@@ -0,0 +1,136 @@
+/**
+ * BitChat Peer Directory
+ * Persistent record of every peer seen, keyed by peer ID
+ *
+ * Entries live in fixed-size slots of one file, placed by a hash of the peer
+ * ID with linear probing over at most BITCHAT_PEERS_PROBE_LIMIT slots, so a
+ * lookup reads a handful of slots and nothing is loaded at startup. When
+ * every slot a peer may use is taken, the one seen longest ago is reused.
+ * A small LRU cache in RAM answers repeat lookups, and updates go out
+ * through the storage writer.
+ *
+ * Besides the announced nickname and keys, an entry keeps the Noise
+ * resumption state of the peer's last session, so a known peer reconnects
+ * after a restart with a one round trip resume instead of a full handshake.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_PEERS_PATH APP_DATA_PATH("bitchat") "/peers.dat"
+#define BITCHAT_PEERS_CAPACITY 64
+#define BITCHAT_PEERS_PROBE_LIMIT 8
+#define BITCHAT_PEERS_CACHE_SIZE 8
+// last_seen alone is written back at most this often (seconds)
+#define BITCHAT_PEERS_TOUCH_INTERVAL 60
+
+#define BITCHAT_PEER_FLAG_NOISE_KEY 0x01 // noise_key announced
+#define BITCHAT_PEER_FLAG_SIGNING_KEY 0x02 // signing_key announced
+#define BITCHAT_PEER_FLAG_VERIFIED 0x04 // A handshake proved noise_key
+#define BITCHAT_PEER_FLAG_RESUMABLE 0x08 // remote_static/resume_secret are valid
+
+typedef struct BitchatPeers BitchatPeers;
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * One known peer
+ */
+typedef struct {
+    uint8_t peer_id[8];
+    uint8_t flags; // BITCHAT_PEER_FLAG_*
+    uint32_t last_seen; // Seconds
+    char nickname[32];
+    uint8_t noise_key[32];
+    uint8_t signing_key[32];
+    // Noise session to resume
+    uint8_t remote_static[32];
+    uint8_t resume_secret[32];
+} BitchatPeerEntry;
+
+/**
+ * Peer directory statistics
+ */
+typedef struct {
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t slot_reads;
+    uint32_t writes;
+    uint32_t evictions; // Slots reused for another peer
+} BitchatPeersStats;
+
+/**
+ * Open the peer directory
+ * Nothing is read until the first lookup.
+ * @param writer Storage writer that updates go through
+ * @return Directory instance
+ */
+BitchatPeers* bitchat_peers_alloc(BitchatWriter* writer);
+
+/**
+ * Stage pending updates and free the directory
+ */
+void bitchat_peers_free(BitchatPeers* peers);
+
+/**
+ * Look up a peer
+ * Blocks on SD I/O when the peer is not cached.
+ * @param peers Directory instance
+ * @param peer_id Peer ID (8 bytes)
+ * @param entry Output
+ * @return false if the peer is unknown
+ */
+bool bitchat_peers_get(BitchatPeers* peers, const uint8_t* peer_id, BitchatPeerEntry* entry);
+
+/**
+ * Store a peer, replacing what was known about it
+ */
+void bitchat_peers_put(BitchatPeers* peers, const BitchatPeerEntry* entry);
+
+/**
+ * Record a peer's announcement
+ * A changed Noise key clears the verified and resumable state.
+ * @param peers Directory instance
+ * @param peer_id Peer ID (8 bytes)
+ * @param nickname Announced nickname
+ * @param noise_key Announced Noise static key (32 bytes), NULL if absent
+ * @param signing_key Announced Ed25519 key (32 bytes), NULL if absent
+ * @param timestamp Seconds
+ */
+void bitchat_peers_record_announcement(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    const char* nickname,
+    const uint8_t* noise_key,
+    const uint8_t* signing_key,
+    uint32_t timestamp);
+
+/**
+ * Record an established Noise session's resumption state
+ * @param peers Directory instance
+ * @param peer_id Peer ID (8 bytes)
+ * @param remote_static Authenticated remote static key (32 bytes)
+ * @param resume_secret Resumption secret (32 bytes)
+ */
+void bitchat_peers_record_session(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    const uint8_t* remote_static,
+    const uint8_t* resume_secret);
+
+/**
+ * Resolve a peer ID to its last announced nickname
+ * @return false if the peer is unknown
+ */
+bool bitchat_peers_get_nickname(
+    BitchatPeers* peers,
+    const uint8_t* peer_id,
+    char* nickname,
+    size_t size);
+
+/**
+ * Get directory statistics
+ */
+void bitchat_peers_get_stats(BitchatPeers* peers, BitchatPeersStats* stats);
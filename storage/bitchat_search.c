@@ -0,0 +1,325 @@
+/**
+ * BitChat History Search Implementation
+ */
+
+#include "bitchat_search.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TAG "BitchatSearch"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+// Postings ANDed per segment; further trigrams only narrow what is verified anyway
+#define SEARCH_MAX_TERMS 8
+// Signatures read per I/O when falling back to a segment's .sig file
+#define SEARCH_SIGNATURE_BATCH 16
+
+struct BitchatSearch {
+    BitchatHistory* history;
+    Storage* storage;
+
+    char query[BITCHAT_SEARCH_MAX_QUERY + 1]; // Lowercase
+    size_t query_length;
+    uint8_t query_signature[BITCHAT_SEARCH_SIGNATURE_SIZE];
+    uint8_t terms[SEARCH_MAX_TERMS]; // Signature bits to read postings for
+    size_t term_count;
+
+    // Cursor, newest first: positions below position in segment remain
+    uint32_t end_seq;
+    uint32_t first_segment;
+    uint32_t segment;
+    int32_t position;
+    bool loaded;
+    bool done;
+    uint8_t candidates[BITCHAT_SEARCH_POSTINGS_SIZE];
+
+    // Match delivery for the page in progress
+    BitchatHistoryCallback callback;
+    void* callback_context;
+    bool matched;
+};
+
+static char search_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static size_t search_trigram_bit(const char* trigram) {
+    uint32_t hash = ((uint8_t)search_lower(trigram[0]) << 16) |
+                    ((uint8_t)search_lower(trigram[1]) << 8) | (uint8_t)search_lower(trigram[2]);
+    return (uint32_t)(hash * 2654435761UL) >> (32 - 7);
+}
+
+static const char* search_path(char* path, size_t size, uint32_t segment, const char* extension) {
+    snprintf(path, size, BITCHAT_HISTORY_DIR "/%08lx.%s", segment, extension);
+    return path;
+}
+
+/**
+ * Compute the trigram signature of a text
+ */
+void bitchat_search_signature(const char* text, size_t length, uint8_t* signature) {
+    furi_assert(text || length == 0);
+    furi_assert(signature);
+
+    memset(signature, 0, BITCHAT_SEARCH_SIGNATURE_SIZE);
+    for(size_t i = 0; i + 3 <= length; i++) {
+        size_t bit = search_trigram_bit(&text[i]);
+        signature[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+/**
+ * Transpose a sealed segment's signatures into postings
+ */
+bool bitchat_search_index_segment(Storage* storage, uint32_t segment) {
+    furi_assert(storage);
+
+    char path[64];
+    char temp_path[64];
+    uint8_t* postings = bitchat_heap_alloc(
+        BitchatHeapTagStorage, BITCHAT_SEARCH_SIGNATURE_BITS * BITCHAT_SEARCH_POSTINGS_SIZE);
+    // Records without a signature match everything
+    memset(postings, 0xFF, BITCHAT_SEARCH_SIGNATURE_BITS * BITCHAT_SEARCH_POSTINGS_SIZE);
+
+    File* file = storage_file_alloc(storage);
+    bool success = storage_file_open(
+        file, search_path(path, sizeof(path), segment, "sig"), FSAM_READ, FSOM_OPEN_EXISTING);
+    if(success) {
+        uint8_t batch[SEARCH_SIGNATURE_BATCH][BITCHAT_SEARCH_SIGNATURE_SIZE];
+        size_t position = 0;
+        while(position < BITCHAT_HISTORY_SEGMENT_RECORDS) {
+            size_t read = storage_file_read(file, batch, sizeof(batch)) /
+                          BITCHAT_SEARCH_SIGNATURE_SIZE;
+            for(size_t i = 0; i < read; i++, position++) {
+                for(size_t bit = 0; bit < BITCHAT_SEARCH_SIGNATURE_BITS; bit++) {
+                    if(!(batch[i][bit / 8] & (1 << (bit % 8)))) {
+                        postings[bit * BITCHAT_SEARCH_POSTINGS_SIZE + position / 8] &=
+                            ~(1 << (position % 8));
+                    }
+                }
+            }
+            if(read < SEARCH_SIGNATURE_BATCH) break;
+        }
+        storage_file_close(file);
+    }
+
+    // Written aside and renamed so a reader never sees a partial file
+    search_path(temp_path, sizeof(temp_path), segment, "bit");
+    success = success &&
+              storage_file_open(file, temp_path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+              storage_file_write(
+                  file, postings, BITCHAT_SEARCH_SIGNATURE_BITS * BITCHAT_SEARCH_POSTINGS_SIZE) ==
+                  BITCHAT_SEARCH_SIGNATURE_BITS * BITCHAT_SEARCH_POSTINGS_SIZE;
+    storage_file_close(file);
+    storage_file_free(file);
+    bitchat_heap_free(postings);
+
+    if(success) {
+        search_path(path, sizeof(path), segment, "bix");
+        storage_common_remove(storage, path);
+        success = storage_common_rename(storage, temp_path, path) == FSE_OK;
+    }
+    if(!success) {
+        storage_common_remove(storage, temp_path);
+        BITCHAT_LOG_E(TAG, "Failed to index segment %lu", segment);
+    }
+    return success;
+}
+
+/**
+ * Allocate a search
+ */
+BitchatSearch* bitchat_search_alloc(BitchatHistory* history) {
+    furi_assert(history);
+
+    BitchatSearch* search = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatSearch));
+    memset(search, 0, sizeof(BitchatSearch));
+
+    search->history = history;
+    search->storage = furi_record_open(RECORD_STORAGE);
+    search->done = true;
+
+    return search;
+}
+
+/**
+ * Free a search
+ */
+void bitchat_search_free(BitchatSearch* search) {
+    furi_assert(search);
+
+    furi_record_close(RECORD_STORAGE);
+    bitchat_heap_free(search);
+}
+
+/**
+ * Start a new query
+ */
+void bitchat_search_start(BitchatSearch* search, const char* query) {
+    furi_assert(search);
+    furi_assert(query);
+
+    search->query_length = strnlen(query, BITCHAT_SEARCH_MAX_QUERY);
+    for(size_t i = 0; i < search->query_length; i++) {
+        search->query[i] = search_lower(query[i]);
+    }
+    search->query[search->query_length] = '\0';
+
+    bitchat_search_signature(search->query, search->query_length, search->query_signature);
+    search->term_count = 0;
+    for(size_t bit = 0; bit < BITCHAT_SEARCH_SIGNATURE_BITS && search->term_count < SEARCH_MAX_TERMS;
+        bit++) {
+        if(search->query_signature[bit / 8] & (1 << (bit % 8))) {
+            search->terms[search->term_count++] = bit;
+        }
+    }
+
+    search->end_seq = bitchat_history_count(search->history);
+    search->first_segment = bitchat_history_first(search->history) / BITCHAT_HISTORY_SEGMENT_RECORDS;
+    search->segment = search->end_seq > 0 ? (search->end_seq - 1) / BITCHAT_HISTORY_SEGMENT_RECORDS :
+                                            0;
+    search->loaded = false;
+    search->done = search->end_seq == 0;
+}
+
+/**
+ * Narrow the current segment to the records that can match
+ */
+static void search_load_segment(BitchatSearch* search) {
+    uint32_t records = BITCHAT_HISTORY_SEGMENT_RECORDS;
+    if(search->segment == search->end_seq / BITCHAT_HISTORY_SEGMENT_RECORDS) {
+        records = search->end_seq % BITCHAT_HISTORY_SEGMENT_RECORDS;
+    }
+    search->position = records - 1;
+
+    memset(search->candidates, 0, sizeof(search->candidates));
+    for(uint32_t position = 0; position < records; position++) {
+        search->candidates[position / 8] |= 1 << (position % 8);
+    }
+    if(search->term_count == 0) return;
+
+    char path[64];
+    File* file = storage_file_alloc(search->storage);
+
+    if(storage_file_open(
+           file, search_path(path, sizeof(path), search->segment, "bix"), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        // One bitmap read per term
+        uint8_t postings[BITCHAT_SEARCH_POSTINGS_SIZE];
+        for(size_t i = 0; i < search->term_count; i++) {
+            if(!storage_file_seek(file, search->terms[i] * BITCHAT_SEARCH_POSTINGS_SIZE, true) ||
+               storage_file_read(file, postings, sizeof(postings)) != sizeof(postings)) {
+                break;
+            }
+            for(size_t j = 0; j < sizeof(postings); j++) {
+                search->candidates[j] &= postings[j];
+            }
+        }
+        storage_file_close(file);
+    } else if(storage_file_open(
+                  file,
+                  search_path(path, sizeof(path), search->segment, "sig"),
+                  FSAM_READ,
+                  FSOM_OPEN_EXISTING)) {
+        // Not transposed yet: test each record's signature
+        uint8_t batch[SEARCH_SIGNATURE_BATCH][BITCHAT_SEARCH_SIGNATURE_SIZE];
+        uint32_t position = 0;
+        while(position < records) {
+            size_t read = storage_file_read(file, batch, sizeof(batch)) /
+                          BITCHAT_SEARCH_SIGNATURE_SIZE;
+            for(size_t i = 0; i < read && position < records; i++, position++) {
+                for(size_t j = 0; j < BITCHAT_SEARCH_SIGNATURE_SIZE; j++) {
+                    if((batch[i][j] & search->query_signature[j]) != search->query_signature[j]) {
+                        search->candidates[position / 8] &= ~(1 << (position % 8));
+                        break;
+                    }
+                }
+            }
+            if(read < SEARCH_SIGNATURE_BATCH) break;
+        }
+        storage_file_close(file);
+    }
+
+    storage_file_free(file);
+}
+
+/**
+ * Check a candidate record against the query text
+ */
+static void search_verify_callback(void* context, const BitchatHistoryRecord* record) {
+    BitchatSearch* search = context;
+
+    for(const char* start = record->content; *start; start++) {
+        size_t i = 0;
+        while(i < search->query_length && search_lower(start[i]) == search->query[i]) {
+            i++;
+        }
+        if(i == search->query_length) {
+            search->matched = true;
+            search->callback(search->callback_context, record);
+            return;
+        }
+    }
+}
+
+/**
+ * Find the next matches
+ */
+size_t bitchat_search_next(
+    BitchatSearch* search,
+    size_t max_results,
+    size_t max_segments,
+    BitchatHistoryCallback callback,
+    void* context) {
+    furi_assert(search);
+    furi_assert(callback);
+
+    search->callback = callback;
+    search->callback_context = context;
+    size_t found = 0;
+    size_t segments = 0;
+
+    while(found < max_results && !search->done) {
+        if(!search->loaded) {
+            if(max_segments > 0 && segments == max_segments) break;
+            search_load_segment(search);
+            search->loaded = true;
+            segments++;
+        }
+
+        while(found < max_results && search->position >= 0) {
+            uint32_t position = search->position--;
+            if(!(search->candidates[position / 8] & (1 << (position % 8)))) continue;
+
+            search->matched = false;
+            bitchat_history_read(
+                search->history,
+                search->segment * BITCHAT_HISTORY_SEGMENT_RECORDS + position,
+                1,
+                search_verify_callback,
+                search);
+            if(search->matched) found++;
+        }
+
+        if(search->position < 0) {
+            if(search->segment <= search->first_segment) {
+                search->done = true;
+            } else {
+                search->segment--;
+                search->loaded = false;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Check whether every record has been searched
+ */
+bool bitchat_search_is_done(BitchatSearch* search) {
+    furi_assert(search);
+    return search->done;
+}
@@ -0,0 +1,87 @@
+/**
+ * BitChat History Search
+ * Trigram index over message history
+ *
+ * Every record gets a signature of BITCHAT_SEARCH_SIGNATURE_BITS bits, one
+ * bit per hashed lowercase trigram of its text, appended to its segment's
+ * `.sig` file as it is written. Once a segment is sealed its signatures are
+ * transposed into a `.bix` file of per-bit postings: bitmap b holds the
+ * records whose signature has bit b set. A query then reads one 32-byte
+ * bitmap per distinct trigram of the query for each segment, ANDs them, and
+ * reads only the candidate records, which are checked against the query
+ * text. Sealed segments not yet transposed fall back to their `.sig` file,
+ * and records with no signature are always candidates.
+ *
+ * Results come newest first, a page at a time.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bitchat_history.h"
+
+#define BITCHAT_SEARCH_SIGNATURE_BITS 128
+#define BITCHAT_SEARCH_SIGNATURE_SIZE (BITCHAT_SEARCH_SIGNATURE_BITS / 8)
+#define BITCHAT_SEARCH_POSTINGS_SIZE (BITCHAT_HISTORY_SEGMENT_RECORDS / 8)
+#define BITCHAT_SEARCH_MAX_QUERY 31
+
+typedef struct BitchatSearch BitchatSearch;
+typedef struct Storage Storage;
+
+/**
+ * Compute the trigram signature of a text
+ * @param text Text, not necessarily NUL-terminated
+ * @param length Text length
+ * @param signature Output (BITCHAT_SEARCH_SIGNATURE_SIZE bytes)
+ */
+void bitchat_search_signature(const char* text, size_t length, uint8_t* signature);
+
+/**
+ * Transpose a sealed segment's signatures into postings
+ * Blocks on SD I/O; for background threads.
+ * @param storage Storage record
+ * @param segment Sealed segment
+ * @return true if the postings file was written
+ */
+bool bitchat_search_index_segment(Storage* storage, uint32_t segment);
+
+/**
+ * Allocate a search over a history
+ */
+BitchatSearch* bitchat_search_alloc(BitchatHistory* history);
+
+/**
+ * Free a search
+ */
+void bitchat_search_free(BitchatSearch* search);
+
+/**
+ * Start a new query from the newest record
+ * Matching is case-insensitive for ASCII.
+ */
+void bitchat_search_start(BitchatSearch* search, const char* query);
+
+/**
+ * Find the next matches, newest first
+ * Stops at max_results matches or after max_segments segments, so the SD
+ * time of one call stays bounded; call again to continue.
+ * @param search Search instance
+ * @param max_results Maximum matches to return
+ * @param max_segments Maximum segments to start searching, 0 for no limit
+ * @param callback Called once per match
+ * @param context Callback context
+ * @return Number of matches found
+ */
+size_t bitchat_search_next(
+    BitchatSearch* search,
+    size_t max_results,
+    size_t max_segments,
+    BitchatHistoryCallback callback,
+    void* context);
+
+/**
+ * Check whether every record has been searched
+ */
+bool bitchat_search_is_done(BitchatSearch* search);
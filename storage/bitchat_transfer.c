@@ -0,0 +1,612 @@
+/**
+ * BitChat Bulk Transfer Implementation
+ */
+
+#include "bitchat_transfer.h"
+#include "bitchat_writer.h"
+#include "../ble/bitchat_ble.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <furi_hal.h>
+#include <storage/storage.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TAG "BitchatTransfer"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+
+// Incoming transfers with no chunk for this long are abandoned
+#define TRANSFER_RECEIVE_IDLE_MS (BITCHAT_TRANSFER_RETRY_MS * BITCHAT_TRANSFER_MAX_RETRIES * 2)
+// Later chunks seen past a hole before it is resent without waiting for the timer
+#define TRANSFER_FAST_RETRANSMIT_SACKS 3
+
+#define TRANSFER_PACKET_BUFFER_SIZE                                          \
+    (BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE + BITCHAT_RECIPIENT_ID_SIZE + \
+     BITCHAT_TRANSFER_DATA_HEADER_SIZE + BITCHAT_TRANSFER_CHUNK_SIZE)
+
+/**
+ * Sender state of one in-flight chunk, indexed by chunk % BITCHAT_TRANSFER_WINDOW
+ */
+typedef struct {
+    uint32_t sent_tick;
+    uint8_t retries;
+    bool acked;
+} TransferChunk;
+
+struct BitchatTransfer {
+    BitchatBle* ble;
+    BitchatWriter* writer;
+    Storage* storage;
+    FuriMutex* mutex;
+    uint8_t local_peer_id[8];
+
+    // Outgoing
+    BitchatTransferStatus send;
+    File* send_file;
+    uint32_t send_chunk_count;
+    uint32_t send_base; // Oldest unacknowledged chunk
+    uint32_t send_next; // Next chunk never sent
+    TransferChunk window[BITCHAT_TRANSFER_WINDOW];
+
+    // Incoming
+    BitchatTransferStatus receive;
+    bool receive_open;
+    uint32_t receive_pending; // Chunk writes staged but not yet on the card
+    uint32_t receive_chunk_count;
+    uint32_t receive_next; // Next chunk expected in order
+    uint32_t receive_sack; // Bit i: chunk receive_next + 1 + i already written
+    uint32_t receive_tick;
+    char receive_path[64];
+
+    // One packet at a time is built here, header and chunk together
+    uint8_t packet_buffer[TRANSFER_PACKET_BUFFER_SIZE];
+};
+
+static void encode_u16_be(uint8_t* buf, uint16_t value) {
+    buf[0] = (value >> 8) & 0xFF;
+    buf[1] = value & 0xFF;
+}
+
+static uint16_t decode_u16_be(const uint8_t* buf) {
+    return ((uint16_t)buf[0] << 8) | buf[1];
+}
+
+static void encode_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+static uint32_t decode_u32_be(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) |
+           buf[3];
+}
+
+/**
+ * Allocate the transfer engine
+ */
+BitchatTransfer*
+    bitchat_transfer_alloc(BitchatBle* ble, BitchatWriter* writer, const uint8_t* local_peer_id) {
+    furi_assert(ble);
+    furi_assert(writer);
+    furi_assert(local_peer_id);
+
+    BitchatTransfer* transfer = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatTransfer));
+    memset(transfer, 0, sizeof(BitchatTransfer));
+
+    transfer->ble = ble;
+    transfer->writer = writer;
+    transfer->storage = furi_record_open(RECORD_STORAGE);
+    transfer->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    memcpy(transfer->local_peer_id, local_peer_id, 8);
+
+    // Created up front so receiving never touches the card directly
+    storage_common_mkdir(transfer->storage, APP_DATA_PATH("bitchat"));
+    storage_common_mkdir(transfer->storage, BITCHAT_TRANSFER_DIR);
+
+    return transfer;
+}
+
+static void transfer_close_send_locked(BitchatTransfer* transfer, BitchatTransferState state) {
+    if(transfer->send_file) {
+        storage_file_close(transfer->send_file);
+        storage_file_free(transfer->send_file);
+        transfer->send_file = NULL;
+    }
+    transfer->send.state = state;
+}
+
+static void transfer_close_receive_locked(BitchatTransfer* transfer, BitchatTransferState state) {
+    if(transfer->receive_open) {
+        transfer->receive_open = false;
+
+        // Don't leave a file with holes behind; staged after the chunk writes
+        if(state != BitchatTransferStateComplete &&
+           !bitchat_writer_remove(transfer->writer, transfer->receive_path, NULL, NULL)) {
+            BITCHAT_LOG_E(TAG, "Failed to stage removal of %s", transfer->receive_path);
+        }
+    }
+    transfer->receive.state = state;
+}
+
+/**
+ * Free the transfer engine
+ */
+void bitchat_transfer_free(BitchatTransfer* transfer) {
+    furi_assert(transfer);
+
+    transfer_close_send_locked(transfer, BitchatTransferStateIdle);
+    transfer_close_receive_locked(transfer, BitchatTransferStateIdle);
+
+    // Chunk write callbacks still pending refer to this instance
+    bitchat_writer_flush(transfer->writer, true);
+
+    furi_mutex_free(transfer->mutex);
+    furi_record_close(RECORD_STORAGE);
+    bitchat_heap_free(transfer);
+}
+
+/**
+ * Encode a transfer packet header into packet_buffer
+ * @return Pointer to the payload area, or NULL on error
+ */
+static uint8_t* transfer_begin_packet_locked(
+    BitchatTransfer* transfer,
+    uint8_t type,
+    const uint8_t* peer_id,
+    size_t payload_length,
+    size_t* packet_size) {
+    BitchatPacket packet = {0};
+    packet.version = BITCHAT_VERSION;
+    packet.type = type;
+    packet.ttl = BITCHAT_TRANSFER_TTL;
+    packet.timestamp = bitchat_get_timestamp_ms();
+    packet.payload_length = payload_length;
+    packet.has_recipient = true;
+    memcpy(packet.sender_id, transfer->local_peer_id, 8);
+    memcpy(packet.recipient_id, peer_id, 8);
+
+    *packet_size =
+        bitchat_packet_encode(&packet, transfer->packet_buffer, sizeof(transfer->packet_buffer));
+    if(*packet_size == 0) return NULL;
+    return &transfer->packet_buffer[*packet_size - payload_length];
+}
+
+/**
+ * Read one chunk from the file and send it
+ */
+static bool transfer_send_chunk_locked(BitchatTransfer* transfer, uint32_t index) {
+    uint32_t offset = index * BITCHAT_TRANSFER_CHUNK_SIZE;
+    size_t length = transfer->send.total_size - offset;
+    if(length > BITCHAT_TRANSFER_CHUNK_SIZE) length = BITCHAT_TRANSFER_CHUNK_SIZE;
+
+    size_t packet_size;
+    uint8_t* payload = transfer_begin_packet_locked(
+        transfer,
+        BITCHAT_PACKET_TYPE_TRANSFER_DATA,
+        transfer->send.peer_id,
+        BITCHAT_TRANSFER_DATA_HEADER_SIZE + length,
+        &packet_size);
+    if(!payload) return false;
+
+    encode_u32_be(&payload[0], transfer->send.transfer_id);
+    encode_u16_be(&payload[4], index);
+    encode_u32_be(&payload[6], transfer->send.total_size);
+
+    // Chunks are read straight into the packet; retransmissions re-read them
+    if(!storage_file_seek(transfer->send_file, offset, true) ||
+       storage_file_read(
+           transfer->send_file, &payload[BITCHAT_TRANSFER_DATA_HEADER_SIZE], length) != length) {
+        BITCHAT_LOG_E(TAG, "Failed to read chunk %lu", index);
+        return false;
+    }
+
+    TransferChunk* chunk = &transfer->window[index % BITCHAT_TRANSFER_WINDOW];
+    chunk->sent_tick = furi_get_tick();
+
+    bitchat_ble_send_to_peer(
+        transfer->ble, transfer->send.peer_id, transfer->packet_buffer, packet_size);
+    return true;
+}
+
+/**
+ * Send new chunks while the window has room
+ */
+static void transfer_pump_locked(BitchatTransfer* transfer) {
+    while(transfer->send_next < transfer->send_chunk_count &&
+          transfer->send_next < transfer->send_base + BITCHAT_TRANSFER_WINDOW) {
+        TransferChunk* chunk = &transfer->window[transfer->send_next % BITCHAT_TRANSFER_WINDOW];
+        chunk->acked = false;
+        chunk->retries = 0;
+
+        if(!transfer_send_chunk_locked(transfer, transfer->send_next)) {
+            transfer_close_send_locked(transfer, BitchatTransferStateFailed);
+            return;
+        }
+        transfer->send_next++;
+    }
+}
+
+/**
+ * Start sending a file
+ */
+bool bitchat_transfer_send_file(BitchatTransfer* transfer, const uint8_t* peer_id, const char* path) {
+    furi_assert(transfer);
+    furi_assert(peer_id);
+    furi_assert(path);
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+
+    if(transfer->send.state == BitchatTransferStateActive) {
+        BITCHAT_LOG_W(TAG, "Transfer already in progress");
+        furi_mutex_release(transfer->mutex);
+        return false;
+    }
+
+    File* file = storage_file_alloc(transfer->storage);
+    if(!storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        BITCHAT_LOG_E(TAG, "Failed to open %s", path);
+        storage_file_free(file);
+        furi_mutex_release(transfer->mutex);
+        return false;
+    }
+
+    uint64_t size = storage_file_size(file);
+    uint64_t chunk_count = (size + BITCHAT_TRANSFER_CHUNK_SIZE - 1) / BITCHAT_TRANSFER_CHUNK_SIZE;
+    if(size == 0 || chunk_count > BITCHAT_TRANSFER_MAX_CHUNKS) {
+        BITCHAT_LOG_E(TAG, "Cannot send %s: %lu bytes", path, (uint32_t)size);
+        storage_file_close(file);
+        storage_file_free(file);
+        furi_mutex_release(transfer->mutex);
+        return false;
+    }
+
+    memset(&transfer->send, 0, sizeof(transfer->send));
+    transfer->send.state = BitchatTransferStateActive;
+    transfer->send.transfer_id = furi_hal_random_get();
+    memcpy(transfer->send.peer_id, peer_id, 8);
+    transfer->send.total_size = size;
+    transfer->send_file = file;
+    transfer->send_chunk_count = chunk_count;
+    transfer->send_base = 0;
+    transfer->send_next = 0;
+
+    BITCHAT_LOG_I(TAG, "Sending %s: %lu bytes in %lu chunks", path, (uint32_t)size, (uint32_t)chunk_count);
+    transfer_pump_locked(transfer);
+
+    furi_mutex_release(transfer->mutex);
+    return true;
+}
+
+/**
+ * Process an acknowledgement of our outgoing transfer
+ */
+static void transfer_handle_ack_locked(
+    BitchatTransfer* transfer,
+    const uint8_t* sender_id,
+    const uint8_t* payload,
+    size_t size) {
+    if(size < BITCHAT_TRANSFER_ACK_SIZE || transfer->send.state != BitchatTransferStateActive ||
+       decode_u32_be(&payload[0]) != transfer->send.transfer_id ||
+       memcmp(sender_id, transfer->send.peer_id, 8) != 0) {
+        return;
+    }
+
+    uint32_t cumulative = decode_u16_be(&payload[4]);
+    uint32_t sack = decode_u32_be(&payload[6]);
+    if(cumulative < transfer->send_base || cumulative > transfer->send_next) return;
+
+    for(uint32_t i = transfer->send_base; i < cumulative; i++) {
+        transfer->window[i % BITCHAT_TRANSFER_WINDOW].acked = true;
+    }
+
+    size_t sacked = 0;
+    for(uint32_t bit = 0; bit < BITCHAT_TRANSFER_SACK_BITS; bit++) {
+        uint32_t index = cumulative + 1 + bit;
+        if(index >= transfer->send_next) break;
+        if(sack & (1UL << bit)) {
+            transfer->window[index % BITCHAT_TRANSFER_WINDOW].acked = true;
+            sacked++;
+        }
+    }
+
+    while(transfer->send_base < transfer->send_next &&
+          transfer->window[transfer->send_base % BITCHAT_TRANSFER_WINDOW].acked) {
+        transfer->send_base++;
+    }
+
+    uint32_t done = transfer->send_base * BITCHAT_TRANSFER_CHUNK_SIZE;
+    transfer->send.bytes_done = done < transfer->send.total_size ? done : transfer->send.total_size;
+
+    if(transfer->send_base == transfer->send_chunk_count) {
+        BITCHAT_LOG_I(TAG, "Transfer %08lX sent", transfer->send.transfer_id);
+        transfer_close_send_locked(transfer, BitchatTransferStateComplete);
+        return;
+    }
+
+    // Later chunks got through but the oldest didn't: resend it now, once
+    TransferChunk* oldest = &transfer->window[transfer->send_base % BITCHAT_TRANSFER_WINDOW];
+    if(sacked >= TRANSFER_FAST_RETRANSMIT_SACKS && oldest->retries == 0) {
+        oldest->retries++;
+        transfer->send.retransmissions++;
+        if(!transfer_send_chunk_locked(transfer, transfer->send_base)) {
+            transfer_close_send_locked(transfer, BitchatTransferStateFailed);
+            return;
+        }
+    }
+
+    transfer_pump_locked(transfer);
+}
+
+/**
+ * Acknowledge everything received so far
+ */
+static void transfer_send_ack_locked(BitchatTransfer* transfer) {
+    size_t packet_size;
+    uint8_t* payload = transfer_begin_packet_locked(
+        transfer,
+        BITCHAT_PACKET_TYPE_TRANSFER_ACK,
+        transfer->receive.peer_id,
+        BITCHAT_TRANSFER_ACK_SIZE,
+        &packet_size);
+    if(!payload) return;
+
+    encode_u32_be(&payload[0], transfer->receive.transfer_id);
+    encode_u16_be(&payload[4], transfer->receive_next);
+    encode_u32_be(&payload[6], transfer->receive_sack);
+
+    bitchat_ble_send_to_peer(
+        transfer->ble, transfer->receive.peer_id, transfer->packet_buffer, packet_size);
+}
+
+/**
+ * Open the destination file for a new incoming transfer
+ */
+static bool transfer_start_receive_locked(
+    BitchatTransfer* transfer,
+    const uint8_t* sender_id,
+    uint32_t transfer_id,
+    uint32_t total_size) {
+    uint32_t chunk_count =
+        (total_size + BITCHAT_TRANSFER_CHUNK_SIZE - 1) / BITCHAT_TRANSFER_CHUNK_SIZE;
+    if(total_size == 0 || chunk_count > BITCHAT_TRANSFER_MAX_CHUNKS) return false;
+
+    snprintf(
+        transfer->receive_path,
+        sizeof(transfer->receive_path),
+        BITCHAT_TRANSFER_DIR "/%02x%02x%02x%02x_%08lx.bin",
+        sender_id[0],
+        sender_id[1],
+        sender_id[2],
+        sender_id[3],
+        transfer_id);
+
+    // Truncate any earlier file of the same name before the chunks land
+    if(!bitchat_writer_replace(transfer->writer, transfer->receive_path, NULL, 0, NULL, NULL)) {
+        BITCHAT_LOG_E(TAG, "Failed to create %s", transfer->receive_path);
+        return false;
+    }
+
+    memset(&transfer->receive, 0, sizeof(transfer->receive));
+    transfer->receive.state = BitchatTransferStateActive;
+    transfer->receive.transfer_id = transfer_id;
+    memcpy(transfer->receive.peer_id, sender_id, 8);
+    transfer->receive.total_size = total_size;
+    transfer->receive_open = true;
+    transfer->receive_chunk_count = chunk_count;
+    transfer->receive_next = 0;
+    transfer->receive_sack = 0;
+
+    BITCHAT_LOG_I(TAG, "Receiving %lu bytes into %s", total_size, transfer->receive_path);
+    return true;
+}
+
+/**
+ * Chunk write finished on the writer thread
+ * A failed write loses data that was already acknowledged, so the
+ * transfer fails even if every chunk has arrived.
+ */
+static void transfer_write_callback(void* context, bool success) {
+    BitchatTransfer* transfer = context;
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+
+    transfer->receive_pending--;
+    if(!success && transfer->receive.state == BitchatTransferStateActive) {
+        BITCHAT_LOG_E(TAG, "Failed to write transfer %08lX", transfer->receive.transfer_id);
+        transfer_close_receive_locked(transfer, BitchatTransferStateFailed);
+    } else if(!success && transfer->receive.state == BitchatTransferStateComplete) {
+        BITCHAT_LOG_E(TAG, "Failed to write transfer %08lX", transfer->receive.transfer_id);
+        bitchat_writer_remove(transfer->writer, transfer->receive_path, NULL, NULL);
+        transfer->receive.state = BitchatTransferStateFailed;
+    }
+
+    furi_mutex_release(transfer->mutex);
+}
+
+/**
+ * Stage a received chunk at its offset and acknowledge it
+ */
+static void transfer_handle_data_locked(
+    BitchatTransfer* transfer,
+    const uint8_t* sender_id,
+    const uint8_t* payload,
+    size_t size) {
+    if(size <= BITCHAT_TRANSFER_DATA_HEADER_SIZE) return;
+
+    uint32_t transfer_id = decode_u32_be(&payload[0]);
+    uint32_t index = decode_u16_be(&payload[4]);
+    uint32_t total_size = decode_u32_be(&payload[6]);
+    const uint8_t* data = &payload[BITCHAT_TRANSFER_DATA_HEADER_SIZE];
+    size_t length = size - BITCHAT_TRANSFER_DATA_HEADER_SIZE;
+    uint32_t now = furi_get_tick();
+
+    bool same = transfer->receive.transfer_id == transfer_id &&
+                memcmp(transfer->receive.peer_id, sender_id, 8) == 0;
+    if(!same) {
+        // One incoming transfer at a time; a silent one is given up on. Writes
+        // of the previous one must land first so its failures can't be
+        // mistaken for this one's
+        if(transfer->receive_pending > 0 ||
+           (transfer->receive.state == BitchatTransferStateActive &&
+            now - transfer->receive_tick < furi_ms_to_ticks(TRANSFER_RECEIVE_IDLE_MS))) {
+            BITCHAT_LOG_W(TAG, "Busy, dropping chunk of transfer %08lX", transfer_id);
+            return;
+        }
+        transfer_close_receive_locked(transfer, BitchatTransferStateIdle);
+        if(!transfer_start_receive_locked(transfer, sender_id, transfer_id, total_size)) {
+            return;
+        }
+    } else if(transfer->receive.state != BitchatTransferStateActive) {
+        // Our last ack got lost; repeat it so the sender can finish
+        if(transfer->receive.state == BitchatTransferStateComplete) {
+            transfer_send_ack_locked(transfer);
+        }
+        return;
+    }
+
+    transfer->receive_tick = now;
+
+    uint32_t offset = index * BITCHAT_TRANSFER_CHUNK_SIZE;
+    size_t expected = 0;
+    if(index < transfer->receive_chunk_count) {
+        expected = total_size - offset;
+        if(expected > BITCHAT_TRANSFER_CHUNK_SIZE) expected = BITCHAT_TRANSFER_CHUNK_SIZE;
+    }
+    if(total_size != transfer->receive.total_size || length != expected) {
+        BITCHAT_LOG_W(TAG, "Malformed chunk %lu", index);
+        return;
+    }
+
+    bool duplicate = index < transfer->receive_next;
+    if(index > transfer->receive_next) {
+        uint32_t bit = index - transfer->receive_next - 1;
+        if(bit >= BITCHAT_TRANSFER_SACK_BITS) return;
+        duplicate = transfer->receive_sack & (1UL << bit);
+    }
+
+    if(!duplicate) {
+        // Out-of-order chunks extend the file; the gap is filled when they
+        // arrive. With the staging buffer full the chunk goes unacknowledged
+        // and the sender's retransmission tries again.
+        if(!bitchat_writer_write_at(
+               transfer->writer,
+               transfer->receive_path,
+               offset,
+               data,
+               length,
+               transfer_write_callback,
+               transfer)) {
+            BITCHAT_LOG_W(TAG, "Deferring chunk %lu", index);
+            return;
+        }
+        transfer->receive_pending++;
+
+        if(index == transfer->receive_next) {
+            transfer->receive_next++;
+            while(transfer->receive_sack & 1) {
+                transfer->receive_sack >>= 1;
+                transfer->receive_next++;
+            }
+            transfer->receive_sack >>= 1;
+        } else {
+            transfer->receive_sack |= 1UL << (index - transfer->receive_next - 1);
+        }
+
+        uint32_t done = transfer->receive_next * BITCHAT_TRANSFER_CHUNK_SIZE;
+        transfer->receive.bytes_done = done < total_size ? done : total_size;
+    }
+
+    if(transfer->receive_next == transfer->receive_chunk_count) {
+        BITCHAT_LOG_I(TAG, "Transfer %08lX received", transfer_id);
+        transfer_close_receive_locked(transfer, BitchatTransferStateComplete);
+    }
+
+    transfer_send_ack_locked(transfer);
+}
+
+/**
+ * Handle a TRANSFER_DATA or TRANSFER_ACK packet addressed to us
+ */
+bool bitchat_transfer_handle_packet(BitchatTransfer* transfer, const BitchatPacket* packet) {
+    furi_assert(transfer);
+    furi_assert(packet);
+
+    if(packet->type != BITCHAT_PACKET_TYPE_TRANSFER_DATA &&
+       packet->type != BITCHAT_PACKET_TYPE_TRANSFER_ACK) {
+        return false;
+    }
+    if(!packet->payload) return true;
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+
+    if(packet->type == BITCHAT_PACKET_TYPE_TRANSFER_DATA) {
+        transfer_handle_data_locked(
+            transfer, packet->sender_id, packet->payload, packet->payload_length);
+    } else {
+        transfer_handle_ack_locked(
+            transfer, packet->sender_id, packet->payload, packet->payload_length);
+    }
+
+    furi_mutex_release(transfer->mutex);
+    return true;
+}
+
+/**
+ * Retransmit chunks whose acknowledgement is overdue
+ */
+void bitchat_transfer_tick(BitchatTransfer* transfer) {
+    furi_assert(transfer);
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+
+    uint32_t now = furi_get_tick();
+    for(uint32_t i = transfer->send_base;
+        transfer->send.state == BitchatTransferStateActive && i < transfer->send_next;
+        i++) {
+        TransferChunk* chunk = &transfer->window[i % BITCHAT_TRANSFER_WINDOW];
+        if(chunk->acked || now - chunk->sent_tick < furi_ms_to_ticks(BITCHAT_TRANSFER_RETRY_MS)) {
+            continue;
+        }
+
+        if(chunk->retries >= BITCHAT_TRANSFER_MAX_RETRIES) {
+            BITCHAT_LOG_W(TAG, "Transfer %08lX timed out at chunk %lu", transfer->send.transfer_id, i);
+            transfer_close_send_locked(transfer, BitchatTransferStateFailed);
+            break;
+        }
+
+        chunk->retries++;
+        transfer->send.retransmissions++;
+        if(!transfer_send_chunk_locked(transfer, i)) {
+            transfer_close_send_locked(transfer, BitchatTransferStateFailed);
+        }
+    }
+
+    furi_mutex_release(transfer->mutex);
+}
+
+/**
+ * Get progress of the outgoing transfer
+ */
+void bitchat_transfer_get_send_status(BitchatTransfer* transfer, BitchatTransferStatus* status) {
+    furi_assert(transfer);
+    furi_assert(status);
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+    *status = transfer->send;
+    furi_mutex_release(transfer->mutex);
+}
+
+/**
+ * Get progress of the incoming transfer
+ */
+void bitchat_transfer_get_receive_status(BitchatTransfer* transfer, BitchatTransferStatus* status) {
+    furi_assert(transfer);
+    furi_assert(status);
+
+    furi_mutex_acquire(transfer->mutex, FuriWaitForever);
+    *status = transfer->receive;
+    furi_mutex_release(transfer->mutex);
+}
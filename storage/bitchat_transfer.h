@@ -0,0 +1,109 @@
+/**
+ * BitChat Bulk Transfer
+ * Streams files between peers in chunks, straight from and to SD card
+ *
+ * A file is sent as BITCHAT_PACKET_TYPE_TRANSFER_DATA packets of one chunk
+ * each; the BLE layer fragments them further. Up to BITCHAT_TRANSFER_WINDOW
+ * chunks are outstanding at once. The receiver answers every chunk with a
+ * BITCHAT_PACKET_TYPE_TRANSFER_ACK carrying its cumulative position and a
+ * selective-acknowledgement bitmap, so only chunks that were actually lost
+ * are resent. Neither side buffers more than one chunk: the sender re-reads
+ * chunks from the file for retransmission and the receiver hands each chunk
+ * to the storage writer, acknowledging it once staged. A chunk that does not
+ * fit in the writer's staging buffer is left unacknowledged and resent.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../protocol/bitchat_protocol.h"
+
+typedef struct BitchatBle BitchatBle;
+typedef struct BitchatWriter BitchatWriter;
+
+#define BITCHAT_TRANSFER_CHUNK_SIZE 1024
+#define BITCHAT_TRANSFER_WINDOW 8
+// Chunks past the cumulative ack the receiver tracks (>= BITCHAT_TRANSFER_WINDOW)
+#define BITCHAT_TRANSFER_SACK_BITS 32
+#define BITCHAT_TRANSFER_RETRY_MS 1500
+#define BITCHAT_TRANSFER_MAX_RETRIES 8
+#define BITCHAT_TRANSFER_MAX_CHUNKS 0xFFFF
+#define BITCHAT_TRANSFER_TTL 7
+#define BITCHAT_TRANSFER_DIR APP_DATA_PATH("bitchat") "/transfers"
+
+// transfer id (4) | chunk index (2) | total size (4) | chunk data
+#define BITCHAT_TRANSFER_DATA_HEADER_SIZE 10
+// transfer id (4) | next expected chunk (2) | SACK bitmap (4)
+#define BITCHAT_TRANSFER_ACK_SIZE 10
+
+typedef struct BitchatTransfer BitchatTransfer;
+
+typedef enum {
+    BitchatTransferStateIdle,
+    BitchatTransferStateActive,
+    BitchatTransferStateComplete,
+    BitchatTransferStateFailed,
+} BitchatTransferState;
+
+/**
+ * Progress of one direction
+ */
+typedef struct {
+    BitchatTransferState state;
+    uint32_t transfer_id;
+    uint8_t peer_id[8];
+    uint32_t total_size;
+    uint32_t bytes_done; // Acknowledged (sending) or written in order (receiving)
+    uint32_t retransmissions;
+} BitchatTransferStatus;
+
+/**
+ * Allocate the transfer engine
+ * @param ble BLE service used to send chunks and acks
+ * @param writer Storage writer that received chunks go through
+ * @param local_peer_id Our peer ID (8 bytes)
+ * @return Transfer engine instance
+ */
+BitchatTransfer*
+    bitchat_transfer_alloc(BitchatBle* ble, BitchatWriter* writer, const uint8_t* local_peer_id);
+
+/**
+ * Free the transfer engine, abandoning any transfer in progress
+ */
+void bitchat_transfer_free(BitchatTransfer* transfer);
+
+/**
+ * Start sending a file
+ * Only one outgoing transfer runs at a time.
+ * @param transfer Transfer engine
+ * @param peer_id Recipient (8 bytes)
+ * @param path File to send
+ * @return false if a transfer is already running or the file cannot be opened
+ */
+bool bitchat_transfer_send_file(BitchatTransfer* transfer, const uint8_t* peer_id, const char* path);
+
+/**
+ * Handle a TRANSFER_DATA or TRANSFER_ACK packet addressed to us
+ * Chunks are written under BITCHAT_TRANSFER_DIR, named by sender and transfer id.
+ * @return true if the packet was a transfer packet
+ */
+bool bitchat_transfer_handle_packet(BitchatTransfer* transfer, const BitchatPacket* packet);
+
+/**
+ * Retransmit chunks whose acknowledgement is overdue
+ * Call periodically, e.g. every few hundred ms, while a transfer is active.
+ * New chunks are clocked out by incoming acks and need no tick.
+ */
+void bitchat_transfer_tick(BitchatTransfer* transfer);
+
+/**
+ * Get progress of the outgoing transfer
+ */
+void bitchat_transfer_get_send_status(BitchatTransfer* transfer, BitchatTransferStatus* status);
+
+/**
+ * Get progress of the incoming transfer
+ */
+void bitchat_transfer_get_receive_status(BitchatTransfer* transfer, BitchatTransferStatus* status);
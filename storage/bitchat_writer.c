@@ -0,0 +1,571 @@
+/**
+ * BitChat Storage Writer Implementation
+ */
+
+#include "bitchat_writer.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+
+#define TAG "BitchatWriter"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_STORAGE
+#define WRITER_STACK_SIZE 2048
+#define WRITER_FLAG_WAKE (1UL << 0)
+#define WRITER_FLAG_DONE (1UL << 23) // Set on a flush waiter's own thread
+#define WRITER_WAIT_POLL_MS 100
+
+typedef enum {
+    WriterOpAppend,
+    WriterOpReplace,
+    WriterOpWriteAt,
+    WriterOpRemove,
+} WriterOp;
+
+/**
+ * Entry header, stored at the top of a staging buffer just above its path
+ * Data grows up from the bottom of the buffer and headers grow down from
+ * the top, so the data of consecutive appends is contiguous.
+ */
+typedef struct {
+    uint32_t data_offset;
+    uint32_t file_offset; // WriterOpWriteAt only
+    uint32_t enqueue_tick;
+    BitchatWriterCallback callback;
+    void* context;
+    uint16_t size;
+    uint8_t op;
+    uint8_t path_length;
+} WriterEntry;
+
+typedef struct {
+    uint8_t* data;
+    size_t data_used;
+    size_t header_used;
+    size_t entry_count;
+    size_t last_entry; // Offset of the newest entry header
+} WriterBuffer;
+
+struct BitchatWriter {
+    Storage* storage;
+    FuriMutex* mutex;
+    FuriThread* thread;
+    bool running;
+
+    uint8_t memory[2][BITCHAT_WRITER_STAGING_SIZE];
+    WriterBuffer staging;
+    uint8_t* spare; // The other buffer, free once the thread has written it
+    WriterBuffer writing; // Buffer being written; no entries when idle
+    uint32_t oldest_tick;
+    bool flush_requested;
+
+    // Entries staged and finished so far, for flush waiters
+    uint32_t staged_total;
+    uint32_t done_total;
+    FuriThreadId waiter;
+
+    BitchatWriterStats stats;
+};
+
+static size_t writer_histogram_bucket(uint32_t ms) {
+    size_t bucket = 0;
+    while(ms > 1 && bucket < BITCHAT_WRITER_HISTOGRAM_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static uint32_t writer_elapsed_ms(uint32_t since) {
+    return (furi_get_tick() - since) * 1000 / furi_kernel_get_tick_frequency();
+}
+
+/**
+ * Read the entry header below top and its path, moving top past both
+ */
+static void writer_get_entry(
+    const WriterBuffer* buffer,
+    size_t* top,
+    WriterEntry* entry,
+    const char** path) {
+    *top -= sizeof(WriterEntry);
+    memcpy(entry, &buffer->data[*top], sizeof(WriterEntry));
+    *top -= entry->path_length;
+    *path = (const char*)&buffer->data[*top];
+}
+
+/**
+ * Write one swapped-out buffer and run its callbacks
+ */
+static void writer_write_buffer(BitchatWriter* writer, WriterBuffer* buffer) {
+    File* file = storage_file_alloc(writer->storage);
+    uint32_t batch_start = furi_get_tick();
+    size_t top = BITCHAT_WRITER_STAGING_SIZE;
+    size_t index = 0;
+    size_t bytes = 0;
+    size_t errors = 0;
+
+    while(index < buffer->entry_count) {
+        size_t entry_top = top;
+        WriterEntry first;
+        const char* path;
+        writer_get_entry(buffer, &top, &first, &path);
+
+        // Merge following appends to the same file: their data is contiguous
+        size_t run_top = top;
+        size_t run_count = 1;
+        size_t run_size = first.size;
+        while(first.op == WriterOpAppend && index + run_count < buffer->entry_count) {
+            size_t next_top = run_top;
+            WriterEntry next;
+            const char* next_path;
+            writer_get_entry(buffer, &next_top, &next, &next_path);
+            if(next.op != WriterOpAppend || next.path_length != first.path_length ||
+               memcmp(next_path, path, first.path_length) != 0) {
+                break;
+            }
+            run_top = next_top;
+            run_size += next.size;
+            run_count++;
+        }
+
+        char file_path[BITCHAT_WRITER_MAX_PATH + 1];
+        memcpy(file_path, path, first.path_length);
+        file_path[first.path_length] = '\0';
+
+        bool success;
+        if(first.op == WriterOpRemove) {
+            FS_Error error = storage_common_remove(writer->storage, file_path);
+            success = error == FSE_OK || error == FSE_NOT_EXIST;
+        } else {
+            FS_OpenMode mode = first.op == WriterOpAppend  ? FSOM_OPEN_APPEND :
+                               first.op == WriterOpWriteAt ? FSOM_OPEN_ALWAYS :
+                                                             FSOM_CREATE_ALWAYS;
+            success = storage_file_open(file, file_path, FSAM_WRITE, mode);
+            if(success) {
+                if(first.op == WriterOpWriteAt) {
+                    success = storage_file_seek(file, first.file_offset, true);
+                }
+                success = success &&
+                          storage_file_write(file, &buffer->data[first.data_offset], run_size) ==
+                              run_size;
+                storage_file_close(file);
+            }
+        }
+        if(success) {
+            bytes += run_size;
+        } else {
+            BITCHAT_LOG_E(TAG, "Failed to write %s", file_path);
+            errors += run_count;
+        }
+
+        // The file is closed: every entry in the run is durable
+        for(size_t i = 0; i < run_count; i++) {
+            WriterEntry entry;
+            const char* entry_path;
+            writer_get_entry(buffer, &entry_top, &entry, &entry_path);
+
+            furi_mutex_acquire(writer->mutex, FuriWaitForever);
+            writer->stats.latency_histogram[writer_histogram_bucket(
+                writer_elapsed_ms(entry.enqueue_tick))]++;
+            furi_mutex_release(writer->mutex);
+
+            if(entry.callback) {
+                entry.callback(entry.context, success);
+            }
+        }
+
+        top = run_top;
+        index += run_count;
+    }
+
+    storage_file_free(file);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    writer->stats.batches++;
+    writer->stats.bytes_written += bytes;
+    writer->stats.errors += errors;
+    writer->stats.write_histogram[writer_histogram_bucket(writer_elapsed_ms(batch_start))]++;
+    writer->done_total += buffer->entry_count;
+    writer->spare = buffer->data;
+    memset(&writer->writing, 0, sizeof(WriterBuffer));
+    if(writer->waiter) {
+        furi_thread_flags_set(writer->waiter, WRITER_FLAG_DONE);
+    }
+    furi_mutex_release(writer->mutex);
+}
+
+/**
+ * Writer thread: sleep until a flush is due, then write the staged buffer
+ */
+static int32_t writer_thread(void* context) {
+    BitchatWriter* writer = context;
+    uint32_t deadline = furi_ms_to_ticks(BITCHAT_WRITER_FLUSH_DEADLINE_MS);
+
+    while(true) {
+        furi_mutex_acquire(writer->mutex, FuriWaitForever);
+
+        bool running = writer->running;
+        uint32_t timeout = FuriWaitForever;
+        bool due = false;
+        if(writer->staging.entry_count > 0) {
+            uint32_t age = furi_get_tick() - writer->oldest_tick;
+            due = !running || writer->flush_requested ||
+                  writer->staging.data_used + writer->staging.header_used >=
+                      BITCHAT_WRITER_FLUSH_SIZE ||
+                  age >= deadline;
+            timeout = due ? 0 : deadline - age;
+        }
+
+        WriterBuffer batch = {0};
+        if(due) {
+            // Swap buffers; producers keep staging while this one is written
+            batch = writer->staging;
+            writer->staging.data = writer->spare;
+            writer->staging.data_used = 0;
+            writer->staging.header_used = 0;
+            writer->staging.entry_count = 0;
+            writer->spare = NULL;
+            // Kept readable until the card has it
+            writer->writing = batch;
+        }
+        writer->flush_requested = false;
+
+        furi_mutex_release(writer->mutex);
+
+        if(due) {
+            writer_write_buffer(writer, &batch);
+        } else if(!running) {
+            break;
+        } else {
+            furi_thread_flags_wait(WRITER_FLAG_WAKE, FuriFlagWaitAny, timeout);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate the writer and start its thread
+ */
+BitchatWriter* bitchat_writer_alloc(void) {
+    BitchatWriter* writer = bitchat_heap_alloc(BitchatHeapTagStorage, sizeof(BitchatWriter));
+    memset(writer, 0, sizeof(BitchatWriter));
+
+    writer->storage = furi_record_open(RECORD_STORAGE);
+    writer->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    writer->staging.data = writer->memory[0];
+    writer->spare = writer->memory[1];
+    writer->running = true;
+
+    writer->thread = furi_thread_alloc_ex("BitchatWriter", WRITER_STACK_SIZE, writer_thread, writer);
+    furi_thread_set_priority(writer->thread, FuriThreadPriorityLow);
+    furi_thread_start(writer->thread);
+
+    return writer;
+}
+
+/**
+ * Write everything staged, stop the thread and free the writer
+ */
+void bitchat_writer_free(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    writer->running = false;
+    furi_mutex_release(writer->mutex);
+
+    furi_thread_flags_set(furi_thread_get_id(writer->thread), WRITER_FLAG_WAKE);
+    furi_thread_join(writer->thread);
+    furi_thread_free(writer->thread);
+
+    furi_mutex_free(writer->mutex);
+    furi_record_close(RECORD_STORAGE);
+    bitchat_heap_free(writer);
+}
+
+/**
+ * Copy an entry into the staging buffer
+ */
+static bool writer_stage(
+    BitchatWriter* writer,
+    WriterOp op,
+    const char* path,
+    uint32_t file_offset,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    furi_assert(writer);
+    furi_assert(path);
+    furi_assert(data || size == 0);
+
+    size_t path_length = strlen(path);
+    furi_check(path_length <= BITCHAT_WRITER_MAX_PATH);
+    size_t header_size = sizeof(WriterEntry) + path_length;
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+
+    WriterBuffer* staging = &writer->staging;
+
+    // An append with no callback extends the previous append to the same
+    // file in place, so small records don't each pay for a header and path
+    if(op == WriterOpAppend && !callback && staging->entry_count > 0 &&
+       staging->data_used + staging->header_used + size <= BITCHAT_WRITER_STAGING_SIZE) {
+        WriterEntry previous;
+        memcpy(&previous, &staging->data[staging->last_entry], sizeof(WriterEntry));
+        if(previous.op == WriterOpAppend && !previous.callback &&
+           previous.path_length == path_length && previous.size + size <= UINT16_MAX &&
+           memcmp(&staging->data[staging->last_entry - path_length], path, path_length) == 0) {
+            memcpy(&staging->data[staging->data_used], data, size);
+            staging->data_used += size;
+            previous.size += size;
+            memcpy(&staging->data[staging->last_entry], &previous, sizeof(WriterEntry));
+            writer->stats.entries++;
+            bool wake = staging->data_used + staging->header_used >= BITCHAT_WRITER_FLUSH_SIZE;
+
+            furi_mutex_release(writer->mutex);
+
+            if(wake) {
+                furi_thread_flags_set(furi_thread_get_id(writer->thread), WRITER_FLAG_WAKE);
+            }
+            return true;
+        }
+    }
+
+    if(staging->data_used + staging->header_used + header_size + size >
+       BITCHAT_WRITER_STAGING_SIZE) {
+        writer->stats.rejected++;
+        furi_mutex_release(writer->mutex);
+        BITCHAT_LOG_W(TAG, "Staging buffer full, dropping %zu bytes for %s", size, path);
+        return false;
+    }
+
+    WriterEntry entry = {
+        .data_offset = staging->data_used,
+        .file_offset = file_offset,
+        .enqueue_tick = furi_get_tick(),
+        .callback = callback,
+        .context = context,
+        .size = size,
+        .op = op,
+        .path_length = path_length,
+    };
+
+    if(size > 0) {
+        memcpy(&staging->data[staging->data_used], data, size);
+        staging->data_used += size;
+    }
+
+    size_t top = BITCHAT_WRITER_STAGING_SIZE - staging->header_used;
+    staging->last_entry = top - sizeof(WriterEntry);
+    memcpy(&staging->data[staging->last_entry], &entry, sizeof(WriterEntry));
+    memcpy(&staging->data[top - header_size], path, path_length);
+    staging->header_used += header_size;
+
+    bool wake = staging->entry_count == 0 ||
+                staging->data_used + staging->header_used >= BITCHAT_WRITER_FLUSH_SIZE;
+    if(staging->entry_count == 0) {
+        writer->oldest_tick = entry.enqueue_tick;
+    }
+    staging->entry_count++;
+    writer->staged_total++;
+    writer->stats.entries++;
+
+    furi_mutex_release(writer->mutex);
+
+    if(wake) {
+        furi_thread_flags_set(furi_thread_get_id(writer->thread), WRITER_FLAG_WAKE);
+    }
+    return true;
+}
+
+/**
+ * Stage data to append to a file
+ */
+bool bitchat_writer_append(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    return writer_stage(writer, WriterOpAppend, path, 0, data, size, callback, context);
+}
+
+/**
+ * Stage data to replace a file's contents
+ */
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    return writer_stage(writer, WriterOpReplace, path, 0, data, size, callback, context);
+}
+
+/**
+ * Stage data to write at an offset, extending the file if needed
+ */
+bool bitchat_writer_write_at(
+    BitchatWriter* writer,
+    const char* path,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    return writer_stage(writer, WriterOpWriteAt, path, offset, data, size, callback, context);
+}
+
+/**
+ * Stage removal of a file
+ */
+bool bitchat_writer_remove(
+    BitchatWriter* writer,
+    const char* path,
+    BitchatWriterCallback callback,
+    void* context) {
+    return writer_stage(writer, WriterOpRemove, path, 0, NULL, 0, callback, context);
+}
+
+/**
+ * Ask the writer to write everything staged now
+ */
+void bitchat_writer_flush(BitchatWriter* writer, bool wait) {
+    furi_assert(writer);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    writer->flush_requested = true;
+    uint32_t target = writer->staged_total;
+    furi_mutex_release(writer->mutex);
+
+    furi_thread_flags_set(furi_thread_get_id(writer->thread), WRITER_FLAG_WAKE);
+
+    while(wait) {
+        furi_mutex_acquire(writer->mutex, FuriWaitForever);
+        bool done = (int32_t)(writer->done_total - target) >= 0;
+        if(!done) {
+            writer->waiter = furi_thread_get_current_id();
+            writer->flush_requested = true;
+        }
+        furi_mutex_release(writer->mutex);
+        if(done) break;
+
+        // The timeout covers a second waiter taking over the wakeup
+        furi_thread_flags_set(furi_thread_get_id(writer->thread), WRITER_FLAG_WAKE);
+        furi_thread_flags_wait(
+            WRITER_FLAG_DONE, FuriFlagWaitAny, furi_ms_to_ticks(WRITER_WAIT_POLL_MS));
+    }
+
+    if(wait) {
+        furi_mutex_acquire(writer->mutex, FuriWaitForever);
+        if(writer->waiter == furi_thread_get_current_id()) {
+            writer->waiter = NULL;
+        }
+        furi_mutex_release(writer->mutex);
+    }
+}
+
+/**
+ * Copy the newest staged write_at of exactly this range out of one buffer
+ */
+static bool writer_find_write_at(
+    const WriterBuffer* buffer,
+    const char* path,
+    size_t path_length,
+    uint32_t offset,
+    void* data,
+    size_t size) {
+    bool found = false;
+    size_t top = BITCHAT_WRITER_STAGING_SIZE;
+    for(size_t i = 0; i < buffer->entry_count; i++) {
+        WriterEntry entry;
+        const char* entry_path;
+        writer_get_entry(buffer, &top, &entry, &entry_path);
+        if(entry.op == WriterOpWriteAt && entry.file_offset == offset && entry.size == size &&
+           entry.path_length == path_length && memcmp(entry_path, path, path_length) == 0) {
+            memcpy(data, &buffer->data[entry.data_offset], size);
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * Read back data staged with bitchat_writer_write_at() that is not yet on the card
+ */
+bool bitchat_writer_read_staged(
+    BitchatWriter* writer,
+    const char* path,
+    uint32_t offset,
+    void* data,
+    size_t size) {
+    furi_assert(writer);
+    furi_assert(path);
+    furi_assert(data);
+
+    size_t path_length = strlen(path);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    // Staged entries are newer than the ones being written
+    bool found = writer_find_write_at(&writer->writing, path, path_length, offset, data, size);
+    found |= writer_find_write_at(&writer->staging, path, path_length, offset, data, size);
+    furi_mutex_release(writer->mutex);
+
+    return found;
+}
+
+/**
+ * Get a mark covering everything staged so far
+ */
+uint32_t bitchat_writer_get_mark(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    uint32_t mark = writer->staged_total;
+    furi_mutex_release(writer->mutex);
+
+    return mark;
+}
+
+/**
+ * Check whether everything staged before a mark has been written
+ */
+bool bitchat_writer_is_written(BitchatWriter* writer, uint32_t mark) {
+    furi_assert(writer);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    bool written = (int32_t)(writer->done_total - mark) >= 0;
+    furi_mutex_release(writer->mutex);
+
+    return written;
+}
+
+/**
+ * Check whether anything is staged or being written
+ */
+bool bitchat_writer_is_pending(BitchatWriter* writer) {
+    furi_assert(writer);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    bool pending = writer->done_total != writer->staged_total;
+    furi_mutex_release(writer->mutex);
+
+    return pending;
+}
+
+/**
+ * Get writer statistics
+ */
+void bitchat_writer_get_stats(BitchatWriter* writer, BitchatWriterStats* stats) {
+    furi_assert(writer);
+    furi_assert(stats);
+
+    furi_mutex_acquire(writer->mutex, FuriWaitForever);
+    *stats = writer->stats;
+    furi_mutex_release(writer->mutex);
+}
@@ -0,0 +1,153 @@
+/**
+ * BitChat Storage Writer
+ * Write-behind SD card writes on a dedicated thread
+ *
+ * Callers copy data into a bounded staging buffer and return immediately;
+ * they never wait for the SD card. The writer thread swaps the staging
+ * buffer out and writes it once BITCHAT_WRITER_FLUSH_SIZE bytes are staged,
+ * the oldest entry is BITCHAT_WRITER_FLUSH_DEADLINE_MS old, or a flush is
+ * requested. Consecutive appends to the same file are merged into one
+ * sequential write; appends without a callback are merged while staged.
+ * Each entry's callback runs on the writer thread once its data has been
+ * written and the file closed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_WRITER_STAGING_SIZE 4096
+#define BITCHAT_WRITER_FLUSH_SIZE 1024
+#define BITCHAT_WRITER_FLUSH_DEADLINE_MS 500
+#define BITCHAT_WRITER_MAX_PATH 63
+// Log2 millisecond buckets: 0-1, 2-3, 4-7, ... , >= 1024
+#define BITCHAT_WRITER_HISTOGRAM_BUCKETS 12
+
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * Called on the writer thread when an entry is durable or has failed
+ */
+typedef void (*BitchatWriterCallback)(void* context, bool success);
+
+/**
+ * Writer statistics
+ */
+typedef struct {
+    uint32_t entries;
+    uint32_t batches;
+    uint32_t bytes_written;
+    uint32_t rejected; // Staging buffer full
+    uint32_t errors;
+    uint32_t latency_histogram[BITCHAT_WRITER_HISTOGRAM_BUCKETS]; // Enqueue to durable
+    uint32_t write_histogram[BITCHAT_WRITER_HISTOGRAM_BUCKETS]; // SD time per batch
+} BitchatWriterStats;
+
+/**
+ * Allocate the writer and start its thread
+ */
+BitchatWriter* bitchat_writer_alloc(void);
+
+/**
+ * Write everything staged, stop the thread and free the writer
+ */
+void bitchat_writer_free(BitchatWriter* writer);
+
+/**
+ * Stage data to append to a file (created if missing)
+ * @param writer Writer instance
+ * @param path File path
+ * @param data Data to append
+ * @param size Data size
+ * @param callback Durability callback (optional)
+ * @param context Callback context
+ * @return false if the staging buffer is full; nothing was staged
+ */
+bool bitchat_writer_append(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context);
+
+/**
+ * Stage data to replace a file's contents
+ * @return false if the staging buffer is full; nothing was staged
+ */
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context);
+
+/**
+ * Stage data to write at an offset, extending the file if needed
+ * @return false if the staging buffer is full; nothing was staged
+ */
+bool bitchat_writer_write_at(
+    BitchatWriter* writer,
+    const char* path,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context);
+
+/**
+ * Stage removal of a file, ordered after everything staged before it
+ * @return false if the staging buffer is full; nothing was staged
+ */
+bool bitchat_writer_remove(
+    BitchatWriter* writer,
+    const char* path,
+    BitchatWriterCallback callback,
+    void* context);
+
+/**
+ * Ask the writer to write everything staged now
+ * @param writer Writer instance
+ * @param wait Block until it is written (never from UI or radio paths,
+ *             nor from a writer callback)
+ */
+void bitchat_writer_flush(BitchatWriter* writer, bool wait);
+
+/**
+ * Read back data staged with bitchat_writer_write_at() that is not yet on the card
+ * Only an entry for exactly this path, offset and size matches; the newest
+ * wins. Check here before reading the file: whatever is not found here is
+ * already on the card. Never blocks on SD.
+ * @return true if data was filled from a staged entry
+ */
+bool bitchat_writer_read_staged(
+    BitchatWriter* writer,
+    const char* path,
+    uint32_t offset,
+    void* data,
+    size_t size);
+
+/**
+ * Get a mark covering everything staged so far
+ * Pass it to bitchat_writer_is_written() later to learn whether that data
+ * has reached the card, without waiting for it.
+ */
+uint32_t bitchat_writer_get_mark(BitchatWriter* writer);
+
+/**
+ * Check whether everything staged before a mark has been written (or failed)
+ */
+bool bitchat_writer_is_written(BitchatWriter* writer, uint32_t mark);
+
+/**
+ * Check whether anything is staged or being written
+ */
+bool bitchat_writer_is_pending(BitchatWriter* writer);
+
+/**
+ * Get writer statistics
+ */
+void bitchat_writer_get_stats(BitchatWriter* writer, BitchatWriterStats* stats);
@@ -0,0 +1,321 @@
+/**
+ * BitChat Ed25519 Test
+ * Checks Ed25519 against RFC 8032 and packet signatures built on it, on a host
+ *
+ *   rfc8032     section 7.1 tests 1-3: public key from seed, signature,
+ *               verify, and rejection of a changed signature or message
+ *   batch       the same signatures checked together, with same-key
+ *               duplicates; one bad signature fails only its own item
+ *   packet      bitchat_packet_sign() and the verifier: TTL changes keep a
+ *               signature valid, payload and sender changes do not, and a
+ *               relayed copy is answered from the cache
+ *
+ * Build from the repository root:
+ *   cc -O2 -Itools/host -I. -o bitchat_ed25519_test tools/bitchat_ed25519_test.c \
+ *       crypto/bitchat_signature.c crypto/bitchat_ed25519.c crypto/bitchat_fe25519.c \
+ *       crypto/bitchat_sha512.c protocol/bitchat_protocol.c utils/bitchat_metrics.c \
+ *       utils/bitchat_log.c utils/bitchat_heap.c
+ *
+ * Usage: bitchat_ed25519_test
+ * Exits non-zero if any check fails.
+ */
+
+#include "crypto/bitchat_signature.h"
+#include "crypto/bitchat_ed25519.h"
+#include "protocol/bitchat_protocol.h"
+#include "storage/bitchat_writer.h"
+#include "utils/bitchat_heap.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+
+#define TAG "BitchatEd25519Test"
+#define TEST_MAX_MESSAGE 8
+
+typedef struct {
+    const char* seed;
+    const char* public_key;
+    const char* message;
+    const char* signature;
+} TestVector;
+
+/**
+ * RFC 8032 section 7.1, TEST 1 to TEST 3
+ */
+static const TestVector test_vectors[] = {
+    {
+        "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+        "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+        "",
+        "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+        "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b",
+    },
+    {
+        "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+        "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+        "72",
+        "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+        "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00",
+    },
+    {
+        "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+        "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+        "af82",
+        "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+        "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a",
+    },
+};
+
+#define TEST_VECTOR_COUNT COUNT_OF(test_vectors)
+
+/**
+ * A vector in binary form
+ */
+typedef struct {
+    uint8_t seed[BITCHAT_ED25519_SEED_SIZE];
+    uint8_t public_key[BITCHAT_ED25519_PUBLIC_KEY_SIZE];
+    uint8_t message[TEST_MAX_MESSAGE];
+    size_t message_size;
+    uint8_t signature[BITCHAT_ED25519_SIGNATURE_SIZE];
+} TestCase;
+
+static uint32_t test_random_state = 0x2545F491;
+static uint32_t test_failures;
+
+/**
+ * Only needed to link; nothing here depends on time
+ */
+uint32_t furi_get_tick(void) {
+    return 0;
+}
+
+/**
+ * Seeded xorshift so runs repeat exactly
+ */
+uint32_t furi_hal_random_get(void) {
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * Only needed to link bitchat_metrics.c; nothing is saved here
+ */
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    UNUSED(writer);
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    if(callback) callback(context, false);
+    return false;
+}
+
+static void test_check(bool condition, const char* group, size_t index, const char* what) {
+    if(!condition) {
+        printf("FAIL %s %zu: %s\n", group, index, what);
+        test_failures++;
+    }
+}
+
+static size_t test_unhex(const char* hex, uint8_t* out, size_t out_size) {
+    size_t size = strlen(hex) / 2;
+    furi_check(size <= out_size);
+    for(size_t i = 0; i < size; i++) {
+        unsigned int byte;
+        sscanf(&hex[i * 2], "%2x", &byte);
+        out[i] = byte;
+    }
+    return size;
+}
+
+static void test_load(TestCase* cases) {
+    for(size_t i = 0; i < TEST_VECTOR_COUNT; i++) {
+        const TestVector* vector = &test_vectors[i];
+        TestCase* test = &cases[i];
+        test_unhex(vector->seed, test->seed, sizeof(test->seed));
+        test_unhex(vector->public_key, test->public_key, sizeof(test->public_key));
+        test->message_size = test_unhex(vector->message, test->message, sizeof(test->message));
+        test_unhex(vector->signature, test->signature, sizeof(test->signature));
+    }
+}
+
+static void test_rfc8032(TestCase* cases) {
+    for(size_t i = 0; i < TEST_VECTOR_COUNT; i++) {
+        TestCase* test = &cases[i];
+
+        BitchatEd25519Key key;
+        bitchat_ed25519_expand(&key, test->seed);
+        test_check(
+            memcmp(key.public_key, test->public_key, sizeof(key.public_key)) == 0,
+            "rfc8032",
+            i,
+            "public key");
+
+        uint8_t signature[BITCHAT_ED25519_SIGNATURE_SIZE];
+        bitchat_ed25519_sign(&key, test->message, test->message_size, signature);
+        test_check(
+            memcmp(signature, test->signature, sizeof(signature)) == 0, "rfc8032", i, "signature");
+        bitchat_ed25519_wipe(&key);
+
+        test_check(
+            bitchat_ed25519_verify(
+                test->public_key, test->message, test->message_size, test->signature),
+            "rfc8032",
+            i,
+            "verify");
+
+        // Both halves of the signature are checked: R and S
+        signature[0] ^= 0x01;
+        test_check(
+            !bitchat_ed25519_verify(test->public_key, test->message, test->message_size, signature),
+            "rfc8032",
+            i,
+            "changed R rejected");
+        signature[0] ^= 0x01;
+        signature[40] ^= 0x01;
+        test_check(
+            !bitchat_ed25519_verify(test->public_key, test->message, test->message_size, signature),
+            "rfc8032",
+            i,
+            "changed S rejected");
+
+        uint8_t message[TEST_MAX_MESSAGE + 1];
+        memcpy(message, test->message, test->message_size);
+        message[test->message_size] = 0x00;
+        test_check(
+            !bitchat_ed25519_verify(
+                test->public_key, message, test->message_size + 1, test->signature),
+            "rfc8032",
+            i,
+            "longer message rejected");
+    }
+}
+
+static void test_batch(TestCase* cases) {
+    BitchatEd25519BatchItem items[BITCHAT_ED25519_BATCH_MAX];
+    uint8_t signatures[BITCHAT_ED25519_BATCH_MAX][BITCHAT_ED25519_SIGNATURE_SIZE];
+    bool valid[BITCHAT_ED25519_BATCH_MAX];
+
+    // Every vector more than once, so same-key items share work
+    for(size_t i = 0; i < BITCHAT_ED25519_BATCH_MAX; i++) {
+        TestCase* test = &cases[i % TEST_VECTOR_COUNT];
+        memcpy(signatures[i], test->signature, sizeof(signatures[i]));
+        items[i].public_key = test->public_key;
+        items[i].message = test->message;
+        items[i].message_size = test->message_size;
+        items[i].signature = signatures[i];
+    }
+
+    size_t count = bitchat_ed25519_verify_batch(items, BITCHAT_ED25519_BATCH_MAX, valid);
+    test_check(count == BITCHAT_ED25519_BATCH_MAX, "batch", count, "all valid");
+
+    signatures[4][40] ^= 0x01;
+    count = bitchat_ed25519_verify_batch(items, BITCHAT_ED25519_BATCH_MAX, valid);
+    test_check(count == BITCHAT_ED25519_BATCH_MAX - 1, "batch", count, "one invalid");
+    for(size_t i = 0; i < BITCHAT_ED25519_BATCH_MAX; i++) {
+        test_check(valid[i] == (i != 4), "batch", i, "result per item");
+    }
+
+    count = bitchat_ed25519_verify_batch(items, 1, valid);
+    test_check(count == 1 && valid[0], "batch", count, "single item");
+}
+
+static void test_packet(TestCase* cases) {
+    static uint8_t payload[] = "signed payload";
+
+    BitchatEd25519Key key;
+    bitchat_ed25519_expand(&key, cases[0].seed);
+
+    BitchatPacket packet = {0};
+    packet.version = BITCHAT_VERSION;
+    packet.type = BITCHAT_PACKET_TYPE_PUBLIC_MESSAGE;
+    packet.ttl = 7;
+    packet.timestamp = 1700000000000ULL;
+    packet.payload = payload;
+    packet.payload_length = sizeof(payload) - 1;
+    memset(packet.sender_id, 0x11, sizeof(packet.sender_id));
+
+    test_check(bitchat_packet_sign(&packet, &key), "packet", 0, "sign");
+    test_check(packet.has_signature, "packet", 0, "has_signature set");
+    bitchat_ed25519_wipe(&key);
+
+    BitchatSignatureVerifier* verifier = bitchat_signature_verifier_alloc();
+    const uint8_t* public_key = cases[0].public_key;
+    test_check(
+        bitchat_signature_verify_packet(verifier, &packet, public_key), "packet", 0, "verify");
+    test_check(
+        !bitchat_signature_verify_packet(verifier, &packet, cases[1].public_key),
+        "packet",
+        0,
+        "other key rejected");
+
+    // Encoded and decoded as a relay would see it, one hop later
+    uint8_t frame[128];
+    size_t frame_size = bitchat_packet_encode(&packet, frame, sizeof(frame));
+    frame[BITCHAT_PACKET_TTL_OFFSET]--;
+    BitchatPacket relayed;
+    test_check(bitchat_packet_decode(frame, frame_size, &relayed), "packet", 1, "decode");
+    test_check(
+        bitchat_signature_verify_packet(verifier, &relayed, public_key),
+        "packet",
+        1,
+        "TTL decremented");
+
+    uint32_t cache_hits;
+    uint32_t verifications;
+    bitchat_signature_get_stats(verifier, &cache_hits, &verifications);
+    test_check(cache_hits == 1, "packet", cache_hits, "relayed copy from cache");
+
+    relayed.payload[0] ^= 0x01;
+    test_check(
+        !bitchat_signature_verify_packet(verifier, &relayed, public_key),
+        "packet",
+        1,
+        "payload changed");
+    relayed.payload[0] ^= 0x01;
+    relayed.sender_id[0] ^= 0x01;
+    test_check(
+        !bitchat_signature_verify_packet(verifier, &relayed, public_key),
+        "packet",
+        1,
+        "sender changed");
+    relayed.sender_id[0] ^= 0x01;
+
+    // A burst with the good packet, its relayed copy and a tampered one
+    BitchatPacket tampered = relayed;
+    uint8_t tampered_payload[sizeof(payload) - 1];
+    memcpy(tampered_payload, relayed.payload, sizeof(tampered_payload));
+    tampered_payload[1] ^= 0x01;
+    tampered.payload = tampered_payload;
+
+    const BitchatPacket* burst[] = {&packet, &relayed, &tampered};
+    const uint8_t* keys[] = {public_key, public_key, public_key};
+    bool valid[COUNT_OF(burst)];
+    size_t count = bitchat_signature_verify_packets(verifier, burst, keys, COUNT_OF(burst), valid);
+    test_check(count == 2 && valid[0] && valid[1] && !valid[2], "packet", count, "burst");
+
+    bitchat_heap_free(relayed.payload);
+    bitchat_signature_verifier_free(verifier);
+}
+
+int main(void) {
+    TestCase cases[TEST_VECTOR_COUNT];
+    test_load(cases);
+
+    test_rfc8032(cases);
+    test_batch(cases);
+    test_packet(cases);
+
+    if(test_failures > 0) {
+        printf("%lu checks failed\n", (unsigned long)test_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,428 @@
+/**
+ * BitChat Fragment Test
+ * Checks Reed-Solomon erasure decoding in the fragment reassembler, on a host
+ *
+ *   exhaustive  K = 5, R = 3 with a padded last block: every one of the 256
+ *               loss patterns rebuilds the frame exactly when at least K
+ *               fragments arrive, and never otherwise
+ *   maximum     K = 32, R = 8 in a 4 KB frame: random sets of 8 lost
+ *               fragments, the rest delivered in random order
+ *   single      K = 1: the repair fragment alone rebuilds the frame
+ *   senders     two transfers interleaved, each rebuilt from repair fragments
+ *   late        fragments of a completed transfer are ignored, and an
+ *               incomplete transfer is dropped after BITCHAT_FRAGMENT_TIMEOUT_MS
+ *   junk        the stack is filled with a different junk byte before every
+ *               fragment, so struct padding cannot decide whether it matches
+ *
+ * Build from the repository root:
+ *   cc -O2 -Itools/host -I. -o bitchat_fragment_test tools/bitchat_fragment_test.c \
+ *       protocol/bitchat_fragment.c utils/bitchat_metrics.c utils/bitchat_log.c \
+ *       utils/bitchat_heap.c
+ *
+ * Usage: bitchat_fragment_test
+ * Exits non-zero if any check fails.
+ */
+
+#include "protocol/bitchat_fragment.h"
+#include "storage/bitchat_writer.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+
+#define TAG "BitchatFragmentTest"
+#define TEST_MAX_FRAGMENTS (BITCHAT_FRAGMENT_MAX_DATA + BITCHAT_FRAGMENT_MAX_REPAIR)
+#define TEST_MAX_FRAGMENT_SIZE (BITCHAT_FRAGMENT_HEADER_SIZE + BITCHAT_FRAGMENT_MAX_FRAME)
+#define TEST_RANDOM_PATTERNS 200
+
+/**
+ * Every fragment of one frame, encoded up front
+ */
+typedef struct {
+    BitchatFragmentPlan plan;
+    uint8_t frame[BITCHAT_FRAGMENT_MAX_FRAME];
+    uint8_t fragments[TEST_MAX_FRAGMENTS][TEST_MAX_FRAGMENT_SIZE];
+    size_t fragment_size;
+    size_t count;
+} TestTransfer;
+
+static uint32_t test_tick;
+static uint32_t test_random_state = 0x2545F491;
+static uint32_t test_failures;
+
+/**
+ * Tick the reassembler sees; moved by hand for the timeout case
+ */
+uint32_t furi_get_tick(void) {
+    return test_tick;
+}
+
+/**
+ * Seeded xorshift so runs repeat exactly
+ */
+uint32_t furi_hal_random_get(void) {
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * Only needed to link bitchat_metrics.c; nothing is saved here
+ */
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    UNUSED(writer);
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    if(callback) callback(context, false);
+    return false;
+}
+
+static void test_check(bool condition, const char* group, uint32_t index, const char* what) {
+    if(!condition) {
+        printf("FAIL %s %lu: %s\n", group, (unsigned long)index, what);
+        test_failures++;
+    }
+}
+
+/**
+ * Fill a frame with a pattern and encode all of its fragments
+ */
+static bool test_transfer_build(
+    TestTransfer* transfer,
+    size_t frame_size,
+    size_t block_size,
+    uint8_t repair_count) {
+    for(size_t i = 0; i < frame_size; i++) {
+        transfer->frame[i] = furi_hal_random_get() & 0xFF;
+    }
+
+    if(!bitchat_fragment_plan(
+           frame_size,
+           BITCHAT_FRAGMENT_HEADER_SIZE + block_size,
+           repair_count,
+           0x01,
+           &transfer->plan)) {
+        return false;
+    }
+
+    transfer->count = bitchat_fragment_count(&transfer->plan);
+    for(size_t f = 0; f < transfer->count; f++) {
+        transfer->fragment_size = bitchat_fragment_encode(
+            &transfer->plan,
+            transfer->frame,
+            f,
+            transfer->fragments[f],
+            sizeof(transfer->fragments[f]));
+        if(transfer->fragment_size == 0) return false;
+    }
+    return true;
+}
+
+/**
+ * Deliver fragments in the given order, skipping lost ones
+ * @return true if the frame was rebuilt exactly, on the K-th fragment delivered
+ */
+static bool test_transfer_deliver(
+    BitchatReassembler* reassembler,
+    const uint8_t* sender_id,
+    const TestTransfer* transfer,
+    const uint8_t* order,
+    uint64_t lost) {
+    size_t delivered = 0;
+    bool rebuilt = false;
+
+    for(size_t n = 0; n < transfer->count; n++) {
+        uint8_t f = order[n];
+        if(lost & (1ULL << f)) continue;
+        delivered++;
+
+        const uint8_t* frame;
+        size_t frame_size;
+        if(!bitchat_reassembler_add(
+               reassembler,
+               sender_id,
+               transfer->fragments[f],
+               transfer->fragment_size,
+               &frame,
+               &frame_size)) {
+            continue;
+        }
+
+        // Completing twice, or before K fragments, is as wrong as not at all
+        if(rebuilt || delivered != transfer->plan.data_count) return false;
+        if(frame_size != transfer->plan.total_size) return false;
+        if(memcmp(frame, transfer->frame, frame_size) != 0) return false;
+        rebuilt = true;
+    }
+    return rebuilt;
+}
+
+static void test_order_identity(uint8_t* order, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+}
+
+static void test_order_shuffle(uint8_t* order, size_t count) {
+    test_order_identity(order, count);
+    for(size_t i = count - 1; i > 0; i--) {
+        size_t j = furi_hal_random_get() % (i + 1);
+        uint8_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+}
+
+static size_t test_bit_count(uint64_t bits) {
+    size_t count = 0;
+    for(; bits; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+static void test_exhaustive(TestTransfer* transfer) {
+    static const uint8_t sender_id[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+
+    // 5 blocks of 35 bytes; the last carries 4 bytes of padding
+    bool built = test_transfer_build(transfer, 171, 35, 3);
+    test_check(built && transfer->count == 8, "exhaustive", 0, "plan");
+    if(!built) return;
+
+    uint8_t order[TEST_MAX_FRAGMENTS];
+    test_order_identity(order, transfer->count);
+
+    for(uint64_t lost = 0; lost < (1ULL << transfer->count); lost++) {
+        BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+        bool rebuilt = test_transfer_deliver(reassembler, sender_id, transfer, order, lost);
+        bool recoverable = test_bit_count(lost) <= transfer->plan.repair_count;
+        test_check(rebuilt == recoverable, "exhaustive", lost, "rebuilt iff K arrived");
+        bitchat_reassembler_free(reassembler);
+    }
+}
+
+static void test_maximum(TestTransfer* transfer) {
+    static const uint8_t sender_id[8] = {2, 2, 2, 2, 2, 2, 2, 2};
+
+    bool built = test_transfer_build(
+        transfer, BITCHAT_FRAGMENT_MAX_FRAME - 5, 128, BITCHAT_FRAGMENT_MAX_REPAIR);
+    test_check(
+        built && transfer->plan.data_count == BITCHAT_FRAGMENT_MAX_DATA, "maximum", 0, "plan");
+    if(!built) return;
+
+    uint8_t order[TEST_MAX_FRAGMENTS];
+    for(uint32_t pattern = 0; pattern < TEST_RANDOM_PATTERNS; pattern++) {
+        // The first R of a shuffled order are lost, so every mix of data
+        // and repair losses comes up, including only data lost
+        test_order_shuffle(order, transfer->count);
+        uint64_t lost = 0;
+        for(size_t i = 0; i < transfer->plan.repair_count; i++) {
+            lost |= 1ULL << order[i];
+        }
+        test_order_shuffle(order, transfer->count);
+
+        BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+        test_check(
+            test_transfer_deliver(reassembler, sender_id, transfer, order, lost),
+            "maximum",
+            pattern,
+            "rebuilt with R lost");
+        bitchat_reassembler_free(reassembler);
+    }
+
+    // The first R data fragments lost: every repair fragment is needed
+    test_order_identity(order, transfer->count);
+    uint64_t lost = (1ULL << transfer->plan.repair_count) - 1;
+    BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+    test_check(
+        test_transfer_deliver(reassembler, sender_id, transfer, order, lost),
+        "maximum",
+        TEST_RANDOM_PATTERNS,
+        "rebuilt from all repair fragments");
+    bitchat_reassembler_free(reassembler);
+}
+
+static void test_single(TestTransfer* transfer) {
+    static const uint8_t sender_id[8] = {3, 3, 3, 3, 3, 3, 3, 3};
+
+    bool built = test_transfer_build(transfer, 60, 100, 1);
+    test_check(built && transfer->count == 2, "single", 0, "plan");
+    if(!built) return;
+
+    uint8_t order[TEST_MAX_FRAGMENTS];
+    test_order_identity(order, transfer->count);
+    BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+    test_check(
+        test_transfer_deliver(reassembler, sender_id, transfer, order, 1ULL << 0),
+        "single",
+        0,
+        "rebuilt from repair alone");
+    bitchat_reassembler_free(reassembler);
+}
+
+static void test_senders(TestTransfer* first, TestTransfer* second) {
+    static const uint8_t first_id[8] = {4, 4, 4, 4, 4, 4, 4, 4};
+    static const uint8_t second_id[8] = {5, 5, 5, 5, 5, 5, 5, 5};
+
+    bool built = test_transfer_build(first, 1000, 100, 3) &&
+                 test_transfer_build(second, 700, 100, 2);
+    test_check(built, "senders", 0, "plan");
+    if(!built) return;
+
+    // Alternate between the transfers; each loses two data fragments
+    const uint64_t first_lost = (1ULL << 2) | (1ULL << 7);
+    const uint64_t second_lost = (1ULL << 0) | (1ULL << 6);
+    BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+    size_t done = 0;
+    for(size_t f = 0; f < first->count || f < second->count; f++) {
+        const uint8_t* frame;
+        size_t frame_size;
+        if(f < first->count && !(first_lost & (1ULL << f)) &&
+           bitchat_reassembler_add(
+               reassembler, first_id, first->fragments[f], first->fragment_size, &frame, &frame_size)) {
+            test_check(
+                frame_size == first->plan.total_size &&
+                    memcmp(frame, first->frame, frame_size) == 0,
+                "senders",
+                0,
+                "first rebuilt");
+            done++;
+        }
+        if(f < second->count && !(second_lost & (1ULL << f)) &&
+           bitchat_reassembler_add(
+               reassembler,
+               second_id,
+               second->fragments[f],
+               second->fragment_size,
+               &frame,
+               &frame_size)) {
+            test_check(
+                frame_size == second->plan.total_size &&
+                    memcmp(frame, second->frame, frame_size) == 0,
+                "senders",
+                1,
+                "second rebuilt");
+            done++;
+        }
+    }
+    test_check(done == 2, "senders", done, "both rebuilt once");
+    bitchat_reassembler_free(reassembler);
+}
+
+static void test_late(TestTransfer* transfer, TestTransfer* other) {
+    static const uint8_t sender_id[8] = {6, 6, 6, 6, 6, 6, 6, 6};
+    static const uint8_t other_id[8] = {7, 7, 7, 7, 7, 7, 7, 7};
+
+    bool built = test_transfer_build(transfer, 400, 100, 2) &&
+                 test_transfer_build(other, 300, 100, 1);
+    test_check(built, "late", 0, "plan");
+    if(!built) return;
+
+    const uint8_t* frame;
+    size_t frame_size;
+    uint8_t order[TEST_MAX_FRAGMENTS];
+    test_order_identity(order, transfer->count);
+
+    // The repair fragments after completion must not start the frame again
+    BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+    test_check(
+        test_transfer_deliver(reassembler, sender_id, transfer, order, 0),
+        "late",
+        0,
+        "rebuilt, then late fragments ignored");
+
+    // Half a transfer, then silence past the timeout: another transfer
+    // evicts it and its remaining fragments alone are not enough
+    test_tick = 0;
+    for(size_t f = 0; f < 2; f++) {
+        test_check(
+            !bitchat_reassembler_add(
+                reassembler, other_id, other->fragments[f], other->fragment_size, &frame, &frame_size),
+            "late",
+            1,
+            "partial");
+    }
+    test_tick = furi_ms_to_ticks(BITCHAT_FRAGMENT_TIMEOUT_MS) + 1;
+    test_transfer_build(transfer, 400, 100, 2);
+    test_check(
+        test_transfer_deliver(reassembler, sender_id, transfer, order, 0),
+        "late",
+        2,
+        "new transfer after timeout");
+    bool completed = false;
+    for(size_t f = 2; f < other->count; f++) {
+        completed |= bitchat_reassembler_add(
+            reassembler, other_id, other->fragments[f], other->fragment_size, &frame, &frame_size);
+    }
+    test_check(!completed, "late", 3, "timed out transfer dropped");
+    bitchat_reassembler_free(reassembler);
+}
+
+/**
+ * Scribble over the stack that the next bitchat_reassembler_add will reuse
+ */
+static __attribute__((noinline)) void test_stack_junk(uint8_t value) {
+    volatile uint8_t junk[1024];
+    for(size_t i = 0; i < sizeof(junk); i++) {
+        junk[i] = value;
+    }
+}
+
+static void test_junk(TestTransfer* transfer) {
+    static const uint8_t sender_id[8] = {8, 8, 8, 8, 8, 8, 8, 8};
+
+    bool built = test_transfer_build(transfer, 500, 100, 2);
+    test_check(built, "junk", 0, "plan");
+    if(!built) return;
+
+    BitchatReassembler* reassembler = bitchat_reassembler_alloc();
+    size_t done = 0;
+    for(size_t f = 0; f < transfer->count; f++) {
+        const uint8_t* frame;
+        size_t frame_size;
+        test_stack_junk(0xA5 ^ (f * 0x3B));
+        if(!bitchat_reassembler_add(
+               reassembler,
+               sender_id,
+               transfer->fragments[f],
+               transfer->fragment_size,
+               &frame,
+               &frame_size)) {
+            continue;
+        }
+        test_check(
+            f + 1 == transfer->plan.data_count && frame_size == transfer->plan.total_size &&
+                memcmp(frame, transfer->frame, frame_size) == 0,
+            "junk",
+            f,
+            "rebuilt on the K-th fragment");
+        done++;
+    }
+    test_check(done == 1, "junk", done, "rebuilt once");
+    bitchat_reassembler_free(reassembler);
+}
+
+int main(void) {
+    static TestTransfer first;
+    static TestTransfer second;
+
+    test_exhaustive(&first);
+    test_maximum(&first);
+    test_single(&first);
+    test_senders(&first, &second);
+    test_late(&first, &second);
+    test_junk(&first);
+
+    if(test_failures > 0) {
+        printf("%lu checks failed\n", (unsigned long)test_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,381 @@
+/**
+ * BitChat Noise Frame Test
+ * Checks the ChaCha20-Poly1305 AEAD against RFC 8439 and the in-place
+ * packet encryption built on it, on a host
+ *
+ *   aead        RFC 8439 section 2.8.2 vector: ciphertext, tag, decrypt and
+ *               rejection of a flipped tag
+ *   frame       XX handshake between two engines, then
+ *               bitchat_noise_encrypt_frame() / bitchat_noise_decrypt_frame()
+ *               round trips: unchanged, with the TTL decremented as a relay
+ *               would, and rejected when the header, IDs or ciphertext change
+ *               or the frame is replayed
+ *   spoof       a forged message 1 for an established peer, and enough of
+ *               them for other peers to fill the table, leave its keys in
+ *               use; a real new handshake with that peer still rekeys
+ *
+ * Build from the repository root:
+ *   cc -O2 -Itools/host -I. -o bitchat_noise_test tools/bitchat_noise_test.c \
+ *       crypto/noise_protocol.c crypto/bitchat_chacha20poly1305.c \
+ *       crypto/bitchat_sha256.c crypto/bitchat_x25519.c crypto/bitchat_fe25519.c \
+ *       protocol/bitchat_protocol.c utils/bitchat_metrics.c utils/bitchat_log.c \
+ *       utils/bitchat_heap.c
+ *
+ * Usage: bitchat_noise_test
+ * Exits non-zero if any check fails.
+ */
+
+#include "crypto/noise_protocol.h"
+#include "crypto/bitchat_chacha20poly1305.h"
+#include "crypto/bitchat_x25519.h"
+#include "protocol/bitchat_protocol.h"
+#include "storage/bitchat_writer.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+
+#define TAG "BitchatNoiseTest"
+#define FRAME_BUFFER_SIZE 256
+
+static uint32_t test_random_state = 0x2545F491;
+static uint32_t test_failures;
+
+/**
+ * Sessions never idle out here
+ */
+uint32_t furi_get_tick(void) {
+    return 0;
+}
+
+/**
+ * Seeded xorshift so runs repeat exactly
+ */
+uint32_t furi_hal_random_get(void) {
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/**
+ * Only needed to link bitchat_metrics.c; nothing is saved here
+ */
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    UNUSED(writer);
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    if(callback) callback(context, false);
+    return false;
+}
+
+static void test_check(bool condition, const char* group, const char* what) {
+    if(!condition) {
+        printf("FAIL %s: %s\n", group, what);
+        test_failures++;
+    }
+}
+
+/**
+ * RFC 8439 section 2.8.2
+ */
+static void test_aead(void) {
+    static const char plaintext[] =
+        "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+        "for the future, sunscreen would be it.";
+    static const uint8_t nonce[BITCHAT_CHACHAPOLY_NONCE_SIZE] = {
+        0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+    static const uint8_t ad[] = {
+        0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7};
+    static const uint8_t expected[] = {
+        0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef,
+        0x7e, 0xc2, 0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7,
+        0x36, 0xee, 0x62, 0xd6, 0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa,
+        0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b, 0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29,
+        0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36, 0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77,
+        0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58, 0xfa, 0xb3, 0x24, 0xe4,
+        0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc, 0x3f, 0xf4,
+        0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+        0x61, 0x16};
+    static const uint8_t expected_tag[BITCHAT_CHACHAPOLY_TAG_SIZE] = {
+        0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a,
+        0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91};
+
+    uint8_t key[BITCHAT_CHACHAPOLY_KEY_SIZE];
+    for(size_t i = 0; i < sizeof(key); i++) {
+        key[i] = 0x80 + i;
+    }
+
+    size_t size = sizeof(plaintext) - 1;
+    test_check(size == sizeof(expected), "aead", "vector size");
+
+    uint8_t ciphertext[sizeof(expected)];
+    uint8_t tag[BITCHAT_CHACHAPOLY_TAG_SIZE];
+    bitchat_chachapoly_encrypt(
+        key, nonce, ad, sizeof(ad), (const uint8_t*)plaintext, size, ciphertext, tag);
+    test_check(memcmp(ciphertext, expected, size) == 0, "aead", "ciphertext");
+    test_check(memcmp(tag, expected_tag, sizeof(tag)) == 0, "aead", "tag");
+
+    uint8_t decrypted[sizeof(expected)];
+    bool ok = bitchat_chachapoly_decrypt(
+        key, nonce, ad, sizeof(ad), expected, size, expected_tag, decrypted);
+    test_check(ok && memcmp(decrypted, plaintext, size) == 0, "aead", "decrypt");
+
+    // In place, as the frame path uses it
+    memcpy(decrypted, expected, size);
+    ok = bitchat_chachapoly_decrypt(
+        key, nonce, ad, sizeof(ad), decrypted, size, expected_tag, decrypted);
+    test_check(ok && memcmp(decrypted, plaintext, size) == 0, "aead", "decrypt in place");
+
+    tag[0] = expected_tag[0] ^ 0x01;
+    ok = bitchat_chachapoly_decrypt(key, nonce, ad, sizeof(ad), expected, size, tag, NULL);
+    test_check(!ok, "aead", "flipped tag rejected");
+}
+
+/**
+ * Run the XX handshake between two engines
+ */
+static bool test_handshake(
+    BitchatNoise* initiator,
+    const uint8_t* initiator_id,
+    BitchatNoise* responder,
+    const uint8_t* responder_id) {
+    uint8_t first[BITCHAT_NOISE_MAX_HANDSHAKE_SIZE];
+    uint8_t second[BITCHAT_NOISE_MAX_HANDSHAKE_SIZE];
+    BitchatNoiseOutput output;
+
+    if(!bitchat_noise_connect(initiator, responder_id, first, sizeof(first), &output)) {
+        return false;
+    }
+    if(!bitchat_noise_handle_handshake(
+           responder, initiator_id, first, output.size, second, sizeof(second), &output)) {
+        return false;
+    }
+    if(!bitchat_noise_handle_handshake(
+           initiator, responder_id, second, output.size, first, sizeof(first), &output)) {
+        return false;
+    }
+    if(!bitchat_noise_handle_handshake(
+           responder, initiator_id, first, output.size, second, sizeof(second), &output)) {
+        return false;
+    }
+    return bitchat_noise_is_established(initiator, responder_id) &&
+           bitchat_noise_is_established(responder, initiator_id);
+}
+
+/**
+ * Encode a private message frame and encrypt its payload in place
+ * @return Frame size, or 0 on error
+ */
+static size_t test_seal_frame(
+    BitchatNoise* noise,
+    const uint8_t* sender_id,
+    const uint8_t* recipient_id,
+    const char* text,
+    uint8_t* frame) {
+    size_t text_size = strlen(text);
+
+    BitchatPacket packet = {0};
+    packet.version = BITCHAT_VERSION;
+    packet.type = BITCHAT_PACKET_TYPE_PRIVATE_MESSAGE;
+    packet.ttl = 7;
+    packet.timestamp = 1700000000000ULL;
+    packet.payload_length = text_size + BITCHAT_NOISE_TRANSPORT_OVERHEAD;
+    packet.has_recipient = true;
+    memcpy(packet.sender_id, sender_id, BITCHAT_SENDER_ID_SIZE);
+    memcpy(packet.recipient_id, recipient_id, BITCHAT_RECIPIENT_ID_SIZE);
+
+    size_t frame_size = bitchat_packet_encode(&packet, frame, FRAME_BUFFER_SIZE);
+    if(frame_size == 0) return 0;
+
+    uint8_t* payload = &frame[frame_size - packet.payload_length];
+    memcpy(&payload[BITCHAT_NOISE_NONCE_PREFIX_SIZE], text, text_size);
+    if(!bitchat_noise_encrypt_frame(noise, recipient_id, frame, frame_size)) return 0;
+    return frame_size;
+}
+
+/**
+ * Decrypt a copy of a frame, leaving the original intact for the next case
+ */
+static bool test_open_frame(
+    BitchatNoise* noise,
+    const uint8_t* sender_id,
+    const uint8_t* frame,
+    size_t frame_size,
+    const char* text) {
+    uint8_t copy[FRAME_BUFFER_SIZE];
+    memcpy(copy, frame, frame_size);
+
+    uint8_t* plaintext;
+    size_t plaintext_size;
+    if(!bitchat_noise_decrypt_frame(noise, sender_id, copy, frame_size, &plaintext, &plaintext_size)) {
+        return false;
+    }
+    return plaintext_size == strlen(text) && memcmp(plaintext, text, plaintext_size) == 0;
+}
+
+static void test_frame(void) {
+    static const uint8_t alice_id[BITCHAT_SENDER_ID_SIZE] = {1, 1, 1, 1, 1, 1, 1, 1};
+    static const uint8_t bob_id[BITCHAT_SENDER_ID_SIZE] = {2, 2, 2, 2, 2, 2, 2, 2};
+    static const char text[] = "meet at the north gate";
+
+    uint8_t alice_key[BITCHAT_NOISE_KEY_SIZE];
+    uint8_t bob_key[BITCHAT_NOISE_KEY_SIZE];
+    furi_hal_random_fill_buf(alice_key, sizeof(alice_key));
+    furi_hal_random_fill_buf(bob_key, sizeof(bob_key));
+
+    BitchatNoise* alice = bitchat_noise_alloc(alice_id, alice_key);
+    BitchatNoise* bob = bitchat_noise_alloc(bob_id, bob_key);
+
+    bool established = test_handshake(alice, alice_id, bob, bob_id);
+    test_check(established, "frame", "handshake");
+    if(!established) {
+        bitchat_noise_free(alice);
+        bitchat_noise_free(bob);
+        return;
+    }
+
+    uint8_t frame[FRAME_BUFFER_SIZE];
+    uint8_t changed[FRAME_BUFFER_SIZE];
+
+    // Each frame carries a fresh nonce, so every accepted case needs its own
+    size_t frame_size = test_seal_frame(alice, alice_id, bob_id, text, frame);
+    test_check(frame_size > 0, "frame", "encrypt");
+    size_t text_offset = frame_size - BITCHAT_NOISE_TAG_SIZE - strlen(text);
+    test_check(
+        memcmp(&frame[text_offset], text, strlen(text)) != 0, "frame", "payload encrypted");
+    test_check(test_open_frame(bob, alice_id, frame, frame_size, text), "frame", "round trip");
+    test_check(!test_open_frame(bob, alice_id, frame, frame_size, text), "frame", "replay");
+
+    // Relays decrement the TTL; it is left out of the associated data
+    frame_size = test_seal_frame(alice, alice_id, bob_id, text, frame);
+    memcpy(changed, frame, frame_size);
+    changed[BITCHAT_PACKET_TTL_OFFSET] -= 3;
+    test_check(
+        test_open_frame(bob, alice_id, changed, frame_size, text), "frame", "TTL decremented");
+
+    // The rest of the header and both IDs are authenticated
+    frame_size = test_seal_frame(alice, alice_id, bob_id, text, frame);
+    memcpy(changed, frame, frame_size);
+    changed[1] = BITCHAT_PACKET_TYPE_PUBLIC_MESSAGE;
+    test_check(
+        !test_open_frame(bob, alice_id, changed, frame_size, text), "frame", "type changed");
+    memcpy(changed, frame, frame_size);
+    changed[10] ^= 0x01;
+    test_check(
+        !test_open_frame(bob, alice_id, changed, frame_size, text), "frame", "timestamp changed");
+    memcpy(changed, frame, frame_size);
+    changed[BITCHAT_HEADER_SIZE + BITCHAT_SENDER_ID_SIZE] ^= 0x01;
+    test_check(
+        !test_open_frame(bob, alice_id, changed, frame_size, text), "frame", "recipient changed");
+    memcpy(changed, frame, frame_size);
+    changed[frame_size - 1] ^= 0x01;
+    test_check(
+        !test_open_frame(bob, alice_id, changed, frame_size, text), "frame", "tag changed");
+    memcpy(changed, frame, frame_size);
+    changed[frame_size - BITCHAT_NOISE_TAG_SIZE - 1] ^= 0x01;
+    test_check(
+        !test_open_frame(bob, alice_id, changed, frame_size, text),
+        "frame",
+        "ciphertext changed");
+
+    // None of the rejected copies used up the nonce
+    test_check(
+        test_open_frame(bob, alice_id, frame, frame_size, text), "frame", "original after rejects");
+
+    // And the other direction
+    frame_size = test_seal_frame(bob, bob_id, alice_id, text, frame);
+    test_check(
+        test_open_frame(alice, bob_id, frame, frame_size, text), "frame", "reverse round trip");
+
+    bitchat_noise_free(alice);
+    bitchat_noise_free(bob);
+}
+
+static void test_spoof(void) {
+    static const uint8_t alice_id[BITCHAT_SENDER_ID_SIZE] = {1, 1, 1, 1, 1, 1, 1, 1};
+    static const uint8_t bob_id[BITCHAT_SENDER_ID_SIZE] = {2, 2, 2, 2, 2, 2, 2, 2};
+    static const char text[] = "still here";
+
+    uint8_t alice_key[BITCHAT_NOISE_KEY_SIZE];
+    uint8_t bob_key[BITCHAT_NOISE_KEY_SIZE];
+    furi_hal_random_fill_buf(alice_key, sizeof(alice_key));
+    furi_hal_random_fill_buf(bob_key, sizeof(bob_key));
+
+    BitchatNoise* alice = bitchat_noise_alloc(alice_id, alice_key);
+    BitchatNoise* bob = bitchat_noise_alloc(bob_id, bob_key);
+
+    bool established = test_handshake(alice, alice_id, bob, bob_id);
+    test_check(established, "spoof", "handshake");
+    if(!established) {
+        bitchat_noise_free(alice);
+        bitchat_noise_free(bob);
+        return;
+    }
+
+    // Anyone can send a message 1 claiming to be alice
+    uint8_t forged[BITCHAT_X25519_KEY_SIZE];
+    uint8_t out[BITCHAT_NOISE_MAX_HANDSHAKE_SIZE];
+    BitchatNoiseOutput output;
+    furi_hal_random_fill_buf(forged, sizeof(forged));
+    bitchat_noise_handle_handshake(
+        bob, alice_id, forged, sizeof(forged), out, sizeof(out), &output);
+    test_check(bitchat_noise_is_established(bob, alice_id), "spoof", "established after forged");
+
+    // And for as many other peers as the table holds
+    for(uint8_t i = 0; i < BITCHAT_NOISE_MAX_SESSIONS; i++) {
+        uint8_t peer_id[BITCHAT_SENDER_ID_SIZE];
+        memset(peer_id, 0x40 + i, sizeof(peer_id));
+        furi_hal_random_fill_buf(forged, sizeof(forged));
+        bitchat_noise_handle_handshake(
+            bob, peer_id, forged, sizeof(forged), out, sizeof(out), &output);
+    }
+    test_check(bitchat_noise_is_established(bob, alice_id), "spoof", "established after flood");
+
+    uint8_t frame[FRAME_BUFFER_SIZE];
+    size_t frame_size = test_seal_frame(alice, alice_id, bob_id, text, frame);
+    test_check(
+        frame_size > 0 && test_open_frame(bob, alice_id, frame, frame_size, text),
+        "spoof",
+        "old keys to bob");
+    frame_size = test_seal_frame(bob, bob_id, alice_id, text, frame);
+    test_check(
+        frame_size > 0 && test_open_frame(alice, bob_id, frame, frame_size, text),
+        "spoof",
+        "old keys to alice");
+
+    // Alice really starts over; bob swaps in the new keys on message 3
+    bitchat_noise_remove_session(alice, bob_id);
+    test_check(test_handshake(alice, alice_id, bob, bob_id), "spoof", "new handshake");
+    frame_size = test_seal_frame(alice, alice_id, bob_id, text, frame);
+    test_check(
+        frame_size > 0 && test_open_frame(bob, alice_id, frame, frame_size, text),
+        "spoof",
+        "new keys to bob");
+    frame_size = test_seal_frame(bob, bob_id, alice_id, text, frame);
+    test_check(
+        frame_size > 0 && test_open_frame(alice, bob_id, frame, frame_size, text),
+        "spoof",
+        "new keys to alice");
+
+    bitchat_noise_free(alice);
+    bitchat_noise_free(bob);
+}
+
+int main(void) {
+    test_aead();
+    test_frame();
+    test_spoof();
+
+    if(test_failures > 0) {
+        printf("%lu checks failed\n", (unsigned long)test_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
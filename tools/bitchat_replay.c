@@ -0,0 +1,471 @@
+/**
+ * BitChat Capture Replay
+ * Replays a frame capture (storage/bitchat_capture) on a host through the
+ * same receive pipeline the app runs, timing each stage
+ *
+ * Stages, as in bitchat_ble_receive_frame():
+ *   link        v2/v3 frames expanded to v1 with a per-link alias context
+ *   classify    header peeked and routed; frames routed nowhere stop here
+ *   reassemble  fragment packets collected until a frame is rebuilt
+ *   decode      bitchat_packet_decode()
+ *   payload     message or announcement payload decoded
+ *
+ * Sent frames are replayed too, each link direction with its own context,
+ * so both sides of a conversation are exercised.
+ *
+ * Replay is deterministic: the tick the fragment reassembler sees follows
+ * the capture's timestamps and the random source is seeded. By default
+ * frames are replayed as fast as possible; --realtime keeps their spacing.
+ *
+ * Build from the repository root:
+ *   cc -O2 -Itools/host -I. -o bitchat_replay tools/bitchat_replay.c \
+ *       protocol/bitchat_protocol.c protocol/bitchat_fragment.c \
+ *       ble/bitchat_link_context.c utils/bitchat_metrics.c utils/bitchat_log.c \
+ *       utils/bitchat_heap.c
+ *
+ * Usage: bitchat_replay [--realtime] [--repeat N] [--metrics FILE] capture.bcap
+ */
+
+#include "protocol/bitchat_protocol.h"
+#include "protocol/bitchat_fragment.h"
+#include "ble/bitchat_link_context.h"
+#include "storage/bitchat_capture.h"
+#include "storage/bitchat_writer.h"
+#include "utils/bitchat_metrics.h"
+#include "utils/bitchat_heap.h"
+#include <furi.h>
+#include <furi_hal_random.h>
+#include <time.h>
+#include <errno.h>
+
+#define TAG "BitchatReplay"
+#define REPLAY_MAX_LINKS 32
+#define REPLAY_BUFFER_SIZE BITCHAT_FRAGMENT_MAX_FRAME
+
+typedef enum {
+    ReplayStageLink,
+    ReplayStageClassify,
+    ReplayStageReassemble,
+    ReplayStageDecode,
+    ReplayStagePayload,
+    ReplayStageCount,
+} ReplayStage;
+
+static const char* const replay_stage_names[ReplayStageCount] = {
+    [ReplayStageLink] = "link",
+    [ReplayStageClassify] = "classify",
+    [ReplayStageReassemble] = "reassemble",
+    [ReplayStageDecode] = "decode",
+    [ReplayStagePayload] = "payload",
+};
+
+typedef struct {
+    uint32_t count;
+    uint32_t failed;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} ReplayStageStats;
+
+/**
+ * One direction of one link
+ */
+typedef struct {
+    uint8_t peer_id[8];
+    uint8_t direction;
+    BitchatLinkContext context;
+} ReplayLink;
+
+typedef struct {
+    ReplayLink links[REPLAY_MAX_LINKS];
+    size_t link_count;
+    BitchatReassembler* reassemblers[2]; // By direction
+    uint8_t buffer[REPLAY_BUFFER_SIZE];
+
+    ReplayStageStats stages[ReplayStageCount];
+    uint32_t frames[2]; // By direction
+    uint32_t truncated;
+    uint32_t reassembled;
+    uint32_t messages;
+    uint32_t announcements;
+} Replay;
+
+// Replay time, in capture milliseconds
+static uint32_t replay_tick;
+static uint32_t replay_random_state = 0x2545F491;
+
+/**
+ * Tick the protocol code sees; follows the capture
+ */
+uint32_t furi_get_tick(void) {
+    return replay_tick;
+}
+
+/**
+ * Seeded xorshift so runs repeat exactly
+ */
+uint32_t furi_hal_random_get(void) {
+    replay_random_state ^= replay_random_state << 13;
+    replay_random_state ^= replay_random_state >> 17;
+    replay_random_state ^= replay_random_state << 5;
+    return replay_random_state;
+}
+
+// The metrics snapshot is the only thing written; it goes straight to a file
+struct BitchatWriter {
+    uint32_t unused;
+};
+
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    UNUSED(writer);
+    FILE* file = fopen(path, "wb");
+    bool success = file && fwrite(data, 1, size, file) == size;
+    if(file) fclose(file);
+    if(callback) callback(context, success);
+    return success;
+}
+
+static uint64_t replay_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void replay_sleep_until_ns(uint64_t deadline) {
+    uint64_t now = replay_now_ns();
+    if(deadline <= now) return;
+    uint64_t wait = deadline - now;
+    struct timespec duration = {.tv_sec = wait / 1000000000ULL, .tv_nsec = wait % 1000000000ULL};
+    while(nanosleep(&duration, &duration) != 0 && errno == EINTR) {
+    }
+}
+
+static uint16_t replay_read_u16(const uint8_t* data) {
+    return ((uint16_t)data[0] << 8) | data[1];
+}
+
+static uint32_t replay_read_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) |
+           data[3];
+}
+
+/**
+ * Record one stage run
+ */
+static void replay_observe(Replay* replay, ReplayStage stage, uint64_t start, bool success) {
+    uint64_t elapsed = replay_now_ns() - start;
+    ReplayStageStats* stats = &replay->stages[stage];
+    stats->count++;
+    stats->total_ns += elapsed;
+    if(elapsed > stats->max_ns) stats->max_ns = elapsed;
+    if(!success) stats->failed++;
+}
+
+/**
+ * Find or add the context for one direction of a link
+ */
+static ReplayLink* replay_find_link(Replay* replay, const uint8_t* peer_id, uint8_t direction) {
+    for(size_t i = 0; i < replay->link_count; i++) {
+        ReplayLink* link = &replay->links[i];
+        if(link->direction == direction && memcmp(link->peer_id, peer_id, 8) == 0) {
+            return link;
+        }
+    }
+    if(replay->link_count == REPLAY_MAX_LINKS) return NULL;
+
+    ReplayLink* link = &replay->links[replay->link_count++];
+    memcpy(link->peer_id, peer_id, 8);
+    link->direction = direction;
+    bitchat_link_context_reset(&link->context);
+    return link;
+}
+
+/**
+ * Forget all link and reassembly state, as after a reconnect
+ */
+static void replay_reset(Replay* replay) {
+    replay->link_count = 0;
+    for(size_t i = 0; i < 2; i++) {
+        if(replay->reassemblers[i]) bitchat_reassembler_free(replay->reassemblers[i]);
+        replay->reassemblers[i] = bitchat_reassembler_alloc();
+    }
+}
+
+/**
+ * Route a v1 frame from its header, as the BLE layer does
+ * The capture does not record our peer ID; all zeros stands in for it.
+ * @return false if the frame is dropped
+ */
+static bool replay_classify(Replay* replay, const uint8_t* frame, size_t size) {
+    static const uint8_t local_peer_id[8] = {0};
+    uint64_t start = replay_now_ns();
+    BitchatPacketHeader header;
+    bool routed = bitchat_packet_peek_header(frame, size, &header) &&
+                  bitchat_packet_classify(&header, local_peer_id) != BitchatRouteDrop;
+    replay_observe(replay, ReplayStageClassify, start, routed);
+    return routed;
+}
+
+/**
+ * Run one frame through the pipeline
+ */
+static void replay_frame(
+    Replay* replay,
+    uint8_t direction,
+    const uint8_t* peer_id,
+    uint64_t epoch,
+    const uint8_t* data,
+    size_t size) {
+    uint8_t* buffer = replay->buffer;
+
+    // Link: normalize to v1
+    uint64_t start = replay_now_ns();
+    size_t frame_size = 0;
+    if(size == 0) {
+        // Nothing to normalize; counted as a link failure
+    } else if(data[0] == BITCHAT_VERSION_COMPACT) {
+        frame_size = bitchat_packet_expand(data, size, epoch, buffer, REPLAY_BUFFER_SIZE);
+    } else if(data[0] == BITCHAT_VERSION_ALIASED) {
+        ReplayLink* link = replay_find_link(replay, peer_id, direction);
+        if(link) {
+            frame_size = bitchat_link_decompress(
+                &link->context, data, size, epoch, buffer, REPLAY_BUFFER_SIZE);
+        }
+    } else if(size <= REPLAY_BUFFER_SIZE) {
+        memcpy(buffer, data, size);
+        frame_size = size;
+    }
+    replay_observe(replay, ReplayStageLink, start, frame_size > 0);
+    if(frame_size == 0) return;
+
+    // Classify: frames routed nowhere never reach reassembly or decode
+    if(!replay_classify(replay, buffer, frame_size)) return;
+
+    // Reassemble: fragments are held until a frame is rebuilt
+    if(buffer[1] == BITCHAT_PACKET_TYPE_FRAGMENT) {
+        start = replay_now_ns();
+        size_t offset;
+        size_t length;
+        const uint8_t* frame = NULL;
+        size_t rebuilt_size = 0;
+        bool located = bitchat_packet_locate_payload(buffer, frame_size, &offset, &length);
+        if(located && bitchat_reassembler_add(
+                          replay->reassemblers[direction],
+                          &buffer[BITCHAT_HEADER_SIZE],
+                          &buffer[offset],
+                          length,
+                          &frame,
+                          &rebuilt_size)) {
+            memmove(buffer, frame, rebuilt_size);
+            replay->reassembled++;
+        }
+        frame_size = rebuilt_size;
+        replay_observe(replay, ReplayStageReassemble, start, located);
+        if(frame_size == 0) return;
+        if(!replay_classify(replay, buffer, frame_size)) return;
+    }
+
+    // Decode
+    start = replay_now_ns();
+    BitchatPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    bool decoded = bitchat_packet_decode(buffer, frame_size, &packet);
+    replay_observe(replay, ReplayStageDecode, start, decoded);
+    if(!decoded) return;
+
+    // Payload: the types the app turns into chat and peer updates
+    if(packet.payload && !packet.is_compressed) {
+        if(packet.type == BITCHAT_PACKET_TYPE_PUBLIC_MESSAGE) {
+            static BitchatMessage message;
+            start = replay_now_ns();
+            bool success = bitchat_message_decode(packet.payload, packet.payload_length, &message);
+            replay_observe(replay, ReplayStagePayload, start, success);
+            if(success) replay->messages++;
+        } else if(packet.type == BITCHAT_PACKET_TYPE_ANNOUNCEMENT) {
+            BitchatAnnouncement announcement;
+            start = replay_now_ns();
+            bool success = bitchat_announcement_decode(
+                packet.payload, packet.payload_length, &announcement);
+            replay_observe(replay, ReplayStagePayload, start, success);
+            if(success) replay->announcements++;
+        }
+    }
+    bitchat_heap_free(packet.payload);
+}
+
+/**
+ * Replay every record once
+ * @return false if the capture is malformed
+ */
+static bool replay_pass(Replay* replay, const uint8_t* file, size_t file_size, bool realtime) {
+    uint32_t tick_base = replay_tick;
+    uint64_t wall_start = replay_now_ns();
+    size_t position = BITCHAT_CAPTURE_FILE_HEADER_SIZE;
+
+    replay_reset(replay);
+    while(position < file_size) {
+        if(file_size - position < BITCHAT_CAPTURE_RECORD_HEADER_SIZE) {
+            fprintf(stderr, "Truncated record header at offset %zu\n", position);
+            return false;
+        }
+        const uint8_t* record = &file[position];
+        uint32_t timestamp = replay_read_u32(&record[0]);
+        uint8_t direction = record[4];
+        size_t captured = replay_read_u16(&record[6]);
+        size_t original = replay_read_u16(&record[8]);
+        const uint8_t* peer_id = &record[10];
+        uint64_t epoch = ((uint64_t)replay_read_u32(&record[18]) << 32) |
+                         replay_read_u32(&record[22]);
+        const uint8_t* data = &record[BITCHAT_CAPTURE_RECORD_HEADER_SIZE];
+        if(direction > BitchatCaptureDirectionTx ||
+           file_size - position - BITCHAT_CAPTURE_RECORD_HEADER_SIZE < captured) {
+            fprintf(stderr, "Bad record at offset %zu\n", position);
+            return false;
+        }
+        position += BITCHAT_CAPTURE_RECORD_HEADER_SIZE + captured;
+
+        replay_tick = tick_base + timestamp;
+        if(realtime) {
+            replay_sleep_until_ns(wall_start + (uint64_t)timestamp * 1000000ULL);
+        }
+
+        replay->frames[direction]++;
+        if(captured < original) {
+            // Cut at capture time; the rest of the frame is unknown
+            replay->truncated++;
+            continue;
+        }
+        replay_frame(replay, direction, peer_id, epoch, data, captured);
+    }
+
+    // Let partial fragment sets from this pass time out before the next
+    replay_tick += 60 * 1000;
+    return true;
+}
+
+static void replay_report(const Replay* replay, const char* path, uint32_t passes, uint64_t ns) {
+    printf(
+        "%s: %lu frames (%lu rx, %lu tx), %lu pass(es) in %.3f ms\n",
+        path,
+        (unsigned long)(replay->frames[0] + replay->frames[1]),
+        (unsigned long)replay->frames[BitchatCaptureDirectionRx],
+        (unsigned long)replay->frames[BitchatCaptureDirectionTx],
+        (unsigned long)passes,
+        ns / 1e6);
+    printf(
+        "%lu reassembled, %lu messages, %lu announcements, %lu truncated in capture\n\n",
+        (unsigned long)replay->reassembled,
+        (unsigned long)replay->messages,
+        (unsigned long)replay->announcements,
+        (unsigned long)replay->truncated);
+
+    printf("%-11s %9s %7s %11s %9s %9s\n", "stage", "count", "failed", "total ms", "mean us", "max us");
+    for(size_t i = 0; i < ReplayStageCount; i++) {
+        const ReplayStageStats* stats = &replay->stages[i];
+        printf(
+            "%-11s %9lu %7lu %11.3f %9.3f %9.3f\n",
+            replay_stage_names[i],
+            (unsigned long)stats->count,
+            (unsigned long)stats->failed,
+            stats->total_ns / 1e6,
+            stats->count > 0 ? stats->total_ns / 1e3 / stats->count : 0.0,
+            stats->max_ns / 1e3);
+    }
+}
+
+static uint8_t* replay_load(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if(!file) return NULL;
+
+    uint8_t* data = NULL;
+    if(fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if(length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc(length > 0 ? length : 1);
+            if(fread(data, 1, length, file) == (size_t)length) {
+                *size = length;
+            } else {
+                free(data);
+                data = NULL;
+            }
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+static int replay_usage(const char* name) {
+    fprintf(stderr, "Usage: %s [--realtime] [--repeat N] [--metrics FILE] capture.bcap\n", name);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    bool realtime = false;
+    uint32_t repeat = 1;
+    const char* metrics_path = NULL;
+    const char* path = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = strtoul(argv[++i], NULL, 10);
+            if(repeat == 0) return replay_usage(argv[0]);
+        } else if(strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if(argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            return replay_usage(argv[0]);
+        }
+    }
+    if(!path) return replay_usage(argv[0]);
+
+    size_t file_size = 0;
+    uint8_t* file = replay_load(path, &file_size);
+    if(!file) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 1;
+    }
+    if(file_size < BITCHAT_CAPTURE_FILE_HEADER_SIZE ||
+       memcmp(file, BITCHAT_CAPTURE_MAGIC, 4) != 0 ||
+       replay_read_u16(&file[4]) != BITCHAT_CAPTURE_VERSION) {
+        fprintf(stderr, "%s is not a version %d capture\n", path, BITCHAT_CAPTURE_VERSION);
+        free(file);
+        return 1;
+    }
+
+    Replay* replay = calloc(1, sizeof(Replay));
+
+    int result = 0;
+    uint64_t start = replay_now_ns();
+    uint32_t passes = 0;
+    while(passes < repeat) {
+        passes++;
+        if(!replay_pass(replay, file, file_size, realtime)) {
+            result = 1;
+            break;
+        }
+    }
+    replay_report(replay, path, passes, replay_now_ns() - start);
+
+    if(metrics_path) {
+        // The stack's own counters and histograms, in the app's metrics.txt format
+        BitchatMetricsSnapshot snapshot;
+        BitchatWriter writer;
+        bitchat_metrics_snapshot(&snapshot);
+        if(!bitchat_metrics_save(&snapshot, &writer, metrics_path)) result = 1;
+    }
+
+    for(size_t i = 0; i < 2; i++) {
+        bitchat_reassembler_free(replay->reassemblers[i]);
+    }
+    free(replay);
+    free(file);
+    return result;
+}
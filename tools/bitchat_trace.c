@@ -0,0 +1,106 @@
+/**
+ * BitChat Trace Formatter
+ * Formats a binary trace saved by the app (bitchat/trace.bin) on a host,
+ * with the same format strings the device would use
+ *
+ * Build from the repository root:
+ *   cc -O2 -Itools/host -I. -o bitchat_trace tools/bitchat_trace.c utils/bitchat_log.c
+ *
+ * Usage: bitchat_trace trace.bin
+ */
+
+#include "utils/bitchat_log.h"
+#include "storage/bitchat_writer.h"
+#include <furi.h>
+
+#define TAG "BitchatTraceTool"
+
+/**
+ * Only needed to link bitchat_log.c; nothing is recorded here
+ */
+uint32_t furi_get_tick(void) {
+    return 0;
+}
+
+bool bitchat_writer_replace(
+    BitchatWriter* writer,
+    const char* path,
+    const void* data,
+    size_t size,
+    BitchatWriterCallback callback,
+    void* context) {
+    UNUSED(writer);
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    UNUSED(callback);
+    UNUSED(context);
+    return false;
+}
+
+static uint32_t trace_read_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) |
+           data[3];
+}
+
+int main(int argc, char** argv) {
+    if(argc != 2) {
+        fprintf(stderr, "Usage: %s trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if(!file) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    uint8_t header[BITCHAT_TRACE_FILE_HEADER_SIZE];
+    if(fread(header, 1, sizeof(header), file) != sizeof(header) ||
+       memcmp(header, BITCHAT_TRACE_MAGIC, 4) != 0 ||
+       ((header[4] << 8) | header[5]) != BITCHAT_TRACE_VERSION) {
+        fprintf(stderr, "%s is not a version %d trace\n", argv[1], BITCHAT_TRACE_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    size_t count = (header[6] << 8) | header[7];
+    uint8_t record[BITCHAT_TRACE_ENTRY_SIZE];
+    char line[128];
+    bool have_previous = false;
+    uint32_t previous = 0;
+    int result = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(fread(record, 1, sizeof(record), file) != sizeof(record)) {
+            fprintf(stderr, "Trace truncated after %zu of %zu entries\n", i, count);
+            result = 1;
+            break;
+        }
+
+        // Ticks were converted to milliseconds when saved
+        BitchatTraceEntry entry;
+        entry.tick = trace_read_u32(&record[0]);
+        entry.sequence = trace_read_u32(&record[4]);
+        entry.id = (record[8] << 8) | record[9];
+        for(size_t a = 0; a < 3; a++) {
+            entry.args[a] = trace_read_u32(&record[12 + a * 4]);
+        }
+
+        // Records overwritten while the ring was copied leave a gap
+        if(have_previous && entry.sequence != previous + 1) {
+            printf("... %lu events lost\n", (unsigned long)(entry.sequence - previous - 1));
+        }
+        have_previous = true;
+        previous = entry.sequence;
+
+        bitchat_trace_format(&entry, line, sizeof(line));
+        printf(
+            "#%-6lu %10lu ms  %s\n",
+            (unsigned long)entry.sequence,
+            (unsigned long)entry.tick,
+            line);
+    }
+
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,104 @@
+/**
+ * Host shim for the parts of furi.h the protocol code uses
+ * Only for tools/; never built into the app
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define furi_assert(x) assert(x)
+#define furi_check(x) assert(x)
+#define UNUSED(x) (void)(x)
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#define APP_DATA_PATH(path) "./" path
+
+// Silent unless BITCHAT_HOST_VERBOSE; tools report failures themselves
+#ifdef BITCHAT_HOST_VERBOSE
+#define FURI_LOG_E(tag, format, ...) fprintf(stderr, "[E][%s] " format "\n", tag, ##__VA_ARGS__)
+#define FURI_LOG_W(tag, format, ...) fprintf(stderr, "[W][%s] " format "\n", tag, ##__VA_ARGS__)
+#define FURI_LOG_I(tag, format, ...) fprintf(stderr, "[I][%s] " format "\n", tag, ##__VA_ARGS__)
+#define FURI_LOG_D(tag, format, ...) fprintf(stderr, "[D][%s] " format "\n", tag, ##__VA_ARGS__)
+#else
+#define FURI_LOG_E(tag, format, ...) \
+    do {                             \
+        if(0) fprintf(stderr, format, ##__VA_ARGS__); \
+    } while(0)
+#define FURI_LOG_W(tag, format, ...) \
+    do {                             \
+        if(0) fprintf(stderr, format, ##__VA_ARGS__); \
+    } while(0)
+#define FURI_LOG_I(tag, format, ...) \
+    do {                             \
+        if(0) fprintf(stderr, format, ##__VA_ARGS__); \
+    } while(0)
+#define FURI_LOG_D(tag, format, ...) \
+    do {                             \
+        if(0) fprintf(stderr, format, ##__VA_ARGS__); \
+    } while(0)
+#endif
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriStatusOk = 0,
+} FuriStatus;
+
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+/**
+ * Tools are single-threaded, so a mutex only has to exist
+ */
+typedef struct {
+    uint32_t unused;
+} FuriMutex;
+
+static inline FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    UNUSED(type);
+    return calloc(1, sizeof(FuriMutex));
+}
+
+static inline void furi_mutex_free(FuriMutex* mutex) {
+    free(mutex);
+}
+
+static inline FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    UNUSED(mutex);
+    UNUSED(timeout);
+    return FuriStatusOk;
+}
+
+static inline FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    UNUSED(mutex);
+    return FuriStatusOk;
+}
+
+/**
+ * Tick source, defined by the tool so time can follow a capture
+ */
+uint32_t furi_get_tick(void);
+
+static inline uint32_t furi_kernel_get_tick_frequency(void) {
+    return 1000;
+}
+
+static inline uint32_t furi_ms_to_ticks(uint32_t milliseconds) {
+    return milliseconds;
+}
+
+static inline size_t memmgr_get_free_heap(void) {
+    return 0;
+}
+
+static inline size_t memmgr_get_minimum_free_heap(void) {
+    return 0;
+}
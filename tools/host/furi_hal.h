@@ -0,0 +1,9 @@
+/**
+ * Host shim for furi_hal.h
+ */
+
+#pragma once
+
+#include <furi_hal_random.h>
+#include <furi_hal_rtc.h>
+#include <furi_hal_cortex.h>
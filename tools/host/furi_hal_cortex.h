@@ -0,0 +1,30 @@
+/**
+ * Host shim for furi_hal_cortex.h
+ * DWT->CYCCNT reads the monotonic clock as a 64 MHz cycle counter
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#define HOST_CYCLES_PER_MICROSECOND 64
+
+typedef struct {
+    uint32_t CYCCNT;
+} HostDwt;
+
+static inline HostDwt* host_dwt(void) {
+    static HostDwt dwt;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    dwt.CYCCNT = (uint32_t)(ns * HOST_CYCLES_PER_MICROSECOND / 1000);
+    return &dwt;
+}
+
+#define DWT (host_dwt())
+
+static inline uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+    return HOST_CYCLES_PER_MICROSECOND;
+}
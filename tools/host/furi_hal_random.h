@@ -0,0 +1,16 @@
+/**
+ * Host shim for furi_hal_random.h
+ * Defined by the tool, seeded so runs repeat exactly
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+uint32_t furi_hal_random_get(void);
+
+static inline void furi_hal_random_fill_buf(uint8_t* buffer, uint32_t size) {
+    for(uint32_t i = 0; i < size; i++) {
+        buffer[i] = furi_hal_random_get() & 0xFF;
+    }
+}
@@ -0,0 +1,31 @@
+/**
+ * Host shim for furi_hal_rtc.h
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct {
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+    uint8_t weekday;
+} DateTime;
+
+static inline void furi_hal_rtc_get_datetime(DateTime* datetime) {
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    datetime->hour = tm.tm_hour;
+    datetime->minute = tm.tm_min;
+    datetime->second = tm.tm_sec;
+    datetime->day = tm.tm_mday;
+    datetime->month = tm.tm_mon + 1;
+    datetime->year = tm.tm_year + 1900;
+    datetime->weekday = tm.tm_wday;
+}
@@ -3,43 +3,644 @@
  */
 
 #include "chat_view.h"
+#include "../storage/bitchat_history.h"
+#include "../utils/bitchat_names.h"
+#include "../utils/bitchat_metrics.h"
+#include "../utils/bitchat_log.h"
+#include "../utils/bitchat_heap.h"
 #include <gui/elements.h>
 #include <furi.h>
 #include <string.h>
 
 #define TAG "ChatView"
-#define MAX_MESSAGES 50
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_UI
+#define MAX_MESSAGES 60
 #define MESSAGE_DISPLAY_LINES 5
-#define MAX_LINE_LENGTH 22  // Flipper screen is ~128 pixels wide
+#define MESSAGE_MAX_LINES 8 // Wrapped lines kept per message; the rest is cut off
+#define MESSAGE_TEXT_WIDTH 124 // Flipper screen is 128 pixels wide
+#define OWN_MARKER_WIDTH 6 // Own messages are indented past the ">" marker
+#define GLYPH_FIRST ' '
+#define GLYPH_COUNT 95 // Printable ASCII
+#define HISTORY_PAGE_SIZE 10 // Records paged in per scroll past the window edge
+#define HISTORY_SCAN_PAGES 8 // Pages looked through per scroll for the thread's next message
+#define MESSAGE_NOT_STORED UINT32_MAX
+#define FRAME_INTERVAL_MS 50 // Model changes are batched into at most one redraw per frame
+#define STAGING_SIZE 8 // Messages posted between two frames; the oldest is dropped past this
+#define PEER_NAME_SIZE 32
 
 typedef struct {
-    char sender[32];
+    uint32_t seq; // History record, or MESSAGE_NOT_STORED
+    BitchatName sender; // Held while the message is in the window or staged
     char content[128];
     bool is_own;
+    bool is_private; // Sender names the other party of the thread
     uint32_t timestamp;
+    // Wrap layout, computed on first use once the font is measured
+    uint8_t line_count; // 0 until laid out
+    uint8_t line_start[MESSAGE_MAX_LINES]; // Offsets into content; line 0 follows the sender
 } ChatMessage;
 
+/**
+ * One buffer of updates posted since the last frame
+ */
+typedef struct {
+    ChatMessage messages[STAGING_SIZE]; // Ring, oldest at start
+    size_t start;
+    size_t count;
+    uint8_t peer_count;
+    bool is_connected;
+    bool peer_count_changed;
+    bool connected_changed;
+} ChatViewStaging;
+
+/**
+ * Updates posted from any thread, applied on the GUI thread
+ * Producers fill the back buffer; the GUI thread swaps buffers and applies
+ * the other one to the model. The mutex is only held to stage one update or
+ * to swap, and the GUI thread merely tries it, so draw never waits on ingest
+ * and ingest never waits on draw.
+ */
+typedef struct {
+    FuriMutex* mutex;
+    ChatViewStaging buffers[2];
+    ChatViewStaging* back;
+    bool dirty; // Changed since the last draw picked up the back buffer
+    uint32_t redraws_requested;
+    uint32_t overruns;
+} ChatViewInbox;
+
 typedef struct {
+    // Ring of the window's messages, oldest at head; see chat_view_message()
     ChatMessage messages[MAX_MESSAGES];
+    size_t head;
     size_t message_count;
-    size_t scroll_offset;
+    size_t scroll_offset; // Message at the top of the screen
+    uint8_t scroll_line; // Wrapped line of that message at the top
+    bool follow; // Keep the newest line in view
+    // Stored records [history_floor, history_ceiling) cover the window
+    uint32_t history_floor;
+    uint32_t history_ceiling;
+    uint32_t history_first; // Older records were compacted away
+    bool newer_in_history; // Records past history_ceiling arrived while paged back
+    char private_peer[PEER_NAME_SIZE]; // Thread on screen; empty for the public room
+    BitchatNames* names; // Shared with the app
+    char loading[16]; // Startup stage in progress, empty once ready
     uint8_t peer_count;
     bool is_connected;
     char local_nickname[32];
+    uint8_t glyph_width[GLYPH_COUNT]; // FontSecondary advances, measured on first draw
+    bool font_measured;
+    ChatViewInbox* inbox; // Owned by the ChatView
+    uint32_t redraws_requested; // By input
+    uint32_t redraws_performed;
     ChatViewCallback callback;
     void* callback_context;
 } ChatViewModel;
 
 struct ChatView {
     View* view;
+    BitchatHistory* history;
+    BitchatNames* names;
+    FuriTimer* redraw_timer;
+    ChatViewInbox inbox;
+    // History is read into the page with the model unlocked, then installed
+    FuriMutex* page_mutex;
+    ChatMessage page[HISTORY_PAGE_SIZE];
 };
 
+/**
+ * Records of one thread read from history, not yet in the window
+ */
+typedef struct {
+    BitchatNames* names;
+    const char* private_peer; // Thread being read; empty for the public room
+    ChatMessage* messages; // HISTORY_PAGE_SIZE slots
+    size_t count;
+} ChatViewHistoryLoad;
+
+/**
+ * Get the window's index-th message, counting from the oldest
+ */
+static ChatMessage* chat_view_message(ChatViewModel* model, size_t index) {
+    return &model->messages[(model->head + index) % MAX_MESSAGES];
+}
+
+/**
+ * Drop the sender references of messages leaving the window
+ * @param first Index of the first, counting from the oldest
+ */
+static void chat_view_release_messages(ChatViewModel* model, size_t first, size_t count) {
+    for(size_t i = first; i < first + count; i++) {
+        bitchat_names_release(model->names, chat_view_message(model, i)->sender);
+    }
+}
+
+/**
+ * Take the back buffer to stage an update into
+ */
+static ChatViewStaging* chat_view_stage_begin(ChatView* chat_view) {
+    furi_mutex_acquire(chat_view->inbox.mutex, FuriWaitForever);
+    return chat_view->inbox.back;
+}
+
+/**
+ * Release the back buffer and schedule a redraw at the end of the frame
+ * Changes until the timer fires share one redraw.
+ */
+static void chat_view_stage_end(ChatView* chat_view) {
+    chat_view->inbox.dirty = true;
+    chat_view->inbox.redraws_requested++;
+    furi_mutex_release(chat_view->inbox.mutex);
+
+    if(!furi_timer_is_running(chat_view->redraw_timer)) {
+        furi_timer_start(chat_view->redraw_timer, furi_ms_to_ticks(FRAME_INTERVAL_MS));
+    }
+}
+
+/**
+ * Schedule a redraw for a change made directly to the model
+ */
+static void chat_view_request_redraw(ChatView* chat_view) {
+    chat_view_stage_begin(chat_view);
+    chat_view_stage_end(chat_view);
+}
+
+/**
+ * Redraw if anything changed since the last frame was drawn
+ */
+static void chat_view_redraw_timer_callback(void* context) {
+    ChatView* chat_view = context;
+
+    furi_mutex_acquire(chat_view->inbox.mutex, FuriWaitForever);
+    bool dirty = chat_view->inbox.dirty;
+    furi_mutex_release(chat_view->inbox.mutex);
+
+    if(dirty) {
+        with_view_model(
+            chat_view->view,
+            ChatViewModel* model,
+            {
+                UNUSED(model);
+            },
+            true);
+    }
+}
+
+/**
+ * Check whether a message belongs to the thread on screen
+ */
+static bool chat_view_in_conversation(const char* private_peer, bool is_private, const char* sender) {
+    if(!is_private) return private_peer[0] == '\0';
+    return strcmp(sender, private_peer) == 0;
+}
+
+/**
+ * Copy one history record of the thread into the page being loaded
+ */
+static void chat_view_history_load_callback(void* context, const BitchatHistoryRecord* record) {
+    ChatViewHistoryLoad* load = context;
+    bool is_private = record->flags & BITCHAT_HISTORY_FLAG_PRIVATE;
+    if(!chat_view_in_conversation(load->private_peer, is_private, record->sender)) return;
+    if(load->count == HISTORY_PAGE_SIZE) return;
+
+    ChatMessage* msg = &load->messages[load->count++];
+
+    msg->seq = record->seq;
+    msg->sender = bitchat_names_acquire(load->names, record->sender);
+    strncpy(msg->content, record->content, sizeof(msg->content) - 1);
+    msg->content[sizeof(msg->content) - 1] = '\0';
+    msg->is_own = record->flags & BITCHAT_HISTORY_FLAG_OWN;
+    msg->is_private = is_private;
+    msg->timestamp = record->timestamp;
+    msg->line_count = 0;
+}
+
+/**
+ * Get the width of one byte of text
+ */
+static uint8_t chat_view_glyph_width(const ChatViewModel* model, char c) {
+    uint8_t index = (uint8_t)c - GLYPH_FIRST;
+    // Bytes outside printable ASCII are measured as a wide glyph
+    if(index >= GLYPH_COUNT) index = 'W' - GLYPH_FIRST;
+    return model->glyph_width[index];
+}
+
+/**
+ * Get the width of a run of text
+ */
+static uint16_t chat_view_text_width(const ChatViewModel* model, const char* text, size_t length) {
+    uint16_t width = 0;
+    for(size_t i = 0; i < length; i++) {
+        width += chat_view_glyph_width(model, text[i]);
+    }
+    return width;
+}
+
+/**
+ * Wrap a message to the screen width, breaking after a space where possible
+ */
+static void chat_view_layout_message(const ChatViewModel* model, ChatMessage* msg) {
+    const char* sender = msg->is_own ? "You" : bitchat_names_get(model->names, msg->sender);
+    uint16_t width = MESSAGE_TEXT_WIDTH - (msg->is_own ? OWN_MARKER_WIDTH : 0);
+    uint16_t x = chat_view_text_width(model, sender, strlen(sender)) +
+                 chat_view_text_width(model, ": ", 2);
+    size_t length = strlen(msg->content);
+    size_t line = 0;
+    size_t space = 0; // Offset just past the line's last space, 0 if none
+
+    msg->line_start[0] = 0;
+    for(size_t i = 0; i < length; i++) {
+        uint8_t glyph = chat_view_glyph_width(model, msg->content[i]);
+        if(x + glyph > width && i > msg->line_start[line]) {
+            if(line + 1 == MESSAGE_MAX_LINES) break;
+            size_t start = space > msg->line_start[line] ? space : i;
+            msg->line_start[++line] = start;
+            x = chat_view_text_width(model, &msg->content[start], i - start);
+            space = 0;
+        }
+        x += glyph;
+        if(msg->content[i] == ' ') space = i + 1;
+    }
+    msg->line_count = line + 1;
+}
+
+/**
+ * Get a message's wrapped line count, laying it out on first use
+ * Until the font is measured every message counts as one line.
+ */
+static uint8_t chat_view_message_lines(ChatViewModel* model, ChatMessage* msg) {
+    if(msg->line_count == 0) {
+        if(!model->font_measured) return 1;
+        chat_view_layout_message(model, msg);
+    }
+    return msg->line_count;
+}
+
+/**
+ * Put the newest wrapped line at the bottom of the screen
+ */
+static void chat_view_scroll_to_bottom(ChatViewModel* model) {
+    size_t lines = 0;
+    size_t index = model->message_count;
+
+    model->scroll_offset = 0;
+    model->scroll_line = 0;
+    while(index > 0) {
+        index--;
+        lines += chat_view_message_lines(model, chat_view_message(model, index));
+        if(lines >= MESSAGE_DISPLAY_LINES) {
+            model->scroll_offset = index;
+            model->scroll_line = lines - MESSAGE_DISPLAY_LINES;
+            break;
+        }
+    }
+}
+
+/**
+ * Check whether wrapped lines below the screen are still in the window
+ */
+static bool chat_view_more_below(ChatViewModel* model) {
+    size_t lines = 0;
+    for(size_t i = model->scroll_offset; i < model->message_count; i++) {
+        lines += chat_view_message_lines(model, chat_view_message(model, i));
+        if(i == model->scroll_offset) lines -= model->scroll_line;
+        if(lines > MESSAGE_DISPLAY_LINES) return true;
+    }
+    return false;
+}
+
+/**
+ * Recompute the stored range after messages left the window
+ */
+static void chat_view_update_history_range(ChatViewModel* model) {
+    uint32_t floor = MESSAGE_NOT_STORED;
+    uint32_t ceiling = MESSAGE_NOT_STORED;
+    for(size_t i = 0; i < model->message_count; i++) {
+        ChatMessage* msg = chat_view_message(model, i);
+        if(msg->seq == MESSAGE_NOT_STORED) continue;
+        if(floor == MESSAGE_NOT_STORED) floor = msg->seq;
+        ceiling = msg->seq + 1;
+    }
+    if(floor != MESSAGE_NOT_STORED) {
+        model->history_floor = floor;
+        model->history_ceiling = ceiling;
+    } else {
+        model->history_floor = model->history_ceiling;
+    }
+}
+
+/**
+ * Drop the sender references of a page that did not enter the window
+ */
+static void chat_view_discard_page(ChatViewHistoryLoad* load) {
+    for(size_t i = 0; i < load->count; i++) {
+        bitchat_names_release(load->names, load->messages[i].sender);
+    }
+    load->count = 0;
+}
+
+/**
+ * Put a page read below the window in at the top, dropping the newest if full
+ * Only as many messages are dropped as were loaded.
+ * @param start Lowest record the page covers
+ * @return Number of records loaded
+ */
+static size_t chat_view_install_older(ChatViewModel* model, ChatViewHistoryLoad* load, uint32_t start) {
+    // The newest messages fall off the end; the page goes in before the head
+    size_t read = load->count;
+    uint32_t ceiling = model->history_ceiling;
+    size_t keep = model->message_count;
+    if(keep > MAX_MESSAGES - read) keep = MAX_MESSAGES - read;
+    bool full = keep < model->message_count;
+    chat_view_release_messages(model, keep, model->message_count - keep);
+    model->head = (model->head + MAX_MESSAGES - read) % MAX_MESSAGES;
+    for(size_t i = 0; i < read; i++) {
+        *chat_view_message(model, i) = load->messages[i];
+    }
+    load->count = 0;
+
+    model->message_count = read + keep;
+    chat_view_update_history_range(model);
+    // Nothing of the thread is left unread in [start, floor), nor in
+    // [newest, ceiling) unless the newest were dropped
+    model->history_floor = start;
+    if(!full) model->history_ceiling = ceiling;
+    return read;
+}
+
+/**
+ * Page older records in at the top of the window, dropping the newest if full
+ * History is read with the model unlocked; the page is dropped if the window
+ * moved meanwhile. Call without holding the model.
+ * @return Number of records loaded
+ */
+static size_t chat_view_load_older(ChatView* chat_view) {
+    BitchatHistory* history = chat_view->history;
+    char peer[PEER_NAME_SIZE];
+    uint32_t floor;
+
+    furi_mutex_acquire(chat_view->page_mutex, FuriWaitForever);
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            memcpy(peer, model->private_peer, sizeof(peer));
+            floor = model->history_floor;
+        },
+        false);
+
+    uint32_t first = bitchat_history_first(history);
+    if(floor < first) floor = first;
+    uint32_t available = floor - first;
+    size_t count = available < HISTORY_PAGE_SIZE ? available : HISTORY_PAGE_SIZE;
+    // Live messages may sit above records still being written; wait for those
+    // rather than step over them as if they were gone
+    if(floor > bitchat_history_written_count(history)) count = 0;
+
+    // Pages emptied by compaction or holding only other threads are stepped over
+    ChatViewHistoryLoad load = {
+        .names = chat_view->names, .private_peer = peer, .messages = chat_view->page};
+    uint32_t start = floor;
+    size_t pages = 0;
+    while(count > 0 && load.count == 0 && start > first && pages++ < HISTORY_SCAN_PAGES) {
+        size_t page = start - first < count ? start - first : count;
+        start -= page;
+        bitchat_history_read(history, start, page, chat_view_history_load_callback, &load);
+    }
+
+    size_t read = 0;
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            model->history_first = first;
+            if(model->history_floor < first) model->history_floor = first;
+            if(start != floor && model->history_floor == floor &&
+               strcmp(model->private_peer, peer) == 0) {
+                read = chat_view_install_older(model, &load, start);
+            }
+        },
+        false);
+    chat_view_discard_page(&load);
+    furi_mutex_release(chat_view->page_mutex);
+
+    return read;
+}
+
+/**
+ * Put a page read above the window in at the bottom, dropping the oldest if full
+ * @param next Record after the last one the page covers
+ */
+static void chat_view_install_newer(ChatViewModel* model, ChatViewHistoryLoad* load, uint32_t next) {
+    size_t read = load->count;
+    if(model->message_count + read > MAX_MESSAGES) {
+        size_t drop = model->message_count + read - MAX_MESSAGES;
+        chat_view_release_messages(model, 0, drop);
+        model->head = (model->head + drop) % MAX_MESSAGES;
+        model->message_count -= drop;
+        if(model->scroll_offset > drop) {
+            model->scroll_offset -= drop;
+        } else {
+            model->scroll_offset = 0;
+            model->scroll_line = 0;
+        }
+    }
+    for(size_t i = 0; i < read; i++) {
+        *chat_view_message(model, model->message_count++) = load->messages[i];
+    }
+    load->count = 0;
+
+    chat_view_update_history_range(model);
+    // Nothing of the thread is left unread in [ceiling, next)
+    model->history_ceiling = next;
+}
+
+/**
+ * Page newer records in at the bottom of the window, dropping the oldest if full
+ * History is read with the model unlocked; the page is dropped if the window
+ * moved meanwhile. Call without holding the model.
+ */
+static void chat_view_load_newer(ChatView* chat_view) {
+    BitchatHistory* history = chat_view->history;
+    char peer[PEER_NAME_SIZE];
+    uint32_t ceiling;
+
+    furi_mutex_acquire(chat_view->page_mutex, FuriWaitForever);
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            memcpy(peer, model->private_peer, sizeof(peer));
+            ceiling = model->history_ceiling;
+        },
+        false);
+
+    // Records still being written are paged in on a later call; live messages
+    // may already have moved the ceiling past them
+    uint32_t written = bitchat_history_written_count(history);
+    uint32_t available = written > ceiling ? written - ceiling : 0;
+    size_t count = available < HISTORY_PAGE_SIZE ? available : HISTORY_PAGE_SIZE;
+
+    ChatViewHistoryLoad load = {
+        .names = chat_view->names, .private_peer = peer, .messages = chat_view->page};
+    uint32_t total = ceiling + available;
+    uint32_t next = ceiling;
+    size_t pages = 0;
+    while(load.count == 0 && next < total && pages++ < HISTORY_SCAN_PAGES) {
+        size_t page = total - next < count ? total - next : count;
+        bitchat_history_read(history, next, page, chat_view_history_load_callback, &load);
+        next += page;
+    }
+    uint32_t stored = bitchat_history_count(history);
+
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            if(next != ceiling && model->history_ceiling == ceiling &&
+               strcmp(model->private_peer, peer) == 0) {
+                chat_view_install_newer(model, &load, next);
+            }
+            model->newer_in_history = model->history_ceiling < stored;
+        },
+        false);
+    chat_view_discard_page(&load);
+    furi_mutex_release(chat_view->page_mutex);
+}
+
+/**
+ * Append a message at the bottom of the window
+ * @param sender Reference handed over to the window
+ */
+static void chat_view_push_message(
+    ChatViewModel* model,
+    uint32_t seq,
+    BitchatName sender,
+    const char* message,
+    bool is_own,
+    bool is_private) {
+    if(model->message_count == MAX_MESSAGES) {
+        // Overwrite the oldest
+        chat_view_release_messages(model, 0, 1);
+        model->head = (model->head + 1) % MAX_MESSAGES;
+        model->message_count--;
+    }
+
+    ChatMessage* msg = chat_view_message(model, model->message_count);
+    msg->seq = seq;
+    msg->sender = sender;
+    strncpy(msg->content, message, sizeof(msg->content) - 1);
+    msg->content[sizeof(msg->content) - 1] = '\0';
+    msg->is_own = is_own;
+    msg->is_private = is_private;
+    msg->timestamp = furi_get_tick();
+    msg->line_count = 0;
+    model->message_count++;
+
+    // Auto-scroll to bottom when new message arrives
+    model->follow = true;
+}
+
+/**
+ * Apply the updates posted since the last frame
+ * Only tries the inbox lock; if a producer holds it, its timer brings the
+ * updates in next frame.
+ */
+static void chat_view_apply_staged(ChatViewModel* model) {
+    ChatViewInbox* inbox = model->inbox;
+    if(furi_mutex_acquire(inbox->mutex, 0) != FuriStatusOk) return;
+    ChatViewStaging* front = inbox->back;
+    inbox->back = front == &inbox->buffers[0] ? &inbox->buffers[1] : &inbox->buffers[0];
+    inbox->dirty = false;
+    bitchat_metrics_set(BitchatGaugeChatStaged, 0);
+    furi_mutex_release(inbox->mutex);
+
+    if(front->peer_count_changed) model->peer_count = front->peer_count;
+    if(front->connected_changed) model->is_connected = front->is_connected;
+
+    for(size_t i = 0; i < front->count; i++) {
+        ChatMessage* staged = &front->messages[(front->start + i) % STAGING_SIZE];
+        if(!chat_view_in_conversation(
+               model->private_peer,
+               staged->is_private, bitchat_names_get(model->names, staged->sender))) {
+            // Another thread's record: the window is still complete up to it
+            if(staged->seq == model->history_ceiling) model->history_ceiling++;
+            bitchat_names_release(model->names, staged->sender);
+            continue;
+        }
+
+        if(staged->seq == MESSAGE_NOT_STORED || staged->seq == model->history_ceiling ||
+           (model->follow && staged->seq > model->history_ceiling)) {
+            chat_view_push_message(
+                model,
+                staged->seq,
+                staged->sender,
+                staged->content,
+                staged->is_own,
+                staged->is_private);
+            chat_view_update_history_range(model);
+        } else {
+            // The window was paged back; the record pages in on scrolling down
+            model->newer_in_history = true;
+            bitchat_names_release(model->names, staged->sender);
+        }
+    }
+
+    front->start = 0;
+    front->count = 0;
+    front->peer_count_changed = false;
+    front->connected_changed = false;
+}
+
+/**
+ * Draw one wrapped line of a message
+ */
+static void chat_view_draw_line(
+    Canvas* canvas,
+    const char* sender,
+    const ChatMessage* msg,
+    uint8_t line,
+    uint8_t line_count,
+    uint8_t y_pos) {
+    uint8_t x_pos = 2;
+
+    // Highlight own messages
+    if(msg->is_own) {
+        if(line == 0) canvas_draw_str(canvas, 2, y_pos, ">");
+        x_pos += OWN_MARKER_WIDTH;
+    }
+
+    size_t start = msg->line_start[line];
+    size_t end = line + 1 < line_count ? msg->line_start[line + 1] : strlen(msg->content);
+    char text[BITCHAT_NAME_MAX + sizeof(msg->content) + 3];
+    if(line == 0) {
+        // Format: "sender: message" or "You: message"
+        snprintf(
+            text,
+            sizeof(text),
+            "%s: %.*s",
+            msg->is_own ? "You" : sender,
+            (int)(end - start),
+            &msg->content[start]);
+    } else {
+        snprintf(text, sizeof(text), "%.*s", (int)(end - start), &msg->content[start]);
+    }
+    canvas_draw_str(canvas, x_pos, y_pos, text);
+}
+
 /**
  * Draw callback for chat view
  */
 static void chat_view_draw_callback(Canvas* canvas, void* model) {
     ChatViewModel* vm = model;
 
+    uint32_t start = bitchat_metrics_start();
+
+    // Whatever was posted so far is in this frame
+    chat_view_apply_staged(vm);
+    vm->redraws_performed++;
+    bitchat_metrics_add(BitchatCounterChatFrames, 1);
+
     // Clear screen
     canvas_clear(canvas);
     canvas_set_color(canvas, ColorBlack);
@@ -56,9 +657,15 @@ static void chat_view_draw_callback(Canvas* canvas, void* model) {
         canvas_draw_circle(canvas, 6, 6, 3);
     }
 
-    // Title
+    // Title: the public room, or the peer of a private thread
     canvas_set_font(canvas, FontSecondary);
-    canvas_draw_str(canvas, 12, 9, "BitChat");
+    if(vm->private_peer[0] != '\0') {
+        char title[20];
+        snprintf(title, sizeof(title), "@%s", vm->private_peer);
+        canvas_draw_str(canvas, 12, 9, title);
+    } else {
+        canvas_draw_str(canvas, 12, 9, "BitChat");
+    }
 
     // Peer count
     char peer_str[16];
@@ -66,7 +673,12 @@ static void chat_view_draw_callback(Canvas* canvas, void* model) {
     canvas_draw_str_aligned(canvas, 125, 9, AlignRight, AlignBottom, peer_str);
 
     // Message area
-    if(vm->message_count == 0) {
+    if(vm->loading[0] != '\0') {
+        char stage[32];
+        snprintf(stage, sizeof(stage), "Loading %s...", vm->loading);
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str_aligned(canvas, 64, 35, AlignCenter, AlignCenter, stage);
+    } else if(vm->message_count == 0) {
         // No messages yet
         canvas_set_font(canvas, FontSecondary);
         canvas_draw_str_aligned(canvas, 64, 35, AlignCenter, AlignCenter, "No messages yet");
@@ -75,44 +687,42 @@ static void chat_view_draw_callback(Canvas* canvas, void* model) {
         // Display messages with scrolling
         canvas_set_font(canvas, FontSecondary);
 
-        size_t start_idx = vm->scroll_offset;
-        size_t end_idx = vm->message_count;
-        if(end_idx - start_idx > MESSAGE_DISPLAY_LINES) {
-            end_idx = start_idx + MESSAGE_DISPLAY_LINES;
+        // Glyph widths are read once; messages are wrapped with them on first use
+        if(!vm->font_measured) {
+            for(size_t i = 0; i < GLYPH_COUNT; i++) {
+                vm->glyph_width[i] = canvas_glyph_width(canvas, GLYPH_FIRST + i);
+            }
+            vm->font_measured = true;
+        }
+        if(vm->follow) {
+            chat_view_scroll_to_bottom(vm);
         }
 
+        // Only the lines on screen are visited
+        size_t index = vm->scroll_offset;
+        uint8_t line = vm->scroll_line;
         uint8_t y_pos = 22;
-        for(size_t i = start_idx; i < end_idx; i++) {
-            ChatMessage* msg = &vm->messages[i];
-
-            // Format: "sender: message" or "You: message"
-            char line[64];
-            const char* display_sender = msg->is_own ? "You" : msg->sender;
-
-            // Truncate message if needed
-            char truncated_msg[40];
-            strncpy(truncated_msg, msg->content, sizeof(truncated_msg) - 1);
-            truncated_msg[sizeof(truncated_msg) - 1] = '\0';
-
-            snprintf(line, sizeof(line), "%s: %s", display_sender, truncated_msg);
+        for(size_t drawn = 0; drawn < MESSAGE_DISPLAY_LINES && index < vm->message_count;
+            drawn++) {
+            ChatMessage* msg = chat_view_message(vm, index);
+            uint8_t line_count = chat_view_message_lines(vm, msg);
+            chat_view_draw_line(
+                canvas, bitchat_names_get(vm->names, msg->sender), msg, line, line_count, y_pos);
+            y_pos += 10;
 
-            // Highlight own messages
-            if(msg->is_own) {
-                canvas_draw_str(canvas, 2, y_pos, ">");
-                canvas_draw_str(canvas, 8, y_pos, line);
-            } else {
-                canvas_draw_str(canvas, 2, y_pos, line);
+            if(++line == line_count) {
+                index++;
+                line = 0;
             }
-
-            y_pos += 10;
         }
 
         // Scroll indicators
-        if(vm->scroll_offset > 0) {
-            // Can scroll up
+        if(vm->scroll_offset > 0 || vm->scroll_line > 0 ||
+           vm->history_floor > vm->history_first) {
+            // Can scroll up (older history is paged in on demand)
             canvas_draw_str_aligned(canvas, 64, 14, AlignCenter, AlignBottom, "^");
         }
-        if(end_idx < vm->message_count) {
+        if(index < vm->message_count || vm->newer_in_history) {
             // Can scroll down
             canvas_draw_str_aligned(canvas, 64, 63, AlignCenter, AlignBottom, "v");
         }
@@ -121,7 +731,9 @@ static void chat_view_draw_callback(Canvas* canvas, void* model) {
     // Footer help text
     canvas_set_font(canvas, FontSecondary);
     canvas_draw_frame(canvas, 0, 54, 128, 10);
-    canvas_draw_str_aligned(canvas, 64, 61, AlignCenter, AlignBottom, "OK=Send Back=Menu");
+    canvas_draw_str_aligned(canvas, 64, 61, AlignCenter, AlignBottom, "OK=Send <=Peers >=Find");
+
+    bitchat_metrics_observe(BitchatHistogramChatDraw, start);
 }
 
 /**
@@ -133,27 +745,74 @@ static bool chat_view_input_callback(InputEvent* event, void* context) {
     bool consumed = false;
 
     if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
+        chat_view_apply_staged(model);
+
+        // Scrolling starts from the newest line if the view was following it
+        if(model->follow && (event->key == InputKeyUp || event->key == InputKeyDown)) {
+            chat_view_scroll_to_bottom(model);
+            model->follow = false;
+        }
+
         switch(event->key) {
             case InputKeyUp:
-                // Scroll up
-                if(model->scroll_offset > 0) {
+                // Scroll up a line, paging older history in at the top of the window
+                if(model->scroll_offset == 0 && model->scroll_line == 0 && chat_view->history) {
+                    // Paging reads the SD card, so the model is let go meanwhile
+                    view_commit_model(chat_view->view, false);
+                    size_t loaded = chat_view_load_older(chat_view);
+                    model = view_get_model(chat_view->view);
+                    model->scroll_offset += loaded;
+                }
+                if(model->scroll_line > 0) {
+                    model->scroll_line--;
+                    consumed = true;
+                } else if(model->scroll_offset > 0) {
                     model->scroll_offset--;
+                    model->scroll_line =
+                        chat_view_message_lines(
+                            model, chat_view_message(model, model->scroll_offset)) -
+                        1;
                     consumed = true;
                 }
                 break;
 
             case InputKeyDown:
-                // Scroll down
-                if(model->scroll_offset + MESSAGE_DISPLAY_LINES < model->message_count) {
-                    model->scroll_offset++;
+                // Scroll down a line, paging newer history back in at the bottom
+                if(!chat_view_more_below(model) && chat_view->history) {
+                    view_commit_model(chat_view->view, false);
+                    chat_view_load_newer(chat_view);
+                    model = view_get_model(chat_view->view);
+                }
+                if(chat_view_more_below(model)) {
+                    ChatMessage* msg = chat_view_message(model, model->scroll_offset);
+                    if(++model->scroll_line == chat_view_message_lines(model, msg)) {
+                        model->scroll_offset++;
+                        model->scroll_line = 0;
+                    }
                     consumed = true;
                 }
                 break;
 
             case InputKeyOk:
-                // Open text input
-                if(model->callback) {
-                    model->callback(model->callback_context, 0);
+                // Open text input once startup is done
+                if(model->callback && model->loading[0] == '\0') {
+                    model->callback(model->callback_context, ChatViewEventCompose);
+                }
+                consumed = true;
+                break;
+
+            case InputKeyLeft:
+                // Conversations and peers
+                if(model->callback && model->loading[0] == '\0') {
+                    model->callback(model->callback_context, ChatViewEventPeers);
+                }
+                consumed = true;
+                break;
+
+            case InputKeyRight:
+                // Search history
+                if(model->callback && chat_view->history && model->loading[0] == '\0') {
+                    model->callback(model->callback_context, ChatViewEventSearch);
                 }
                 consumed = true;
                 break;
@@ -166,11 +825,19 @@ static bool chat_view_input_callback(InputEvent* event, void* context) {
             default:
                 break;
         }
+    } else if(event->type == InputTypeLong && event->key == InputKeyOk) {
+        // Diagnostics, available even while starting up
+        if(model->callback) {
+            model->callback(model->callback_context, ChatViewEventDiagnostics);
+        }
+        consumed = true;
     }
 
+    // Input redraws immediately, taking any pending changes along
     if(consumed) {
-        view_commit_model(chat_view->view, true);
+        model->redraws_requested++;
     }
+    view_commit_model(chat_view->view, consumed);
 
     return consumed;
 }
@@ -178,14 +845,24 @@ static bool chat_view_input_callback(InputEvent* event, void* context) {
 /**
  * Allocate chat view
  */
-ChatView* chat_view_alloc(void) {
-    ChatView* chat_view = malloc(sizeof(ChatView));
+ChatView* chat_view_alloc(BitchatNames* names) {
+    furi_assert(names);
+
+    ChatView* chat_view = bitchat_heap_alloc(BitchatHeapTagUi, sizeof(ChatView));
+    chat_view->history = NULL;
+    chat_view->names = names;
 
     chat_view->view = view_alloc();
     view_allocate_model(chat_view->view, ViewModelTypeLocking, sizeof(ChatViewModel));
     view_set_context(chat_view->view, chat_view);
     view_set_draw_callback(chat_view->view, chat_view_draw_callback);
     view_set_input_callback(chat_view->view, chat_view_input_callback);
+    chat_view->redraw_timer =
+        furi_timer_alloc(chat_view_redraw_timer_callback, FuriTimerTypeOnce, chat_view);
+    memset(&chat_view->inbox, 0, sizeof(ChatViewInbox));
+    chat_view->inbox.mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    chat_view->inbox.back = &chat_view->inbox.buffers[0];
+    chat_view->page_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
 
     // Initialize model
     with_view_model(
@@ -193,6 +870,8 @@ ChatView* chat_view_alloc(void) {
         ChatViewModel* model,
         {
             memset(model, 0, sizeof(ChatViewModel));
+            model->inbox = &chat_view->inbox;
+            model->names = names;
             model->is_connected = false;
             model->peer_count = 0;
             model->message_count = 0;
@@ -209,8 +888,39 @@ ChatView* chat_view_alloc(void) {
  */
 void chat_view_free(ChatView* chat_view) {
     furi_assert(chat_view);
+
+    ChatViewRedrawStats stats;
+    chat_view_get_redraw_stats(chat_view, &stats);
+    BITCHAT_LOG_I(
+        TAG,
+        "Redraws: %lu requested, %lu performed, %lu staging overruns",
+        (unsigned long)stats.redraws_requested,
+        (unsigned long)stats.redraws_performed,
+        (unsigned long)stats.staging_overruns);
+
+    furi_timer_stop(chat_view->redraw_timer);
+    furi_timer_free(chat_view->redraw_timer);
+
+    // Hand the names back to the shared table
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            chat_view_release_messages(model, 0, model->message_count);
+            model->message_count = 0;
+        },
+        false);
+    for(size_t i = 0; i < 2; i++) {
+        ChatViewStaging* staging = &chat_view->inbox.buffers[i];
+        for(size_t j = 0; j < staging->count; j++) {
+            bitchat_names_release(
+                chat_view->names, staging->messages[(staging->start + j) % STAGING_SIZE].sender);
+        }
+    }
     view_free(chat_view->view);
-    free(chat_view);
+    furi_mutex_free(chat_view->inbox.mutex);
+    furi_mutex_free(chat_view->page_mutex);
+    bitchat_heap_free(chat_view);
 }
 
 /**
@@ -237,6 +947,40 @@ void chat_view_set_callback(ChatView* chat_view, ChatViewCallback callback, void
         false);
 }
 
+/**
+ * Post a message for the next frame
+ */
+static void chat_view_stage_message(
+    ChatView* chat_view,
+    uint32_t seq,
+    const char* sender,
+    const char* message,
+    bool is_own,
+    bool is_private) {
+    BitchatName name = bitchat_names_acquire(chat_view->names, sender);
+    ChatViewStaging* back = chat_view_stage_begin(chat_view);
+
+    if(back->count == STAGING_SIZE) {
+        // Frames are not keeping up; the view loses the oldest, history keeps it
+        bitchat_names_release(chat_view->names, back->messages[back->start].sender);
+        back->start = (back->start + 1) % STAGING_SIZE;
+        back->count--;
+        chat_view->inbox.overruns++;
+        bitchat_metrics_add(BitchatCounterChatOverruns, 1);
+    }
+
+    ChatMessage* msg = &back->messages[(back->start + back->count++) % STAGING_SIZE];
+    msg->seq = seq;
+    msg->sender = name;
+    strncpy(msg->content, message, sizeof(msg->content) - 1);
+    msg->content[sizeof(msg->content) - 1] = '\0';
+    msg->is_own = is_own;
+    msg->is_private = is_private;
+    bitchat_metrics_set(BitchatGaugeChatStaged, back->count);
+
+    chat_view_stage_end(chat_view);
+}
+
 /**
  * Add a message
  */
@@ -245,66 +989,164 @@ void chat_view_add_message(ChatView* chat_view, const char* sender, const char*
     furi_assert(sender);
     furi_assert(message);
 
+    chat_view_stage_message(chat_view, MESSAGE_NOT_STORED, sender, message, is_own, false);
+}
+
+/**
+ * Add a message that was just appended to history
+ */
+void chat_view_add_stored_message(
+    ChatView* chat_view,
+    uint32_t seq,
+    const char* sender,
+    const char* message,
+    uint8_t flags) {
+    furi_assert(chat_view);
+    furi_assert(sender);
+    furi_assert(message);
+
+    chat_view_stage_message(
+        chat_view,
+        seq,
+        sender,
+        message,
+        flags & BITCHAT_HISTORY_FLAG_OWN,
+        flags & BITCHAT_HISTORY_FLAG_PRIVATE);
+}
+
+/**
+ * Attach message history for scrollback
+ */
+void chat_view_set_history(ChatView* chat_view, BitchatHistory* history) {
+    furi_assert(chat_view);
+
+    chat_view->history = history;
+
+    uint32_t count = history ? bitchat_history_written_count(history) : 0;
+    bool newer = history && count < bitchat_history_count(history);
     with_view_model(
         chat_view->view,
         ChatViewModel* model,
         {
-            // Add message to ring buffer
-            if(model->message_count < MAX_MESSAGES) {
-                size_t idx = model->message_count;
-                strncpy(model->messages[idx].sender, sender, sizeof(model->messages[idx].sender) - 1);
-                strncpy(model->messages[idx].content, message, sizeof(model->messages[idx].content) - 1);
-                model->messages[idx].is_own = is_own;
-                model->messages[idx].timestamp = furi_get_tick();
-                model->message_count++;
-            } else {
-                // Shift messages up (remove oldest)
-                memmove(&model->messages[0], &model->messages[1], (MAX_MESSAGES - 1) * sizeof(ChatMessage));
-
-                // Add new message at end
-                size_t idx = MAX_MESSAGES - 1;
-                strncpy(model->messages[idx].sender, sender, sizeof(model->messages[idx].sender) - 1);
-                strncpy(model->messages[idx].content, message, sizeof(model->messages[idx].content) - 1);
-                model->messages[idx].is_own = is_own;
-                model->messages[idx].timestamp = furi_get_tick();
-            }
-
-            // Auto-scroll to bottom when new message arrives
-            if(model->message_count > MESSAGE_DISPLAY_LINES) {
-                model->scroll_offset = model->message_count - MESSAGE_DISPLAY_LINES;
-            }
+            model->history_floor = count;
+            model->history_ceiling = count;
+            model->newer_in_history = newer;
+            model->follow = true;
         },
-        true);
+        false);
+
+    // Only the latest page is read now; older pages load on scroll
+    if(history) {
+        chat_view_load_older(chat_view);
+    }
+    chat_view_request_redraw(chat_view);
 }
 
 /**
- * Set peer count
+ * Switch to a conversation
+ * Its newest page is read before the model is locked; older pages load on scroll.
  */
-void chat_view_set_peer_count(ChatView* chat_view, uint8_t count) {
+void chat_view_set_conversation(
+    ChatView* chat_view,
+    const char* peer,
+    const uint32_t* seqs,
+    size_t count) {
     furi_assert(chat_view);
+    furi_assert(seqs || count == 0);
+
+    BitchatHistory* history = chat_view->history;
+    char private_peer[PEER_NAME_SIZE] = {0};
+    if(peer) strncpy(private_peer, peer, sizeof(private_peer) - 1);
+    if(!history) count = 0;
+    if(count > HISTORY_PAGE_SIZE) {
+        seqs += count - HISTORY_PAGE_SIZE;
+        count = HISTORY_PAGE_SIZE;
+    }
+
+    furi_mutex_acquire(chat_view->page_mutex, FuriWaitForever);
+    ChatViewHistoryLoad load = {
+        .names = chat_view->names, .private_peer = private_peer, .messages = chat_view->page};
+    for(size_t i = 0; i < count; i++) {
+        bitchat_history_read(history, seqs[i], 1, chat_view_history_load_callback, &load);
+    }
+    // Records still being written are left for paging
+    uint32_t total = history ? bitchat_history_written_count(history) : 0;
+    uint32_t first = history ? bitchat_history_first(history) : 0;
+    bool newer = history && total < bitchat_history_count(history);
 
     with_view_model(
         chat_view->view,
         ChatViewModel* model,
         {
-            model->peer_count = count;
+            memcpy(model->private_peer, private_peer, sizeof(model->private_peer));
+            chat_view_release_messages(model, 0, model->message_count);
+            model->head = 0;
+            model->scroll_offset = 0;
+            model->scroll_line = 0;
+            model->follow = true;
+
+            for(size_t i = 0; i < load.count; i++) {
+                *chat_view_message(model, i) = load.messages[i];
+            }
+            model->message_count = load.count;
+            load.count = 0;
+            model->history_first = first;
+            model->history_floor = total;
+            model->history_ceiling = total;
+            chat_view_update_history_range(model);
+            // The thread's newest records were given, so nothing newer is left to page in
+            model->history_ceiling = total;
+            model->newer_in_history = newer;
         },
-        true);
+        false);
+    furi_mutex_release(chat_view->page_mutex);
+
+    chat_view_request_redraw(chat_view);
 }
 
 /**
- * Set connected status
+ * Show or clear the startup loading state
  */
-void chat_view_set_connected(ChatView* chat_view, bool connected) {
+void chat_view_set_loading(ChatView* chat_view, const char* stage) {
     furi_assert(chat_view);
 
     with_view_model(
         chat_view->view,
         ChatViewModel* model,
         {
-            model->is_connected = connected;
+            if(stage) {
+                strncpy(model->loading, stage, sizeof(model->loading) - 1);
+                model->loading[sizeof(model->loading) - 1] = '\0';
+            } else {
+                model->loading[0] = '\0';
+            }
+            chat_view_request_redraw(chat_view);
         },
-        true);
+        false);
+}
+
+/**
+ * Set peer count
+ */
+void chat_view_set_peer_count(ChatView* chat_view, uint8_t count) {
+    furi_assert(chat_view);
+
+    ChatViewStaging* back = chat_view_stage_begin(chat_view);
+    back->peer_count = count;
+    back->peer_count_changed = true;
+    chat_view_stage_end(chat_view);
+}
+
+/**
+ * Set connected status
+ */
+void chat_view_set_connected(ChatView* chat_view, bool connected) {
+    furi_assert(chat_view);
+
+    ChatViewStaging* back = chat_view_stage_begin(chat_view);
+    back->is_connected = connected;
+    back->connected_changed = true;
+    chat_view_stage_end(chat_view);
 }
 
 /**
@@ -317,10 +1159,14 @@ void chat_view_clear_messages(ChatView* chat_view) {
         chat_view->view,
         ChatViewModel* model,
         {
+            chat_view_release_messages(model, 0, model->message_count);
             model->message_count = 0;
             model->scroll_offset = 0;
+            model->scroll_line = 0;
+            model->history_floor = model->history_ceiling;
+            chat_view_request_redraw(chat_view);
         },
-        true);
+        false);
 }
 
 /**
@@ -339,3 +1185,25 @@ void chat_view_set_nickname(ChatView* chat_view, const char* nickname) {
         },
         false);
 }
+
+/**
+ * Get redraw statistics
+ */
+void chat_view_get_redraw_stats(ChatView* chat_view, ChatViewRedrawStats* stats) {
+    furi_assert(chat_view);
+    furi_assert(stats);
+
+    with_view_model(
+        chat_view->view,
+        ChatViewModel* model,
+        {
+            stats->redraws_requested = model->redraws_requested;
+            stats->redraws_performed = model->redraws_performed;
+        },
+        false);
+
+    furi_mutex_acquire(chat_view->inbox.mutex, FuriWaitForever);
+    stats->redraws_requested += chat_view->inbox.redraws_requested;
+    stats->staging_overruns = chat_view->inbox.overruns;
+    furi_mutex_release(chat_view->inbox.mutex);
+}
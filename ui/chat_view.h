@@ -9,16 +9,40 @@
 #include "../bitchat_app.h"
 
 typedef struct ChatView ChatView;
+typedef struct BitchatHistory BitchatHistory;
+typedef struct BitchatNames BitchatNames;
+
+/**
+ * Chat view events
+ */
+typedef enum {
+    ChatViewEventCompose, // OK: open message input
+    ChatViewEventSearch, // Right: search history
+    ChatViewEventPeers, // Left: conversations and peers
+    ChatViewEventDiagnostics, // Hold OK: live stack diagnostics
+} ChatViewEvent;
+
+/**
+ * Redraw statistics
+ * Model changes are batched, so far fewer frames are drawn than requested.
+ */
+typedef struct {
+    uint32_t redraws_requested; // Model changes and input that needed a redraw
+    uint32_t redraws_performed; // Frames drawn
+    uint32_t staging_overruns; // Posted messages dropped before a frame took them
+} ChatViewRedrawStats;
 
 /**
  * Callback for input events from chat view
+ * @param index ChatViewEvent
  */
 typedef void (*ChatViewCallback)(void* context, uint32_t index);
 
 /**
  * Allocate chat view
+ * @param names Table the window's sender names are interned in
  */
-ChatView* chat_view_alloc(void);
+ChatView* chat_view_alloc(BitchatNames* names);
 
 /**
  * Free chat view
@@ -36,10 +60,55 @@ View* chat_view_get_view(ChatView* chat_view);
 void chat_view_set_callback(ChatView* chat_view, ChatViewCallback callback, void* context);
 
 /**
- * Add a message to the chat view
+ * Add a message to the public room
+ * Safe from any thread: the message is staged without taking the view
+ * model and appears with the next frame.
  */
 void chat_view_add_message(ChatView* chat_view, const char* sender, const char* message, bool is_own);
 
+/**
+ * Add a message that was just appended to history as record seq
+ * Staged like chat_view_add_message(); it only shows if it belongs to the
+ * conversation on screen. If the window is paged back, the record is left
+ * to page in when scrolling down.
+ * @param flags BITCHAT_HISTORY_FLAG_* of the record
+ */
+void chat_view_add_stored_message(
+    ChatView* chat_view,
+    uint32_t seq,
+    const char* sender,
+    const char* message,
+    uint8_t flags);
+
+/**
+ * Attach message history; the latest page is shown and older pages
+ * are loaded on demand when scrolling past the top of the window
+ */
+void chat_view_set_history(ChatView* chat_view, BitchatHistory* history);
+
+/**
+ * Switch to a conversation
+ * Only the given records are read; older ones page in on scroll. Blocks
+ * on SD I/O.
+ * @param chat_view Chat view
+ * @param peer Peer of a private thread, or NULL for the public room
+ * @param seqs Record numbers of the conversation's latest messages, oldest first
+ * @param count Number of record numbers
+ */
+void chat_view_set_conversation(
+    ChatView* chat_view,
+    const char* peer,
+    const uint32_t* seqs,
+    size_t count);
+
+/**
+ * Show the startup stage in progress instead of messages
+ * Input that needs the backend is ignored until it is cleared.
+ * @param chat_view Chat view
+ * @param stage Stage name, or NULL once startup is done
+ */
+void chat_view_set_loading(ChatView* chat_view, const char* stage);
+
 /**
  * Update peer count display
  */
@@ -59,3 +128,8 @@ void chat_view_clear_messages(ChatView* chat_view);
  * Set local nickname
  */
 void chat_view_set_nickname(ChatView* chat_view, const char* nickname);
+
+/**
+ * Get redraw statistics
+ */
+void chat_view_get_redraw_stats(ChatView* chat_view, ChatViewRedrawStats* stats);
@@ -0,0 +1,395 @@
+/**
+ * BitChat Diagnostics View Implementation
+ */
+
+#include "diagnostics_view.h"
+#include "../ble/bitchat_ble.h"
+#include "../storage/bitchat_capture.h"
+#include "../utils/bitchat_metrics.h"
+#include "../utils/bitchat_heap.h"
+#include <gui/elements.h>
+#include <furi.h>
+#include <string.h>
+
+#define TAG "DiagnosticsView"
+#define DIAGNOSTICS_REFRESH_MS 1000
+#define DIAGNOSTICS_DISPLAY_LINES 4
+#define DIAGNOSTICS_STACK_LINES 7 // Lines before the per-peer ones
+#define DIAGNOSTICS_CAPTURE_LINE (DIAGNOSTICS_STACK_LINES - 1)
+#define DIAGNOSTICS_MAX_LINES (DIAGNOSTICS_STACK_LINES + 1 + BITCHAT_BLE_MAX_PEERS)
+#define DIAGNOSTICS_LINE_SIZE 32
+
+typedef struct {
+    // Formatted on refresh, so drawing is only text
+    char lines[DIAGNOSTICS_MAX_LINES][DIAGNOSTICS_LINE_SIZE];
+    size_t line_count;
+    size_t scroll_offset;
+} DiagnosticsViewModel;
+
+struct DiagnosticsView {
+    View* view;
+    BitchatBle* ble;
+    BitchatCapture* capture;
+    FuriTimer* refresh_timer;
+    // Rates are the difference between the last two snapshots. Kept here
+    // rather than on the timer thread's small stack
+    BitchatMetricsSnapshot snapshots[2];
+    size_t current;
+    bool has_previous;
+    BitchatBlePeer peers[BITCHAT_BLE_MAX_PEERS];
+};
+
+static uint32_t diagnostics_sum(const uint32_t* values, size_t count) {
+    uint32_t sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+/**
+ * Format a per-second rate with one decimal
+ */
+static void diagnostics_format_rate(char* out, size_t size, uint32_t delta, uint32_t elapsed_ms) {
+    uint32_t tenths = elapsed_ms > 0 ? (uint64_t)delta * 10000 / elapsed_ms : 0;
+    snprintf(out, size, "%lu.%lu", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+}
+
+/**
+ * Format the stack-wide lines from two snapshots
+ */
+static size_t diagnostics_format_stack(
+    DiagnosticsViewModel* model,
+    const BitchatMetricsSnapshot* now,
+    const BitchatMetricsSnapshot* before) {
+    uint32_t elapsed = before ? now->uptime_ms - before->uptime_ms : 0;
+    char in[12], out[12], frames[12], fragments[12], reassembled[12];
+
+#define DIAGNOSTICS_DELTA(field) (before ? now->field - before->field : 0)
+    diagnostics_format_rate(
+        in,
+        sizeof(in),
+        diagnostics_sum(now->packets_rx, BITCHAT_METRICS_PACKET_TYPES) -
+            (before ? diagnostics_sum(before->packets_rx, BITCHAT_METRICS_PACKET_TYPES) : 0),
+        elapsed);
+    diagnostics_format_rate(
+        out,
+        sizeof(out),
+        diagnostics_sum(now->packets_tx, BITCHAT_METRICS_PACKET_TYPES) -
+            (before ? diagnostics_sum(before->packets_tx, BITCHAT_METRICS_PACKET_TYPES) : 0),
+        elapsed);
+    diagnostics_format_rate(
+        frames, sizeof(frames), DIAGNOSTICS_DELTA(counters[BitchatCounterChatFrames]), elapsed);
+    diagnostics_format_rate(
+        fragments,
+        sizeof(fragments),
+        DIAGNOSTICS_DELTA(counters[BitchatCounterFragmentsSent]),
+        elapsed);
+    diagnostics_format_rate(
+        reassembled,
+        sizeof(reassembled),
+        DIAGNOSTICS_DELTA(counters[BitchatCounterFramesReassembled]),
+        elapsed);
+#undef DIAGNOSTICS_DELTA
+
+    size_t line = 0;
+    snprintf(model->lines[line++], DIAGNOSTICS_LINE_SIZE, "Pkt/s in %s out %s", in, out);
+    snprintf(
+        model->lines[line++], DIAGNOSTICS_LINE_SIZE, "Frag/s out %s in %s", fragments, reassembled);
+    snprintf(
+        model->lines[line++],
+        DIAGNOSTICS_LINE_SIZE,
+        "Err dec %lu link %lu aead %lu",
+        (unsigned long)now->counters[BitchatCounterDecodeFailed],
+        (unsigned long)now->counters[BitchatCounterLinkDecodeFailed],
+        (unsigned long)now->counters[BitchatCounterCryptoFailed]);
+    snprintf(
+        model->lines[line++],
+        DIAGNOSTICS_LINE_SIZE,
+        "Queue %lu peak %lu stage %lu",
+        (unsigned long)now->gauges[BitchatGaugeEventQueueDepth],
+        (unsigned long)now->gauges[BitchatGaugeEventQueuePeak],
+        (unsigned long)now->gauges[BitchatGaugeChatStaged]);
+    snprintf(
+        model->lines[line++],
+        DIAGNOSTICS_LINE_SIZE,
+        "Heap %luK min %luK",
+        (unsigned long)now->gauges[BitchatGaugeHeapFree] / 1024,
+        (unsigned long)now->gauges[BitchatGaugeHeapMinFree] / 1024);
+    snprintf(
+        model->lines[line++],
+        DIAGNOSTICS_LINE_SIZE,
+        "Redraw %s/s drop %lu",
+        frames,
+        (unsigned long)now->counters[BitchatCounterChatOverruns]);
+    line++; // DIAGNOSTICS_CAPTURE_LINE, formatted by diagnostics_format_capture()
+    return line;
+}
+
+/**
+ * Format the frame capture status line
+ */
+static void diagnostics_format_capture(DiagnosticsViewModel* model, BitchatCapture* capture) {
+    char* line = model->lines[DIAGNOSTICS_CAPTURE_LINE];
+    BitchatCaptureStats stats = {0};
+    if(capture) {
+        bitchat_capture_get_stats(capture, &stats);
+    }
+
+    if(stats.running) {
+        snprintf(
+            line,
+            DIAGNOSTICS_LINE_SIZE,
+            "Cap %lu fr %luK drop %lu",
+            (unsigned long)stats.frames,
+            (unsigned long)stats.bytes / 1024,
+            (unsigned long)stats.dropped);
+    } else {
+        snprintf(line, DIAGNOSTICS_LINE_SIZE, "Capture off");
+    }
+}
+
+/**
+ * Format one line per peer in range: frames in/out, share of bad frames
+ * received, and seconds since last heard
+ */
+static size_t diagnostics_format_peers(
+    DiagnosticsViewModel* model,
+    size_t line,
+    const BitchatBlePeer* peers,
+    size_t count) {
+    if(count == 0) {
+        snprintf(model->lines[line++], DIAGNOSTICS_LINE_SIZE, "No peers in range");
+        return line;
+    }
+
+    snprintf(model->lines[line++], DIAGNOSTICS_LINE_SIZE, "Peer rx/tx err seen");
+    uint32_t now = furi_get_tick();
+    for(size_t i = 0; i < count; i++) {
+        const BitchatBlePeer* peer = &peers[i];
+        uint32_t received = peer->frames_rx + peer->rx_errors;
+        uint32_t error_percent = received > 0 ? peer->rx_errors * 100 / received : 0;
+        uint32_t seen_s = (now - peer->last_seen) / furi_kernel_get_tick_frequency();
+        snprintf(
+            model->lines[line++],
+            DIAGNOSTICS_LINE_SIZE,
+            "%.8s %lu/%lu %lu%% %lus",
+            peer->nickname[0] != '\0' ? peer->nickname : "?",
+            (unsigned long)peer->frames_rx,
+            (unsigned long)peer->frames_tx,
+            (unsigned long)error_percent,
+            (unsigned long)seen_s);
+    }
+    return line;
+}
+
+/**
+ * Take a snapshot and reformat the lines
+ */
+static void diagnostics_view_refresh(DiagnosticsView* diagnostics_view) {
+    bitchat_metrics_sample_heap();
+
+    diagnostics_view->current ^= 1;
+    BitchatMetricsSnapshot* now = &diagnostics_view->snapshots[diagnostics_view->current];
+    BitchatMetricsSnapshot* before =
+        diagnostics_view->has_previous ?
+            &diagnostics_view->snapshots[diagnostics_view->current ^ 1] :
+            NULL;
+    bitchat_metrics_snapshot(now);
+    diagnostics_view->has_previous = true;
+
+    size_t peer_count = 0;
+    if(diagnostics_view->ble) {
+        peer_count = bitchat_ble_get_peers(
+            diagnostics_view->ble, diagnostics_view->peers, BITCHAT_BLE_MAX_PEERS);
+    }
+
+    with_view_model(
+        diagnostics_view->view,
+        DiagnosticsViewModel* model,
+        {
+            size_t line = diagnostics_format_stack(model, now, before);
+            diagnostics_format_capture(model, diagnostics_view->capture);
+            model->line_count =
+                diagnostics_format_peers(model, line, diagnostics_view->peers, peer_count);
+            if(model->scroll_offset + DIAGNOSTICS_DISPLAY_LINES > model->line_count) {
+                model->scroll_offset = model->line_count > DIAGNOSTICS_DISPLAY_LINES ?
+                                           model->line_count - DIAGNOSTICS_DISPLAY_LINES :
+                                           0;
+            }
+        },
+        true);
+}
+
+static void diagnostics_view_timer_callback(void* context) {
+    diagnostics_view_refresh(context);
+}
+
+/**
+ * Start refreshing when shown
+ */
+static void diagnostics_view_enter_callback(void* context) {
+    DiagnosticsView* diagnostics_view = context;
+
+    // Rates start over from this visit
+    diagnostics_view->has_previous = false;
+    diagnostics_view_refresh(diagnostics_view);
+    furi_timer_start(diagnostics_view->refresh_timer, furi_ms_to_ticks(DIAGNOSTICS_REFRESH_MS));
+}
+
+/**
+ * Stop refreshing when hidden
+ */
+static void diagnostics_view_exit_callback(void* context) {
+    DiagnosticsView* diagnostics_view = context;
+    furi_timer_stop(diagnostics_view->refresh_timer);
+}
+
+/**
+ * Draw callback for diagnostics view
+ */
+static void diagnostics_view_draw_callback(Canvas* canvas, void* model) {
+    DiagnosticsViewModel* vm = model;
+
+    canvas_clear(canvas);
+    canvas_set_color(canvas, ColorBlack);
+
+    // Header
+    canvas_draw_frame(canvas, 0, 0, 128, 12);
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 3, 9, "Diagnostics");
+
+    size_t end_idx = vm->line_count;
+    if(end_idx - vm->scroll_offset > DIAGNOSTICS_DISPLAY_LINES) {
+        end_idx = vm->scroll_offset + DIAGNOSTICS_DISPLAY_LINES;
+    }
+
+    uint8_t y_pos = 22;
+    for(size_t i = vm->scroll_offset; i < end_idx; i++) {
+        canvas_draw_str(canvas, 2, y_pos, vm->lines[i]);
+        y_pos += 10;
+    }
+
+    if(vm->scroll_offset > 0) {
+        canvas_draw_str_aligned(canvas, 126, 22, AlignRight, AlignBottom, "^");
+    }
+    if(end_idx < vm->line_count) {
+        canvas_draw_str_aligned(canvas, 126, 52, AlignRight, AlignBottom, "v");
+    }
+
+    // Footer
+    canvas_draw_frame(canvas, 0, 54, 128, 10);
+    canvas_draw_str_aligned(canvas, 64, 62, AlignCenter, AlignBottom, "OK=Capture Back=Chat");
+}
+
+/**
+ * Input callback for diagnostics view
+ */
+static bool diagnostics_view_input_callback(InputEvent* event, void* context) {
+    DiagnosticsView* diagnostics_view = context;
+    DiagnosticsViewModel* model = view_get_model(diagnostics_view->view);
+    bool consumed = false;
+
+    if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
+        switch(event->key) {
+            case InputKeyUp:
+                if(model->scroll_offset > 0) {
+                    model->scroll_offset--;
+                }
+                consumed = true;
+                break;
+
+            case InputKeyDown:
+                if(model->scroll_offset + DIAGNOSTICS_DISPLAY_LINES < model->line_count) {
+                    model->scroll_offset++;
+                }
+                consumed = true;
+                break;
+
+            case InputKeyOk:
+                // Capture restarts from an empty file each time it is turned on
+                if(diagnostics_view->capture) {
+                    if(bitchat_capture_is_running(diagnostics_view->capture)) {
+                        bitchat_capture_stop(diagnostics_view->capture);
+                    } else {
+                        bitchat_capture_start(diagnostics_view->capture);
+                    }
+                    diagnostics_format_capture(model, diagnostics_view->capture);
+                }
+                consumed = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    view_commit_model(diagnostics_view->view, consumed);
+
+    return consumed;
+}
+
+/**
+ * Allocate diagnostics view
+ */
+DiagnosticsView* diagnostics_view_alloc(void) {
+    DiagnosticsView* diagnostics_view =
+        bitchat_heap_alloc(BitchatHeapTagUi, sizeof(DiagnosticsView));
+    memset(diagnostics_view, 0, sizeof(DiagnosticsView));
+
+    diagnostics_view->view = view_alloc();
+    view_allocate_model(diagnostics_view->view, ViewModelTypeLocking, sizeof(DiagnosticsViewModel));
+    view_set_context(diagnostics_view->view, diagnostics_view);
+    view_set_draw_callback(diagnostics_view->view, diagnostics_view_draw_callback);
+    view_set_input_callback(diagnostics_view->view, diagnostics_view_input_callback);
+    view_set_enter_callback(diagnostics_view->view, diagnostics_view_enter_callback);
+    view_set_exit_callback(diagnostics_view->view, diagnostics_view_exit_callback);
+    diagnostics_view->refresh_timer = furi_timer_alloc(
+        diagnostics_view_timer_callback, FuriTimerTypePeriodic, diagnostics_view);
+
+    with_view_model(
+        diagnostics_view->view,
+        DiagnosticsViewModel* model,
+        {
+            memset(model, 0, sizeof(DiagnosticsViewModel));
+        },
+        true);
+
+    return diagnostics_view;
+}
+
+/**
+ * Free diagnostics view
+ */
+void diagnostics_view_free(DiagnosticsView* diagnostics_view) {
+    furi_assert(diagnostics_view);
+
+    furi_timer_stop(diagnostics_view->refresh_timer);
+    furi_timer_free(diagnostics_view->refresh_timer);
+    view_free(diagnostics_view->view);
+    bitchat_heap_free(diagnostics_view);
+}
+
+/**
+ * Get the view
+ */
+View* diagnostics_view_get_view(DiagnosticsView* diagnostics_view) {
+    furi_assert(diagnostics_view);
+    return diagnostics_view->view;
+}
+
+/**
+ * Attach the BLE service
+ */
+void diagnostics_view_set_ble(DiagnosticsView* diagnostics_view, BitchatBle* ble) {
+    furi_assert(diagnostics_view);
+    diagnostics_view->ble = ble;
+}
+
+/**
+ * Attach the frame capture
+ */
+void diagnostics_view_set_capture(DiagnosticsView* diagnostics_view, BitchatCapture* capture) {
+    furi_assert(diagnostics_view);
+    diagnostics_view->capture = capture;
+}
@@ -0,0 +1,39 @@
+/**
+ * BitChat Diagnostics View
+ * Live packet rates, errors, queue depths, heap, redraw rate and per-peer
+ * link quality, refreshed once a second while on screen. OK turns raw
+ * frame capture on and off
+ */
+
+#pragma once
+
+#include <gui/view.h>
+
+typedef struct DiagnosticsView DiagnosticsView;
+typedef struct BitchatBle BitchatBle;
+typedef struct BitchatCapture BitchatCapture;
+
+/**
+ * Allocate diagnostics view
+ */
+DiagnosticsView* diagnostics_view_alloc(void);
+
+/**
+ * Free diagnostics view
+ */
+void diagnostics_view_free(DiagnosticsView* diagnostics_view);
+
+/**
+ * Get the view
+ */
+View* diagnostics_view_get_view(DiagnosticsView* diagnostics_view);
+
+/**
+ * Attach the BLE service that per-peer link counts are read from
+ */
+void diagnostics_view_set_ble(DiagnosticsView* diagnostics_view, BitchatBle* ble);
+
+/**
+ * Attach the frame capture that OK turns on and off
+ */
+void diagnostics_view_set_capture(DiagnosticsView* diagnostics_view, BitchatCapture* capture);
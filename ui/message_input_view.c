@@ -3,6 +3,7 @@
  */
 
 #include "message_input_view.h"
+#include "../utils/bitchat_heap.h"
 #include <gui/view.h>
 #include <furi.h>
 #include <string.h>
@@ -36,7 +37,8 @@ static void message_input_view_text_input_callback(void* context) {
  * Allocate message input view
  */
 MessageInputView* message_input_view_alloc(void) {
-    MessageInputView* message_input_view = malloc(sizeof(MessageInputView));
+    MessageInputView* message_input_view =
+        bitchat_heap_alloc(BitchatHeapTagUi, sizeof(MessageInputView));
     memset(message_input_view, 0, sizeof(MessageInputView));
 
     message_input_view->text_input = text_input_alloc();
@@ -59,7 +61,7 @@ MessageInputView* message_input_view_alloc(void) {
 void message_input_view_free(MessageInputView* message_input_view) {
     furi_assert(message_input_view);
     text_input_free(message_input_view->text_input);
-    free(message_input_view);
+    bitchat_heap_free(message_input_view);
 }
 
 /**
@@ -89,3 +91,11 @@ void message_input_view_reset(MessageInputView* message_input_view) {
     furi_assert(message_input_view);
     memset(message_input_view->message_buffer, 0, MAX_MESSAGE_LENGTH);
 }
+
+/**
+ * Set the prompt
+ */
+void message_input_view_set_header_text(MessageInputView* message_input_view, const char* text) {
+    furi_assert(message_input_view);
+    text_input_set_header_text(message_input_view->text_input, text);
+}
@@ -41,3 +41,8 @@ void message_input_view_set_callback(
  * Reset the view (clear input)
  */
 void message_input_view_reset(MessageInputView* message_input_view);
+
+/**
+ * Set the prompt shown above the input
+ */
+void message_input_view_set_header_text(MessageInputView* message_input_view, const char* text);
@@ -3,6 +3,7 @@
  */
 
 #include "nickname_view.h"
+#include "../utils/bitchat_heap.h"
 #include <gui/view.h>
 #include <furi.h>
 #include <string.h>
@@ -31,7 +32,7 @@ static void nickname_view_text_input_callback(void* context) {
  * Allocate nickname view
  */
 NicknameView* nickname_view_alloc(void) {
-    NicknameView* nickname_view = malloc(sizeof(NicknameView));
+    NicknameView* nickname_view = bitchat_heap_alloc(BitchatHeapTagUi, sizeof(NicknameView));
     memset(nickname_view, 0, sizeof(NicknameView));
 
     nickname_view->text_input = text_input_alloc();
@@ -54,7 +55,7 @@ NicknameView* nickname_view_alloc(void) {
 void nickname_view_free(NicknameView* nickname_view) {
     furi_assert(nickname_view);
     text_input_free(nickname_view->text_input);
-    free(nickname_view);
+    bitchat_heap_free(nickname_view);
 }
 
 /**
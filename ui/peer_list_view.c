@@ -0,0 +1,235 @@
+/**
+ * BitChat Peer List View Implementation
+ */
+
+#include "peer_list_view.h"
+#include "../utils/bitchat_heap.h"
+#include <gui/elements.h>
+#include <furi.h>
+#include <string.h>
+
+#define TAG "PeerListView"
+#define PEER_LIST_DISPLAY_LINES 4
+
+typedef struct {
+    PeerListEntry entries[PEER_LIST_MAX_ENTRIES];
+    size_t entry_count;
+    size_t selected;
+    size_t scroll_offset;
+    PeerListViewCallback callback;
+    void* callback_context;
+} PeerListViewModel;
+
+struct PeerListView {
+    View* view;
+};
+
+/**
+ * Draw callback for peer list view
+ */
+static void peer_list_view_draw_callback(Canvas* canvas, void* model) {
+    PeerListViewModel* vm = model;
+
+    canvas_clear(canvas);
+    canvas_set_color(canvas, ColorBlack);
+
+    // Header
+    canvas_draw_frame(canvas, 0, 0, 128, 12);
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 3, 9, "Conversations");
+
+    size_t end_idx = vm->entry_count;
+    if(end_idx - vm->scroll_offset > PEER_LIST_DISPLAY_LINES) {
+        end_idx = vm->scroll_offset + PEER_LIST_DISPLAY_LINES;
+    }
+
+    uint8_t y_pos = 22;
+    for(size_t i = vm->scroll_offset; i < end_idx; i++) {
+        PeerListEntry* entry = &vm->entries[i];
+
+        if(i == vm->selected) {
+            canvas_draw_str(canvas, 2, y_pos, ">");
+        }
+
+        // "#" marks the public room, "*" a peer in range
+        char name[40];
+        if(entry->peer[0] == '\0') {
+            snprintf(name, sizeof(name), "# Public");
+        } else {
+            snprintf(name, sizeof(name), "%c %s", entry->connected ? '*' : ' ', entry->peer);
+        }
+        canvas_draw_str(canvas, 8, y_pos, name);
+
+        if(entry->unread > 0) {
+            char unread[12];
+            snprintf(unread, sizeof(unread), "(%lu)", (unsigned long)entry->unread);
+            canvas_draw_str_aligned(canvas, 120, y_pos, AlignRight, AlignBottom, unread);
+        }
+        y_pos += 10;
+    }
+
+    if(vm->scroll_offset > 0) {
+        canvas_draw_str_aligned(canvas, 126, 22, AlignRight, AlignBottom, "^");
+    }
+    if(end_idx < vm->entry_count) {
+        canvas_draw_str_aligned(canvas, 126, 52, AlignRight, AlignBottom, "v");
+    }
+
+    // Footer
+    canvas_draw_frame(canvas, 0, 54, 128, 10);
+    canvas_draw_str_aligned(canvas, 64, 62, AlignCenter, AlignBottom, "OK=Open Back=Chat");
+}
+
+/**
+ * Input callback for peer list view
+ */
+static bool peer_list_view_input_callback(InputEvent* event, void* context) {
+    PeerListView* peer_list_view = context;
+    PeerListViewModel* model = view_get_model(peer_list_view->view);
+    bool consumed = false;
+    char peer[sizeof(model->entries[0].peer)];
+    bool open = false;
+
+    if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
+        switch(event->key) {
+            case InputKeyUp:
+                if(model->selected > 0) {
+                    model->selected--;
+                    if(model->selected < model->scroll_offset) {
+                        model->scroll_offset = model->selected;
+                    }
+                }
+                consumed = true;
+                break;
+
+            case InputKeyDown:
+                if(model->selected + 1 < model->entry_count) {
+                    model->selected++;
+                    if(model->selected >= model->scroll_offset + PEER_LIST_DISPLAY_LINES) {
+                        model->scroll_offset = model->selected - PEER_LIST_DISPLAY_LINES + 1;
+                    }
+                }
+                consumed = true;
+                break;
+
+            case InputKeyOk:
+                if(model->callback && model->selected < model->entry_count) {
+                    strcpy(peer, model->entries[model->selected].peer);
+                    open = true;
+                }
+                consumed = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    PeerListViewCallback callback = model->callback;
+    void* callback_context = model->callback_context;
+    view_commit_model(peer_list_view->view, consumed);
+
+    // Opening a thread reads history, so it runs with the model released
+    if(open) {
+        callback(callback_context, peer[0] != '\0' ? peer : NULL);
+    }
+
+    return consumed;
+}
+
+/**
+ * Allocate peer list view
+ */
+PeerListView* peer_list_view_alloc(void) {
+    PeerListView* peer_list_view = bitchat_heap_alloc(BitchatHeapTagUi, sizeof(PeerListView));
+
+    peer_list_view->view = view_alloc();
+    view_allocate_model(peer_list_view->view, ViewModelTypeLocking, sizeof(PeerListViewModel));
+    view_set_context(peer_list_view->view, peer_list_view);
+    view_set_draw_callback(peer_list_view->view, peer_list_view_draw_callback);
+    view_set_input_callback(peer_list_view->view, peer_list_view_input_callback);
+
+    with_view_model(
+        peer_list_view->view,
+        PeerListViewModel* model,
+        {
+            memset(model, 0, sizeof(PeerListViewModel));
+        },
+        true);
+
+    return peer_list_view;
+}
+
+/**
+ * Free peer list view
+ */
+void peer_list_view_free(PeerListView* peer_list_view) {
+    furi_assert(peer_list_view);
+    view_free(peer_list_view->view);
+    bitchat_heap_free(peer_list_view);
+}
+
+/**
+ * Get the view
+ */
+View* peer_list_view_get_view(PeerListView* peer_list_view) {
+    furi_assert(peer_list_view);
+    return peer_list_view->view;
+}
+
+/**
+ * Set callback
+ */
+void peer_list_view_set_callback(
+    PeerListView* peer_list_view,
+    PeerListViewCallback callback,
+    void* context) {
+    furi_assert(peer_list_view);
+
+    with_view_model(
+        peer_list_view->view,
+        PeerListViewModel* model,
+        {
+            model->callback = callback;
+            model->callback_context = context;
+        },
+        false);
+}
+
+/**
+ * Replace the rows
+ */
+void peer_list_view_set_entries(
+    PeerListView* peer_list_view,
+    const PeerListEntry* entries,
+    size_t count) {
+    furi_assert(peer_list_view);
+    furi_assert(entries || count == 0);
+
+    if(count > PEER_LIST_MAX_ENTRIES) count = PEER_LIST_MAX_ENTRIES;
+
+    with_view_model(
+        peer_list_view->view,
+        PeerListViewModel* model,
+        {
+            char selected[sizeof(model->entries[0].peer)] = "";
+            if(model->selected < model->entry_count) {
+                strcpy(selected, model->entries[model->selected].peer);
+            }
+
+            memcpy(model->entries, entries, count * sizeof(PeerListEntry));
+            model->entry_count = count;
+            model->selected = 0;
+            for(size_t i = 0; i < count; i++) {
+                if(strcmp(model->entries[i].peer, selected) == 0) {
+                    model->selected = i;
+                    break;
+                }
+            }
+            if(model->selected < model->scroll_offset ||
+               model->selected >= model->scroll_offset + PEER_LIST_DISPLAY_LINES) {
+                model->scroll_offset = model->selected;
+            }
+        },
+        true);
+}
@@ -0,0 +1,59 @@
+/**
+ * BitChat Peer List View
+ * Lists the public room, private threads with their unread counts, and
+ * peers in range
+ */
+
+#pragma once
+
+#include <gui/view.h>
+
+#define PEER_LIST_MAX_ENTRIES 17 // The public room, 8 threads and 8 peers in range
+
+typedef struct PeerListView PeerListView;
+
+/**
+ * One row of the list
+ */
+typedef struct {
+    char peer[32]; // Empty for the public room
+    uint32_t unread;
+    bool connected;
+} PeerListEntry;
+
+/**
+ * Callback when a row is opened
+ * @param peer Peer of the private thread, or NULL for the public room
+ */
+typedef void (*PeerListViewCallback)(void* context, const char* peer);
+
+/**
+ * Allocate peer list view
+ */
+PeerListView* peer_list_view_alloc(void);
+
+/**
+ * Free peer list view
+ */
+void peer_list_view_free(PeerListView* peer_list_view);
+
+/**
+ * Get the view
+ */
+View* peer_list_view_get_view(PeerListView* peer_list_view);
+
+/**
+ * Set callback
+ */
+void peer_list_view_set_callback(
+    PeerListView* peer_list_view,
+    PeerListViewCallback callback,
+    void* context);
+
+/**
+ * Replace the rows, keeping the selection on the same peer if it is still listed
+ */
+void peer_list_view_set_entries(
+    PeerListView* peer_list_view,
+    const PeerListEntry* entries,
+    size_t count);
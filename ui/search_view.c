@@ -0,0 +1,301 @@
+/**
+ * BitChat Search View Implementation
+ */
+
+#include "search_view.h"
+#include "../storage/bitchat_search.h"
+#include "../utils/bitchat_names.h"
+#include "../utils/bitchat_heap.h"
+#include <gui/elements.h>
+#include <furi.h>
+#include <string.h>
+
+#define TAG "SearchView"
+#define MAX_RESULTS 20
+#define RESULT_DISPLAY_LINES 4
+#define SEARCH_PAGE_SIZE 5 // Matches looked up per scroll past the last result
+#define SEARCH_SEGMENT_BUDGET 1 // History segments searched per tick
+
+typedef struct {
+    BitchatName sender; // Held while the result is listed
+    char content[64];
+    bool is_own;
+} SearchResult;
+
+typedef struct {
+    char query[BITCHAT_SEARCH_MAX_QUERY + 1];
+    SearchResult results[MAX_RESULTS];
+    size_t result_count;
+    size_t scroll_offset;
+    bool dropped; // Older results were dropped to make room
+    bool done;
+    BitchatNames* names; // Shared with the app
+} SearchViewModel;
+
+struct SearchView {
+    View* view;
+    BitchatSearch* search;
+    BitchatNames* names;
+    size_t wanted; // Matches still to look up for the page in progress, 0 when idle
+    // Matches found by one tick, listed once the search step is over
+    SearchResult found[SEARCH_PAGE_SIZE];
+    size_t found_count;
+};
+
+/**
+ * Drop the listed results and their sender references
+ */
+static void search_view_clear_results(SearchViewModel* model) {
+    for(size_t i = 0; i < model->result_count; i++) {
+        bitchat_names_release(model->names, model->results[i].sender);
+    }
+    model->result_count = 0;
+}
+
+/**
+ * Copy one match aside until the search step is over
+ */
+static void search_view_result_callback(void* context, const BitchatHistoryRecord* record) {
+    SearchView* search_view = context;
+    if(search_view->found_count == SEARCH_PAGE_SIZE) return;
+
+    SearchResult* result = &search_view->found[search_view->found_count++];
+    result->sender = bitchat_names_acquire(search_view->names, record->sender);
+    strncpy(result->content, record->content, sizeof(result->content) - 1);
+    result->content[sizeof(result->content) - 1] = '\0';
+    result->is_own = record->flags & BITCHAT_HISTORY_FLAG_OWN;
+}
+
+/**
+ * List a match at the bottom, dropping the top if full
+ * @param result Match whose sender reference is handed over
+ */
+static void search_view_add_result(SearchViewModel* model, const SearchResult* result) {
+    if(model->result_count == MAX_RESULTS) {
+        bitchat_names_release(model->names, model->results[0].sender);
+        memmove(&model->results[0], &model->results[1], (MAX_RESULTS - 1) * sizeof(SearchResult));
+        model->result_count--;
+        if(model->scroll_offset > 0) model->scroll_offset--;
+        model->dropped = true;
+    }
+    model->results[model->result_count++] = *result;
+}
+
+/**
+ * Draw callback for search view
+ */
+static void search_view_draw_callback(Canvas* canvas, void* model) {
+    SearchViewModel* vm = model;
+
+    canvas_clear(canvas);
+    canvas_set_color(canvas, ColorBlack);
+
+    // Header bar with the query
+    canvas_draw_frame(canvas, 0, 0, 128, 12);
+    canvas_set_font(canvas, FontSecondary);
+    char header[48];
+    snprintf(header, sizeof(header), "Search: %s", vm->query);
+    canvas_draw_str(canvas, 3, 9, header);
+
+    if(vm->result_count == 0) {
+        canvas_draw_str_aligned(
+            canvas, 64, 33, AlignCenter, AlignCenter, vm->done ? "No matches" : "Searching...");
+    } else {
+        size_t end_idx = vm->result_count;
+        if(end_idx - vm->scroll_offset > RESULT_DISPLAY_LINES) {
+            end_idx = vm->scroll_offset + RESULT_DISPLAY_LINES;
+        }
+
+        uint8_t y_pos = 22;
+        for(size_t i = vm->scroll_offset; i < end_idx; i++) {
+            SearchResult* result = &vm->results[i];
+            char line[64];
+            snprintf(
+                line,
+                sizeof(line),
+                "%s: %s",
+                result->is_own ? "You" : bitchat_names_get(vm->names, result->sender),
+                result->content);
+            canvas_draw_str(canvas, 2, y_pos, line);
+            y_pos += 10;
+        }
+
+        if(vm->scroll_offset > 0 || vm->dropped) {
+            canvas_draw_str_aligned(canvas, 124, 22, AlignRight, AlignBottom, "^");
+        }
+        if(end_idx < vm->result_count || !vm->done) {
+            canvas_draw_str_aligned(canvas, 124, 52, AlignRight, AlignBottom, "v");
+        }
+    }
+
+    // Footer
+    canvas_draw_frame(canvas, 0, 54, 128, 10);
+    canvas_draw_str_aligned(
+        canvas,
+        64,
+        62,
+        AlignCenter,
+        AlignBottom,
+        vm->done && vm->result_count > 0 ? "End of results" : "Back=Chat");
+}
+
+/**
+ * Input callback for search view
+ */
+static bool search_view_input_callback(InputEvent* event, void* context) {
+    SearchView* search_view = context;
+    SearchViewModel* model = view_get_model(search_view->view);
+    bool consumed = false;
+
+    if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
+        switch(event->key) {
+            case InputKeyUp:
+                if(model->scroll_offset > 0) {
+                    model->scroll_offset--;
+                    consumed = true;
+                }
+                break;
+
+            case InputKeyDown:
+                // Matches are looked up a page at a time, on ticks, as the list runs out
+                if(model->scroll_offset + RESULT_DISPLAY_LINES >= model->result_count &&
+                   !model->done && search_view->wanted == 0) {
+                    search_view->wanted = SEARCH_PAGE_SIZE;
+                }
+                if(model->scroll_offset + RESULT_DISPLAY_LINES < model->result_count) {
+                    model->scroll_offset++;
+                }
+                consumed = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    view_commit_model(search_view->view, consumed);
+
+    return consumed;
+}
+
+/**
+ * Allocate search view
+ */
+SearchView* search_view_alloc(BitchatNames* names) {
+    furi_assert(names);
+
+    SearchView* search_view = bitchat_heap_alloc(BitchatHeapTagUi, sizeof(SearchView));
+    search_view->search = NULL;
+    search_view->names = names;
+    search_view->wanted = 0;
+    search_view->found_count = 0;
+
+    search_view->view = view_alloc();
+    view_allocate_model(search_view->view, ViewModelTypeLocking, sizeof(SearchViewModel));
+    view_set_context(search_view->view, search_view);
+    view_set_draw_callback(search_view->view, search_view_draw_callback);
+    view_set_input_callback(search_view->view, search_view_input_callback);
+
+    with_view_model(
+        search_view->view,
+        SearchViewModel* model,
+        {
+            memset(model, 0, sizeof(SearchViewModel));
+            model->names = names;
+            model->done = true;
+        },
+        true);
+
+    return search_view;
+}
+
+/**
+ * Free search view
+ */
+void search_view_free(SearchView* search_view) {
+    furi_assert(search_view);
+
+    with_view_model(
+        search_view->view,
+        SearchViewModel* model,
+        {
+            search_view_clear_results(model);
+        },
+        false);
+    view_free(search_view->view);
+    bitchat_heap_free(search_view);
+}
+
+/**
+ * Get the view
+ */
+View* search_view_get_view(SearchView* search_view) {
+    furi_assert(search_view);
+    return search_view->view;
+}
+
+/**
+ * Attach the search
+ */
+void search_view_set_search(SearchView* search_view, BitchatSearch* search) {
+    furi_assert(search_view);
+    search_view->search = search;
+}
+
+/**
+ * Start a query
+ */
+void search_view_start(SearchView* search_view, const char* query) {
+    furi_assert(search_view);
+    furi_assert(query);
+
+    if(search_view->search) {
+        bitchat_search_start(search_view->search, query);
+    }
+    // The first page is looked up on the next ticks, so "Searching..." shows meanwhile
+    search_view->wanted = search_view->search ? SEARCH_PAGE_SIZE : 0;
+
+    with_view_model(
+        search_view->view,
+        SearchViewModel* model,
+        {
+            strncpy(model->query, query, sizeof(model->query) - 1);
+            model->query[sizeof(model->query) - 1] = '\0';
+            search_view_clear_results(model);
+            model->scroll_offset = 0;
+            model->dropped = false;
+            model->done = search_view->search == NULL;
+        },
+        true);
+}
+
+/**
+ * Search on for the page in progress
+ */
+void search_view_tick(SearchView* search_view) {
+    furi_assert(search_view);
+    if(search_view->wanted == 0) return;
+
+    // The history is read with the model unlocked, so the list keeps drawing
+    search_view->found_count = 0;
+    bitchat_search_next(
+        search_view->search,
+        search_view->wanted,
+        SEARCH_SEGMENT_BUDGET,
+        search_view_result_callback,
+        search_view);
+    bool done = bitchat_search_is_done(search_view->search);
+    search_view->wanted = done ? 0 : search_view->wanted - search_view->found_count;
+
+    with_view_model(
+        search_view->view,
+        SearchViewModel* model,
+        {
+            for(size_t i = 0; i < search_view->found_count; i++) {
+                search_view_add_result(model, &search_view->found[i]);
+            }
+            model->done = done;
+        },
+        true);
+    search_view->found_count = 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * BitChat Search View
+ * Lists history records matching a query, newest first
+ */
+
+#pragma once
+
+#include <gui/view.h>
+
+typedef struct SearchView SearchView;
+typedef struct BitchatSearch BitchatSearch;
+typedef struct BitchatNames BitchatNames;
+
+/**
+ * Allocate search view
+ * @param names Table the results' sender names are interned in
+ */
+SearchView* search_view_alloc(BitchatNames* names);
+
+/**
+ * Free search view
+ */
+void search_view_free(SearchView* search_view);
+
+/**
+ * Get the view
+ */
+View* search_view_get_view(SearchView* search_view);
+
+/**
+ * Attach the search that results are paged from
+ */
+void search_view_set_search(SearchView* search_view, BitchatSearch* search);
+
+/**
+ * Start a query
+ * Matches are looked up by search_view_tick(), a page at a time.
+ */
+void search_view_start(SearchView* search_view, const char* query);
+
+/**
+ * Search one more history segment for the page being looked up, if any
+ * Call periodically from the thread that delivers input.
+ */
+void search_view_tick(SearchView* search_view);
@@ -0,0 +1,136 @@
+/**
+ * BitChat Heap Accounting Implementation
+ */
+
+#include "bitchat_heap.h"
+#include "bitchat_log.h"
+#include <furi.h>
+#include <string.h>
+
+#define TAG "BitchatHeap"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_UTILS
+#define HEAP_MAGIC 0xB17C
+
+static const char* const heap_tag_names[BitchatHeapTagCount] = {
+    [BitchatHeapTagApp] = "app",
+    [BitchatHeapTagPacket] = "packet",
+    [BitchatHeapTagMessage] = "message",
+    [BitchatHeapTagBle] = "ble",
+    [BitchatHeapTagCrypto] = "crypto",
+    [BitchatHeapTagIdentity] = "identity",
+    [BitchatHeapTagStorage] = "storage",
+    [BitchatHeapTagUi] = "ui",
+};
+
+#if BITCHAT_HEAP_TRACKING
+
+/**
+ * Prefix of every tracked block; 8 bytes keeps the caller's memory 8-aligned
+ */
+typedef struct {
+    uint32_t size;
+    uint16_t magic;
+    uint8_t tag;
+    uint8_t reserved;
+} HeapHeader;
+
+_Static_assert(sizeof(HeapHeader) == 8, "heap header must keep 8-byte alignment");
+
+// Only ever touched with atomic builtins
+static uint32_t heap_current[BitchatHeapTagCount];
+static uint32_t heap_peak[BitchatHeapTagCount];
+static uint32_t heap_allocations[BitchatHeapTagCount];
+static uint32_t heap_live[BitchatHeapTagCount];
+
+/**
+ * Allocate memory charged to a tag
+ */
+void* bitchat_heap_alloc(BitchatHeapTag tag, size_t size) {
+    furi_assert(tag < BitchatHeapTagCount);
+
+    HeapHeader* header = malloc(sizeof(HeapHeader) + size);
+    header->size = size;
+    header->magic = HEAP_MAGIC;
+    header->tag = tag;
+    header->reserved = 0;
+
+    uint32_t current = __atomic_add_fetch(&heap_current[tag], size, __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&heap_peak[tag], __ATOMIC_RELAXED);
+    while(peak < current &&
+          !__atomic_compare_exchange_n(
+              &heap_peak[tag], &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_fetch_add(&heap_allocations[tag], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&heap_live[tag], 1, __ATOMIC_RELAXED);
+
+    return header + 1;
+}
+
+/**
+ * Free memory from bitchat_heap_alloc()
+ */
+void bitchat_heap_free(void* ptr) {
+    if(!ptr) return;
+
+    HeapHeader* header = (HeapHeader*)ptr - 1;
+    // Catches blocks from plain malloc() and double frees
+    furi_check(header->magic == HEAP_MAGIC);
+    furi_check(header->tag < BitchatHeapTagCount);
+    header->magic = 0;
+
+    __atomic_fetch_sub(&heap_current[header->tag], header->size, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&heap_live[header->tag], 1, __ATOMIC_RELAXED);
+    free(header);
+}
+
+/**
+ * Get usage of one tag
+ */
+void bitchat_heap_get_stats(BitchatHeapTag tag, BitchatHeapStats* stats) {
+    furi_assert(tag < BitchatHeapTagCount);
+    furi_assert(stats);
+
+    stats->current = __atomic_load_n(&heap_current[tag], __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&heap_peak[tag], __ATOMIC_RELAXED);
+    stats->allocations = __atomic_load_n(&heap_allocations[tag], __ATOMIC_RELAXED);
+    stats->live = __atomic_load_n(&heap_live[tag], __ATOMIC_RELAXED);
+}
+
+#else
+
+void bitchat_heap_get_stats(BitchatHeapTag tag, BitchatHeapStats* stats) {
+    furi_assert(tag < BitchatHeapTagCount);
+    furi_assert(stats);
+    memset(stats, 0, sizeof(BitchatHeapStats));
+}
+
+#endif
+
+/**
+ * Log usage per tag and warn about leaks
+ */
+uint32_t bitchat_heap_report(void) {
+    uint32_t leaked = 0;
+    for(size_t tag = 0; tag < BitchatHeapTagCount; tag++) {
+        BitchatHeapStats stats;
+        bitchat_heap_get_stats(tag, &stats);
+        if(stats.allocations == 0) continue;
+
+        BITCHAT_LOG_I(
+            TAG,
+            "%s: peak %lu bytes, %lu allocations",
+            heap_tag_names[tag],
+            (unsigned long)stats.peak,
+            (unsigned long)stats.allocations);
+        if(stats.live > 0) {
+            BITCHAT_LOG_W(
+                TAG,
+                "%s: %lu allocations (%lu bytes) not freed",
+                heap_tag_names[tag],
+                (unsigned long)stats.live,
+                (unsigned long)stats.current);
+            leaked += stats.live;
+        }
+    }
+    return leaked;
+}
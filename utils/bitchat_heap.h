@@ -0,0 +1,83 @@
+/**
+ * BitChat Heap Accounting
+ * Tagged allocation wrappers with per-subsystem usage and high-water marks
+ *
+ * Each allocation is charged to a tag naming the subsystem that owns it.
+ * Per tag the current and peak bytes and the number of allocations are
+ * kept with relaxed atomics, so the wrappers are safe from any thread and
+ * take no lock. bitchat_heap_report() logs the totals at exit and warns
+ * about any tag that still holds memory.
+ *
+ * Memory from bitchat_heap_alloc() must be released with
+ * bitchat_heap_free() and never with free(). Each block carries an 8-byte
+ * header with its size and tag. Building with -DBITCHAT_HEAP_TRACKING=0
+ * turns the wrappers into plain malloc() and free() with no header and no
+ * accounting.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifndef BITCHAT_HEAP_TRACKING
+#define BITCHAT_HEAP_TRACKING 1
+#endif
+
+/**
+ * Subsystems memory is charged to
+ */
+typedef enum {
+    BitchatHeapTagApp, // App state and exit-time snapshots
+    BitchatHeapTagPacket, // Decoded payloads and fragment reassembly
+    BitchatHeapTagMessage,
+    BitchatHeapTagBle,
+    BitchatHeapTagCrypto, // Noise sessions, handshakes, signature batches
+    BitchatHeapTagIdentity,
+    BitchatHeapTagStorage,
+    BitchatHeapTagUi, // Views and the interned names they share
+    BitchatHeapTagCount,
+} BitchatHeapTag;
+
+/**
+ * Usage of one tag
+ */
+typedef struct {
+    uint32_t current; // Bytes held now
+    uint32_t peak; // Most bytes held at once
+    uint32_t allocations; // Allocations made since start
+    uint32_t live; // Allocations not yet freed
+} BitchatHeapStats;
+
+#if BITCHAT_HEAP_TRACKING
+
+/**
+ * Allocate memory charged to a tag
+ * Like malloc(), never returns NULL on the device.
+ */
+void* bitchat_heap_alloc(BitchatHeapTag tag, size_t size);
+
+/**
+ * Free memory from bitchat_heap_alloc(); NULL is ignored
+ */
+void bitchat_heap_free(void* ptr);
+
+#else
+
+#define bitchat_heap_alloc(tag, size) malloc(size)
+#define bitchat_heap_free(ptr) free(ptr)
+
+#endif
+
+/**
+ * Get usage of one tag (all zero when tracking is compiled out)
+ */
+void bitchat_heap_get_stats(BitchatHeapTag tag, BitchatHeapStats* stats);
+
+/**
+ * Log usage per tag and warn about tags still holding memory
+ * @return Number of allocations not freed
+ */
+uint32_t bitchat_heap_report(void);
@@ -0,0 +1,142 @@
+/**
+ * BitChat Logging Implementation
+ */
+
+#include "bitchat_log.h"
+#include "../storage/bitchat_writer.h"
+#include <furi.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "BitchatTrace"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_UTILS
+
+static const char* const trace_formats[BitchatTraceCount] = {
+    [BitchatTracePacketEncoded] = "Encoded packet: type=%lu, ttl=%lu, total=%lu bytes",
+    [BitchatTracePacketDecoded] = "Decoded packet: type=%lu, ttl=%lu, payload=%lu bytes",
+    [BitchatTraceBleBroadcast] = "Broadcasting %lu bytes to %lu peers",
+    [BitchatTraceBleSend] = "Sending to peer %lu: %lu bytes as v%lu",
+    [BitchatTraceBleFragment] = "Fragmenting %lu bytes into %lu+%lu",
+};
+
+// The ring; the slot for the next record is claimed with one atomic add
+static BitchatTraceEntry trace_ring[BITCHAT_TRACE_CAPACITY];
+static uint32_t trace_next;
+
+static void trace_write_u32(uint8_t* buffer, uint32_t value) {
+    for(int i = 0; i < 4; i++) {
+        buffer[i] = (value >> (24 - i * 8)) & 0xFF;
+    }
+}
+
+/**
+ * Record a trace event
+ */
+void bitchat_trace_record(BitchatTraceId id, uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t sequence = __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+    BitchatTraceEntry* entry = &trace_ring[sequence & (BITCHAT_TRACE_CAPACITY - 1)];
+    entry->tick = furi_get_tick();
+    entry->sequence = sequence;
+    entry->id = id;
+    entry->args[0] = a;
+    entry->args[1] = b;
+    entry->args[2] = c;
+}
+
+/**
+ * Copy the ring out, oldest first
+ */
+size_t bitchat_trace_snapshot(BitchatTraceEntry* entries, size_t max_entries) {
+    furi_assert(entries);
+
+    uint32_t next = __atomic_load_n(&trace_next, __ATOMIC_RELAXED);
+    size_t count = next < BITCHAT_TRACE_CAPACITY ? next : BITCHAT_TRACE_CAPACITY;
+    if(count > max_entries) count = max_entries;
+
+    uint32_t first = next - count;
+    for(size_t i = 0; i < count; i++) {
+        entries[i] = trace_ring[(first + i) & (BITCHAT_TRACE_CAPACITY - 1)];
+    }
+    return count;
+}
+
+/**
+ * Format one entry as text
+ */
+int bitchat_trace_format(const BitchatTraceEntry* entry, char* buffer, size_t size) {
+    furi_assert(entry);
+    furi_assert(buffer);
+
+    if(entry->id >= BitchatTraceCount) {
+        return snprintf(buffer, size, "Unknown trace %u", entry->id);
+    }
+    return snprintf(
+        buffer,
+        size,
+        trace_formats[entry->id],
+        (unsigned long)entry->args[0],
+        (unsigned long)entry->args[1],
+        (unsigned long)entry->args[2]);
+}
+
+/**
+ * Format the ring to the log
+ */
+void bitchat_trace_log(void) {
+    BitchatTraceEntry* entries = malloc(sizeof(BitchatTraceEntry) * BITCHAT_TRACE_CAPACITY);
+    size_t count = bitchat_trace_snapshot(entries, BITCHAT_TRACE_CAPACITY);
+
+    char line[96];
+    for(size_t i = 0; i < count; i++) {
+        bitchat_trace_format(&entries[i], line, sizeof(line));
+        BITCHAT_LOG_I(
+            TAG,
+            "#%lu %lu ms: %s",
+            (unsigned long)entries[i].sequence,
+            (unsigned long)((uint64_t)entries[i].tick * 1000 / furi_kernel_get_tick_frequency()),
+            line);
+    }
+    free(entries);
+}
+
+/**
+ * Save the ring in binary through the storage writer
+ */
+bool bitchat_trace_save(BitchatWriter* writer, const char* path) {
+    furi_assert(writer);
+    furi_assert(path);
+
+    BitchatTraceEntry* entries = malloc(sizeof(BitchatTraceEntry) * BITCHAT_TRACE_CAPACITY);
+    size_t count = bitchat_trace_snapshot(entries, BITCHAT_TRACE_CAPACITY);
+
+    // Ticks are saved as milliseconds so the host needs no tick rate
+    size_t size = BITCHAT_TRACE_FILE_HEADER_SIZE + count * BITCHAT_TRACE_ENTRY_SIZE;
+    uint8_t* data = malloc(size);
+    memcpy(data, BITCHAT_TRACE_MAGIC, 4);
+    data[4] = BITCHAT_TRACE_VERSION >> 8;
+    data[5] = BITCHAT_TRACE_VERSION & 0xFF;
+    data[6] = count >> 8;
+    data[7] = count & 0xFF;
+    for(size_t i = 0; i < count; i++) {
+        uint8_t* record = &data[BITCHAT_TRACE_FILE_HEADER_SIZE + i * BITCHAT_TRACE_ENTRY_SIZE];
+        trace_write_u32(
+            &record[0], (uint64_t)entries[i].tick * 1000 / furi_kernel_get_tick_frequency());
+        trace_write_u32(&record[4], entries[i].sequence);
+        record[8] = entries[i].id >> 8;
+        record[9] = entries[i].id & 0xFF;
+        record[10] = 0;
+        record[11] = 0;
+        for(size_t a = 0; a < 3; a++) {
+            trace_write_u32(&record[12 + a * 4], entries[i].args[a]);
+        }
+    }
+    free(entries);
+
+    bool saved = bitchat_writer_replace(writer, path, data, size, NULL, NULL);
+    free(data);
+
+    if(!saved) {
+        BITCHAT_LOG_W(TAG, "Trace not saved to %s", path);
+    }
+    return saved;
+}
@@ -0,0 +1,148 @@
+/**
+ * BitChat Logging
+ * Compile-time log levels per module and a binary trace ring for hot paths
+ *
+ * Each source file names its module next to its TAG:
+ *
+ *     #define TAG "BitchatProtocol"
+ *     #define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_PROTOCOL
+ *
+ * and logs with BITCHAT_LOG_E/W/I/D(TAG, ...) in place of FURI_LOG_*.
+ * A call above its module's level is a constant-false branch: it is
+ * compiled out, arguments and all, but still type-checked. Levels default
+ * to BITCHAT_LOG_LEVEL and can be set per module from the build, e.g.
+ * -DBITCHAT_LOG_LEVEL_BLE=BITCHAT_LOG_LEVEL_DEBUG.
+ *
+ * Per-packet events use BITCHAT_TRACE() instead of text. A trace stores a
+ * format ID, the tick and three raw integers in a fixed ring, with one
+ * atomic increment and no formatting; the ring is formatted later, off the
+ * hot path, by bitchat_trace_log() or, from a saved file, on a host by
+ * tools/bitchat_trace.c.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_LOG_LEVEL_NONE 0
+#define BITCHAT_LOG_LEVEL_ERROR 1
+#define BITCHAT_LOG_LEVEL_WARN 2
+#define BITCHAT_LOG_LEVEL_INFO 3
+#define BITCHAT_LOG_LEVEL_TRACE 4 // Binary trace records
+#define BITCHAT_LOG_LEVEL_DEBUG 5 // Formatted debug text
+
+// Field builds keep traces and drop debug text
+#ifndef BITCHAT_LOG_LEVEL
+#define BITCHAT_LOG_LEVEL BITCHAT_LOG_LEVEL_TRACE
+#endif
+
+#ifndef BITCHAT_LOG_LEVEL_APP
+#define BITCHAT_LOG_LEVEL_APP BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_PROTOCOL
+#define BITCHAT_LOG_LEVEL_PROTOCOL BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_BLE
+#define BITCHAT_LOG_LEVEL_BLE BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_CRYPTO
+#define BITCHAT_LOG_LEVEL_CRYPTO BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_STORAGE
+#define BITCHAT_LOG_LEVEL_STORAGE BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_UI
+#define BITCHAT_LOG_LEVEL_UI BITCHAT_LOG_LEVEL
+#endif
+#ifndef BITCHAT_LOG_LEVEL_UTILS
+#define BITCHAT_LOG_LEVEL_UTILS BITCHAT_LOG_LEVEL
+#endif
+
+#define BITCHAT_LOG_ENABLED(level) (BITCHAT_LOG_MODULE >= (level))
+
+#define BITCHAT_LOG_E(tag, ...)                                                        \
+    do {                                                                               \
+        if(BITCHAT_LOG_ENABLED(BITCHAT_LOG_LEVEL_ERROR)) FURI_LOG_E(tag, __VA_ARGS__); \
+    } while(0)
+#define BITCHAT_LOG_W(tag, ...)                                                       \
+    do {                                                                              \
+        if(BITCHAT_LOG_ENABLED(BITCHAT_LOG_LEVEL_WARN)) FURI_LOG_W(tag, __VA_ARGS__); \
+    } while(0)
+#define BITCHAT_LOG_I(tag, ...)                                                       \
+    do {                                                                              \
+        if(BITCHAT_LOG_ENABLED(BITCHAT_LOG_LEVEL_INFO)) FURI_LOG_I(tag, __VA_ARGS__); \
+    } while(0)
+#define BITCHAT_LOG_D(tag, ...)                                                        \
+    do {                                                                               \
+        if(BITCHAT_LOG_ENABLED(BITCHAT_LOG_LEVEL_DEBUG)) FURI_LOG_D(tag, __VA_ARGS__); \
+    } while(0)
+
+#define BITCHAT_TRACE(id, a, b, c)                                                          \
+    do {                                                                                    \
+        if(BITCHAT_LOG_ENABLED(BITCHAT_LOG_LEVEL_TRACE)) bitchat_trace_record(id, a, b, c); \
+    } while(0)
+
+// Power of two so the ring index wraps with a mask
+#define BITCHAT_TRACE_CAPACITY 64
+#define BITCHAT_TRACE_PATH APP_DATA_PATH("bitchat") "/trace.bin"
+#define BITCHAT_TRACE_MAGIC "BTRC"
+#define BITCHAT_TRACE_VERSION 1
+// magic (4) | version (2) | entry count (2)
+#define BITCHAT_TRACE_FILE_HEADER_SIZE 8
+// tick (4) | sequence (4) | id (2) | reserved (2) | args (3 x 4)
+#define BITCHAT_TRACE_ENTRY_SIZE 24
+
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * Trace events; each has a format in bitchat_log.c taking its three arguments
+ */
+typedef enum {
+    BitchatTracePacketEncoded, // type, ttl, size
+    BitchatTracePacketDecoded, // type, ttl, payload length
+    BitchatTraceBleBroadcast, // size, peers
+    BitchatTraceBleSend, // peer index, size on air, wire version
+    BitchatTraceBleFragment, // frame size, data fragments, repair fragments
+    BitchatTraceCount,
+} BitchatTraceId;
+
+/**
+ * One trace record
+ */
+typedef struct {
+    uint32_t tick;
+    uint32_t sequence; // Position in the trace since the app started
+    uint16_t id;
+    uint32_t args[3];
+} BitchatTraceEntry;
+
+/**
+ * Record a trace event; use BITCHAT_TRACE() so it compiles out with the level
+ */
+void bitchat_trace_record(BitchatTraceId id, uint32_t a, uint32_t b, uint32_t c);
+
+/**
+ * Copy the ring out, oldest first
+ * Entries being written at that moment may be torn; sequence numbers show gaps.
+ * @return Number of entries copied
+ */
+size_t bitchat_trace_snapshot(BitchatTraceEntry* entries, size_t max_entries);
+
+/**
+ * Format one entry as text
+ * @return Length written, as snprintf
+ */
+int bitchat_trace_format(const BitchatTraceEntry* entry, char* buffer, size_t size);
+
+/**
+ * Format the ring to the log, oldest first
+ */
+void bitchat_trace_log(void);
+
+/**
+ * Save the ring in binary through the storage writer, for formatting on a host
+ * @return false if the writer had no room; nothing was written
+ */
+bool bitchat_trace_save(BitchatWriter* writer, const char* path);
@@ -0,0 +1,284 @@
+/**
+ * BitChat Metrics Implementation
+ */
+
+#include "bitchat_metrics.h"
+#include "../storage/bitchat_writer.h"
+#include "bitchat_log.h"
+#include <furi.h>
+#include <furi_hal_cortex.h>
+#include <string.h>
+
+#define TAG "BitchatMetrics"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_UTILS
+#define METRICS_TEXT_SIZE 2048
+
+static const char* const metrics_counter_names[BitchatCounterCount] = {
+    [BitchatCounterEncodeFailed] = "encode_failed",
+    [BitchatCounterDecodeFailed] = "decode_failed",
+    [BitchatCounterLinkDecodeFailed] = "link_decode_failed",
+    [BitchatCounterSendFailed] = "send_failed",
+    [BitchatCounterFragmentsSent] = "fragments_sent",
+    [BitchatCounterFramesReassembled] = "frames_reassembled",
+    [BitchatCounterFramesDropped] = "frames_dropped",
+    [BitchatCounterCryptoFailed] = "crypto_failed",
+    [BitchatCounterCryptoReplays] = "crypto_replays",
+    [BitchatCounterChatFrames] = "chat_frames",
+    [BitchatCounterChatOverruns] = "chat_overruns",
+};
+
+static const char* const metrics_gauge_names[BitchatGaugeCount] = {
+    [BitchatGaugeEventQueueDepth] = "event_queue_depth",
+    [BitchatGaugeEventQueuePeak] = "event_queue_peak",
+    [BitchatGaugeChatStaged] = "chat_staged",
+    [BitchatGaugeHeapFree] = "heap_free",
+    [BitchatGaugeHeapMinFree] = "heap_min_free",
+};
+
+static const char* const metrics_histogram_names[BitchatHistogramCount] = {
+    [BitchatHistogramEncode] = "encode_us",
+    [BitchatHistogramDecode] = "decode_us",
+    [BitchatHistogramSeal] = "seal_us",
+    [BitchatHistogramOpen] = "open_us",
+    [BitchatHistogramChatDraw] = "chat_draw_us",
+};
+
+// Slot 0 is any type not listed
+static const char* const metrics_packet_names[BITCHAT_METRICS_PACKET_TYPES] = {
+    "other",
+    "public",
+    "private",
+    "announce",
+    "sync_request",
+    "sync_response",
+    "handshake",
+    "ack",
+    "resume",
+    "fragment",
+    "transfer_data",
+    "transfer_ack",
+};
+
+// The registry; only ever touched with atomic builtins
+static uint32_t metrics_counters[BitchatCounterCount];
+static uint32_t metrics_gauges[BitchatGaugeCount];
+static uint32_t metrics_packets_rx[BITCHAT_METRICS_PACKET_TYPES];
+static uint32_t metrics_packets_tx[BITCHAT_METRICS_PACKET_TYPES];
+static uint32_t metrics_histograms[BitchatHistogramCount][BITCHAT_METRICS_HISTOGRAM_BUCKETS];
+
+/**
+ * Map a packet type to its slot
+ */
+static size_t metrics_packet_slot(uint8_t type) {
+    if(type >= 0x01 && type <= 0x08) return type;
+    if(type >= 0x20 && type <= 0x22) return type - 0x20 + 9;
+    return 0;
+}
+
+static size_t metrics_histogram_bucket(uint32_t us) {
+    if(us <= 1) return 0;
+    size_t bucket = 31 - __builtin_clz(us);
+    return bucket < BITCHAT_METRICS_HISTOGRAM_BUCKETS ? bucket :
+                                                        BITCHAT_METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Get the upper bound of the bucket holding the given share of samples
+ * @param permille Share in thousandths
+ * @return Bound in microseconds, or UINT32_MAX for the open-ended last bucket
+ */
+static uint32_t metrics_histogram_percentile(const uint32_t* buckets, uint32_t total, uint32_t permille) {
+    uint64_t target = ((uint64_t)total * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BITCHAT_METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if(seen >= target) return (2UL << i) - 1;
+    }
+    return UINT32_MAX;
+}
+
+/**
+ * Add to a counter
+ */
+void bitchat_metrics_add(BitchatCounter counter, uint32_t value) {
+    furi_assert(counter < BitchatCounterCount);
+    __atomic_fetch_add(&metrics_counters[counter], value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Count a packet received or sent
+ */
+void bitchat_metrics_count_packet(bool tx, uint8_t type) {
+    uint32_t* packets = tx ? metrics_packets_tx : metrics_packets_rx;
+    __atomic_fetch_add(&packets[metrics_packet_slot(type)], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Set a gauge
+ */
+void bitchat_metrics_set(BitchatGauge gauge, uint32_t value) {
+    furi_assert(gauge < BitchatGaugeCount);
+    __atomic_store_n(&metrics_gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Raise a gauge to value if it is below it
+ */
+void bitchat_metrics_set_max(BitchatGauge gauge, uint32_t value) {
+    furi_assert(gauge < BitchatGaugeCount);
+    uint32_t current = __atomic_load_n(&metrics_gauges[gauge], __ATOMIC_RELAXED);
+    while(current < value &&
+          !__atomic_compare_exchange_n(
+              &metrics_gauges[gauge], &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Read free heap and its low-water mark
+ */
+void bitchat_metrics_sample_heap(void) {
+    bitchat_metrics_set(BitchatGaugeHeapFree, memmgr_get_free_heap());
+    bitchat_metrics_set(BitchatGaugeHeapMinFree, memmgr_get_minimum_free_heap());
+}
+
+/**
+ * Start timing an operation
+ */
+uint32_t bitchat_metrics_start(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * Record the time since bitchat_metrics_start()
+ */
+void bitchat_metrics_observe(BitchatHistogram histogram, uint32_t start) {
+    furi_assert(histogram < BitchatHistogramCount);
+    uint32_t us = (DWT->CYCCNT - start) / furi_hal_cortex_instructions_per_microsecond();
+    __atomic_fetch_add(
+        &metrics_histograms[histogram][metrics_histogram_bucket(us)], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Copy the registry out
+ */
+void bitchat_metrics_snapshot(BitchatMetricsSnapshot* snapshot) {
+    furi_assert(snapshot);
+
+    snapshot->uptime_ms = furi_get_tick() * 1000 / furi_kernel_get_tick_frequency();
+    for(size_t i = 0; i < BitchatCounterCount; i++) {
+        snapshot->counters[i] = __atomic_load_n(&metrics_counters[i], __ATOMIC_RELAXED);
+    }
+    for(size_t i = 0; i < BitchatGaugeCount; i++) {
+        snapshot->gauges[i] = __atomic_load_n(&metrics_gauges[i], __ATOMIC_RELAXED);
+    }
+    for(size_t i = 0; i < BITCHAT_METRICS_PACKET_TYPES; i++) {
+        snapshot->packets_rx[i] = __atomic_load_n(&metrics_packets_rx[i], __ATOMIC_RELAXED);
+        snapshot->packets_tx[i] = __atomic_load_n(&metrics_packets_tx[i], __ATOMIC_RELAXED);
+    }
+    for(size_t h = 0; h < BitchatHistogramCount; h++) {
+        for(size_t i = 0; i < BITCHAT_METRICS_HISTOGRAM_BUCKETS; i++) {
+            snapshot->histograms[h][i] =
+                __atomic_load_n(&metrics_histograms[h][i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Log a snapshot
+ */
+void bitchat_metrics_log(const BitchatMetricsSnapshot* snapshot) {
+    furi_assert(snapshot);
+
+    BITCHAT_LOG_I(TAG, "Metrics at %lu ms", (unsigned long)snapshot->uptime_ms);
+    for(size_t i = 0; i < BitchatCounterCount; i++) {
+        if(snapshot->counters[i] == 0) continue;
+        BITCHAT_LOG_I(TAG, "  %s: %lu", metrics_counter_names[i], (unsigned long)snapshot->counters[i]);
+    }
+    for(size_t i = 0; i < BitchatGaugeCount; i++) {
+        BITCHAT_LOG_I(TAG, "  %s: %lu", metrics_gauge_names[i], (unsigned long)snapshot->gauges[i]);
+    }
+    for(size_t i = 0; i < BITCHAT_METRICS_PACKET_TYPES; i++) {
+        if(snapshot->packets_rx[i] == 0 && snapshot->packets_tx[i] == 0) continue;
+        BITCHAT_LOG_I(
+            TAG,
+            "  %s: %lu rx, %lu tx",
+            metrics_packet_names[i],
+            (unsigned long)snapshot->packets_rx[i],
+            (unsigned long)snapshot->packets_tx[i]);
+    }
+    for(size_t h = 0; h < BitchatHistogramCount; h++) {
+        const uint32_t* buckets = snapshot->histograms[h];
+        uint32_t total = 0;
+        for(size_t i = 0; i < BITCHAT_METRICS_HISTOGRAM_BUCKETS; i++) {
+            total += buckets[i];
+        }
+        if(total == 0) continue;
+        // Bounds are bucket edges; UINT32_MAX means past the last edge
+        BITCHAT_LOG_I(
+            TAG,
+            "  %s: n=%lu p50<=%lu p99<=%lu",
+            metrics_histogram_names[h],
+            (unsigned long)total,
+            (unsigned long)metrics_histogram_percentile(buckets, total, 500),
+            (unsigned long)metrics_histogram_percentile(buckets, total, 990));
+    }
+}
+
+/**
+ * Write a snapshot as text through the storage writer
+ */
+bool bitchat_metrics_save(
+    const BitchatMetricsSnapshot* snapshot,
+    BitchatWriter* writer,
+    const char* path) {
+    furi_assert(snapshot);
+    furi_assert(writer);
+    furi_assert(path);
+
+    char* text = malloc(METRICS_TEXT_SIZE);
+    size_t length = 0;
+#define METRICS_PRINT(...)                                                                   \
+    do {                                                                                     \
+        if(length < METRICS_TEXT_SIZE) {                                                     \
+            length += snprintf(&text[length], METRICS_TEXT_SIZE - length, __VA_ARGS__); \
+        }                                                                                    \
+    } while(0)
+
+    METRICS_PRINT("uptime_ms %lu\n", (unsigned long)snapshot->uptime_ms);
+    for(size_t i = 0; i < BitchatCounterCount; i++) {
+        METRICS_PRINT(
+            "counter.%s %lu\n", metrics_counter_names[i], (unsigned long)snapshot->counters[i]);
+    }
+    for(size_t i = 0; i < BitchatGaugeCount; i++) {
+        METRICS_PRINT("gauge.%s %lu\n", metrics_gauge_names[i], (unsigned long)snapshot->gauges[i]);
+    }
+    for(size_t i = 0; i < BITCHAT_METRICS_PACKET_TYPES; i++) {
+        METRICS_PRINT(
+            "rx.%s %lu\ntx.%s %lu\n",
+            metrics_packet_names[i],
+            (unsigned long)snapshot->packets_rx[i],
+            metrics_packet_names[i],
+            (unsigned long)snapshot->packets_tx[i]);
+    }
+    for(size_t h = 0; h < BitchatHistogramCount; h++) {
+        METRICS_PRINT("histogram.%s", metrics_histogram_names[h]);
+        for(size_t i = 0; i < BITCHAT_METRICS_HISTOGRAM_BUCKETS; i++) {
+            METRICS_PRINT(" %lu", (unsigned long)snapshot->histograms[h][i]);
+        }
+        METRICS_PRINT("\n");
+    }
+#undef METRICS_PRINT
+
+    bool saved = false;
+    if(length < METRICS_TEXT_SIZE) {
+        saved = bitchat_writer_replace(writer, path, text, length, NULL, NULL);
+    } else {
+        BITCHAT_LOG_E(TAG, "Snapshot does not fit %d bytes", METRICS_TEXT_SIZE);
+    }
+    free(text);
+
+    if(!saved) {
+        BITCHAT_LOG_W(TAG, "Snapshot not saved to %s", path);
+    }
+    return saved;
+}
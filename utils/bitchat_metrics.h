@@ -0,0 +1,134 @@
+/**
+ * BitChat Metrics
+ * Counters, gauges and latency histograms for the whole stack
+ *
+ * Every metric is registered statically in the enums below, so recording
+ * is one relaxed atomic update on a fixed slot: no lookup, no lock and no
+ * allocation, cheap enough to stay on in release builds and safe from any
+ * thread. Snapshots copy the registry out for the log or a file.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Log2 microsecond buckets: 0-1, 2-3, 4-7, ... , >= 32768
+#define BITCHAT_METRICS_HISTOGRAM_BUCKETS 16
+// Known packet types get a slot each; anything else is counted in slot 0
+#define BITCHAT_METRICS_PACKET_TYPES 12
+#define BITCHAT_METRICS_PATH APP_DATA_PATH("bitchat") "/metrics.txt"
+
+typedef struct BitchatWriter BitchatWriter;
+
+/**
+ * Event counters
+ */
+typedef enum {
+    BitchatCounterEncodeFailed,
+    BitchatCounterDecodeFailed,
+    BitchatCounterLinkDecodeFailed, // Compact or aliased frame that did not expand
+    BitchatCounterSendFailed, // Radio down, unknown peer or frame too large
+    BitchatCounterFragmentsSent,
+    BitchatCounterFramesReassembled,
+    BitchatCounterFramesDropped, // Routed nowhere from the header alone
+    BitchatCounterCryptoFailed, // Transport message that did not authenticate
+    BitchatCounterCryptoReplays,
+    BitchatCounterChatFrames,
+    BitchatCounterChatOverruns, // Messages dropped from chat view staging
+    BitchatCounterCount,
+} BitchatCounter;
+
+/**
+ * Sampled levels
+ */
+typedef enum {
+    BitchatGaugeEventQueueDepth,
+    BitchatGaugeEventQueuePeak,
+    BitchatGaugeChatStaged, // Messages waiting for the next chat frame
+    BitchatGaugeHeapFree,
+    BitchatGaugeHeapMinFree, // Low-water mark since boot
+    BitchatGaugeCount,
+} BitchatGauge;
+
+/**
+ * Latency histograms
+ */
+typedef enum {
+    BitchatHistogramEncode,
+    BitchatHistogramDecode,
+    BitchatHistogramSeal,
+    BitchatHistogramOpen,
+    BitchatHistogramChatDraw,
+    BitchatHistogramCount,
+} BitchatHistogram;
+
+/**
+ * Copy of the registry at one moment
+ */
+typedef struct {
+    uint32_t uptime_ms;
+    uint32_t counters[BitchatCounterCount];
+    uint32_t gauges[BitchatGaugeCount];
+    uint32_t packets_rx[BITCHAT_METRICS_PACKET_TYPES];
+    uint32_t packets_tx[BITCHAT_METRICS_PACKET_TYPES];
+    uint32_t histograms[BitchatHistogramCount][BITCHAT_METRICS_HISTOGRAM_BUCKETS];
+} BitchatMetricsSnapshot;
+
+/**
+ * Add to a counter
+ */
+void bitchat_metrics_add(BitchatCounter counter, uint32_t value);
+
+/**
+ * Count a packet received or sent, by type
+ * @param type BitchatPacketType
+ */
+void bitchat_metrics_count_packet(bool tx, uint8_t type);
+
+/**
+ * Set a gauge
+ */
+void bitchat_metrics_set(BitchatGauge gauge, uint32_t value);
+
+/**
+ * Raise a gauge to value if it is below it (peaks)
+ */
+void bitchat_metrics_set_max(BitchatGauge gauge, uint32_t value);
+
+/**
+ * Read free heap and its low-water mark into their gauges
+ */
+void bitchat_metrics_sample_heap(void);
+
+/**
+ * Start timing an operation
+ * @return Opaque start time for bitchat_metrics_observe()
+ */
+uint32_t bitchat_metrics_start(void);
+
+/**
+ * Record the time since bitchat_metrics_start() in a histogram
+ */
+void bitchat_metrics_observe(BitchatHistogram histogram, uint32_t start);
+
+/**
+ * Copy the registry out
+ * Each value is read atomically; values are not read at one instant.
+ */
+void bitchat_metrics_snapshot(BitchatMetricsSnapshot* snapshot);
+
+/**
+ * Log a snapshot: non-zero counters, gauges and histogram percentiles
+ */
+void bitchat_metrics_log(const BitchatMetricsSnapshot* snapshot);
+
+/**
+ * Write a snapshot as text, one metric per line, through the storage writer
+ * @return false if the writer had no room; nothing was written
+ */
+bool bitchat_metrics_save(
+    const BitchatMetricsSnapshot* snapshot,
+    BitchatWriter* writer,
+    const char* path);
@@ -0,0 +1,154 @@
+/**
+ * BitChat Name Table Implementation
+ */
+
+#include "bitchat_names.h"
+#include "bitchat_log.h"
+#include "bitchat_heap.h"
+#include <furi.h>
+#include <string.h>
+
+#define TAG "BitchatNames"
+#define BITCHAT_LOG_MODULE BITCHAT_LOG_LEVEL_UTILS
+
+typedef struct {
+    char name[BITCHAT_NAME_MAX + 1];
+    uint16_t refs; // 0 for a free slot
+    uint8_t hash; // Checked before comparing names
+} NamesEntry;
+
+struct BitchatNames {
+    FuriMutex* mutex;
+    // Handle h is entries[h - 1]
+    NamesEntry entries[BITCHAT_NAMES_CAPACITY];
+    BitchatNamesStats stats;
+};
+
+static uint8_t names_hash(const char* name, size_t length) {
+    uint32_t hash = 2166136261UL;
+    for(size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619UL;
+    }
+    return (hash >> 24) ^ (hash & 0xFF);
+}
+
+/**
+ * Allocate an empty name table
+ */
+BitchatNames* bitchat_names_alloc(void) {
+    BitchatNames* names = bitchat_heap_alloc(BitchatHeapTagUi, sizeof(BitchatNames));
+    memset(names, 0, sizeof(BitchatNames));
+    names->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    return names;
+}
+
+/**
+ * Free the name table
+ */
+void bitchat_names_free(BitchatNames* names) {
+    furi_assert(names);
+    BITCHAT_LOG_I(
+        TAG,
+        "Names: %lu held, peak %lu, %lu turned away",
+        (unsigned long)names->stats.count,
+        (unsigned long)names->stats.peak,
+        (unsigned long)names->stats.failures);
+    furi_mutex_free(names->mutex);
+    bitchat_heap_free(names);
+}
+
+/**
+ * Take a reference to a name, adding it if new
+ */
+BitchatName bitchat_names_acquire(BitchatNames* names, const char* name) {
+    furi_assert(names);
+    furi_assert(name);
+
+    size_t length = strnlen(name, BITCHAT_NAME_MAX);
+    uint8_t hash = names_hash(name, length);
+    size_t free_slot = BITCHAT_NAMES_CAPACITY;
+    BitchatName handle = BITCHAT_NAME_NONE;
+
+    furi_mutex_acquire(names->mutex, FuriWaitForever);
+    for(size_t i = 0; i < BITCHAT_NAMES_CAPACITY; i++) {
+        NamesEntry* entry = &names->entries[i];
+        if(entry->refs == 0) {
+            if(free_slot == BITCHAT_NAMES_CAPACITY) free_slot = i;
+        } else if(
+            entry->hash == hash && strncmp(entry->name, name, length) == 0 &&
+            entry->name[length] == '\0') {
+            handle = i + 1;
+            break;
+        }
+    }
+
+    if(handle != BITCHAT_NAME_NONE) {
+        names->entries[handle - 1].refs++;
+    } else if(free_slot < BITCHAT_NAMES_CAPACITY) {
+        NamesEntry* entry = &names->entries[free_slot];
+        memcpy(entry->name, name, length);
+        entry->name[length] = '\0';
+        entry->hash = hash;
+        entry->refs = 1;
+        handle = free_slot + 1;
+        names->stats.count++;
+        if(names->stats.count > names->stats.peak) names->stats.peak = names->stats.count;
+    } else {
+        names->stats.failures++;
+        BITCHAT_LOG_W(TAG, "Table full, %s shows as ?", name);
+    }
+    furi_mutex_release(names->mutex);
+
+    return handle;
+}
+
+/**
+ * Take another reference to a held name
+ */
+void bitchat_names_retain(BitchatNames* names, BitchatName handle) {
+    furi_assert(names);
+    if(handle == BITCHAT_NAME_NONE) return;
+
+    furi_mutex_acquire(names->mutex, FuriWaitForever);
+    furi_assert(names->entries[handle - 1].refs > 0);
+    names->entries[handle - 1].refs++;
+    furi_mutex_release(names->mutex);
+}
+
+/**
+ * Drop a reference
+ */
+void bitchat_names_release(BitchatNames* names, BitchatName handle) {
+    furi_assert(names);
+    if(handle == BITCHAT_NAME_NONE) return;
+
+    furi_mutex_acquire(names->mutex, FuriWaitForever);
+    NamesEntry* entry = &names->entries[handle - 1];
+    furi_assert(entry->refs > 0);
+    if(--entry->refs == 0) {
+        entry->name[0] = '\0';
+        names->stats.count--;
+    }
+    furi_mutex_release(names->mutex);
+}
+
+/**
+ * Get a name's text
+ */
+const char* bitchat_names_get(BitchatNames* names, BitchatName handle) {
+    furi_assert(names);
+    if(handle == BITCHAT_NAME_NONE || handle > BITCHAT_NAMES_CAPACITY) return "?";
+    return names->entries[handle - 1].name;
+}
+
+/**
+ * Get name table statistics
+ */
+void bitchat_names_get_stats(BitchatNames* names, BitchatNamesStats* stats) {
+    furi_assert(names);
+    furi_assert(stats);
+
+    furi_mutex_acquire(names->mutex, FuriWaitForever);
+    *stats = names->stats;
+    furi_mutex_release(names->mutex);
+}
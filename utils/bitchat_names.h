@@ -0,0 +1,72 @@
+/**
+ * BitChat Name Table
+ * Interned nicknames shared by the views
+ *
+ * A room usually has a handful of distinct speakers, so messages held in
+ * RAM keep a 1-byte handle instead of a 32-byte name. Each name is stored
+ * once with a reference count and its slot is freed when the last message
+ * naming it goes away.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BITCHAT_NAMES_CAPACITY 48
+#define BITCHAT_NAME_MAX 31
+#define BITCHAT_NAME_NONE 0 // No name, or the table was full
+
+typedef struct BitchatNames BitchatNames;
+typedef uint8_t BitchatName;
+
+/**
+ * Name table statistics
+ */
+typedef struct {
+    uint32_t count; // Names held now
+    uint32_t peak;
+    uint32_t failures; // Acquires turned away with the table full
+} BitchatNamesStats;
+
+/**
+ * Allocate an empty name table
+ */
+BitchatNames* bitchat_names_alloc(void);
+
+/**
+ * Free the name table
+ */
+void bitchat_names_free(BitchatNames* names);
+
+/**
+ * Take a reference to a name, adding it if new
+ * Names longer than BITCHAT_NAME_MAX are truncated.
+ * @param names Name table
+ * @param name Nickname
+ * @return Handle, or BITCHAT_NAME_NONE if the table is full
+ */
+BitchatName bitchat_names_acquire(BitchatNames* names, const char* name);
+
+/**
+ * Take another reference to a held name
+ */
+void bitchat_names_retain(BitchatNames* names, BitchatName handle);
+
+/**
+ * Drop a reference; the name is freed with its last one
+ */
+void bitchat_names_release(BitchatNames* names, BitchatName handle);
+
+/**
+ * Get a name's text
+ * Stays valid while the caller holds a reference. Never blocks.
+ * @return The name, or "?" for BITCHAT_NAME_NONE
+ */
+const char* bitchat_names_get(BitchatNames* names, BitchatName handle);
+
+/**
+ * Get name table statistics
+ */
+void bitchat_names_get_stats(BitchatNames* names, BitchatNamesStats* stats);